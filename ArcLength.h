@@ -0,0 +1,239 @@
+#pragma once
+#include "Curve.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// 1区間あたりの弧長テーブルの標本数
+static const uint32_t kArcLengthSamplesPerSpan = 32;
+// 弧長から媒介変数への近似に使うChebyshev多項式の項数
+static const uint32_t kArcLengthChebyshevTerms = 16;
+
+/// <summary>
+/// 弧長テーブル
+/// 曲線区間を並べた経路について、媒介変数 u (区間番号 + 区間内の t) と累積弧長の対応を持つ
+/// </summary>
+struct ArcLengthTable {
+	uint32_t spanCount = 0;			// 区間の数
+	uint32_t samplesPerSpan = 0;	// 1区間あたりの標本数
+	std::vector<float> lengths;		// 累積弧長 (u = i / samplesPerSpan での値)
+	float chebyshev[kArcLengthChebyshevTerms] = {}; // 正規化した弧長から u への近似係数
+};
+
+/// <summary>
+/// 曲線区間の一部の弧長を求める(5点Gauss-Legendre積分)
+/// </summary>
+/// <param name="span">曲線区間</param>
+/// <param name="t0">開始位置</param>
+/// <param name="t1">終了位置</param>
+float IntegrateCurveSpanLength(const CurveSpan& span, float t0, float t1) {
+	static const float kNodes[5] = { 0.0f, -0.5384693101f, 0.5384693101f, -0.9061798459f, 0.9061798459f };
+	static const float kWeights[5] = { 0.5688888889f, 0.4786286705f, 0.4786286705f, 0.2369268851f, 0.2369268851f };
+	float halfRange = 0.5f * (t1 - t0);
+	float center = 0.5f * (t0 + t1);
+	float sum = 0.0f;
+	for (int i = 0; i < 5; ++i) {
+		sum += kWeights[i] * Length(EvaluateCurveSpanDerivative(span, center + halfRange * kNodes[i]));
+	}
+	return sum * halfRange;
+}
+
+/// <summary>
+/// 経路全体の長さ
+/// </summary>
+/// <param name="table">弧長テーブル</param>
+float ArcLengthTotal(const ArcLengthTable& table) {
+	return table.lengths.empty() ? 0.0f : table.lengths.back();
+}
+
+/// <summary>
+/// 弧長から媒介変数 u を求める(二分探索 + 線形補間、O(log n))
+/// </summary>
+/// <param name="table">弧長テーブル</param>
+/// <param name="distance">始点からの距離</param>
+/// <returns>媒介変数 u (0 ~ spanCount)</returns>
+float ArcLengthToParameter(const ArcLengthTable& table, float distance) {
+	if (table.lengths.size() < 2 || distance <= 0.0f) { return 0.0f; }
+	if (distance >= table.lengths.back()) { return float(table.spanCount); }
+
+	// distance を超える最初の標本
+	size_t upper = std::upper_bound(table.lengths.begin(), table.lengths.end(), distance) - table.lengths.begin();
+	size_t lower = upper - 1;
+	float s0 = table.lengths[lower];
+	float s1 = table.lengths[upper];
+	float ratio = s1 > s0 ? (distance - s0) / (s1 - s0) : 0.0f;
+	return (float(lower) + ratio) / float(table.samplesPerSpan);
+}
+
+/// <summary>
+/// 弧長から媒介変数 u を求める(Chebyshev近似、O(1))
+/// テーブルより精度は落ちるが、分岐もメモリアクセスもほぼない
+/// </summary>
+/// <param name="table">弧長テーブル</param>
+/// <param name="distance">始点からの距離</param>
+/// <returns>媒介変数 u (0 ~ spanCount)</returns>
+float ArcLengthToParameterChebyshev(const ArcLengthTable& table, float distance) {
+	float total = ArcLengthTotal(table);
+	if (total <= 0.0f) { return 0.0f; }
+	// [0, total] を [-1, 1] に写してClenshaw法で評価
+	float x = std::clamp(2.0f * distance / total - 1.0f, -1.0f, 1.0f);
+	float b1 = 0.0f;
+	float b2 = 0.0f;
+	for (int j = int(kArcLengthChebyshevTerms) - 1; j >= 1; --j) {
+		float b0 = 2.0f * x * b1 - b2 + table.chebyshev[j];
+		b2 = b1;
+		b1 = b0;
+	}
+	float u = x * b1 - b2 + 0.5f * table.chebyshev[0];
+	return std::clamp(u, 0.0f, float(table.spanCount));
+}
+
+/// <summary>
+/// 媒介変数 u から経路上の点を求める
+/// </summary>
+/// <param name="spans">曲線区間の配列</param>
+/// <param name="spanCount">曲線区間の数</param>
+/// <param name="u">媒介変数(0 ~ spanCount)</param>
+/// <returns>経路上の点(区間が無ければ原点)</returns>
+Vector3 EvaluateCurvePath(const CurveSpan* spans, uint32_t spanCount, float u) {
+	if (spanCount == 0) { return { 0.0f, 0.0f, 0.0f }; }
+	uint32_t index = u <= 0.0f ? 0 : uint32_t(u);
+	if (index >= spanCount) {
+		index = spanCount - 1;
+	}
+	return EvaluateCurveSpan(spans[index], u - float(index));
+}
+
+/// <summary>
+/// 弧長テーブルを作成
+/// </summary>
+/// <param name="spans">曲線区間の配列</param>
+/// <param name="spanCount">曲線区間の数</param>
+/// <param name="samplesPerSpan">1区間あたりの標本数</param>
+ArcLengthTable BuildArcLengthTable(const CurveSpan* spans, uint32_t spanCount, uint32_t samplesPerSpan = kArcLengthSamplesPerSpan) {
+	ArcLengthTable table;
+	table.spanCount = spanCount;
+	table.samplesPerSpan = samplesPerSpan;
+	if (spanCount == 0 || samplesPerSpan == 0) {
+		return table;
+	}
+
+	// 累積弧長
+	table.lengths.resize(size_t(spanCount) * samplesPerSpan + 1);
+	table.lengths[0] = 0.0f;
+	float total = 0.0f;
+	const float step = 1.0f / float(samplesPerSpan);
+	for (uint32_t spanIndex = 0; spanIndex < spanCount; ++spanIndex) {
+		for (uint32_t i = 0; i < samplesPerSpan; ++i) {
+			total += IntegrateCurveSpanLength(spans[spanIndex], step * float(i), step * float(i + 1));
+			table.lengths[size_t(spanIndex) * samplesPerSpan + i + 1] = total;
+		}
+	}
+
+	// Chebyshev節点で u(s) を標本化して係数を求める
+	const float kPi = 3.14159265358979f;
+	const uint32_t n = kArcLengthChebyshevTerms;
+	float values[kArcLengthChebyshevTerms];
+	for (uint32_t k = 0; k < n; ++k) {
+		float x = std::cos(kPi * (float(k) + 0.5f) / float(n));
+		values[k] = ArcLengthToParameter(table, 0.5f * (x + 1.0f) * total);
+	}
+	for (uint32_t j = 0; j < n; ++j) {
+		float sum = 0.0f;
+		for (uint32_t k = 0; k < n; ++k) {
+			sum += values[k] * std::cos(kPi * float(j) * (float(k) + 0.5f) / float(n));
+		}
+		table.chebyshev[j] = 2.0f * sum / float(n);
+	}
+	return table;
+}
+
+/// <summary>
+/// 複数の追従者の位置をまとめて求める
+/// </summary>
+/// <param name="table">弧長テーブル</param>
+/// <param name="spans">曲線区間の配列</param>
+/// <param name="distances">各追従者の始点からの距離</param>
+/// <param name="count">追従者の数</param>
+/// <param name="positions">位置の出力先</param>
+void SampleCurvePathByDistance(const ArcLengthTable& table, const CurveSpan* spans,
+	const float* distances, size_t count, Vector3* positions) {
+	if (table.lengths.size() < 2) { return; }
+	const float* begin = table.lengths.data();
+	const float* end = begin + table.lengths.size();
+	const float total = table.lengths.back();
+	const float step = 1.0f / float(table.samplesPerSpan);
+
+	for (size_t i = 0; i < count; ++i) {
+		float distance = std::clamp(distances[i], 0.0f, total);
+		size_t upper = std::upper_bound(begin, end, distance) - begin;
+		if (upper >= table.lengths.size()) {
+			upper = table.lengths.size() - 1;
+		}
+		size_t lower = upper - 1;
+		float s0 = begin[lower];
+		float s1 = begin[upper];
+		float ratio = s1 > s0 ? (distance - s0) / (s1 - s0) : 0.0f;
+
+		// 区間番号と区間内の t に分けて評価
+		uint32_t spanIndex = uint32_t(lower / table.samplesPerSpan);
+		float t = (float(lower % table.samplesPerSpan) + ratio) * step;
+		positions[i] = EvaluateCurveSpan(spans[spanIndex], t);
+	}
+}
+
+/// <summary>
+/// 弧長テーブルのキャッシュ
+/// 同じ制御点(から作った曲線区間)なら積分をやり直さずに使い回す
+/// </summary>
+class ArcLengthCache {
+public:
+	/// <summary>
+	/// 弧長テーブルを取得(なければ作成)
+	/// </summary>
+	/// <param name="spans">曲線区間の配列</param>
+	/// <param name="spanCount">曲線区間の数</param>
+	const ArcLengthTable& Get(const CurveSpan* spans, uint32_t spanCount) {
+		uint64_t key = Hash(spans, spanCount);
+		auto range = entries_.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it) {
+			// ハッシュの衝突に備えて中身も比較する
+			const Entry& entry = it->second;
+			if (entry.spans.size() == spanCount &&
+				std::memcmp(entry.spans.data(), spans, sizeof(CurveSpan) * spanCount) == 0) {
+				return entry.table;
+			}
+		}
+		Entry entry;
+		entry.spans.assign(spans, spans + spanCount);
+		entry.table = BuildArcLengthTable(spans, spanCount);
+		return entries_.emplace(key, std::move(entry))->second.table;
+	}
+
+	// キャッシュを空にする
+	void Clear() { entries_.clear(); }
+
+	// キャッシュされているテーブルの数
+	size_t Size() const { return entries_.size(); }
+
+private:
+	struct Entry {
+		std::vector<CurveSpan> spans;
+		ArcLengthTable table;
+	};
+
+	// FNV-1a
+	static uint64_t Hash(const CurveSpan* spans, uint32_t spanCount) {
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(spans);
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < sizeof(CurveSpan) * spanCount; ++i) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::unordered_multimap<uint64_t, Entry> entries_;
+};
\ No newline at end of file
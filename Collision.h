@@ -0,0 +1,476 @@
+#pragma once
+#include "Distance.h"
+#include "Shape.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/// <summary>
+/// 衝突の詳細
+/// normal は相手(平面・三角形・AABB、AABB同士なら1つ目)の面の法線で、線・球・2つ目のAABBの側を向く
+/// </summary>
+struct Contact {
+	bool hit;			// 衝突しているか
+	float t;			// 線の媒介変数(線以外は0)
+	Vector3 point;		// 衝突点
+	Vector3 normal;		// 衝突面の法線(単位ベクトル)
+	float penetration;	// めり込み量(線は0)
+};
+
+// ---- 判定本体 ----
+// 当たっているかどうかはスカラー型 T のテンプレートで1か所に書き、下の float 版の CheckCollision/GetContact と
+// LaneCollision.h の一括版(T = Float4/Float8 で4~8組をまとめて判定し、結果はレーンごとのマスク)の両方から使う
+// T = double は精度が必要なオフライン計算用
+// float の Shape を渡すと非テンプレート版が優先されるので、こちらを直接使うときは <T> を明示する
+
+// 球同士
+template<typename T>
+LaneMask<T> CheckCollision(const SphereT<T>& sphere1, const SphereT<T>& sphere2) {
+	Vector3T<T> diff = Subtract(sphere2.center, sphere1.center);
+	T radiusSum = sphere1.radius + sphere2.radius;
+	return Dot(diff, diff) <= radiusSum * radiusSum;
+}
+
+// 球と平面
+template<typename T>
+LaneMask<T> CheckCollision(const SphereT<T>& sphere, const PlaneT<T>& plane) {
+	// 平面と点の距離
+	T k = Abs(Dot(plane.normal, sphere.center) - plane.distance);
+	return k <= sphere.radius;
+}
+
+// AABB同士
+template<typename T>
+LaneMask<T> CheckCollision(const AABBT<T>& aabb1, const AABBT<T>& aabb2) {
+	return (aabb1.min.x <= aabb2.max.x) & (aabb1.max.x >= aabb2.min.x) &
+		(aabb1.min.y <= aabb2.max.y) & (aabb1.max.y >= aabb2.min.y) &
+		(aabb1.min.z <= aabb2.max.z) & (aabb1.max.z >= aabb2.min.z);
+}
+
+// AABBと球
+template<typename T>
+LaneMask<T> CheckCollision(const AABBT<T>& aabb, const SphereT<T>& sphere) {
+	// 最近接点
+	Vector3T<T> closestPoint = Min(Max(sphere.center, aabb.min), aabb.max);
+	Vector3T<T> toCenter = Subtract(sphere.center, closestPoint);
+	// 平方根を取らずに半径の2乗と比べる
+	return (Dot(toCenter, toCenter) <= sphere.radius * sphere.radius) & (sphere.radius >= T(0));
+}
+
+/// <summary>
+/// 線と三角形の交差(Segment/Line/Rayの共通部分)
+/// 内外判定は符号だけ見るので法線は正規化しない
+/// </summary>
+/// <param name="t">交点の媒介変数の出力</param>
+/// <param name="normal">三角形の法線(正規化していない)の出力</param>
+template<typename T>
+LaneMask<T> IntersectLineTriangle(const TriangleT<T>& triangle, const Vector3T<T>& origin, const Vector3T<T>& diff, const T& tLower, const T& tUpper,
+	T& t, Vector3T<T>& normal) {
+	Vector3T<T> v01 = Subtract(triangle.vertices[1], triangle.vertices[0]);
+	Vector3T<T> v12 = Subtract(triangle.vertices[2], triangle.vertices[1]);
+	Vector3T<T> v20 = Subtract(triangle.vertices[0], triangle.vertices[2]);
+	normal = Cross(v01, v12);
+
+	// 衝突点(平行なら t が inf/NaN になり、下の比較がすべて偽になる)
+	t = Dot(Subtract(triangle.vertices[0], origin), normal) / Dot(diff, normal);
+	Vector3T<T> p = Add(origin, Multiply(t, diff));
+
+	// 衝突点が三角形の内側か(すべての小三角形のクロス積と法線が同じ向き)
+	T d01 = Dot(Cross(v01, Subtract(p, triangle.vertices[1])), normal);
+	T d12 = Dot(Cross(v12, Subtract(p, triangle.vertices[2])), normal);
+	T d20 = Dot(Cross(v20, Subtract(p, triangle.vertices[0])), normal);
+	return (tLower <= t) & (t <= tUpper) & (d01 >= T(0)) & (d12 >= T(0)) & (d20 >= T(0));
+}
+
+template<typename T>
+LaneMask<T> CheckLineTriangle(const TriangleT<T>& triangle, const Vector3T<T>& origin, const Vector3T<T>& diff, const T& tLower, const T& tUpper) {
+	T t;
+	Vector3T<T> normal;
+	return IntersectLineTriangle(triangle, origin, diff, tLower, tUpper, t, normal);
+}
+
+/// <summary>
+/// 線とAABBの交差(Segment/Line/Rayの共通部分)
+/// </summary>
+/// <param name="tNear">軸ごとの入る側の面の媒介変数の出力</param>
+/// <param name="tEnter">AABBに入る媒介変数の出力</param>
+/// <param name="tExit">AABBから出る媒介変数の出力</param>
+template<typename T>
+LaneMask<T> IntersectLineAABB(const AABBT<T>& aabb, const Vector3T<T>& origin, const Vector3T<T>& diff, const T& tLower, const T& tUpper,
+	Vector3T<T>& tNear, T& tEnter, T& tExit) {
+	// 各平面の媒介変数
+	Vector3T<T> tMin = {
+		(aabb.min.x - origin.x) / diff.x,
+		(aabb.min.y - origin.y) / diff.y,
+		(aabb.min.z - origin.z) / diff.z
+	};
+	Vector3T<T> tMax = {
+		(aabb.max.x - origin.x) / diff.x,
+		(aabb.max.y - origin.y) / diff.y,
+		(aabb.max.z - origin.z) / diff.z
+	};
+	tNear = Min(tMin, tMax);
+	Vector3T<T> tFar = Max(tMin, tMax);
+
+	// 衝突(貫通)している範囲
+	tEnter = Max(Max(tNear.x, tNear.y), tNear.z);
+	tExit = Min(Min(tFar.x, tFar.y), tFar.z);
+	return (tEnter <= tExit) & (tLower <= tExit) & (tEnter <= tUpper);
+}
+
+template<typename T>
+LaneMask<T> CheckLineAABB(const AABBT<T>& aabb, const Vector3T<T>& origin, const Vector3T<T>& diff, const T& tLower, const T& tUpper) {
+	Vector3T<T> tNear;
+	T tEnter;
+	T tExit;
+	return IntersectLineAABB(aabb, origin, diff, tLower, tUpper, tNear, tEnter, tExit);
+}
+
+template<typename T>
+LaneMask<T> CheckCollision(const TriangleT<T>& triangle, const SegmentT<T>& segment) {
+	return CheckLineTriangle(triangle, segment.origin, segment.diff, T(0.0f), T(1.0f));
+}
+
+template<typename T>
+LaneMask<T> CheckCollision(const TriangleT<T>& triangle, const LineT<T>& line) {
+	return CheckLineTriangle(triangle, line.origin, line.diff,
+		T(-(std::numeric_limits<float>::infinity)()), T((std::numeric_limits<float>::infinity)()));
+}
+
+template<typename T>
+LaneMask<T> CheckCollision(const TriangleT<T>& triangle, const RayT<T>& ray) {
+	return CheckLineTriangle(triangle, ray.origin, ray.diff, T(0.0f), T((std::numeric_limits<float>::infinity)()));
+}
+
+template<typename T>
+LaneMask<T> CheckCollision(const AABBT<T>& aabb, const SegmentT<T>& segment) {
+	return CheckLineAABB(aabb, segment.origin, segment.diff, T(0.0f), T(1.0f));
+}
+
+template<typename T>
+LaneMask<T> CheckCollision(const AABBT<T>& aabb, const LineT<T>& line) {
+	return CheckLineAABB(aabb, line.origin, line.diff,
+		T(-(std::numeric_limits<float>::infinity)()), T((std::numeric_limits<float>::infinity)()));
+}
+
+template<typename T>
+LaneMask<T> CheckCollision(const AABBT<T>& aabb, const RayT<T>& ray) {
+	return CheckLineAABB(aabb, ray.origin, ray.diff, T(0.0f), T((std::numeric_limits<float>::infinity)()));
+}
+
+// ---- 分離軸判定(OBB) ----
+
+/// <summary>
+/// OBB同士を15本の分離軸(面の法線6本 + 辺の組の外積9本)で総当たりに調べ、一番離れている軸での隙間を求める
+/// 正なら離れていて、負ならその大きさがめり込み量(軸に沿った最小の押し出し量)
+/// GJK/EPA(Gjk.h)の結果を確かめる基準にする
+/// </summary>
+/// <param name="obb1">OBB1</param>
+/// <param name="obb2">OBB2</param>
+/// <param name="separatingAxis">一番離れている軸の出力(obb1 から obb2 へ向く単位ベクトル、nullptr可)</param>
+float GetSeparationSat(const OBB& obb1, const OBB& obb2, Vector3* separatingAxis = nullptr) {
+	Vector3 axes[15];
+	int axisCount = 0;
+	for (int i = 0; i < 3; ++i) {
+		axes[axisCount++] = obb1.orientations[i];
+		axes[axisCount++] = obb2.orientations[i];
+	}
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			Vector3 cross = Cross(obb1.orientations[i], obb2.orientations[j]);
+			// 平行な辺の組は面の法線で調べ済み
+			float lengthSquared = Dot(cross, cross);
+			if (lengthSquared > 1.0e-6f) {
+				axes[axisCount++] = Multiply(1.0f / std::sqrt(lengthSquared), cross);
+			}
+		}
+	}
+
+	auto getRadius = [](const OBB& obb, const Vector3& axis) {
+		return std::fabs(Dot(obb.orientations[0], axis)) * obb.size.x +
+			std::fabs(Dot(obb.orientations[1], axis)) * obb.size.y +
+			std::fabs(Dot(obb.orientations[2], axis)) * obb.size.z;
+	};
+	Vector3 centerDiff = Subtract(obb2.center, obb1.center);
+	float bestSeparation = -(std::numeric_limits<float>::max)();
+	Vector3 bestAxis = { 0.0f, 1.0f, 0.0f };
+	for (int i = 0; i < axisCount; ++i) {
+		float distance = Dot(centerDiff, axes[i]);
+		float separation = std::fabs(distance) - (getRadius(obb1, axes[i]) + getRadius(obb2, axes[i]));
+		if (separation > bestSeparation) {
+			bestSeparation = separation;
+			bestAxis = distance >= 0.0f ? axes[i] : Multiply(-1.0f, axes[i]);
+		}
+	}
+	if (separatingAxis) { *separatingAxis = bestAxis; }
+	return bestSeparation;
+}
+
+// OBB同士の衝突判定(分離軸判定の総当たり)
+bool CheckCollisionSat(const OBB& obb1, const OBB& obb2) { return GetSeparationSat(obb1, obb2) <= 0.0f; }
+
+// ---- 衝突の詳細 ----
+
+/// <summary>
+/// 線と平面の交点を求める(Segment/Line/Rayの共通部分)
+/// </summary>
+/// <param name="origin">始点</param>
+/// <param name="diff">方向(終点 - 始点)</param>
+/// <param name="plane">平面</param>
+/// <param name="tLower">tの下限</param>
+/// <param name="tUpper">tの上限</param>
+Contact GetLinePlaneContact(const Vector3& origin, const Vector3& diff, const Plane& plane, float tLower, float tUpper) {
+	Contact contact = {};
+	// 法線と線の内積
+	float dot = Dot(plane.normal, diff);
+	if (dot == 0.0f) { return contact; } // 平行な場合衝突しない
+
+	float t = (plane.distance - Dot(origin, plane.normal)) / dot;
+	if (t < tLower || tUpper < t) { return contact; }
+
+	contact.hit = true;
+	contact.t = t;
+	contact.point = Add(origin, Multiply(t, diff));
+	contact.normal = dot < 0.0f ? plane.normal : Multiply(-1.0f, plane.normal); // 線の来る側へ向ける
+	return contact;
+}
+
+/// <summary>
+/// 線と三角形の交点を求める(Segment/Line/Rayの共通部分)
+/// </summary>
+/// <param name="triangle">三角形</param>
+/// <param name="origin">始点</param>
+/// <param name="diff">方向(終点 - 始点)</param>
+/// <param name="tLower">tの下限</param>
+/// <param name="tUpper">tの上限</param>
+Contact GetLineTriangleContact(const Triangle& triangle, const Vector3& origin, const Vector3& diff, float tLower, float tUpper) {
+	Contact contact = {};
+	float t;
+	Vector3 normal;
+	if (!IntersectLineTriangle<float>(triangle, origin, diff, tLower, tUpper, t, normal)) { return contact; }
+
+	normal = Normalize(normal);
+	contact.hit = true;
+	contact.t = t;
+	contact.point = Add(origin, Multiply(t, diff));
+	contact.normal = Dot(diff, normal) < 0.0f ? normal : Multiply(-1.0f, normal); // 線の来る側へ向ける
+	return contact;
+}
+
+/// <summary>
+/// 線とAABBの交点を求める(Segment/Line/Rayの共通部分)
+/// 始点がAABBの内側にあるときは t = tLower、法線は入ってきた面のもの
+/// </summary>
+/// <param name="aabb">AABB</param>
+/// <param name="origin">始点</param>
+/// <param name="diff">方向(終点 - 始点)</param>
+/// <param name="tLower">tの下限</param>
+/// <param name="tUpper">tの上限</param>
+Contact GetLineAABBContact(const AABB& aabb, const Vector3& origin, const Vector3& diff, float tLower, float tUpper) {
+	Contact contact = {};
+	Vector3 tNear;
+	float tEnter;
+	float tExit;
+	if (!IntersectLineAABB<float>(aabb, origin, diff, tLower, tUpper, tNear, tEnter, tExit)) { return contact; }
+
+	contact.hit = true;
+	contact.t = (std::max)(tEnter, tLower);
+	contact.point = Add(origin, Multiply(contact.t, diff));
+	// 最後に入った面の法線
+	if (tNear.x >= tNear.y && tNear.x >= tNear.z) {
+		contact.normal = { diff.x > 0.0f ? -1.0f : 1.0f, 0.0f, 0.0f };
+	} else if (tNear.y >= tNear.z) {
+		contact.normal = { 0.0f, diff.y > 0.0f ? -1.0f : 1.0f, 0.0f };
+	} else {
+		contact.normal = { 0.0f, 0.0f, diff.z > 0.0f ? -1.0f : 1.0f };
+	}
+	return contact;
+}
+
+// 球同士の衝突(法線は sphere1 から sphere2 へ、point は両球の表面上の点の中点)
+Contact GetContact(const Sphere& sphere1, const Sphere& sphere2) {
+	Contact contact = {};
+	if (!CheckCollision<float>(sphere1, sphere2)) { return contact; }
+
+	Vector3 diff = Subtract(sphere2.center, sphere1.center);
+	float distance = Length(diff);
+	contact.hit = true;
+	// 中心が同じなら向きが決まらないので上向き
+	contact.normal = distance > 0.0f ? Multiply(1.0f / distance, diff) : Vector3{ 0.0f, 1.0f, 0.0f };
+	contact.penetration = sphere1.radius + sphere2.radius - distance;
+	Vector3 point1 = Add(sphere1.center, Multiply(sphere1.radius, contact.normal));
+	Vector3 point2 = Subtract(sphere2.center, Multiply(sphere2.radius, contact.normal));
+	contact.point = Multiply(0.5f, Add(point1, point2));
+	return contact;
+}
+
+// 球と平面の衝突
+Contact GetContact(const Sphere& sphere, const Plane& plane) {
+	Contact contact = {};
+	// 半径より距離が小さければ衝突
+	if (!CheckCollision<float>(sphere, plane)) { return contact; }
+
+	// 平面と点の距離(符号付き)
+	float signedDistance = Dot(plane.normal, sphere.center) - plane.distance;
+	float k = std::fabs(signedDistance);
+
+	contact.hit = true;
+	contact.normal = signedDistance >= 0.0f ? plane.normal : Multiply(-1.0f, plane.normal); // 球のある側
+	contact.point = Subtract(sphere.center, Multiply(k, contact.normal)); // 平面上の最近接点
+	contact.penetration = sphere.radius - k;
+	return contact;
+}
+
+// 線分と平面の衝突
+Contact GetContact(const Segment& segment, const Plane& plane) {
+	return GetLinePlaneContact(segment.origin, segment.diff, plane, 0.0f, 1.0f);
+}
+
+// 直線と平面の衝突
+Contact GetContact(const Line& line, const Plane& plane) {
+	// 平行でなければどこかで衝突する
+	return GetLinePlaneContact(line.origin, line.diff, plane,
+		-(std::numeric_limits<float>::infinity)(), (std::numeric_limits<float>::infinity)());
+}
+
+// 半直線と平面の衝突
+Contact GetContact(const Ray& ray, const Plane& plane) {
+	return GetLinePlaneContact(ray.origin, ray.diff, plane, 0.0f, (std::numeric_limits<float>::infinity)());
+}
+
+// 三角形と線分の衝突
+Contact GetContact(const Triangle& triangle, const Segment& segment) {
+	return GetLineTriangleContact(triangle, segment.origin, segment.diff, 0.0f, 1.0f);
+}
+
+// 三角形と直線の衝突
+Contact GetContact(const Triangle& triangle, const Line& line) {
+	return GetLineTriangleContact(triangle, line.origin, line.diff,
+		-(std::numeric_limits<float>::infinity)(), (std::numeric_limits<float>::infinity)());
+}
+
+// 三角形と半直線の衝突
+Contact GetContact(const Triangle& triangle, const Ray& ray) {
+	return GetLineTriangleContact(triangle, ray.origin, ray.diff, 0.0f, (std::numeric_limits<float>::infinity)());
+}
+
+// AABB同士の衝突(法線は aabb1 から aabb2 へ押し出す向き)
+Contact GetContact(const AABB& aabb1, const AABB& aabb2) {
+	Contact contact = {};
+	if (!CheckCollision<float>(aabb1, aabb2)) { return contact; }
+
+	contact.hit = true;
+	// 重なりの中心
+	contact.point = {
+		((std::max)(aabb1.min.x, aabb2.min.x) + (std::min)(aabb1.max.x, aabb2.max.x)) * 0.5f,
+		((std::max)(aabb1.min.y, aabb2.min.y) + (std::min)(aabb1.max.y, aabb2.max.y)) * 0.5f,
+		((std::max)(aabb1.min.z, aabb2.min.z) + (std::min)(aabb1.max.z, aabb2.max.z)) * 0.5f
+	};
+	// 各軸で aabb2 を正・負の向きに押し出すのに必要な量(片方が中に入り込んでいる場合も考える)
+	const float pushPositive[3] = { aabb1.max.x - aabb2.min.x, aabb1.max.y - aabb2.min.y, aabb1.max.z - aabb2.min.z };
+	const float pushNegative[3] = { aabb2.max.x - aabb1.min.x, aabb2.max.y - aabb1.min.y, aabb2.max.z - aabb1.min.z };
+	// 押し出す量が一番小さい軸と向き
+	int bestAxis = 0;
+	float bestSign = 1.0f;
+	contact.penetration = (std::numeric_limits<float>::max)();
+	for (int axis = 0; axis < 3; ++axis) {
+		if (pushPositive[axis] < contact.penetration) {
+			contact.penetration = pushPositive[axis];
+			bestAxis = axis;
+			bestSign = 1.0f;
+		}
+		if (pushNegative[axis] < contact.penetration) {
+			contact.penetration = pushNegative[axis];
+			bestAxis = axis;
+			bestSign = -1.0f;
+		}
+	}
+	contact.normal = { 0.0f, 0.0f, 0.0f };
+	(bestAxis == 0 ? contact.normal.x : bestAxis == 1 ? contact.normal.y : contact.normal.z) = bestSign;
+	return contact;
+}
+
+// AABBと球の衝突
+Contact GetContact(const AABB& aabb, const Sphere& sphere) {
+	Contact contact = {};
+	if (!CheckCollision<float>(aabb, sphere)) { return contact; }
+
+	// 最近接点を求める
+	Vector3 closestPoint = {
+		std::clamp(sphere.center.x, aabb.min.x, aabb.max.x),
+		std::clamp(sphere.center.y, aabb.min.y, aabb.max.y),
+		std::clamp(sphere.center.z, aabb.min.z, aabb.max.z),
+	};
+	// 最近接点と球の中心の距離を求める
+	Vector3 toCenter = Subtract(sphere.center, closestPoint);
+	float distance = Length(toCenter);
+
+	contact.hit = true;
+	if (distance > 0.0f) {
+		contact.point = closestPoint;
+		contact.normal = Multiply(1.0f / distance, toCenter);
+		contact.penetration = sphere.radius - distance;
+		return contact;
+	}
+
+	// 中心がAABBの内側にあるときは一番近い面から押し出す
+	const float faceDistances[6] = {
+		sphere.center.x - aabb.min.x, aabb.max.x - sphere.center.x,
+		sphere.center.y - aabb.min.y, aabb.max.y - sphere.center.y,
+		sphere.center.z - aabb.min.z, aabb.max.z - sphere.center.z,
+	};
+	int face = int(std::min_element(faceDistances, faceDistances + 6) - faceDistances);
+	float sign = (face % 2 == 0) ? -1.0f : 1.0f;
+	contact.normal = { 0.0f, 0.0f, 0.0f };
+	contact.point = sphere.center;
+	switch (face / 2) {
+	case 0: contact.normal.x = sign; contact.point.x = (face == 0) ? aabb.min.x : aabb.max.x; break;
+	case 1: contact.normal.y = sign; contact.point.y = (face == 2) ? aabb.min.y : aabb.max.y; break;
+	default: contact.normal.z = sign; contact.point.z = (face == 4) ? aabb.min.z : aabb.max.z; break;
+	}
+	contact.penetration = sphere.radius + faceDistances[face];
+	return contact;
+}
+
+// AABBと線分の衝突
+Contact GetContact(const AABB& aabb, const Segment& segment) {
+	return GetLineAABBContact(aabb, segment.origin, segment.diff, 0.0f, 1.0f);
+}
+
+// AABBと直線の衝突
+Contact GetContact(const AABB& aabb, const Line& line) {
+	return GetLineAABBContact(aabb, line.origin, line.diff,
+		-(std::numeric_limits<float>::infinity)(), (std::numeric_limits<float>::infinity)());
+}
+
+// AABBと半直線の衝突
+Contact GetContact(const AABB& aabb, const Ray& ray) {
+	return GetLineAABBContact(aabb, ray.origin, ray.diff, 0.0f, (std::numeric_limits<float>::infinity)());
+}
+
+// 球同士の衝突判定
+bool CheckCollision(const Sphere& sphere1, const Sphere& sphere2) { return CheckCollision<float>(sphere1, sphere2); }
+// 球と平面の衝突判定
+bool CheckCollision(const Sphere& sphere, const Plane& plane) { return CheckCollision<float>(sphere, plane); }
+// 線分と平面の衝突判定
+bool CheckCollision(const Segment& segment, const Plane& plane) { return GetContact(segment, plane).hit; }
+// 直線と平面の衝突判定
+bool CheckCollision(const Line& line, const Plane& plane) { return GetContact(line, plane).hit; }
+// 半直線と平面の衝突判定
+bool CheckCollision(const Ray& ray, const Plane& plane) { return GetContact(ray, plane).hit; }
+// 三角形と線分の衝突判定
+bool CheckCollision(const Triangle& triangle, const Segment& segment) { return CheckCollision<float>(triangle, segment); }
+// 三角形と直線の衝突判定
+bool CheckCollision(const Triangle& triangle, const Line& line) { return CheckCollision<float>(triangle, line); }
+// 三角形と半直線の衝突判定
+bool CheckCollision(const Triangle& triangle, const Ray& ray) { return CheckCollision<float>(triangle, ray); }
+// AABB同士の衝突判定
+bool CheckCollision(const AABB& aabb1, const AABB& aabb2) { return CheckCollision<float>(aabb1, aabb2); }
+// AABBと球の衝突判定
+bool CheckCollision(const AABB& aabb, const Sphere& sphere) { return CheckCollision<float>(aabb, sphere); }
+// AABBと線分の衝突判定
+bool CheckCollision(const AABB& aabb, const Segment& segment) { return CheckCollision<float>(aabb, segment); }
+// AABBと直線の衝突判定
+bool CheckCollision(const AABB& aabb, const Line& line) { return CheckCollision<float>(aabb, line); }
+// AABBと半直線の衝突判定
+bool CheckCollision(const AABB& aabb, const Ray& ray) { return CheckCollision<float>(aabb, ray); }
\ No newline at end of file
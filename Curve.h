@@ -0,0 +1,319 @@
+#pragma once
+#include "Vector3.h"
+#include "Matrix4x4.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 曲線の分割数の上限
+static const uint32_t kCurveMaxSegments = 256;
+// 投影できない(カメラの後ろにある)区間の分割数
+static const uint32_t kCurveFallbackSegments = 32;
+
+/// <summary>
+/// 曲線区間(3次以下の多項式) p(t) = a t^3 + b t^2 + c t + d (0 <= t <= 1)
+/// ベジェ曲線もスプラインも一度この形に変換してから評価する
+/// </summary>
+struct CurveSpan {
+	Vector3 a; // 3次の係数
+	Vector3 b; // 2次の係数
+	Vector3 c; // 1次の係数
+	Vector3 d; // 定数項(始点)
+};
+
+/// <summary>
+/// 同次座標に変換した曲線区間
+/// 行列は線形なので変換後も多項式のまま。各頂点は w で割るだけでスクリーン座標になる
+/// </summary>
+struct HomogeneousCurveSpan {
+	float a[4];
+	float b[4];
+	float c[4];
+	float d[4];
+};
+
+/// <summary>
+/// 2次ベジェ曲線から曲線区間を作成
+/// </summary>
+/// <param name="p0">制御点0(始点)</param>
+/// <param name="p1">制御点1</param>
+/// <param name="p2">制御点2(終点)</param>
+CurveSpan MakeQuadraticBezierSpan(const Vector3& p0, const Vector3& p1, const Vector3& p2) {
+	CurveSpan span;
+	span.a = { 0.0f,0.0f,0.0f };
+	span.b = p0 - 2.0f * p1 + p2;
+	span.c = 2.0f * (p1 - p0);
+	span.d = p0;
+	return span;
+}
+
+/// <summary>
+/// 3次ベジェ曲線から曲線区間を作成
+/// </summary>
+/// <param name="p0">制御点0(始点)</param>
+/// <param name="p1">制御点1</param>
+/// <param name="p2">制御点2</param>
+/// <param name="p3">制御点3(終点)</param>
+CurveSpan MakeCubicBezierSpan(const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector3& p3) {
+	CurveSpan span;
+	span.a = 3.0f * (p1 - p2) + p3 - p0;
+	span.b = 3.0f * (p0 - 2.0f * p1 + p2);
+	span.c = 3.0f * (p1 - p0);
+	span.d = p0;
+	return span;
+}
+
+/// <summary>
+/// Catmull-Romスプラインの1区間(p1からp2まで)を作成
+/// </summary>
+/// <param name="p0">前の制御点</param>
+/// <param name="p1">区間の始点</param>
+/// <param name="p2">区間の終点</param>
+/// <param name="p3">次の制御点</param>
+CurveSpan MakeCatmullRomSpan(const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector3& p3) {
+	CurveSpan span;
+	span.a = 0.5f * (3.0f * (p1 - p2) + p3 - p0);
+	span.b = 0.5f * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3);
+	span.c = 0.5f * (p2 - p0);
+	span.d = p1;
+	return span;
+}
+
+/// <summary>
+/// 一様3次Bスプラインの1区間を作成
+/// </summary>
+/// <param name="p0">制御点0</param>
+/// <param name="p1">制御点1</param>
+/// <param name="p2">制御点2</param>
+/// <param name="p3">制御点3</param>
+CurveSpan MakeBSplineSpan(const Vector3& p0, const Vector3& p1, const Vector3& p2, const Vector3& p3) {
+	const float kSixth = 1.0f / 6.0f;
+	CurveSpan span;
+	span.a = kSixth * (3.0f * (p1 - p2) + p3 - p0);
+	span.b = 0.5f * (p0 - 2.0f * p1 + p2);
+	span.c = 0.5f * (p2 - p0);
+	span.d = kSixth * (p0 + 4.0f * p1 + p2);
+	return span;
+}
+
+/// <summary>
+/// 全制御点を通るCatmull-Romスプラインの区間を追加
+/// 両端は端点を複製して補う
+/// </summary>
+/// <param name="points">制御点の配列</param>
+/// <param name="count">制御点の数</param>
+/// <param name="spans">追加先</param>
+void AppendCatmullRomSpans(const Vector3* points, size_t count, std::vector<CurveSpan>& spans) {
+	if (count < 2) { return; }
+	for (size_t i = 0; i + 1 < count; ++i) {
+		const Vector3& p0 = points[i == 0 ? 0 : i - 1];
+		const Vector3& p3 = points[i + 2 < count ? i + 2 : count - 1];
+		spans.push_back(MakeCatmullRomSpan(p0, points[i], points[i + 1], p3));
+	}
+}
+
+/// <summary>
+/// 一様3次Bスプラインの区間を追加
+/// </summary>
+/// <param name="points">制御点の配列</param>
+/// <param name="count">制御点の数(4以上で区間ができる)</param>
+/// <param name="spans">追加先</param>
+void AppendBSplineSpans(const Vector3* points, size_t count, std::vector<CurveSpan>& spans) {
+	for (size_t i = 0; i + 3 < count; ++i) {
+		spans.push_back(MakeBSplineSpan(points[i], points[i + 1], points[i + 2], points[i + 3]));
+	}
+}
+
+/// <summary>
+/// 曲線区間上の点を求める(Horner法)
+/// </summary>
+/// <param name="span">曲線区間</param>
+/// <param name="t">媒介変数(0~1)</param>
+Vector3 EvaluateCurveSpan(const CurveSpan& span, float t) {
+	return ((span.a * t + span.b) * t + span.c) * t + span.d;
+}
+
+/// <summary>
+/// 曲線区間の接線(1階微分)を求める
+/// </summary>
+/// <param name="span">曲線区間</param>
+/// <param name="t">媒介変数(0~1)</param>
+Vector3 EvaluateCurveSpanDerivative(const CurveSpan& span, float t) {
+	return (3.0f * t) * (span.a * t) + (2.0f * t) * span.b + span.c;
+}
+
+/// <summary>
+/// 許容誤差から分割数を求める
+/// 2階微分の最大値Mに対して、n分割した折れ線と曲線のずれは M / (8 n^2) 以下になる
+/// </summary>
+/// <param name="maxSecondDerivative">2階微分の大きさの最大値</param>
+/// <param name="tolerance">許容誤差</param>
+uint32_t CurveSegmentCountFromFlatness(float maxSecondDerivative, float tolerance) {
+	if (tolerance <= 0.0f) { return kCurveMaxSegments; }
+	float n = std::ceil(std::sqrt(maxSecondDerivative / (8.0f * tolerance)));
+	if (n < 1.0f) { return 1; }
+	if (n > float(kCurveMaxSegments)) { return kCurveMaxSegments; }
+	return uint32_t(n);
+}
+
+/// <summary>
+/// ワールド座標での許容誤差を満たす分割数を求める
+/// p''(t) = 6at + 2b は t の1次式なので、大きさの最大値は両端のどちらか
+/// </summary>
+/// <param name="span">曲線区間</param>
+/// <param name="tolerance">許容誤差(ワールド座標)</param>
+uint32_t CurveSegmentCount(const CurveSpan& span, float tolerance) {
+	Vector3 second0 = 2.0f * span.b;
+	Vector3 second1 = 6.0f * span.a + second0;
+	float m = Length(second0);
+	float m1 = Length(second1);
+	return CurveSegmentCountFromFlatness(m > m1 ? m : m1, tolerance);
+}
+
+/// <summary>
+/// 前進差分で曲線区間を分割し、頂点を出力する
+/// 1頂点あたり加算3回(2次曲線なら実質2回)で済む
+/// </summary>
+/// <param name="span">曲線区間</param>
+/// <param name="segmentCount">分割数</param>
+/// <param name="points">出力先(segmentCount + 1 個)</param>
+void TessellateCurveSpan(const CurveSpan& span, uint32_t segmentCount, Vector3* points) {
+	const float h = 1.0f / float(segmentCount);
+	const float h2 = h * h;
+	const float h3 = h2 * h;
+	Vector3 p = span.d;
+	Vector3 delta1 = span.a * h3 + span.b * h2 + span.c * h;
+	Vector3 delta2 = span.a * (6.0f * h3) + span.b * (2.0f * h2);
+	const Vector3 delta3 = span.a * (6.0f * h3);
+	points[0] = p;
+	for (uint32_t i = 1; i < segmentCount; ++i) {
+		p += delta1;
+		delta1 += delta2;
+		delta2 += delta3;
+		points[i] = p;
+	}
+	// 誤差の蓄積で隣の区間と隙間ができないよう、終点は直接求める
+	points[segmentCount] = span.a + span.b + span.c + span.d;
+}
+
+/// <summary>
+/// 曲線区間を同次座標に変換
+/// </summary>
+/// <param name="span">曲線区間</param>
+/// <param name="matrix">変換行列(ビューx射影xビューポート)</param>
+HomogeneousCurveSpan TransformCurveSpan(const CurveSpan& span, const Matrix4x4& matrix) {
+	HomogeneousCurveSpan result;
+	for (int j = 0; j < 4; ++j) {
+		// 係数は方向ベクトル(w=0)、定数項のみ位置(w=1)として変換する
+		result.a[j] = span.a.x * matrix.m[0][j] + span.a.y * matrix.m[1][j] + span.a.z * matrix.m[2][j];
+		result.b[j] = span.b.x * matrix.m[0][j] + span.b.y * matrix.m[1][j] + span.b.z * matrix.m[2][j];
+		result.c[j] = span.c.x * matrix.m[0][j] + span.c.y * matrix.m[1][j] + span.c.z * matrix.m[2][j];
+		result.d[j] = span.d.x * matrix.m[0][j] + span.d.y * matrix.m[1][j] + span.d.z * matrix.m[2][j] + matrix.m[3][j];
+	}
+	return result;
+}
+
+/// <summary>
+/// スクリーン座標での許容誤差を満たす分割数を求める
+/// w の変化が小さいとみなした近似で、2階微分を両端の w の小さい方で割って見積もる
+/// </summary>
+/// <param name="span">同次座標の曲線区間</param>
+/// <param name="tolerance">許容誤差(ピクセル)</param>
+uint32_t ScreenCurveSegmentCount(const HomogeneousCurveSpan& span, float tolerance) {
+	float w0 = span.d[3];
+	float w1 = span.a[3] + span.b[3] + span.c[3] + span.d[3];
+	float wMin = w0 < w1 ? w0 : w1;
+	if (wMin <= 0.0f) {
+		return kCurveFallbackSegments;
+	}
+	float m = 0.0f;
+	float m1 = 0.0f;
+	for (int j = 0; j < 2; ++j) {
+		float second0 = 2.0f * span.b[j];
+		float second1 = 6.0f * span.a[j] + second0;
+		m += second0 * second0;
+		m1 += second1 * second1;
+	}
+	return CurveSegmentCountFromFlatness(std::sqrt(m > m1 ? m : m1) / wMin, tolerance);
+}
+
+/// <summary>
+/// 前進差分で同次座標の曲線区間を分割し、スクリーン座標の頂点を出力する
+/// 行列との積は区間ごとに一度だけで、頂点ごとには w での除算のみ
+/// </summary>
+/// <param name="span">同次座標の曲線区間</param>
+/// <param name="segmentCount">分割数</param>
+/// <param name="points">出力先(segmentCount + 1 個)</param>
+void TessellateCurveSpan(const HomogeneousCurveSpan& span, uint32_t segmentCount, Vector3* points) {
+	const float h = 1.0f / float(segmentCount);
+	const float h2 = h * h;
+	const float h3 = h2 * h;
+	float p[4];
+	float delta1[4];
+	float delta2[4];
+	float delta3[4];
+	float end[4];
+	for (int j = 0; j < 4; ++j) {
+		p[j] = span.d[j];
+		delta1[j] = span.a[j] * h3 + span.b[j] * h2 + span.c[j] * h;
+		delta2[j] = span.a[j] * (6.0f * h3) + span.b[j] * (2.0f * h2);
+		delta3[j] = span.a[j] * (6.0f * h3);
+		end[j] = span.a[j] + span.b[j] + span.c[j] + span.d[j];
+	}
+
+	// TransformVector と同じく w が0なら原点を返す
+	auto divide = [](const float* v) -> Vector3 {
+		if (v[3] == 0.0f) {
+			return { 0.0f,0.0f,0.0f };
+		}
+		float inverseW = 1.0f / v[3];
+		return { v[0] * inverseW, v[1] * inverseW, v[2] * inverseW };
+	};
+
+	points[0] = divide(p);
+	for (uint32_t i = 1; i < segmentCount; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			p[j] += delta1[j];
+			delta1[j] += delta2[j];
+			delta2[j] += delta3[j];
+		}
+		points[i] = divide(p);
+	}
+	points[segmentCount] = divide(end);
+}
+
+/// <summary>
+/// 複数の曲線区間をまとめてスクリーン座標の折れ線に変換する
+/// 区間iの頂点は points[offsets[i]] ~ points[offsets[i + 1] - 1]
+/// 途中の作業用の配列は points と同じアロケータから確保する
+/// </summary>
+/// <param name="spans">曲線区間の配列</param>
+/// <param name="count">曲線区間の数</param>
+/// <param name="screenTransformMatrix">ビューx射影xビューポート行列</param>
+/// <param name="tolerance">許容誤差(ピクセル)</param>
+/// <param name="points">頂点の出力先</param>
+/// <param name="offsets">各区間の先頭位置の出力先(count + 1 個)</param>
+template<typename PointAllocator, typename OffsetAllocator>
+void TessellateCurves(const CurveSpan* spans, size_t count, const Matrix4x4& screenTransformMatrix, float tolerance,
+	std::vector<Vector3, PointAllocator>& points, std::vector<uint32_t, OffsetAllocator>& offsets) {
+	points.clear();
+	offsets.clear();
+	offsets.reserve(count + 1);
+
+	// 先に分割数を決めて一度だけ確保する
+	using SpanAllocator = typename std::allocator_traits<PointAllocator>::template rebind_alloc<HomogeneousCurveSpan>;
+	std::vector<HomogeneousCurveSpan, SpanAllocator> homogeneousSpans(count, SpanAllocator(points.get_allocator()));
+	uint32_t total = 0;
+	for (size_t i = 0; i < count; ++i) {
+		homogeneousSpans[i] = TransformCurveSpan(spans[i], screenTransformMatrix);
+		offsets.push_back(total);
+		total += ScreenCurveSegmentCount(homogeneousSpans[i], tolerance) + 1;
+	}
+	offsets.push_back(total);
+
+	points.resize(total);
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t segmentCount = offsets[i + 1] - offsets[i] - 1;
+		TessellateCurveSpan(homogeneousSpans[i], segmentCount, points.data() + offsets[i]);
+	}
+}
\ No newline at end of file
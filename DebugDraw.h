@@ -0,0 +1,264 @@
+#pragma once
+#include "Curve.h"
+#include "FastMath.h"
+#include "FrameArena.h"
+#include "LineList.h"
+#include "Matrix4x4.h"
+#include "Profiler.h"
+#include "Shape.h"
+#include <cstdint>
+#include <math.h>
+#include <vector>
+
+// 円周率
+static const float kPi = 3.14159265358979f;
+
+// 平面描画
+void DrawPlane(LineList& lineList, const Plane& plane, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
+	MT3_PROFILE_SCOPE("DrawPlane");
+	Vector3 center = Multiply(plane.distance, plane.normal);
+	Vector3 perpendiculars[4];
+	perpendiculars[0] = Normalize(Perpendicular(plane.normal)); // 法線と垂直なベクトル
+	perpendiculars[1] = { -perpendiculars[0].x,-perpendiculars[0].y, -perpendiculars[0].z }; // の逆ベクトル
+	perpendiculars[2] = Cross(plane.normal, perpendiculars[0]); // 法線と、垂直ベクトルのクロス積
+	perpendiculars[3] = { -perpendiculars[2].x,-perpendiculars[2].y, -perpendiculars[2].z }; // の逆ベクトル
+	Vector3 points[4];
+	// 頂点を求める
+	for (int32_t index = 0; index < 4; ++index) {
+		Vector3 extend = Multiply(2.0f, perpendiculars[index]);
+		Vector3 point = Add(center, extend);
+		points[index] = TransformVector(TransformVector(point, viewProjectionMatrix), viewportMatrix);
+	}
+	// 描画
+	lineList.Add(points[0].x, points[0].y, points[2].x, points[2].y, color);
+	lineList.Add(points[2].x, points[2].y, points[1].x, points[1].y, color);
+	lineList.Add(points[1].x, points[1].y, points[3].x, points[3].y, color);
+	lineList.Add(points[3].x, points[3].y, points[0].x, points[0].y, color);
+}
+
+// 三角形描画
+void DrawTriangle(LineList& lineList, const Triangle& triangle, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
+	MT3_PROFILE_SCOPE("DrawTriangle");
+	Vector3 points[3];
+	// 頂点を求める
+	for (int32_t index = 0; index < 3; ++index) {
+		Vector3 point = TransformVector(TransformVector(triangle.vertices[index], viewProjectionMatrix), viewportMatrix);
+		points[index] = point;
+	}
+	// 描画
+	lineList.Add(points[0].x, points[0].y, points[1].x, points[1].y, color);
+	lineList.Add(points[1].x, points[1].y, points[2].x, points[2].y, color);
+	lineList.Add(points[2].x, points[2].y, points[0].x, points[0].y, color);
+}
+
+// AABB描画
+void DrawAABB(LineList& lineList, const AABB& aabb, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
+	MT3_PROFILE_SCOPE("DrawAABB");
+	Vector3 points[8];
+	// 頂点を求める
+	points[0] = { aabb.min.x, aabb.min.y, aabb.min.z };
+	points[1] = { aabb.max.x, aabb.min.y, aabb.min.z };
+	points[2] = { aabb.min.x, aabb.max.y, aabb.min.z };
+	points[3] = { aabb.max.x, aabb.max.y, aabb.min.z };
+	points[4] = { aabb.min.x, aabb.min.y, aabb.max.z };
+	points[5] = { aabb.max.x, aabb.min.y, aabb.max.z };
+	points[6] = { aabb.min.x, aabb.max.y, aabb.max.z };
+	points[7] = { aabb.max.x, aabb.max.y, aabb.max.z };
+
+	// スクリーン座標に変換
+	for (int32_t index = 0; index < 8; ++index) {
+		Vector3 point = TransformVector(TransformVector(points[index], viewProjectionMatrix), viewportMatrix);
+		points[index] = point;
+	}
+
+	// 辺
+	static const int edge[12][2] = {
+		{0,1},{1,3},{3,2},{2,0}, // 下面
+		{4,5},{5,7},{7,6},{6,4}, // 上面
+		{0,4},{1,5},{2,6},{3,7}  // 側面
+	};
+
+	// 辺を描画
+	for (int i = 0; i < 12; ++i) {
+		const Vector3& p0 = points[edge[i][0]];
+		const Vector3& p1 = points[edge[i][1]];
+		lineList.Add(p0.x, p0.y, p1.x, p1.y, color);
+	}
+}
+
+// OBB描画
+void DrawOBB(LineList& lineList, const OBB& obb, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
+	MT3_PROFILE_SCOPE("DrawOBB");
+	Matrix4x4 screenTransformMatrix = Multiply(viewProjectionMatrix, viewportMatrix);
+	Vector3 points[8];
+	// 頂点を求めてスクリーン座標に変換(番号のビット0がx軸、1がy軸、2がz軸の正の側)
+	for (int32_t index = 0; index < 8; ++index) {
+		Vector3 point = obb.center +
+			obb.orientations[0] * ((index & 1) ? obb.size.x : -obb.size.x) +
+			obb.orientations[1] * ((index & 2) ? obb.size.y : -obb.size.y) +
+			obb.orientations[2] * ((index & 4) ? obb.size.z : -obb.size.z);
+		points[index] = TransformVector(point, screenTransformMatrix);
+	}
+
+	// 辺(DrawAABB と同じ並び)
+	static const int edge[12][2] = {
+		{0,1},{1,3},{3,2},{2,0},
+		{4,5},{5,7},{7,6},{6,4},
+		{0,4},{1,5},{2,6},{3,7}
+	};
+	for (int i = 0; i < 12; ++i) {
+		const Vector3& p0 = points[edge[i][0]];
+		const Vector3& p1 = points[edge[i][1]];
+		lineList.Add(p0.x, p0.y, p1.x, p1.y, color);
+	}
+}
+
+// 曲線の許容誤差(ピクセル)
+static const float kCurveTolerance = 0.5f;
+
+// 2次ベジェ曲線描画
+void DrawBezier(LineList& lineList, const Vector3& controlPoint0, const Vector3& controlPoint1, const Vector3& controlPoint2, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
+	MT3_PROFILE_SCOPE("DrawBezier");
+	Matrix4x4 screenTransformMatrix = Multiply(viewProjectionMatrix, viewportMatrix);
+
+	// 曲線ごと同次座標に変換しておけば、各頂点の座標変換は一度だけで済む
+	HomogeneousCurveSpan span = TransformCurveSpan(MakeQuadraticBezierSpan(controlPoint0, controlPoint1, controlPoint2), screenTransformMatrix);
+	uint32_t segmentCount = ScreenCurveSegmentCount(span, kCurveTolerance); // 分割数
+	Vector3 screenPoints[kCurveMaxSegments + 1];
+	TessellateCurveSpan(span, segmentCount, screenPoints);
+
+	for (uint32_t i = 0; i < segmentCount; ++i) {
+		const Vector3& p0 = screenPoints[i];
+		const Vector3& p1 = screenPoints[i + 1];
+		lineList.Add(p0.x, p0.y, p1.x, p1.y, color);
+	}
+}
+
+/// <summary>
+/// 複数の曲線区間をまとめて描画
+/// </summary>
+/// <param name="lineList">線分の追加先</param>
+/// <param name="spans">曲線区間の配列</param>
+/// <param name="count">曲線区間の数</param>
+/// <param name="viewProjectionMatrix">ビューx射影行列</param>
+/// <param name="viewportMatrix">ビューポート行列</param>
+/// <param name="color">色</param>
+void DrawCurves(LineList& lineList, const CurveSpan* spans, size_t count, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
+	MT3_PROFILE_SCOPE("DrawCurves");
+	// 呼び出したスレッドのフレーム用アロケータから確保する(描画準備スレッドから呼んでもよい)
+	FrameVector<Vector3> screenPoints;
+	FrameVector<uint32_t> offsets;
+	TessellateCurves(spans, count, Multiply(viewProjectionMatrix, viewportMatrix), kCurveTolerance, screenPoints, offsets);
+
+	for (size_t spanIndex = 0; spanIndex < count; ++spanIndex) {
+		for (uint32_t i = offsets[spanIndex]; i + 1 < offsets[spanIndex + 1]; ++i) {
+			const Vector3& p0 = screenPoints[i];
+			const Vector3& p1 = screenPoints[i + 1];
+			lineList.Add(p0.x, p0.y, p1.x, p1.y, color);
+		}
+	}
+}
+
+/// <summary>
+/// グリッド描画
+/// </summary>
+/// <param name="lineList">線分の追加先</param>
+/// <param name="viewProjectionMatrix">ビューx射影行列</param>
+/// <param name="viewportMatrix">ビューポート行列</param>
+void DrawGrid(LineList& lineList, const Matrix4x4& viewProjectionMatrix, const Matrix4x4 viewportMatrix) {
+	MT3_PROFILE_SCOPE("DrawGrid");
+	const float kGridHalfWidth = 2.0f;	// 半分の幅
+	const uint32_t kSubdivision = 10;	// 分割数
+	const float kGridEvery = (kGridHalfWidth * 2.0f) / float(kSubdivision);	// 1つ分の長さ
+	Matrix4x4 screenTransformMatrix = Multiply(viewProjectionMatrix, viewportMatrix);
+
+	// 奥から手前への線を順々に引いていく
+	for (uint32_t xIndex = 0; xIndex <= kSubdivision; ++xIndex) {
+		// ワールド座標系上の始点と終点を求める
+		Vector3 start = { -kGridHalfWidth + kGridEvery * xIndex, 0.0f, -kGridHalfWidth };
+		Vector3 end = { -kGridHalfWidth + kGridEvery * xIndex, 0.0f, kGridHalfWidth };
+		// 座標変換
+		Vector3 startScreen = TransformVector(start, screenTransformMatrix);
+		Vector3 endScreen = TransformVector(end, screenTransformMatrix);
+		// 変換した座標を使って表示
+		lineList.Add(startScreen.x, startScreen.y,
+			endScreen.x, endScreen.y, 0xAAAAAAFF);
+	}
+
+	// 左から右への線
+	for (uint32_t zIndex = 0; zIndex <= kSubdivision; ++zIndex) {
+		// ワールド座標系上の始点と終点を求める
+		Vector3 start = { -kGridHalfWidth, 0.0f, -kGridHalfWidth + kGridEvery * zIndex };
+		Vector3 end = { kGridHalfWidth, 0.0f, -kGridHalfWidth + kGridEvery * zIndex };
+		// 座標変換
+		Vector3 startScreen = TransformVector(start, screenTransformMatrix);
+		Vector3 endScreen = TransformVector(end, screenTransformMatrix);
+		// 変換した座標を使って表示
+		lineList.Add(startScreen.x, startScreen.y,
+			endScreen.x, endScreen.y, 0xAAAAAAFF);
+	}
+}
+
+/// <summary>
+/// 球の描画
+/// </summary>
+/// <param name="lineList">線分の追加先</param>
+/// <param name="sphere">球</param>
+/// <param name="viewProjectionMatrix">ビューx射影行列</param>
+/// <param name="viewportMatrix">ビューポート行列</param>
+/// <param name="color">色</param>
+void DrawSphere(LineList& lineList, const Sphere& sphere, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
+	MT3_PROFILE_SCOPE("DrawSphere");
+	const uint32_t kSubdivision = 20;						// 分割数
+	const float kLonEvery = kPi * 2.0f / kSubdivision;		// 経度分割1つ分の角度
+	const float kLatEvery = kPi / kSubdivision;			// 緯度分割1つ分の角度
+	Matrix4x4 screenTransformMatrix = Multiply(viewProjectionMatrix, viewportMatrix);
+
+	// 角度ごとの sin/cos は先にまとめて求めておく(MT3_FAST_MATH が無ければ標準ライブラリと同じ値)
+	float latRadians[kSubdivision + 1];
+	float lonRadians[kSubdivision + 1];
+	for (uint32_t index = 0; index <= kSubdivision; ++index) {
+		latRadians[index] = -kPi / 2.0f + kLatEvery * index;
+		lonRadians[index] = index * kLonEvery;
+	}
+	float latSin[kSubdivision + 1];
+	float latCos[kSubdivision + 1];
+	float lonSin[kSubdivision + 1];
+	float lonCos[kSubdivision + 1];
+#if defined(MT3_FAST_MATH)
+	SinCosArray(latRadians, kSubdivision + 1, latSin, latCos);
+	SinCosArray(lonRadians, kSubdivision + 1, lonSin, lonCos);
+#else
+	for (uint32_t index = 0; index <= kSubdivision; ++index) {
+		SinCos(latRadians[index], latSin[index], latCos[index]);
+		SinCos(lonRadians[index], lonSin[index], lonCos[index]);
+	}
+#endif
+
+	// 格子点を一度ずつScreen座標系に変換する(緯度 -π/2 ~ π/2、経度 0 ~ 2π)
+	Vector3 screens[kSubdivision + 1][kSubdivision + 1];
+	for (uint32_t latIndex = 0; latIndex <= kSubdivision; ++latIndex) {
+		for (uint32_t lonIndex = 0; lonIndex <= kSubdivision; ++lonIndex) {
+			Vector3 point = Add(sphere.center,
+				Multiply(sphere.radius,
+					{ latCos[latIndex] * lonCos[lonIndex], latSin[latIndex], latCos[latIndex] * lonSin[lonIndex] }));
+			screens[latIndex][lonIndex] = TransformVector(point, screenTransformMatrix);
+		}
+	}
+
+	// 経線と緯線をそれぞれ折れ線の順に積む(LineList::Simplify でつなげられるように)
+	for (uint32_t lonIndex = 0; lonIndex < kSubdivision; ++lonIndex) {
+		for (uint32_t latIndex = 0; latIndex < kSubdivision; ++latIndex) {
+			const Vector3& a = screens[latIndex][lonIndex];
+			const Vector3& b = screens[latIndex + 1][lonIndex];
+			lineList.Add(a.x, a.y, b.x, b.y, color);
+		}
+	}
+	for (uint32_t latIndex = 0; latIndex < kSubdivision; ++latIndex) {
+		for (uint32_t lonIndex = 0; lonIndex < kSubdivision; ++lonIndex) {
+			const Vector3& a = screens[latIndex][lonIndex];
+			const Vector3& c = screens[latIndex][lonIndex + 1];
+			lineList.Add(a.x, a.y, c.x, c.y, color);
+		}
+	}
+}
\ No newline at end of file
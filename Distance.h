@@ -0,0 +1,420 @@
+#pragma once
+#include "LaneMath.h"
+#include "Profiler.h"
+#include "Shape.h"
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// 最近接点と距離
+// 判定本体はスカラー型 T のテンプレートで書き、1対1の関数と
+// SoA(要素ごとに配列を分けた形)に対する一括版の両方から使う
+
+// これ以下の長さの2乗は長さ0として扱う
+static const float kDistanceEpsilon = 1.0e-12f;
+// 三角形が潰れているとみなす高さ(辺の長さに対する割合、大きさによらず同じ形なら同じ判定になる)
+static const float kDistanceDegenerateTolerance = 1.0e-5f;
+
+// ---- 判定本体 ----
+
+/// <summary>
+/// 線分上の最近接点の媒介変数(0~1に収める)
+/// </summary>
+/// <param name="point">点</param>
+/// <param name="origin">線分の始点</param>
+/// <param name="diff">線分の方向(終点 - 始点)</param>
+template<typename T>
+T ClosestParameterOnSegment(const Vector3T<T>& point, const Vector3T<T>& origin, const Vector3T<T>& diff) {
+	T lengthSquared = Dot(diff, diff);
+	LaneMask<T> isZero = lengthSquared <= T(kDistanceEpsilon);
+	T t = Dot(Subtract(point, origin), diff) / Select(isZero, T(1.0f), lengthSquared);
+	return Select(isZero, T(0.0f), Clamp(t, T(0.0f), T(1.0f)));
+}
+
+template<typename T>
+Vector3T<T> ClosestPointOnSegment(const Vector3T<T>& point, const Vector3T<T>& origin, const Vector3T<T>& diff) {
+	return Add(origin, Multiply(ClosestParameterOnSegment(point, origin, diff), diff));
+}
+
+/// <summary>
+/// 線分同士の最近接点の媒介変数を求め、距離の2乗を返す
+/// </summary>
+/// <param name="origin1">線分1の始点</param>
+/// <param name="diff1">線分1の方向</param>
+/// <param name="origin2">線分2の始点</param>
+/// <param name="diff2">線分2の方向</param>
+/// <param name="s">線分1の媒介変数の出力</param>
+/// <param name="t">線分2の媒介変数の出力</param>
+template<typename T>
+T ClosestParametersSegmentSegment(const Vector3T<T>& origin1, const Vector3T<T>& diff1,
+	const Vector3T<T>& origin2, const Vector3T<T>& diff2, T& s, T& t) {
+	Vector3T<T> r = Subtract(origin1, origin2);
+	T a = Dot(diff1, diff1);
+	T e = Dot(diff2, diff2);
+	T b = Dot(diff1, diff2);
+	T c = Dot(diff1, r);
+	T f = Dot(diff2, r);
+	LaneMask<T> isZero1 = a <= T(kDistanceEpsilon);
+	LaneMask<T> isZero2 = e <= T(kDistanceEpsilon);
+	T aSafe = Select(isZero1, T(1.0f), a);
+	T eSafe = Select(isZero2, T(1.0f), e);
+
+	// 平行でなければ無限直線同士の最近接点から始める
+	T denominator = a * e - b * b;
+	LaneMask<T> isParallel = denominator <= T(0.0f);
+	s = Select(isParallel, T(0.0f), Clamp((b * f - c * e) / Select(isParallel, T(1.0f), denominator), T(0.0f), T(1.0f)));
+	t = (b * s + f) / eSafe;
+
+	// t が範囲外なら端に寄せて s を求め直す
+	LaneMask<T> isBelow = t < T(0.0f);
+	LaneMask<T> isAbove = t > T(1.0f);
+	s = Select(isBelow, Clamp(-c / aSafe, T(0.0f), T(1.0f)), Select(isAbove, Clamp((b - c) / aSafe, T(0.0f), T(1.0f)), s));
+	t = Clamp(t, T(0.0f), T(1.0f));
+
+	// どちらかが点の場合
+	s = Select(isZero1, T(0.0f), s);
+	t = Select(isZero1, Clamp(f / eSafe, T(0.0f), T(1.0f)), t);
+	s = Select(isZero2, Select(isZero1, T(0.0f), Clamp(-c / aSafe, T(0.0f), T(1.0f))), s);
+	t = Select(isZero2, T(0.0f), t);
+
+	Vector3T<T> difference = Subtract(Add(origin1, Multiply(s, diff1)), Add(origin2, Multiply(t, diff2)));
+	return Dot(difference, difference);
+}
+
+/// <summary>
+/// 三角形上の最近接点
+/// 内側なら平面への射影、外側なら3辺への最近接点のうち近いもの
+/// </summary>
+template<typename T>
+Vector3T<T> ClosestPointOnTriangle(const Vector3T<T>& point, const Vector3T<T>& a, const Vector3T<T>& b, const Vector3T<T>& c) {
+	Vector3T<T> ab = Subtract(b, a);
+	Vector3T<T> bc = Subtract(c, b);
+	Vector3T<T> ca = Subtract(a, c);
+	Vector3T<T> normal = Cross(ab, bc);
+	T normalSquared = Dot(normal, normal);
+
+	// 平面に射影した点が三角形の内側か(潰れた三角形は3辺で求める)
+	const T degenerateSquared = T(kDistanceDegenerateTolerance * kDistanceDegenerateTolerance) * Dot(ab, ab) * Dot(bc, bc);
+	LaneMask<T> isInside = (normalSquared > degenerateSquared) &
+		(Dot(Cross(ab, Subtract(point, a)), normal) >= T(0.0f)) &
+		(Dot(Cross(bc, Subtract(point, b)), normal) >= T(0.0f)) &
+		(Dot(Cross(ca, Subtract(point, c)), normal) >= T(0.0f));
+	T height = Dot(Subtract(point, a), normal) / Select(isInside, normalSquared, T(1.0f));
+	Vector3T<T> projected = Subtract(point, Multiply(height, normal));
+
+	// 3辺の最近接点
+	Vector3T<T> onAB = ClosestPointOnSegment(point, a, ab);
+	Vector3T<T> onBC = ClosestPointOnSegment(point, b, bc);
+	Vector3T<T> onCA = ClosestPointOnSegment(point, c, ca);
+	Vector3T<T> toAB = Subtract(point, onAB);
+	Vector3T<T> toBC = Subtract(point, onBC);
+	Vector3T<T> toCA = Subtract(point, onCA);
+	T distanceAB = Dot(toAB, toAB);
+	T distanceBC = Dot(toBC, toBC);
+	T distanceCA = Dot(toCA, toCA);
+	Vector3T<T> onEdge = Select(distanceBC < distanceAB, onBC, onAB);
+	onEdge = Select(distanceCA < Min(distanceAB, distanceBC), onCA, onEdge);
+
+	return Select(isInside, projected, onEdge);
+}
+
+template<typename T>
+Vector3T<T> ClosestPointOnAABB(const Vector3T<T>& point, const Vector3T<T>& min, const Vector3T<T>& max) {
+	return Clamp(point, min, max);
+}
+
+/// <summary>
+/// OBB上の最近接点(各軸に射影してサイズの範囲に収める)
+/// </summary>
+template<typename T>
+Vector3T<T> ClosestPointOnOBB(const Vector3T<T>& point, const Vector3T<T>& center, const Vector3T<T> orientations[3], const Vector3T<T>& size) {
+	Vector3T<T> toPoint = Subtract(point, center);
+	T x = Clamp(Dot(toPoint, orientations[0]), -size.x, size.x);
+	T y = Clamp(Dot(toPoint, orientations[1]), -size.y, size.y);
+	T z = Clamp(Dot(toPoint, orientations[2]), -size.z, size.z);
+	return Add(Add(Add(center, Multiply(x, orientations[0])), Multiply(y, orientations[1])), Multiply(z, orientations[2]));
+}
+
+template<typename T>
+T DistanceSquared(const Vector3T<T>& v1, const Vector3T<T>& v2) {
+	Vector3T<T> difference = Subtract(v1, v2);
+	return Dot(difference, difference);
+}
+
+// ---- 1対1 ----
+
+// 正射影ベクトル
+Vector3 Project(const Vector3& v1, const Vector3& v2) {
+	Vector3 direction = Normalize(v2);
+	return Multiply(Dot(v1, direction), direction);
+}
+
+// 線分上の最近接点(線分の範囲に収める)
+Vector3 ClosestPoint(const Vector3& point, const Segment& segment) {
+	return ClosestPointOnSegment(point, segment.origin, segment.diff);
+}
+
+// 三角形上の最近接点
+Vector3 ClosestPoint(const Vector3& point, const Triangle& triangle) {
+	return ClosestPointOnTriangle(point, triangle.vertices[0], triangle.vertices[1], triangle.vertices[2]);
+}
+
+// AABB上の最近接点(内側なら点そのもの)
+Vector3 ClosestPoint(const Vector3& point, const AABB& aabb) {
+	return ClosestPointOnAABB(point, aabb.min, aabb.max);
+}
+
+// OBB上の最近接点(内側なら点そのもの)
+Vector3 ClosestPoint(const Vector3& point, const OBB& obb) {
+	return ClosestPointOnOBB(point, obb.center, obb.orientations, obb.size);
+}
+
+/// <summary>
+/// 線分同士の最近接点
+/// </summary>
+/// <param name="segment1">線分1</param>
+/// <param name="segment2">線分2</param>
+/// <param name="point1">線分1上の最近接点の出力</param>
+/// <param name="point2">線分2上の最近接点の出力</param>
+/// <returns>距離の2乗</returns>
+float ClosestPoints(const Segment& segment1, const Segment& segment2, Vector3& point1, Vector3& point2) {
+	float s, t;
+	float distanceSquared = ClosestParametersSegmentSegment(segment1.origin, segment1.diff, segment2.origin, segment2.diff, s, t);
+	point1 = Add(segment1.origin, Multiply(s, segment1.diff));
+	point2 = Add(segment2.origin, Multiply(t, segment2.diff));
+	return distanceSquared;
+}
+
+// 点と線分の距離の2乗
+float DistanceSquared(const Vector3& point, const Segment& segment) { return DistanceSquared(point, ClosestPoint(point, segment)); }
+// 点と三角形の距離の2乗
+float DistanceSquared(const Vector3& point, const Triangle& triangle) { return DistanceSquared(point, ClosestPoint(point, triangle)); }
+// 点とAABBの距離の2乗
+float DistanceSquared(const Vector3& point, const AABB& aabb) { return DistanceSquared(point, ClosestPoint(point, aabb)); }
+// 点とOBBの距離の2乗
+float DistanceSquared(const Vector3& point, const OBB& obb) { return DistanceSquared(point, ClosestPoint(point, obb)); }
+
+// 線分同士の距離の2乗
+float DistanceSquared(const Segment& segment1, const Segment& segment2) {
+	float s, t;
+	return ClosestParametersSegmentSegment(segment1.origin, segment1.diff, segment2.origin, segment2.diff, s, t);
+}
+
+// ---- SoA ----
+// 各構造体は DistanceSquared<T>(query, index) で index からレーン数分の距離の2乗を返す
+
+// 線分の配列
+struct SegmentSoA {
+	std::vector<float> originX, originY, originZ;
+	std::vector<float> diffX, diffY, diffZ;
+
+	void Add(const Segment& segment) {
+		originX.push_back(segment.origin.x); originY.push_back(segment.origin.y); originZ.push_back(segment.origin.z);
+		diffX.push_back(segment.diff.x); diffY.push_back(segment.diff.y); diffZ.push_back(segment.diff.z);
+	}
+	void Clear() {
+		originX.clear(); originY.clear(); originZ.clear();
+		diffX.clear(); diffY.clear(); diffZ.clear();
+	}
+	size_t Size() const { return originX.size(); }
+
+	template<typename T>
+	Vector3T<T> LoadOrigin(size_t i) const { return { LoadLanes<T>(&originX[i]), LoadLanes<T>(&originY[i]), LoadLanes<T>(&originZ[i]) }; }
+	template<typename T>
+	Vector3T<T> LoadDiff(size_t i) const { return { LoadLanes<T>(&diffX[i]), LoadLanes<T>(&diffY[i]), LoadLanes<T>(&diffZ[i]) }; }
+
+	// 点との距離の2乗
+	template<typename T>
+	T DistanceSquared(const Vector3T<T>& point, size_t i) const {
+		return ::DistanceSquared(point, ClosestPointOnSegment(point, LoadOrigin<T>(i), LoadDiff<T>(i)));
+	}
+
+	// 線分との距離の2乗
+	template<typename T>
+	T DistanceSquared(const SegmentT<T>& segment, size_t i) const {
+		T s, t;
+		return ClosestParametersSegmentSegment(segment.origin, segment.diff, LoadOrigin<T>(i), LoadDiff<T>(i), s, t);
+	}
+};
+
+// 三角形の配列
+struct TriangleSoA {
+	std::vector<float> x[3], y[3], z[3]; // 頂点ごと
+
+	void Add(const Triangle& triangle) {
+		for (int v = 0; v < 3; ++v) {
+			x[v].push_back(triangle.vertices[v].x);
+			y[v].push_back(triangle.vertices[v].y);
+			z[v].push_back(triangle.vertices[v].z);
+		}
+	}
+	void Clear() {
+		for (int v = 0; v < 3; ++v) {
+			x[v].clear(); y[v].clear(); z[v].clear();
+		}
+	}
+	size_t Size() const { return x[0].size(); }
+
+	template<typename T>
+	Vector3T<T> LoadVertex(int v, size_t i) const { return { LoadLanes<T>(&x[v][i]), LoadLanes<T>(&y[v][i]), LoadLanes<T>(&z[v][i]) }; }
+
+	template<typename T>
+	T DistanceSquared(const Vector3T<T>& point, size_t i) const {
+		return ::DistanceSquared(point, ClosestPointOnTriangle(point, LoadVertex<T>(0, i), LoadVertex<T>(1, i), LoadVertex<T>(2, i)));
+	}
+};
+
+// AABBの配列
+struct AABBSoA {
+	std::vector<float> minX, minY, minZ;
+	std::vector<float> maxX, maxY, maxZ;
+
+	void Add(const AABB& aabb) {
+		minX.push_back(aabb.min.x); minY.push_back(aabb.min.y); minZ.push_back(aabb.min.z);
+		maxX.push_back(aabb.max.x); maxY.push_back(aabb.max.y); maxZ.push_back(aabb.max.z);
+	}
+	void Clear() {
+		minX.clear(); minY.clear(); minZ.clear();
+		maxX.clear(); maxY.clear(); maxZ.clear();
+	}
+	size_t Size() const { return minX.size(); }
+
+	template<typename T>
+	T DistanceSquared(const Vector3T<T>& point, size_t i) const {
+		Vector3T<T> min = { LoadLanes<T>(&minX[i]), LoadLanes<T>(&minY[i]), LoadLanes<T>(&minZ[i]) };
+		Vector3T<T> max = { LoadLanes<T>(&maxX[i]), LoadLanes<T>(&maxY[i]), LoadLanes<T>(&maxZ[i]) };
+		return ::DistanceSquared(point, ClosestPointOnAABB(point, min, max));
+	}
+};
+
+// OBBの配列
+struct OBBSoA {
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> axisX[3], axisY[3], axisZ[3]; // 軸ごと
+	std::vector<float> sizeX, sizeY, sizeZ;
+
+	void Add(const OBB& obb) {
+		centerX.push_back(obb.center.x); centerY.push_back(obb.center.y); centerZ.push_back(obb.center.z);
+		for (int axis = 0; axis < 3; ++axis) {
+			axisX[axis].push_back(obb.orientations[axis].x);
+			axisY[axis].push_back(obb.orientations[axis].y);
+			axisZ[axis].push_back(obb.orientations[axis].z);
+		}
+		sizeX.push_back(obb.size.x); sizeY.push_back(obb.size.y); sizeZ.push_back(obb.size.z);
+	}
+	void Clear() {
+		centerX.clear(); centerY.clear(); centerZ.clear();
+		for (int axis = 0; axis < 3; ++axis) {
+			axisX[axis].clear(); axisY[axis].clear(); axisZ[axis].clear();
+		}
+		sizeX.clear(); sizeY.clear(); sizeZ.clear();
+	}
+	size_t Size() const { return centerX.size(); }
+
+	template<typename T>
+	T DistanceSquared(const Vector3T<T>& point, size_t i) const {
+		Vector3T<T> center = { LoadLanes<T>(&centerX[i]), LoadLanes<T>(&centerY[i]), LoadLanes<T>(&centerZ[i]) };
+		Vector3T<T> orientations[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			orientations[axis] = { LoadLanes<T>(&axisX[axis][i]), LoadLanes<T>(&axisY[axis][i]), LoadLanes<T>(&axisZ[axis][i]) };
+		}
+		Vector3T<T> size = { LoadLanes<T>(&sizeX[i]), LoadLanes<T>(&sizeY[i]), LoadLanes<T>(&sizeZ[i]) };
+		return ::DistanceSquared(point, ClosestPointOnOBB(point, center, orientations, size));
+	}
+};
+
+// ---- 1対多 ----
+
+// 問い合わせをすべてのレーンに入れる
+template<typename L>
+Vector3T<L> SplatQuery(const Vector3& point) {
+	return { L(point.x), L(point.y), L(point.z) };
+}
+
+template<typename L>
+SegmentT<L> SplatQuery(const Segment& segment) {
+	return { SplatQuery<L>(segment.origin), SplatQuery<L>(segment.diff) };
+}
+
+/// <summary>
+/// 1つの点(または線分)と多数の形状の距離の2乗をまとめて求める
+/// </summary>
+/// <param name="query">点または線分</param>
+/// <param name="primitives">SegmentSoA/TriangleSoA/AABBSoA/OBBSoA</param>
+/// <param name="distancesSquared">距離の2乗の出力(primitives.Size() 個)</param>
+template<typename Query, typename SoA>
+void DistanceSquaredBatch(const Query& query, const SoA& primitives, float* distancesSquared) {
+	MT3_PROFILE_SCOPE("DistanceSquaredBatch");
+	using L = FloatLanes;
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	const size_t count = primitives.Size();
+	auto laneQuery = SplatQuery<L>(query);
+	size_t i = 0;
+	for (; i + kWidth <= count; i += kWidth) {
+		StoreLanes(primitives.template DistanceSquared<L>(laneQuery, i), distancesSquared + i);
+	}
+	auto scalarQuery = SplatQuery<float>(query);
+	for (; i < count; ++i) {
+		distancesSquared[i] = primitives.template DistanceSquared<float>(scalarQuery, i);
+	}
+}
+
+/// <summary>
+/// 1つの点(または線分)に一番近い形状を探す
+/// </summary>
+/// <param name="query">点または線分</param>
+/// <param name="primitives">SegmentSoA/TriangleSoA/AABBSoA/OBBSoA</param>
+/// <param name="distanceSquared">一番近い形状との距離の2乗の出力(不要ならnullptr)</param>
+/// <returns>一番近い形状の番号(空なら SIZE_MAX)</returns>
+template<typename Query, typename SoA>
+size_t FindNearest(const Query& query, const SoA& primitives, float* distanceSquared = nullptr) {
+	MT3_PROFILE_SCOPE("FindNearest");
+	using L = FloatLanes;
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	const size_t count = primitives.Size();
+	const float kInfinity = (std::numeric_limits<float>::infinity)();
+	float bestDistance = kInfinity;
+	size_t bestIndex = (std::numeric_limits<size_t>::max)();
+
+	// レーンごとに最小値と番号を持っておき、最後にまとめる(番号は float で 2^24 まで正確)
+	auto laneQuery = SplatQuery<L>(query);
+	L laneBest = L(kInfinity);
+	L laneBestIndex = L(0.0f);
+	alignas(32) float offsets[kWidth];
+	for (int lane = 0; lane < kWidth; ++lane) {
+		offsets[lane] = float(lane);
+	}
+	L laneIndex = L::Load(offsets);
+	size_t i = 0;
+	for (; i + kWidth <= count; i += kWidth) {
+		L distance = primitives.template DistanceSquared<L>(laneQuery, i);
+		LaneMask<L> isCloser = distance < laneBest;
+		laneBest = Select(isCloser, distance, laneBest);
+		laneBestIndex = Select(isCloser, laneIndex, laneBestIndex);
+		laneIndex += L(float(kWidth));
+	}
+	alignas(32) float bests[kWidth];
+	alignas(32) float bestIndices[kWidth];
+	laneBest.Store(bests);
+	laneBestIndex.Store(bestIndices);
+	for (int lane = 0; lane < kWidth; ++lane) {
+		size_t index = size_t(bestIndices[lane]);
+		if (bests[lane] < bestDistance || (bests[lane] == bestDistance && bests[lane] < kInfinity && index < bestIndex)) {
+			bestDistance = bests[lane];
+			bestIndex = index;
+		}
+	}
+
+	auto scalarQuery = SplatQuery<float>(query);
+	for (; i < count; ++i) {
+		float distance = primitives.template DistanceSquared<float>(scalarQuery, i);
+		if (distance < bestDistance) {
+			bestDistance = distance;
+			bestIndex = i;
+		}
+	}
+	if (distanceSquared) {
+		*distanceSquared = bestDistance;
+	}
+	return bestIndex;
+}
\ No newline at end of file
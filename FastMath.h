@@ -0,0 +1,223 @@
+#pragma once
+#include "LaneMath.h"
+#include "Vector3.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+// 近似計算(高速版)
+// 既存の Normalize/Length/std::sin などは変えず、速度が必要な場所で明示的に使う
+// MT3_FAST_MATH を定義すると SinCos も近似版になる
+//
+// 最大誤差(float の ULP 単位)は下の定数のとおりで、VerifyFastMath と CheckFastMathError で確認する
+// (ScenarioRunner --kernels が毎回確認し、超えていれば失敗で終わる)
+
+// FastSinCos の誤差を保証する入力の範囲
+static const float kFastSinCosMaxRadian = 4096.0f;
+
+static const float kFastRsqrtMaxUlp = 4.0f;			// FastRsqrt
+static const float kFastLengthMaxUlp = 5.0f;		// FastLength(内積の丸めを含む)
+static const float kFastNormalizeMaxUlp = 6.0f;		// FastNormalize の各成分
+static const float kFastSinCosMaxUlp = 2.5f;		// FastSinCos の sin と cos(|radian| <= kFastSinCosMaxRadian)
+static const float kSinCosArrayMaxUlp = 0.0f;		// SinCosArray と FastSinCos の差(同じ値になる)
+
+// π/2 を4つに分けたもの
+// 1~3つ目は仮数が12ビット以下なので、|j| < 2^12 なら j 倍しても丸めが起きない
+static const float kHalfPiPart1 = 1.5703125f;
+static const float kHalfPiPart2 = 4.837512969970703125e-4f;
+static const float kHalfPiPart3 = 7.549533620476723e-8f;
+static const float kHalfPiPart4 = 2.5633440682570896e-12f;
+static const float kTwoOverPi = 0.636619772367581343f;
+
+/// <summary>
+/// 1/sqrt(v) の近似(推定値 + ニュートン法1回)
+/// </summary>
+/// <param name="v">正の値</param>
+template<typename T>
+T FastRsqrt(const T& v) {
+	T y = RsqrtEstimate(v);
+	return y * (T(1.5f) - T(0.5f) * v * y * y);
+}
+
+// 3次元ベクトルの長さ(近似)
+float FastLength(const Vector3& v) {
+	float lengthSquared = Dot(v, v);
+	if (lengthSquared == 0.0f) { return 0.0f; }
+	return lengthSquared * FastRsqrt(lengthSquared);
+}
+
+// 3次元ベクトルの正規化(近似、長さ0なら0ベクトル)
+Vector3 FastNormalize(const Vector3& v) {
+	float lengthSquared = Dot(v, v);
+	if (lengthSquared == 0.0f) { return { 0.0f, 0.0f, 0.0f }; }
+	return Multiply(FastRsqrt(lengthSquared), v);
+}
+
+/// <summary>
+/// sin と cos を同時に求める(範囲縮小を1回で済ませる多項式近似)
+/// T = float でも Float4/Float8 でも同じ結果になる
+/// </summary>
+/// <param name="radian">角度(ラジアン)</param>
+/// <param name="sinValue">sin の出力</param>
+/// <param name="cosValue">cos の出力</param>
+template<typename T>
+void FastSinCos(const T& radian, T& sinValue, T& cosValue) {
+	// radian = j * π/2 + r (|r| <= π/4)
+	T j = Round(radian * T(kTwoOverPi));
+	T r = (((radian - j * T(kHalfPiPart1)) - j * T(kHalfPiPart2)) - j * T(kHalfPiPart3)) - j * T(kHalfPiPart4);
+	T r2 = r * r;
+
+	// [-π/4, π/4] での最小最大近似
+	T s = r + r * r2 * (T(-1.6666654611e-1f) + r2 * (T(8.3321608736e-3f) + r2 * T(-1.9515295891e-4f)));
+	T c = T(1.0f) - T(0.5f) * r2 + r2 * r2 * (T(4.166664568298827e-2f) + r2 * (T(-1.388731625493765e-3f) + r2 * T(2.443315711809948e-5f)));
+
+	// 象限 q = j mod 4 で入れ替えと符号を決める
+	T quarter = Round(j * T(0.25f));
+	T q = j - T(4.0f) * Select(quarter > j * T(0.25f), quarter - T(1.0f), quarter);
+	LaneMask<T> isSwap = (q == T(1.0f)) | (q == T(3.0f));
+	T sinBase = Select(isSwap, c, s);
+	T cosBase = Select(isSwap, s, c);
+	sinValue = Select(q >= T(2.0f), -sinBase, sinBase);
+	cosValue = Select((q == T(1.0f)) | (q == T(2.0f)), -cosBase, cosBase);
+}
+
+/// <summary>
+/// sin と cos を同時に求める
+/// MT3_FAST_MATH が無ければ標準ライブラリと同じ値
+/// </summary>
+/// <param name="radian">角度(ラジアン)</param>
+/// <param name="sinValue">sin の出力</param>
+/// <param name="cosValue">cos の出力</param>
+void SinCos(float radian, float& sinValue, float& cosValue) {
+#if defined(MT3_FAST_MATH)
+	if (std::fabs(radian) <= kFastSinCosMaxRadian) {
+		FastSinCos(radian, sinValue, cosValue);
+		return;
+	}
+#endif
+	sinValue = std::sin(radian);
+	cosValue = std::cos(radian);
+}
+
+// double 版(常に標準ライブラリ)
+void SinCos(double radian, double& sinValue, double& cosValue) {
+	sinValue = std::sin(radian);
+	cosValue = std::cos(radian);
+}
+
+/// <summary>
+/// 配列の sin と cos をまとめて求める(SIMD)
+/// </summary>
+/// <param name="radians">角度の配列</param>
+/// <param name="count">要素数</param>
+/// <param name="sinValues">sin の出力(count 個)</param>
+/// <param name="cosValues">cos の出力(count 個)</param>
+void SinCosArray(const float* radians, size_t count, float* sinValues, float* cosValues) {
+	using L = FloatLanes;
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	size_t i = 0;
+	for (; i + kWidth <= count; i += kWidth) {
+		L sinLanes;
+		L cosLanes;
+		FastSinCos(L::Load(radians + i), sinLanes, cosLanes);
+		sinLanes.Store(sinValues + i);
+		cosLanes.Store(cosValues + i);
+	}
+	for (; i < count; ++i) {
+		FastSinCos(radians[i], sinValues[i], cosValues[i]);
+	}
+}
+
+// 近似計算の最大誤差(ULP)
+struct FastMathErrorReport {
+	float rsqrtUlp;			// FastRsqrt
+	float lengthUlp;		// FastLength
+	float normalizeUlp;		// FastNormalize の各成分
+	float sinUlp;			// FastSinCos の sin
+	float cosUlp;			// FastSinCos の cos
+	float arrayUlp;			// SinCosArray と FastSinCos の差
+};
+
+/// <summary>
+/// double で求めた正確な値と比べたときの誤差(ULP)
+/// </summary>
+/// <param name="value">近似値</param>
+/// <param name="exact">正確な値</param>
+float UlpError(float value, double exact) {
+	float rounded = float(exact);
+	float ulp = std::nextafter(std::fabs(rounded), (std::numeric_limits<float>::max)()) - std::fabs(rounded);
+	return float(std::fabs(double(value) - exact) / double(ulp));
+}
+
+/// <summary>
+/// 近似計算を正確な計算と比べて最大誤差を求める
+/// 先頭のコメントに書いた誤差を守れているかの確認用
+/// </summary>
+/// <param name="sampleCount">調べる値の数</param>
+FastMathErrorReport VerifyFastMath(uint32_t sampleCount = 1u << 20) {
+	FastMathErrorReport report = {};
+	uint32_t state = 0x12345678u;
+	auto random01 = [&state]() {
+		state = state * 1664525u + 1013904223u;
+		return float(state >> 8) / float(1u << 24);
+	};
+
+	const size_t kBatch = 256;
+	float radians[kBatch];
+	float sins[kBatch];
+	float coss[kBatch];
+	for (uint32_t done = 0; done < sampleCount; done += uint32_t(kBatch)) {
+		for (size_t i = 0; i < kBatch; ++i) {
+			// 0 付近と大きい値の両方を含める
+			radians[i] = (random01() * 2.0f - 1.0f) * ((i & 1) ? kFastSinCosMaxRadian : 8.0f);
+		}
+		SinCosArray(radians, kBatch, sins, coss);
+		for (size_t i = 0; i < kBatch; ++i) {
+			float sinValue;
+			float cosValue;
+			FastSinCos(radians[i], sinValue, cosValue);
+			report.sinUlp = (std::max)(report.sinUlp, UlpError(sinValue, std::sin(double(radians[i]))));
+			report.cosUlp = (std::max)(report.cosUlp, UlpError(cosValue, std::cos(double(radians[i]))));
+			report.arrayUlp = (std::max)(report.arrayUlp, UlpError(sins[i], double(sinValue)));
+			report.arrayUlp = (std::max)(report.arrayUlp, UlpError(coss[i], double(cosValue)));
+
+			// 1e-6 ~ 1e6 の範囲
+			float v = std::pow(10.0f, random01() * 12.0f - 6.0f);
+			report.rsqrtUlp = (std::max)(report.rsqrtUlp, UlpError(FastRsqrt(v), 1.0 / std::sqrt(double(v))));
+			Vector3 vector = { radians[i], sinValue * 3.0f, v };
+			double exactLength = std::sqrt(double(vector.x) * vector.x + double(vector.y) * vector.y + double(vector.z) * vector.z);
+			report.lengthUlp = (std::max)(report.lengthUlp, UlpError(FastLength(vector), exactLength));
+			Vector3 normalized = FastNormalize(vector);
+			report.normalizeUlp = (std::max)({ report.normalizeUlp,
+				UlpError(normalized.x, vector.x / exactLength), UlpError(normalized.y, vector.y / exactLength), UlpError(normalized.z, vector.z / exactLength) });
+		}
+	}
+	return report;
+}
+
+/// <summary>
+/// VerifyFastMath の結果が先頭に書いた誤差の範囲に収まっているか
+/// </summary>
+/// <param name="report">VerifyFastMath の結果</param>
+/// <param name="message">範囲を超えた項目の説明(収まっていれば空)</param>
+bool CheckFastMathError(const FastMathErrorReport& report, std::string& message) {
+	message.clear();
+	auto check = [&message](const char* name, float ulp, float maxUlp) {
+		if (!(ulp <= maxUlp)) {
+			char line[128];
+			std::snprintf(line, sizeof(line), "%s: %.3f ULP > %.3f ULP\n", name, ulp, maxUlp);
+			message += line;
+		}
+	};
+	check("FastRsqrt", report.rsqrtUlp, kFastRsqrtMaxUlp);
+	check("FastLength", report.lengthUlp, kFastLengthMaxUlp);
+	check("FastNormalize", report.normalizeUlp, kFastNormalizeMaxUlp);
+	check("FastSinCos(sin)", report.sinUlp, kFastSinCosMaxUlp);
+	check("FastSinCos(cos)", report.cosUlp, kFastSinCosMaxUlp);
+	check("SinCosArray", report.arrayUlp, kSinCosArrayMaxUlp);
+	return message.empty();
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// 固定時間刻みのシミュレーションと積分法
+// 描画のフレーム時間を貯めて決まった刻みでシミュレーションを進め、余った時間の割合で前後の状態を補間して描く
+
+// 積分法
+enum class Integrator {
+	SemiImplicitEuler,	// 半陰的オイラー法(1次、シンプレクティック)
+	VelocityVerlet,		// 速度ベルレ法(2次)
+	RungeKutta4,		// 4次のルンゲ・クッタ法
+	Symplectic4,		// 4次のシンプレクティック法(吉田の方法)
+};
+
+// ImGui などで表示する名前(Integrator の順)
+static const char* const kIntegratorNames[] = { "SemiImplicitEuler", "VelocityVerlet", "RungeKutta4", "Symplectic4" };
+
+/// <summary>
+/// 位置と速度を1ステップ進める
+/// T は float や Vector3 など、T + T と T * float ができる型
+/// 速度ベルレ法とシンプレクティック法は加速度が主に位置で決まる系向け
+/// (速度にもよる場合は、その時点の速度を渡す)
+/// </summary>
+/// <param name="integrator">積分法</param>
+/// <param name="position">位置</param>
+/// <param name="velocity">速度</param>
+/// <param name="deltaTime">刻み幅</param>
+/// <param name="acceleration">加速度 acceleration(position, velocity)</param>
+template<typename T, typename Acceleration>
+void Integrate(Integrator integrator, T& position, T& velocity, float deltaTime, const Acceleration& acceleration) {
+	switch (integrator) {
+	case Integrator::SemiImplicitEuler: {
+		velocity = velocity + acceleration(position, velocity) * deltaTime;
+		position = position + velocity * deltaTime;
+		break;
+	}
+	case Integrator::VelocityVerlet: {
+		T acceleration0 = acceleration(position, velocity);
+		position = position + velocity * deltaTime + acceleration0 * (0.5f * deltaTime * deltaTime);
+		T acceleration1 = acceleration(position, velocity + acceleration0 * deltaTime);
+		velocity = velocity + (acceleration0 + acceleration1) * (0.5f * deltaTime);
+		break;
+	}
+	case Integrator::RungeKutta4: {
+		float halfTime = 0.5f * deltaTime;
+		T k1x = velocity;
+		T k1v = acceleration(position, velocity);
+		T k2x = velocity + k1v * halfTime;
+		T k2v = acceleration(position + k1x * halfTime, k2x);
+		T k3x = velocity + k2v * halfTime;
+		T k3v = acceleration(position + k2x * halfTime, k3x);
+		T k4x = velocity + k3v * deltaTime;
+		T k4v = acceleration(position + k3x * deltaTime, k4x);
+		float sixth = deltaTime / 6.0f;
+		position = position + (k1x + k2x * 2.0f + k3x * 2.0f + k4x) * sixth;
+		velocity = velocity + (k1v + k2v * 2.0f + k3v * 2.0f + k4v) * sixth;
+		break;
+	}
+	case Integrator::Symplectic4: {
+		// 位置と速度を交互に c, d の重みで進める
+		const float w1 = 1.0f / (2.0f - std::cbrt(2.0f));
+		const float w0 = 1.0f - 2.0f * w1;
+		const float c[4] = { 0.5f * w1, 0.5f * (w0 + w1), 0.5f * (w0 + w1), 0.5f * w1 };
+		const float d[3] = { w1, w0, w1 };
+		for (int i = 0; i < 3; ++i) {
+			position = position + velocity * (c[i] * deltaTime);
+			velocity = velocity + acceleration(position, velocity) * (d[i] * deltaTime);
+		}
+		position = position + velocity * (c[3] * deltaTime);
+		break;
+	}
+	}
+}
+
+/// <summary>
+/// 前後の状態を補間する(描画用)
+/// </summary>
+/// <param name="previous">1ステップ前の状態</param>
+/// <param name="current">今の状態</param>
+/// <param name="alpha">FixedTimestep::GetAlpha()</param>
+template<typename T>
+T Interpolate(const T& previous, const T& current, float alpha) {
+	return previous + (current - previous) * alpha;
+}
+
+/// <summary>
+/// 固定時間刻みの時間の管理
+/// </summary>
+class FixedTimestep {
+public:
+	/// <param name="stepTime">1ステップの時間(秒)</param>
+	/// <param name="maxStepsPerFrame">1フレームで進める最大ステップ数(重いときに追いつこうとして止まるのを防ぐ)</param>
+	explicit FixedTimestep(float stepTime = 1.0f / 60.0f, uint32_t maxStepsPerFrame = 8)
+		: stepTime_(stepTime), maxStepsPerFrame_(maxStepsPerFrame) {}
+
+	/// <summary>
+	/// フレーム時間を貯めて、このフレームで進めるステップ数を返す
+	/// </summary>
+	/// <param name="frameTime">前のフレームからの経過時間(秒)</param>
+	uint32_t Advance(float frameTime) {
+		accumulator_ += (std::min)((std::max)(frameTime, 0.0f), stepTime_ * float(maxStepsPerFrame_));
+		uint32_t stepCount = uint32_t(accumulator_ / stepTime_);
+		accumulator_ -= float(stepCount) * stepTime_;
+		return stepCount;
+	}
+
+	// 次のステップまでに進んだ割合(0~1)、描画の補間に使う
+	float GetAlpha() const { return accumulator_ / stepTime_; }
+
+	float GetStepTime() const { return stepTime_; }
+
+	// 刻み幅を変える(貯めた時間は割合を保つ)
+	void SetStepTime(float stepTime) {
+		accumulator_ = GetAlpha() * stepTime;
+		stepTime_ = stepTime;
+	}
+
+	void Reset() { accumulator_ = 0.0f; }
+
+private:
+	float stepTime_;
+	uint32_t maxStepsPerFrame_;
+	float accumulator_ = 0.0f;
+};
+
+/// <summary>
+/// 実際のフレーム時間を測る
+/// </summary>
+class FrameTimer {
+public:
+	FrameTimer() : last_(std::chrono::steady_clock::now()) {}
+
+	// 前回呼んでからの経過時間(秒)
+	float Tick() {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		float elapsed = std::chrono::duration<float>(now - last_).count();
+		last_ = now;
+		return elapsed;
+	}
+
+private:
+	std::chrono::steady_clock::time_point last_;
+};
\ No newline at end of file
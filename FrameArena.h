@@ -0,0 +1,344 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+// フレームの間だけ使うメモリ
+// スレッドごとの線形アロケータから切り出し、フレームの終わりにまとめて捨てる
+// 足りなかったときだけヒープから確保し、次のリセットで1つのブロックにまとめるので、使う量が安定すればヒープを使わなくなる
+
+static const size_t kFrameArenaDefaultBlockSize = size_t(1) << 20;	// 最初に確保する大きさ
+static const uint32_t kFrameArenaMaxThreads = 64;					// 使用量を集計できるスレッド数の上限
+
+/// <summary>
+/// 線形アロケータ(個別の解放はせず、Reset でまとめて捨てる)
+/// 使うのは所有スレッドだけ(統計は他のスレッドから読める)
+/// </summary>
+class LinearArena {
+public:
+	/// <param name="blockSize">最初に確保する大きさ(バイト)</param>
+	explicit LinearArena(size_t blockSize = kFrameArenaDefaultBlockSize) : blockSize_(blockSize) {
+		AddBlock(blockSize_);
+	}
+
+	~LinearArena() {
+		for (Block& block : blocks_) {
+			std::free(block.data);
+		}
+	}
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	/// <summary>
+	/// メモリを切り出す
+	/// </summary>
+	/// <param name="size">大きさ(バイト)</param>
+	/// <param name="alignment">アラインメント(2のべき乗)</param>
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+		Block& block = blocks_.back();
+		uintptr_t begin = reinterpret_cast<uintptr_t>(block.data);
+		uintptr_t aligned = (begin + offset_ + alignment - 1) & ~uintptr_t(alignment - 1);
+		if (aligned + size > begin + block.size) {
+			return AllocateSlow(size, alignment);
+		}
+		offset_ = size_t(aligned - begin) + size;
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	// 型を指定して count 個切り出す(コンストラクタは呼ばない)
+	template<typename T>
+	T* AllocateArray(size_t count) {
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	/// <summary>
+	/// 切り出したメモリをすべて捨てる
+	/// ブロックが複数になっていたら、合計の大きさの1ブロックに作り直す
+	/// </summary>
+	void Reset() {
+		size_t used = GetUsedBytes();
+		lastUsedBytes_.store(used, std::memory_order_relaxed);
+		if (used > highWaterBytes_.load(std::memory_order_relaxed)) {
+			highWaterBytes_.store(used, std::memory_order_relaxed);
+		}
+		if (blocks_.size() > 1) {
+			size_t total = 0;
+			for (Block& block : blocks_) {
+				total += block.size;
+				std::free(block.data);
+			}
+			blocks_.clear();
+			capacityBytes_.store(0, std::memory_order_relaxed);
+			AddBlock(total);
+		}
+		usedBeforeCurrent_ = 0;
+		offset_ = 0;
+	}
+
+	// 今のフレームで使っている量(アラインメントの隙間を含む)
+	size_t GetUsedBytes() const { return usedBeforeCurrent_ + offset_; }
+	// 直前のリセットまでに使った量
+	size_t GetLastUsedBytes() const { return lastUsedBytes_.load(std::memory_order_relaxed); }
+	// リセットまでに使った量の最大
+	size_t GetHighWaterBytes() const { return highWaterBytes_.load(std::memory_order_relaxed); }
+	// 確保済みの大きさ
+	size_t GetCapacityBytes() const { return capacityBytes_.load(std::memory_order_relaxed); }
+	// ヒープから確保した回数
+	size_t GetHeapAllocationCount() const { return heapAllocationCount_.load(std::memory_order_relaxed); }
+
+private:
+	struct Block {
+		char* data;
+		size_t size;
+	};
+
+	void AddBlock(size_t size) {
+		char* data = static_cast<char*>(std::malloc(size));
+		if (!data) { throw std::bad_alloc(); }
+		blocks_.push_back({ data, size });
+		capacityBytes_.fetch_add(size, std::memory_order_relaxed);
+		heapAllocationCount_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// 今のブロックに入らないときは新しいブロックを足す
+	void* AllocateSlow(size_t size, size_t alignment) {
+		usedBeforeCurrent_ += blocks_.back().size;
+		AddBlock((std::max)(blockSize_, size + alignment));
+		offset_ = 0;
+		return Allocate(size, alignment);
+	}
+
+	size_t blockSize_;
+	std::vector<Block> blocks_;		// 使っているのは最後のブロック
+	size_t usedBeforeCurrent_ = 0;	// 最後より前のブロックの大きさの合計
+	size_t offset_ = 0;				// 最後のブロックで使った量
+	std::atomic<size_t> lastUsedBytes_ = 0;
+	std::atomic<size_t> highWaterBytes_ = 0;
+	std::atomic<size_t> capacityBytes_ = 0;
+	std::atomic<size_t> heapAllocationCount_ = 0;
+};
+
+/// <summary>
+/// スレッドごとのフレーム用アロケータの全体の状態
+/// </summary>
+struct FrameArenaState {
+	std::atomic<LinearArena*> arenas[kFrameArenaMaxThreads] = {};
+	std::atomic<uint32_t> threadCount{ 0 };
+	std::atomic<uint64_t> frame{ 0 };	// FrameArenaEndFrame で進む
+};
+
+FrameArenaState& GetFrameArenaState() {
+	static FrameArenaState state;
+	return state;
+}
+
+// 呼び出したスレッドのフレーム用アロケータ
+struct FrameArenaThread {
+	LinearArena* arena;
+	uint64_t frame;			// 最後にリセットしたフレーム
+	bool isManualReset;		// true なら自動でリセットしない
+};
+
+FrameArenaThread& GetFrameArenaThread() {
+	thread_local FrameArenaThread local = [] {
+		FrameArenaState& state = GetFrameArenaState();
+		// スレッドが終了しても集計で読めるよう解放しない
+		LinearArena* arena = new LinearArena();
+		uint32_t index = state.threadCount.fetch_add(1);
+		if (index < kFrameArenaMaxThreads) {
+			state.arenas[index].store(arena, std::memory_order_release);
+		}
+		return FrameArenaThread{ arena, state.frame.load(std::memory_order_relaxed), false };
+	}();
+	return local;
+}
+
+/// <summary>
+/// 呼び出したスレッドのフレーム用アロケータを取得
+/// FrameArenaEndFrame の後で最初に呼んだときにリセットされるので、切り出したメモリはそのフレームの間だけ使える
+/// </summary>
+LinearArena& GetFrameArena() {
+	FrameArenaThread& local = GetFrameArenaThread();
+	uint64_t frame = GetFrameArenaState().frame.load(std::memory_order_relaxed);
+	if (local.frame != frame && !local.isManualReset) {
+		local.arena->Reset();
+		local.frame = frame;
+	}
+	return *local.arena;
+}
+
+/// <summary>
+/// 呼び出したスレッドのフレーム用アロケータを自分でリセットするようにする
+/// フレームの区切りとずれて動くスレッド(描画準備など)が、区切りごとに GetFrameArena().Reset() を呼ぶ
+/// </summary>
+void SetFrameArenaManualReset(bool isManualReset) {
+	GetFrameArenaThread().isManualReset = isManualReset;
+}
+
+/// <summary>
+/// フレームの終了(メインスレッドで Novice::EndFrame の後に呼ぶ)
+/// 各スレッドのフレーム用アロケータは次に使うときにリセットされる
+/// </summary>
+void FrameArenaEndFrame() {
+	GetFrameArenaState().frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+// フレーム用アロケータの使用量
+struct FrameArenaReport {
+	uint32_t threadCount;
+	size_t lastUsedBytes;		// 直前のフレームで使った量(全スレッドの合計)
+	size_t highWaterBytes;		// 1スレッドが1フレームで使った量の最大
+	size_t capacityBytes;		// 確保済みの大きさ(全スレッドの合計)
+	size_t heapAllocationCount;	// ヒープから確保した回数(全スレッドの合計、安定すれば増えない)
+};
+
+/// <summary>
+/// 全スレッドのフレーム用アロケータの使用量を集計する
+/// </summary>
+FrameArenaReport GetFrameArenaReport() {
+	FrameArenaState& state = GetFrameArenaState();
+	FrameArenaReport report = {};
+	report.threadCount = (std::min)(state.threadCount.load(std::memory_order_acquire), kFrameArenaMaxThreads);
+	for (uint32_t i = 0; i < report.threadCount; ++i) {
+		LinearArena* arena = state.arenas[i].load(std::memory_order_acquire);
+		if (!arena) { continue; }
+		report.lastUsedBytes += arena->GetLastUsedBytes();
+		report.highWaterBytes = (std::max)(report.highWaterBytes, arena->GetHighWaterBytes());
+		report.capacityBytes += arena->GetCapacityBytes();
+		report.heapAllocationCount += arena->GetHeapAllocationCount();
+	}
+	return report;
+}
+
+/// <summary>
+/// LinearArena から切り出す STL 用アロケータ(deallocate は何もしない)
+/// 既定ではそのスレッドのフレーム用アロケータを使う
+/// </summary>
+template<typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	ArenaAllocator() : arena_(&GetFrameArena()) {}
+	explicit ArenaAllocator(LinearArena& arena) : arena_(&arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.GetArena()) {}
+
+	T* allocate(size_t count) { return arena_->AllocateArray<T>(count); }
+	void deallocate(T*, size_t) {}
+
+	LinearArena* GetArena() const { return arena_; }
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.GetArena(); }
+
+private:
+	LinearArena* arena_;
+};
+
+// フレームの間だけ使う配列(フレームをまたいで持たないこと)
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+/// <summary>
+/// 同じ大きさのブロックを使い回すプール(BVH や木のノードなど長く使うもの向け)
+/// チャンク単位でまとめて確保し、解放したブロックはリストにつないで再利用する
+/// スレッドセーフではない
+/// </summary>
+class BlockPool {
+public:
+	/// <param name="blockSize">ブロックの大きさ(バイト)</param>
+	/// <param name="blockAlignment">ブロックのアラインメント(2のべき乗)</param>
+	/// <param name="blocksPerChunk">1回に確保するブロック数</param>
+	BlockPool(size_t blockSize, size_t blockAlignment = alignof(std::max_align_t), size_t blocksPerChunk = 256)
+		: blockAlignment_((std::max)(blockAlignment, alignof(FreeBlock))), blocksPerChunk_(blocksPerChunk) {
+		size_t size = (std::max)(blockSize, sizeof(FreeBlock));
+		stride_ = (size + blockAlignment_ - 1) & ~(blockAlignment_ - 1);
+	}
+
+	~BlockPool() {
+		for (void* chunk : chunks_) {
+			::operator delete(chunk, std::align_val_t(blockAlignment_));
+		}
+	}
+
+	BlockPool(const BlockPool&) = delete;
+	BlockPool& operator=(const BlockPool&) = delete;
+
+	void* Allocate() {
+		if (!freeList_) {
+			AddChunk();
+		}
+		FreeBlock* block = freeList_;
+		freeList_ = block->next;
+		++allocatedCount_;
+		return block;
+	}
+
+	void Free(void* pointer) {
+		if (!pointer) { return; }
+		FreeBlock* block = static_cast<FreeBlock*>(pointer);
+		block->next = freeList_;
+		freeList_ = block;
+		--allocatedCount_;
+	}
+
+	// 使用中のブロック数
+	size_t GetAllocatedCount() const { return allocatedCount_; }
+	// 確保済みのブロック数
+	size_t GetCapacity() const { return chunks_.size() * blocksPerChunk_; }
+
+private:
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	void AddChunk() {
+		char* chunk = static_cast<char*>(::operator new(stride_ * blocksPerChunk_, std::align_val_t(blockAlignment_)));
+		chunks_.push_back(chunk);
+		// 先頭から順に使われるよう後ろからつなぐ
+		for (size_t i = blocksPerChunk_; i-- > 0;) {
+			FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * stride_);
+			block->next = freeList_;
+			freeList_ = block;
+		}
+	}
+
+	size_t blockAlignment_;
+	size_t blocksPerChunk_;
+	size_t stride_;
+	std::vector<void*> chunks_;
+	FreeBlock* freeList_ = nullptr;
+	size_t allocatedCount_ = 0;
+};
+
+/// <summary>
+/// 型付きの BlockPool
+/// </summary>
+template<typename T>
+class ObjectPool {
+public:
+	explicit ObjectPool(size_t objectsPerChunk = 256) : pool_(sizeof(T), alignof(T), objectsPerChunk) {}
+
+	template<typename... Args>
+	T* Create(Args&&... args) {
+		return new (pool_.Allocate()) T(std::forward<Args>(args)...);
+	}
+
+	void Destroy(T* object) {
+		if (!object) { return; }
+		object->~T();
+		pool_.Free(object);
+	}
+
+	size_t GetAllocatedCount() const { return pool_.GetAllocatedCount(); }
+
+private:
+	BlockPool pool_;
+};
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+#include "FrameArena.h"
+#include "LineList.h"
+#include "Profiler.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+/// <summary>
+/// 更新と描画準備を2段に分けて並列に動かす
+/// メインスレッドがフレーム N + 1 を更新している間に、描画準備スレッドがフレーム N のスナップショットから線分を作る
+/// スナップショットと線分は2つずつ持ち、フレーム番号の atomic だけで受け渡す(ロックは使わない)
+/// 描画は1フレーム遅れる
+/// </summary>
+template<typename Snapshot>
+class FramePipeline {
+public:
+	// prepare(snapshot, lineList) スナップショットから描画する線分を作る(描画準備スレッドで呼ばれる)
+	using PrepareFunction = std::function<void(const Snapshot&, LineList&)>;
+
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="prepare">描画準備の関数</param>
+	/// <param name="isThreaded">false なら Submit の中でそのまま準備する(遅れ無し、デバッグ用)</param>
+	explicit FramePipeline(PrepareFunction prepare, bool isThreaded = true)
+		: prepare_(std::move(prepare)), isThreaded_(isThreaded) {
+		if (isThreaded_) {
+			thread_ = std::thread([this] { PrepareLoop(); });
+		}
+	}
+
+	~FramePipeline() {
+		if (thread_.joinable()) {
+			isQuit_.store(true, std::memory_order_relaxed);
+			published_.fetch_add(1, std::memory_order_release);
+			published_.notify_one();
+			thread_.join();
+		}
+	}
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	// 次のフレームのスナップショットを書き込む場所(メインスレッドから)
+	Snapshot& GetSnapshot() { return slots_[frame_ % 2].snapshot; }
+
+	/// <summary>
+	/// 書き込んだスナップショットを描画準備に渡し、1フレーム前の線分を受け取る
+	/// 返した線分は次の Submit まで有効(最初のフレームは空)
+	/// </summary>
+	const LineList& Submit() {
+		uint64_t frame = frame_++;
+		if (!isThreaded_) {
+			Slot& slot = slots_[frame % 2];
+			slot.lineList.Clear();
+			prepare_(slot.snapshot, slot.lineList);
+			return slot.lineList;
+		}
+
+		published_.store(frame + 1, std::memory_order_release);
+		published_.notify_one();
+		if (frame == 0) {
+			return emptyLineList_;
+		}
+
+		// 1フレーム前の準備が終わるのを待つ
+		MT3_PROFILE_SCOPE("FramePipeline::Wait");
+		uint64_t completed = completed_.load(std::memory_order_acquire);
+		while (completed < frame) {
+			completed_.wait(completed, std::memory_order_acquire);
+			completed = completed_.load(std::memory_order_acquire);
+		}
+		return slots_[(frame - 1) % 2].lineList;
+	}
+
+private:
+	struct Slot {
+		Snapshot snapshot;
+		LineList lineList;
+	};
+
+	// 描画準備スレッド: 渡されたフレームを順番に1つずつ処理する
+	void PrepareLoop() {
+		// フレームの区切りがメインスレッドとずれるので、フレーム用アロケータは準備ごとに自分でリセットする
+		SetFrameArenaManualReset(true);
+		uint64_t next = 0;
+		while (true) {
+			uint64_t published = published_.load(std::memory_order_acquire);
+			while (published <= next) {
+				published_.wait(published, std::memory_order_acquire);
+				published = published_.load(std::memory_order_acquire);
+			}
+			if (isQuit_.load(std::memory_order_relaxed)) { return; }
+
+			{
+				MT3_PROFILE_SCOPE("FramePipeline::Prepare");
+				GetFrameArena().Reset();
+				Slot& slot = slots_[next % 2];
+				slot.lineList.Clear();
+				prepare_(slot.snapshot, slot.lineList);
+			}
+			++next;
+			completed_.store(next, std::memory_order_release);
+			completed_.notify_one();
+		}
+	}
+
+	PrepareFunction prepare_;
+	bool isThreaded_;
+	Slot slots_[2];
+	LineList emptyLineList_;
+	uint64_t frame_ = 0;						// 次に書き込むフレーム(メインスレッドだけが触る)
+	std::atomic<uint64_t> published_ = 0;		// 渡したフレーム数
+	std::atomic<uint64_t> completed_ = 0;		// 準備が終わったフレーム数
+	std::atomic<bool> isQuit_ = false;
+	std::thread thread_;
+};
\ No newline at end of file
@@ -0,0 +1,678 @@
+#pragma once
+#include "Collision.h"
+#include "Shape.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// GJK(距離・交差判定)と EPA(めり込み量と法線)
+// 形状はサポート関数(ある方向に一番遠い点)と、球のような丸みの半径(マージン)で表す
+// 球は中心1点 + 半径として扱うので、丸みのある形状でも GJK は多面体として早く収束する
+
+static const int kGjkMaxIterations = 64;
+static const int kEpaMaxIterations = 64;
+static const float kGjkRelativeTolerance = 1.0e-6f;	// 収束判定(距離の2乗に対する割合)
+static const float kGjkEpsilon = 1.0e-10f;			// これ以下の距離の2乗は重なりとみなす
+static const float kGjkDegenerateTolerance = 1.0e-5f;	// 三角形・四面体が潰れているとみなす高さ(辺の長さに対する割合)
+static const float kEpaTolerance = 1.0e-4f;			// 面の距離の伸びがこれ以下なら終了
+
+// ---- サポート関数 ----
+
+Vector3 GetSupport(const Sphere& sphere, const Vector3&) { return sphere.center; }
+float GetMargin(const Sphere& sphere) { return sphere.radius; }
+
+Vector3 GetSupport(const AABB& aabb, const Vector3& direction) {
+	return {
+		direction.x >= 0.0f ? aabb.max.x : aabb.min.x,
+		direction.y >= 0.0f ? aabb.max.y : aabb.min.y,
+		direction.z >= 0.0f ? aabb.max.z : aabb.min.z
+	};
+}
+float GetMargin(const AABB&) { return 0.0f; }
+
+Vector3 GetSupport(const OBB& obb, const Vector3& direction) {
+	Vector3 result = obb.center;
+	const float sizes[3] = { obb.size.x, obb.size.y, obb.size.z };
+	for (int axis = 0; axis < 3; ++axis) {
+		float sign = Dot(direction, obb.orientations[axis]) >= 0.0f ? 1.0f : -1.0f;
+		result = Add(result, Multiply(sign * sizes[axis], obb.orientations[axis]));
+	}
+	return result;
+}
+float GetMargin(const OBB&) { return 0.0f; }
+
+Vector3 GetSupport(const Triangle& triangle, const Vector3& direction) {
+	float d0 = Dot(triangle.vertices[0], direction);
+	float d1 = Dot(triangle.vertices[1], direction);
+	float d2 = Dot(triangle.vertices[2], direction);
+	if (d0 >= d1 && d0 >= d2) { return triangle.vertices[0]; }
+	return d1 >= d2 ? triangle.vertices[1] : triangle.vertices[2];
+}
+float GetMargin(const Triangle&) { return 0.0f; }
+
+Vector3 GetSupport(const Segment& segment, const Vector3& direction) {
+	return Dot(segment.diff, direction) > 0.0f ? Add(segment.origin, segment.diff) : segment.origin;
+}
+float GetMargin(const Segment&) { return 0.0f; }
+
+// ---- 単体(シンプレックス) ----
+
+// ミンコフスキー差 A - B 上の点
+struct GjkVertex {
+	Vector3 w;			// a - b
+	Vector3 a;			// A 上の点
+	Vector3 b;			// B 上の点
+	Vector3 direction;	// 求めたときの方向(次のフレームで使う)
+};
+
+struct GjkSimplex {
+	GjkVertex vertices[4];
+	float weights[4];	// 原点への最近接点の重心座標
+	int count;
+};
+
+/// <summary>
+/// 前回の単体の方向を覚えておき、次の問い合わせの初期値にする
+/// 同じペアを毎フレーム調べるときにペアごとに1つ持つ
+/// </summary>
+struct GjkCache {
+	Vector3 directions[4];
+	int count = 0;
+};
+
+template<typename ShapeA, typename ShapeB>
+GjkVertex GetMinkowskiSupport(const ShapeA& a, const ShapeB& b, const Vector3& direction) {
+	GjkVertex vertex;
+	vertex.a = GetSupport(a, direction);
+	vertex.b = GetSupport(b, Multiply(-1.0f, direction));
+	vertex.w = Subtract(vertex.a, vertex.b);
+	vertex.direction = direction;
+	return vertex;
+}
+
+// 単体を指定した頂点だけに減らす
+void ReduceSimplex(GjkSimplex& simplex, int i0, int i1 = -1, int i2 = -1) {
+	GjkVertex vertices[3] = { simplex.vertices[i0] };
+	int count = 1;
+	if (i1 >= 0) { vertices[count++] = simplex.vertices[i1]; }
+	if (i2 >= 0) { vertices[count++] = simplex.vertices[i2]; }
+	for (int i = 0; i < count; ++i) {
+		simplex.vertices[i] = vertices[i];
+	}
+	simplex.count = count;
+}
+
+/// <summary>
+/// 線分上の原点への最近接点(重心座標を求めて不要な頂点を落とす)
+/// </summary>
+Vector3 SolveGjkSegment(GjkSimplex& simplex, int i0, int i1) {
+	const Vector3 a = simplex.vertices[i0].w;
+	Vector3 ab = Subtract(simplex.vertices[i1].w, a);
+	float lengthSquared = Dot(ab, ab);
+	// 同じ点が2つあるときは1点として扱う
+	float t = lengthSquared > 0.0f ? -Dot(a, ab) / lengthSquared : 0.0f;
+	if (t <= 0.0f) {
+		ReduceSimplex(simplex, i0);
+		simplex.weights[0] = 1.0f;
+		return a;
+	}
+	if (t >= 1.0f) {
+		ReduceSimplex(simplex, i1);
+		simplex.weights[0] = 1.0f;
+		return simplex.vertices[0].w;
+	}
+	ReduceSimplex(simplex, i0, i1);
+	simplex.weights[0] = 1.0f - t;
+	simplex.weights[1] = t;
+	return Add(a, Multiply(t, ab));
+}
+
+/// <summary>
+/// 三角形上の原点への最近接点(重心座標を求めて不要な頂点を落とす)
+/// </summary>
+Vector3 SolveGjkTriangle(GjkSimplex& simplex, int i0, int i1, int i2) {
+	// ReduceSimplex で並びが変わるのでコピーしておく
+	const Vector3 a = simplex.vertices[i0].w;
+	const Vector3 b = simplex.vertices[i1].w;
+	const Vector3 c = simplex.vertices[i2].w;
+	Vector3 ab = Subtract(b, a);
+	Vector3 ac = Subtract(c, a);
+
+	// 潰れた三角形(同じ点や一直線上の点を含む)は重心座標が求まらないので、一番近い辺で代える
+	Vector3 normal = Cross(ab, ac);
+	if (Dot(normal, normal) <= kGjkDegenerateTolerance * kGjkDegenerateTolerance * Dot(ab, ab) * Dot(ac, ac)) {
+		const int kEdges[3][2] = { { i0, i1 }, { i0, i2 }, { i1, i2 } };
+		GjkSimplex best = simplex;
+		Vector3 bestPoint = {};
+		float bestDistance = (std::numeric_limits<float>::max)();
+		for (const int* edge : kEdges) {
+			GjkSimplex candidate = simplex;
+			Vector3 point = SolveGjkSegment(candidate, edge[0], edge[1]);
+			if (Dot(point, point) < bestDistance) {
+				bestDistance = Dot(point, point);
+				best = candidate;
+				bestPoint = point;
+			}
+		}
+		simplex = best;
+		return bestPoint;
+	}
+
+	// 頂点 a の領域
+	float d1 = -Dot(ab, a);
+	float d2 = -Dot(ac, a);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		ReduceSimplex(simplex, i0);
+		simplex.weights[0] = 1.0f;
+		return a;
+	}
+	// 頂点 b の領域
+	float d3 = -Dot(ab, b);
+	float d4 = -Dot(ac, b);
+	if (d3 >= 0.0f && d4 <= d3) {
+		ReduceSimplex(simplex, i1);
+		simplex.weights[0] = 1.0f;
+		return b;
+	}
+	// 辺 ab の領域
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		float t = d1 / (d1 - d3);
+		ReduceSimplex(simplex, i0, i1);
+		simplex.weights[0] = 1.0f - t;
+		simplex.weights[1] = t;
+		return Add(a, Multiply(t, ab));
+	}
+	// 頂点 c の領域
+	float d5 = -Dot(ab, c);
+	float d6 = -Dot(ac, c);
+	if (d6 >= 0.0f && d5 <= d6) {
+		ReduceSimplex(simplex, i2);
+		simplex.weights[0] = 1.0f;
+		return c;
+	}
+	// 辺 ac の領域
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		float t = d2 / (d2 - d6);
+		ReduceSimplex(simplex, i0, i2);
+		simplex.weights[0] = 1.0f - t;
+		simplex.weights[1] = t;
+		return Add(a, Multiply(t, ac));
+	}
+	// 辺 bc の領域
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		ReduceSimplex(simplex, i1, i2);
+		simplex.weights[0] = 1.0f - t;
+		simplex.weights[1] = t;
+		return Add(b, Multiply(t, Subtract(c, b)));
+	}
+	// 面の内側
+	float denominator = 1.0f / (va + vb + vc);
+	float v = vb * denominator;
+	float w = vc * denominator;
+	ReduceSimplex(simplex, i0, i1, i2);
+	simplex.weights[0] = 1.0f - v - w;
+	simplex.weights[1] = v;
+	simplex.weights[2] = w;
+	return Add(a, Add(Multiply(v, ab), Multiply(w, ac)));
+}
+
+/// <summary>
+/// 単体上の原点への最近接点を求め、単体をその点を表すのに必要な頂点だけにする
+/// </summary>
+/// <param name="simplex">単体</param>
+/// <param name="isEnclosed">原点を四面体が含んだらtrue</param>
+Vector3 SolveGjkSimplex(GjkSimplex& simplex, bool& isEnclosed) {
+	isEnclosed = false;
+	switch (simplex.count) {
+	case 1:
+		simplex.weights[0] = 1.0f;
+		return simplex.vertices[0].w;
+	case 2:
+		return SolveGjkSegment(simplex, 0, 1);
+	case 3:
+		return SolveGjkTriangle(simplex, 0, 1, 2);
+	default: {
+		// 原点が外側にある面の中から一番近いものを選ぶ
+		static const int kFaces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } };
+		GjkSimplex best = {};
+		float bestDistance = (std::numeric_limits<float>::max)();
+		Vector3 bestPoint = {};
+		bool isOutsideAny = false;
+		for (const int* face : kFaces) {
+			const Vector3& a = simplex.vertices[face[0]].w;
+			Vector3 normal = Cross(Subtract(simplex.vertices[face[1]].w, a), Subtract(simplex.vertices[face[2]].w, a));
+			Vector3 opposite = Subtract(simplex.vertices[face[3]].w, a);
+			float signOrigin = -Dot(a, normal);
+			float signOpposite = Dot(opposite, normal);
+			// 残りの頂点が面からほとんど離れていなければ四面体が潰れていて、符号は誤差なので面を調べる
+			bool isFlat = signOpposite * signOpposite <= kGjkDegenerateTolerance * kGjkDegenerateTolerance * Dot(normal, normal) * Dot(opposite, opposite);
+			// 原点と残りの頂点が面の反対側にある
+			if (signOrigin * signOpposite < 0.0f || isFlat) {
+				isOutsideAny = true;
+				GjkSimplex candidate = simplex;
+				Vector3 point = SolveGjkTriangle(candidate, face[0], face[1], face[2]);
+				float distance = Dot(point, point);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = candidate;
+					bestPoint = point;
+				}
+			}
+		}
+		if (!isOutsideAny) {
+			isEnclosed = true;
+			return { 0.0f, 0.0f, 0.0f };
+		}
+		simplex = best;
+		return bestPoint;
+	}
+	}
+}
+
+// 重心座標から A と B 上の最近接点を求める
+void GetGjkWitnessPoints(const GjkSimplex& simplex, Vector3& pointA, Vector3& pointB) {
+	pointA = { 0.0f, 0.0f, 0.0f };
+	pointB = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < simplex.count; ++i) {
+		pointA = Add(pointA, Multiply(simplex.weights[i], simplex.vertices[i].a));
+		pointB = Add(pointB, Multiply(simplex.weights[i], simplex.vertices[i].b));
+	}
+}
+
+// ---- GJK ----
+
+// GJK の結果(丸みを除いた芯の形状同士)
+struct GjkResult {
+	bool isOverlap;		// 芯が重なっている
+	float distance;		// 芯同士の距離
+	Vector3 pointA;		// A の芯上の最近接点
+	Vector3 pointB;		// B の芯上の最近接点
+	GjkSimplex simplex;	// 最後の単体(EPAの初期値)
+	int iterations;		// 反復回数
+};
+
+/// <summary>
+/// GJK で芯の形状同士の距離を求める
+/// </summary>
+/// <param name="a">形状A</param>
+/// <param name="b">形状B</param>
+/// <param name="cache">前回の単体(nullptrなら使わない、終了時に更新)</param>
+template<typename ShapeA, typename ShapeB>
+GjkResult RunGjk(const ShapeA& a, const ShapeB& b, GjkCache* cache) {
+	GjkResult result = {};
+	GjkSimplex& simplex = result.simplex;
+
+	// 前回の方向で単体を作り直す(無ければ中心の差の方向)
+	// 形状が動くと別の方向が同じ頂点を指すことがあるので、同じ点は1つにまとめる
+	if (cache && cache->count > 0) {
+		simplex.count = 0;
+		for (int i = 0; i < cache->count; ++i) {
+			GjkVertex vertex = GetMinkowskiSupport(a, b, cache->directions[i]);
+			bool isDuplicate = false;
+			for (int k = 0; k < simplex.count; ++k) {
+				Vector3 difference = Subtract(simplex.vertices[k].w, vertex.w);
+				if (Dot(difference, difference) <= kGjkEpsilon) {
+					isDuplicate = true;
+					break;
+				}
+			}
+			if (!isDuplicate) {
+				simplex.vertices[simplex.count++] = vertex;
+			}
+		}
+	} else {
+		Vector3 direction = Subtract(GetSupport(b, { 0.0f, 0.0f, 0.0f }), GetSupport(a, { 0.0f, 0.0f, 0.0f }));
+		if (Dot(direction, direction) <= kGjkEpsilon) {
+			direction = { 1.0f, 0.0f, 0.0f };
+		}
+		simplex.vertices[0] = GetMinkowskiSupport(a, b, direction);
+		simplex.count = 1;
+	}
+
+	bool isEnclosed = false;
+	Vector3 v = SolveGjkSimplex(simplex, isEnclosed);
+	float distanceSquared = Dot(v, v);
+	for (result.iterations = 0; result.iterations < kGjkMaxIterations; ++result.iterations) {
+		if (isEnclosed || distanceSquared <= kGjkEpsilon) {
+			result.isOverlap = true;
+			break;
+		}
+
+		GjkVertex vertex = GetMinkowskiSupport(a, b, Multiply(-1.0f, v));
+		// これ以上近づかない
+		if (distanceSquared - Dot(v, vertex.w) <= kGjkRelativeTolerance * distanceSquared) {
+			break;
+		}
+		bool isDuplicate = false;
+		for (int i = 0; i < simplex.count; ++i) {
+			if (std::memcmp(&simplex.vertices[i].w, &vertex.w, sizeof(Vector3)) == 0) {
+				isDuplicate = true;
+			}
+		}
+		if (isDuplicate) {
+			break;
+		}
+
+		GjkSimplex previous = simplex;
+		simplex.vertices[simplex.count++] = vertex;
+		Vector3 next = SolveGjkSimplex(simplex, isEnclosed);
+		float nextDistanceSquared = Dot(next, next);
+		// 数値誤差で遠ざかったら前の単体で終わる
+		if (!isEnclosed && nextDistanceSquared >= distanceSquared) {
+			simplex = previous;
+			break;
+		}
+		v = next;
+		distanceSquared = nextDistanceSquared;
+	}
+
+	if (result.isOverlap) {
+		result.distance = 0.0f;
+	} else {
+		result.distance = std::sqrt(distanceSquared);
+		GetGjkWitnessPoints(simplex, result.pointA, result.pointB);
+	}
+
+	if (cache) {
+		cache->count = simplex.count;
+		for (int i = 0; i < simplex.count; ++i) {
+			cache->directions[i] = simplex.vertices[i].direction;
+		}
+	}
+	return result;
+}
+
+// ---- EPA ----
+
+struct EpaFace {
+	int index[3];
+	Vector3 normal;		// 外向き(単位ベクトル)
+	float distance;		// 原点から面までの距離
+};
+
+/// <summary>
+/// 原点を含む単体を四面体まで膨らませる
+/// </summary>
+/// <returns>四面体が作れなかったら(形状が平ら)false</returns>
+template<typename ShapeA, typename ShapeB>
+bool ExpandSimplexToTetrahedron(const ShapeA& a, const ShapeB& b, GjkSimplex& simplex) {
+	static const Vector3 kAxes[6] = {
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+		{ 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+	};
+	if (simplex.count == 1) {
+		for (const Vector3& axis : kAxes) {
+			GjkVertex vertex = GetMinkowskiSupport(a, b, axis);
+			Vector3 difference = Subtract(vertex.w, simplex.vertices[0].w);
+			if (Dot(difference, difference) > kGjkEpsilon) {
+				simplex.vertices[simplex.count++] = vertex;
+				break;
+			}
+		}
+	}
+	if (simplex.count == 2) {
+		Vector3 line = Subtract(simplex.vertices[1].w, simplex.vertices[0].w);
+		Vector3 side = Normalize(Perpendicular(line));
+		Vector3 other = Normalize(Cross(line, side));
+		const Vector3 directions[4] = { side, Multiply(-1.0f, side), other, Multiply(-1.0f, other) };
+		for (const Vector3& direction : directions) {
+			GjkVertex vertex = GetMinkowskiSupport(a, b, direction);
+			Vector3 cross = Cross(line, Subtract(vertex.w, simplex.vertices[0].w));
+			if (Dot(cross, cross) > kGjkEpsilon) {
+				simplex.vertices[simplex.count++] = vertex;
+				break;
+			}
+		}
+	}
+	if (simplex.count == 3) {
+		Vector3 normal = Normalize(Cross(Subtract(simplex.vertices[1].w, simplex.vertices[0].w), Subtract(simplex.vertices[2].w, simplex.vertices[0].w)));
+		for (float sign : { 1.0f, -1.0f }) {
+			GjkVertex vertex = GetMinkowskiSupport(a, b, Multiply(sign, normal));
+			if (std::fabs(Dot(Subtract(vertex.w, simplex.vertices[0].w), normal)) > kEpaTolerance) {
+				simplex.vertices[simplex.count++] = vertex;
+				break;
+			}
+		}
+	}
+	return simplex.count == 4;
+}
+
+/// <summary>
+/// EPA でめり込み量と法線を求める
+/// </summary>
+/// <param name="a">形状A</param>
+/// <param name="b">形状B</param>
+/// <param name="simplex">原点を含む単体(GJKの結果)</param>
+/// <param name="normal">A から B へ押し出す向きの出力</param>
+/// <param name="pointA">A 上の点の出力</param>
+/// <param name="pointB">B 上の点の出力</param>
+/// <returns>めり込み量</returns>
+template<typename ShapeA, typename ShapeB>
+float RunEpa(const ShapeA& a, const ShapeB& b, GjkSimplex simplex, Vector3& normal, Vector3& pointA, Vector3& pointB) {
+	if (!ExpandSimplexToTetrahedron(a, b, simplex)) {
+		// 平らな形状同士で体積が無い
+		Vector3 line = Subtract(simplex.vertices[simplex.count > 1 ? 1 : 0].w, simplex.vertices[0].w);
+		normal = Dot(line, line) > kGjkEpsilon ? Normalize(Perpendicular(line)) : Vector3{ 0.0f, 1.0f, 0.0f };
+		pointA = simplex.vertices[0].a;
+		pointB = simplex.vertices[0].b;
+		return 0.0f;
+	}
+
+	std::vector<GjkVertex> vertices(simplex.vertices, simplex.vertices + 4);
+	std::vector<EpaFace> faces;
+	// 面の向きは多面体の内側の点(最初の四面体の重心)から外向きにそろえる
+	Vector3 interior = Multiply(0.25f, Add(Add(vertices[0].w, vertices[1].w), Add(vertices[2].w, vertices[3].w)));
+	auto addFace = [&](int i0, int i1, int i2) {
+		EpaFace face;
+		face.index[0] = i0;
+		face.index[1] = i1;
+		face.index[2] = i2;
+		Vector3 cross = Cross(Subtract(vertices[i1].w, vertices[i0].w), Subtract(vertices[i2].w, vertices[i0].w));
+		float length = Length(cross);
+		if (length <= 0.0f) { return; }
+		face.normal = Multiply(1.0f / length, cross);
+		if (Dot(face.normal, Subtract(vertices[i0].w, interior)) < 0.0f) {
+			face.normal = Multiply(-1.0f, face.normal);
+			std::swap(face.index[1], face.index[2]);
+		}
+		face.distance = Dot(face.normal, vertices[i0].w);
+		faces.push_back(face);
+	};
+	addFace(0, 1, 2);
+	addFace(0, 3, 1);
+	addFace(0, 2, 3);
+	addFace(1, 3, 2);
+
+	EpaFace closest = faces[0];
+	for (int iteration = 0; iteration < kEpaMaxIterations && !faces.empty(); ++iteration) {
+		// 原点に一番近い面
+		size_t closestIndex = 0;
+		for (size_t i = 1; i < faces.size(); ++i) {
+			if (faces[i].distance < faces[closestIndex].distance) {
+				closestIndex = i;
+			}
+		}
+		closest = faces[closestIndex];
+
+		GjkVertex vertex = GetMinkowskiSupport(a, b, closest.normal);
+		if (Dot(vertex.w, closest.normal) - closest.distance <= kEpaTolerance) {
+			break;
+		}
+
+		// 新しい点から見える面を消し、境界の辺と新しい点で面を張る
+		std::vector<std::pair<int, int>> edges;
+		for (size_t i = 0; i < faces.size();) {
+			const EpaFace& face = faces[i];
+			if (Dot(face.normal, Subtract(vertex.w, vertices[face.index[0]].w)) > 0.0f) {
+				for (int e = 0; e < 3; ++e) {
+					std::pair<int, int> edge = { face.index[e], face.index[(e + 1) % 3] };
+					// 逆向きの辺が既にあれば共有辺なので境界ではない
+					bool isShared = false;
+					for (size_t k = 0; k < edges.size(); ++k) {
+						if (edges[k].first == edge.second && edges[k].second == edge.first) {
+							edges.erase(edges.begin() + k);
+							isShared = true;
+							break;
+						}
+					}
+					if (!isShared) {
+						edges.push_back(edge);
+					}
+				}
+				faces[i] = faces.back();
+				faces.pop_back();
+			} else {
+				++i;
+			}
+		}
+		int newIndex = int(vertices.size());
+		vertices.push_back(vertex);
+		for (const std::pair<int, int>& edge : edges) {
+			addFace(edge.first, edge.second, newIndex);
+		}
+	}
+
+	// 原点を面に射影した点の重心座標から A と B 上の点を求める
+	const Vector3& p0 = vertices[closest.index[0]].w;
+	const Vector3& p1 = vertices[closest.index[1]].w;
+	const Vector3& p2 = vertices[closest.index[2]].w;
+	Vector3 projected = Multiply(closest.distance, closest.normal);
+	Vector3 v0 = Subtract(p1, p0);
+	Vector3 v1 = Subtract(p2, p0);
+	Vector3 v2 = Subtract(projected, p0);
+	float d00 = Dot(v0, v0);
+	float d01 = Dot(v0, v1);
+	float d11 = Dot(v1, v1);
+	float d20 = Dot(v2, v0);
+	float d21 = Dot(v2, v1);
+	float denominator = d00 * d11 - d01 * d01;
+	float weight1 = denominator != 0.0f ? (d11 * d20 - d01 * d21) / denominator : 0.0f;
+	float weight2 = denominator != 0.0f ? (d00 * d21 - d01 * d20) / denominator : 0.0f;
+	float weight0 = 1.0f - weight1 - weight2;
+	pointA = Add(Add(Multiply(weight0, vertices[closest.index[0]].a), Multiply(weight1, vertices[closest.index[1]].a)), Multiply(weight2, vertices[closest.index[2]].a));
+	pointB = Add(Add(Multiply(weight0, vertices[closest.index[0]].b), Multiply(weight1, vertices[closest.index[1]].b)), Multiply(weight2, vertices[closest.index[2]].b));
+
+	// A を -normal へ、B を normal へ depth だけ動かすと原点が A - B の外に出る
+	normal = closest.normal;
+	return closest.distance;
+}
+
+// ---- 問い合わせ ----
+
+/// <summary>
+/// 2つの凸形状の距離(重なっていれば0)
+/// 0を返したとき(重なっている・接している)は最近接点が決まらないので pointA と pointB は書き換えない
+/// </summary>
+/// <param name="a">形状A</param>
+/// <param name="b">形状B</param>
+/// <param name="pointA">A 上の最近接点の出力(nullptr可、0を返したときは書かない)</param>
+/// <param name="pointB">B 上の最近接点の出力(nullptr可、0を返したときは書かない)</param>
+/// <param name="cache">前回の単体(nullptr可)</param>
+template<typename ShapeA, typename ShapeB>
+float GjkDistance(const ShapeA& a, const ShapeB& b, Vector3* pointA = nullptr, Vector3* pointB = nullptr, GjkCache* cache = nullptr) {
+	GjkResult result = RunGjk(a, b, cache);
+	float margin = GetMargin(a) + GetMargin(b);
+	if (result.isOverlap || result.distance <= margin) {
+		return 0.0f;
+	}
+	// 芯の最近接点を丸みの分だけ相手へ寄せる
+	Vector3 direction = Multiply(1.0f / result.distance, Subtract(result.pointB, result.pointA));
+	if (pointA) { *pointA = Add(result.pointA, Multiply(GetMargin(a), direction)); }
+	if (pointB) { *pointB = Subtract(result.pointB, Multiply(GetMargin(b), direction)); }
+	return result.distance - margin;
+}
+
+// 2つの凸形状が重なっているか
+template<typename ShapeA, typename ShapeB>
+bool GjkIntersect(const ShapeA& a, const ShapeB& b, GjkCache* cache = nullptr) {
+	GjkResult result = RunGjk(a, b, cache);
+	return result.isOverlap || result.distance <= GetMargin(a) + GetMargin(b);
+}
+
+/// <summary>
+/// 2つの凸形状の衝突の詳細(GJK + EPA)
+/// normal は A から B へ押し出す向き、point は両形状の接触点の中点
+/// 数値誤差でめり込み量が0以下になったら(接しているだけ)当たっていないとする
+/// </summary>
+/// <param name="a">形状A</param>
+/// <param name="b">形状B</param>
+/// <param name="cache">前回の単体(nullptr可)</param>
+template<typename ShapeA, typename ShapeB>
+Contact GjkContact(const ShapeA& a, const ShapeB& b, GjkCache* cache = nullptr) {
+	Contact contact = {};
+	GjkResult result = RunGjk(a, b, cache);
+	float marginA = GetMargin(a);
+	float marginB = GetMargin(b);
+	if (!result.isOverlap && result.distance > marginA + marginB) {
+		return contact;
+	}
+
+	contact.hit = true;
+	Vector3 pointA;
+	Vector3 pointB;
+	if (!result.isOverlap && result.distance > 0.0f) {
+		// 芯は離れていて丸みだけが重なっている
+		contact.normal = Multiply(1.0f / result.distance, Subtract(result.pointB, result.pointA));
+		contact.penetration = marginA + marginB - result.distance;
+		pointA = result.pointA;
+		pointB = result.pointB;
+	} else {
+		// 芯が重なっているので EPA
+		float depth = RunEpa(a, b, result.simplex, contact.normal, pointA, pointB);
+		contact.penetration = depth + marginA + marginB;
+	}
+	if (contact.penetration <= 0.0f) {
+		return Contact{};
+	}
+	pointA = Add(pointA, Multiply(marginA, contact.normal));
+	pointB = Subtract(pointB, Multiply(marginB, contact.normal));
+	contact.point = Multiply(0.5f, Add(pointA, pointB));
+	return contact;
+}
+
+// ---- 専用の判定が無い組み合わせ ----
+// 球同士は Collision.h の式で求める
+
+// 球と線分の衝突
+Contact GetContact(const Sphere& sphere, const Segment& segment) { return GjkContact(sphere, segment); }
+// 三角形と球の衝突
+Contact GetContact(const Triangle& triangle, const Sphere& sphere) { return GjkContact(triangle, sphere); }
+// 三角形同士の衝突
+Contact GetContact(const Triangle& triangle1, const Triangle& triangle2) { return GjkContact(triangle1, triangle2); }
+// AABBと三角形の衝突
+Contact GetContact(const AABB& aabb, const Triangle& triangle) { return GjkContact(aabb, triangle); }
+// OBBと球の衝突
+Contact GetContact(const OBB& obb, const Sphere& sphere) { return GjkContact(obb, sphere); }
+// OBBとAABBの衝突
+Contact GetContact(const OBB& obb, const AABB& aabb) { return GjkContact(obb, aabb); }
+// OBB同士の衝突
+Contact GetContact(const OBB& obb1, const OBB& obb2) { return GjkContact(obb1, obb2); }
+// OBBと三角形の衝突
+Contact GetContact(const OBB& obb, const Triangle& triangle) { return GjkContact(obb, triangle); }
+// OBBと線分の衝突
+Contact GetContact(const OBB& obb, const Segment& segment) { return GjkContact(obb, segment); }
+
+// 球と線分の衝突判定
+bool CheckCollision(const Sphere& sphere, const Segment& segment) { return GjkIntersect(sphere, segment); }
+// 三角形と球の衝突判定
+bool CheckCollision(const Triangle& triangle, const Sphere& sphere) { return GjkIntersect(triangle, sphere); }
+// 三角形同士の衝突判定
+bool CheckCollision(const Triangle& triangle1, const Triangle& triangle2) { return GjkIntersect(triangle1, triangle2); }
+// AABBと三角形の衝突判定
+bool CheckCollision(const AABB& aabb, const Triangle& triangle) { return GjkIntersect(aabb, triangle); }
+// OBBと球の衝突判定
+bool CheckCollision(const OBB& obb, const Sphere& sphere) { return GjkIntersect(obb, sphere); }
+// OBBとAABBの衝突判定
+bool CheckCollision(const OBB& obb, const AABB& aabb) { return GjkIntersect(obb, aabb); }
+// OBB同士の衝突判定
+bool CheckCollision(const OBB& obb1, const OBB& obb2) { return GjkIntersect(obb1, obb2); }
+// OBBと三角形の衝突判定
+bool CheckCollision(const OBB& obb, const Triangle& triangle) { return GjkIntersect(obb, triangle); }
+// OBBと線分の衝突判定
+bool CheckCollision(const OBB& obb, const Segment& segment) { return GjkIntersect(obb, segment); }
\ No newline at end of file
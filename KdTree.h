@@ -0,0 +1,416 @@
+#pragma once
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "Vector3.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// 点群の KD 木(最近傍・k 近傍・半径内の点)
+// ノードへのポインタを持たず、点の配列そのものを木の形に並べ替える(暗黙の木)
+// 範囲 [begin, end) の真ん中 (begin + end) / 2 の点がそのノードの分割点で、左右の子はその前後の範囲
+// 部分木は配列上で連続するので、深いところを調べるときはキャッシュに乗ったまま進める
+// 点が少ない範囲(葉)は分けずに全部調べる
+
+static const uint32_t kKdTreeLeafSize = 8;				// これ以下の点の範囲は葉にする
+static const uint32_t kKdTreeInvalidIndex = 0xFFFFFFFFu;	// 見つからなかったときの番号
+static const uint32_t kKdTreeIndexBits = 30;				// 点の番号のビット数(上の2ビットは分ける軸)
+static const uint32_t kKdTreeMaxPointCount = 1u << kKdTreeIndexBits;
+static const size_t kKdTreeQueryGrainSize = 256;		// まとめて問い合わせるときの並列処理の区切り
+
+/// <summary>
+/// 木の中の点(元の番号を一緒に並べ替える)
+/// 分割点では分ける軸も同じ16バイトに入れ、たどるときに別の配列を読まずに済ませる
+/// </summary>
+struct KdTreePoint {
+	Vector3 position;
+	uint32_t packed;	// 下位30ビットが Build に渡した配列での番号、上位2ビットが分ける軸(0:x 1:y 2:z)
+
+	uint32_t GetIndex() const { return packed & (kKdTreeMaxPointCount - 1); }
+	uint32_t GetSplitAxis() const { return packed >> kKdTreeIndexBits; }
+};
+
+/// <summary>
+/// 点群の KD 木
+/// 作った後は読むだけなので、複数のスレッドから同時に問い合わせてよい
+/// </summary>
+class KdTree {
+public:
+	explicit KdTree(ThreadPool* threadPool = nullptr)
+		: threadPool_(threadPool ? threadPool : &ThreadPool::GetDefault()) {}
+
+	/// <summary>
+	/// 木を作る(点はコピーする)
+	/// 上の階層は同じ深さのノードごとに並列に nth_element で分け、
+	/// ノードがスレッド数より十分多くなったら部分木ごとに並列に作る
+	/// </summary>
+	/// <param name="points">点の配列</param>
+	/// <param name="count">点の数(kKdTreeMaxPointCount 未満、超えた分は使わない)</param>
+	void Build(const Vector3* points, size_t count) {
+		MT3_PROFILE_SCOPE("KdTree::Build");
+		const uint32_t pointCount = uint32_t((std::min)(count, size_t(kKdTreeMaxPointCount - 1)));
+		points_.resize(pointCount);
+		if (pointCount == 0) { return; }
+
+		const uint32_t threadCount = threadPool_->GetThreadCount();
+		const size_t grainSize = (std::max)(size_t(4096), size_t(pointCount) / (size_t(threadCount) * 4));
+		// 範囲を調べる(スレッドごとの結果を最後にまとめる)
+		std::vector<Vector3> threadMins(threadCount, points[0]);
+		std::vector<Vector3> threadMaxs(threadCount, points[0]);
+		threadPool_->ParallelFor(pointCount, grainSize, [&](size_t begin, size_t end, uint32_t workerIndex) {
+			Vector3 min = threadMins[workerIndex];
+			Vector3 max = threadMaxs[workerIndex];
+			for (size_t i = begin; i < end; ++i) {
+				const Vector3& point = points[i];
+				points_[i] = { point, uint32_t(i) };
+				min = { (std::min)(min.x, point.x), (std::min)(min.y, point.y), (std::min)(min.z, point.z) };
+				max = { (std::max)(max.x, point.x), (std::max)(max.y, point.y), (std::max)(max.z, point.z) };
+			}
+			threadMins[workerIndex] = min;
+			threadMaxs[workerIndex] = max;
+		});
+		BuildTask root = { 0, pointCount, threadMins[0], threadMaxs[0] };
+		for (uint32_t i = 1; i < threadCount; ++i) {
+			root.min = { (std::min)(root.min.x, threadMins[i].x), (std::min)(root.min.y, threadMins[i].y), (std::min)(root.min.z, threadMins[i].z) };
+			root.max = { (std::max)(root.max.x, threadMaxs[i].x), (std::max)(root.max.y, threadMaxs[i].y), (std::max)(root.max.z, threadMaxs[i].z) };
+		}
+
+		// 深さごとに分ける(1つの深さのノードは範囲が重ならないので並列に分けられる)
+		std::vector<BuildTask> tasks = { root };
+		std::vector<BuildTask> nextTasks;
+		while (!tasks.empty() && tasks.size() < size_t(threadCount) * 8) {
+			nextTasks.assign(tasks.size() * 2, BuildTask{ 0, 0, {}, {} });
+			threadPool_->ParallelFor(tasks.size(), 1, [&](size_t begin, size_t end, uint32_t) {
+				for (size_t i = begin; i < end; ++i) {
+					Split(tasks[i], nextTasks[i * 2], nextTasks[i * 2 + 1]);
+				}
+			});
+			tasks.clear();
+			for (const BuildTask& task : nextTasks) {
+				if (task.end - task.begin > kKdTreeLeafSize) {
+					tasks.push_back(task);
+				}
+			}
+		}
+		// 残りは部分木ごと(深さ優先で作るので、部分木の点がキャッシュに乗ったまま進む)
+		threadPool_->ParallelFor(tasks.size(), 1, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				BuildSubtree(tasks[i]);
+			}
+		});
+	}
+
+	size_t Size() const { return points_.size(); }
+	// 木の順に並べた点
+	const std::vector<KdTreePoint>& GetPoints() const { return points_; }
+
+	/// <summary>
+	/// 一番近い点を探す
+	/// </summary>
+	/// <param name="point">問い合わせる点</param>
+	/// <param name="distanceSquared">一番近い点との距離の2乗の出力(不要ならnullptr)</param>
+	/// <param name="maxDistanceSquared">これより遠い点は探さない</param>
+	/// <returns>一番近い点の番号(無ければ kKdTreeInvalidIndex、同じ距離なら番号の小さい方)</returns>
+	uint32_t FindNearest(const Vector3& point, float* distanceSquared = nullptr,
+		float maxDistanceSquared = (std::numeric_limits<float>::infinity)()) const {
+		uint32_t bestIndex = kKdTreeInvalidIndex;
+		float bestDistance = maxDistanceSquared;
+		Traverse(point, [&bestDistance]() { return bestDistance; }, [&](const KdTreePoint& candidate, float distance) {
+			if (distance < bestDistance || (distance == bestDistance && candidate.GetIndex() < bestIndex)) {
+				bestDistance = distance;
+				bestIndex = candidate.GetIndex();
+			}
+		});
+		if (distanceSquared) {
+			*distanceSquared = bestIndex != kKdTreeInvalidIndex ? bestDistance : (std::numeric_limits<float>::infinity)();
+		}
+		return bestIndex;
+	}
+
+	/// <summary>
+	/// 近い順に k 個の点を探す
+	/// </summary>
+	/// <param name="point">問い合わせる点</param>
+	/// <param name="k">探す数</param>
+	/// <param name="indices">点の番号の出力(k 個分、近い順)</param>
+	/// <param name="distancesSquared">距離の2乗の出力(k 個分、不要ならnullptr)</param>
+	/// <returns>見つかった数(点が k 個より少なければその数、残りは kKdTreeInvalidIndex)</returns>
+	size_t FindKNearest(const Vector3& point, size_t k, uint32_t* indices, float* distancesSquared = nullptr) const {
+		if (k == 0) { return 0; }
+		if (k == 1) {
+			float distance;
+			indices[0] = FindNearest(point, &distance);
+			if (distancesSquared) { distancesSquared[0] = distance; }
+			return indices[0] != kKdTreeInvalidIndex ? 1 : 0;
+		}
+		// 遠いものが先頭のヒープ(出力の配列をそのまま使う)
+		KNearestHeap heap = { indices, distancesSquared, k, 0 };
+		std::vector<float> heapDistances;
+		if (!distancesSquared) {
+			heapDistances.resize(k);
+			heap.distances = heapDistances.data();
+		}
+		Traverse(point, [&heap]() { return heap.GetBound(); }, [&heap](const KdTreePoint& candidate, float distance) {
+			heap.Push(candidate.GetIndex(), distance);
+		});
+		size_t found = heap.count;
+		heap.SortAscending();
+		for (size_t i = found; i < k; ++i) {
+			indices[i] = kKdTreeInvalidIndex;
+			heap.distances[i] = (std::numeric_limits<float>::infinity)();
+		}
+		return found;
+	}
+
+	/// <summary>
+	/// 半径内の点をすべて探す(木の順、距離順ではない)
+	/// </summary>
+	/// <param name="point">問い合わせる点</param>
+	/// <param name="radius">半径(境界上の点も含む)</param>
+	/// <param name="indices">点の番号を追加する先</param>
+	/// <returns>見つかった数</returns>
+	size_t FindInRadius(const Vector3& point, float radius, std::vector<uint32_t>& indices) const {
+		size_t before = indices.size();
+		VisitInRadius(point, radius, [&indices](const KdTreePoint& candidate) { indices.push_back(candidate.GetIndex()); });
+		return indices.size() - before;
+	}
+
+	// 半径内の点の数
+	size_t CountInRadius(const Vector3& point, float radius) const {
+		size_t count = 0;
+		VisitInRadius(point, radius, [&count](const KdTreePoint&) { ++count; });
+		return count;
+	}
+
+	/// <summary>
+	/// 多数の点の最近傍を並列に探す
+	/// </summary>
+	/// <param name="points">問い合わせる点の配列</param>
+	/// <param name="count">問い合わせの数</param>
+	/// <param name="indices">番号の出力(count 個)</param>
+	/// <param name="distancesSquared">距離の2乗の出力(count 個、不要ならnullptr)</param>
+	void FindNearestBatch(const Vector3* points, size_t count, uint32_t* indices, float* distancesSquared = nullptr) const {
+		MT3_PROFILE_SCOPE("KdTree::FindNearestBatch");
+		threadPool_->ParallelFor(count, kKdTreeQueryGrainSize, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				indices[i] = FindNearest(points[i], distancesSquared ? distancesSquared + i : nullptr);
+			}
+		});
+	}
+
+	/// <summary>
+	/// 多数の点の k 近傍を並列に探す
+	/// </summary>
+	/// <param name="points">問い合わせる点の配列</param>
+	/// <param name="count">問い合わせの数</param>
+	/// <param name="k">1つの問い合わせで探す数</param>
+	/// <param name="indices">番号の出力(count * k 個、問い合わせごとに近い順)</param>
+	/// <param name="distancesSquared">距離の2乗の出力(count * k 個、不要ならnullptr)</param>
+	void FindKNearestBatch(const Vector3* points, size_t count, size_t k, uint32_t* indices, float* distancesSquared = nullptr) const {
+		MT3_PROFILE_SCOPE("KdTree::FindKNearestBatch");
+		threadPool_->ParallelFor(count, kKdTreeQueryGrainSize, [&](size_t begin, size_t end, uint32_t) {
+			std::vector<float> distances(distancesSquared ? 0 : k);
+			for (size_t i = begin; i < end; ++i) {
+				FindKNearest(points[i], k, indices + i * k, distancesSquared ? distancesSquared + i * k : distances.data());
+			}
+		});
+	}
+
+	/// <summary>
+	/// 多数の点の半径内の点を並列に探す
+	/// 問い合わせ i の結果は indices[offsets[i]] ~ indices[offsets[i + 1]] (数えてから埋めるので、スレッド数によらず同じ並び)
+	/// </summary>
+	/// <param name="points">問い合わせる点の配列</param>
+	/// <param name="count">問い合わせの数</param>
+	/// <param name="radius">半径</param>
+	/// <param name="offsets">結果の開始位置の出力(count + 1 個)</param>
+	/// <param name="indices">番号の出力</param>
+	void FindInRadiusBatch(const Vector3* points, size_t count, float radius, std::vector<size_t>& offsets, std::vector<uint32_t>& indices) const {
+		MT3_PROFILE_SCOPE("KdTree::FindInRadiusBatch");
+		offsets.assign(count + 1, 0);
+		threadPool_->ParallelFor(count, kKdTreeQueryGrainSize, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				offsets[i + 1] = CountInRadius(points[i], radius);
+			}
+		});
+		for (size_t i = 0; i < count; ++i) {
+			offsets[i + 1] += offsets[i];
+		}
+		indices.resize(offsets[count]);
+		threadPool_->ParallelFor(count, kKdTreeQueryGrainSize, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				uint32_t* output = indices.data() + offsets[i];
+				VisitInRadius(points[i], radius, [&output](const KdTreePoint& candidate) { *output++ = candidate.GetIndex(); });
+			}
+		});
+	}
+
+private:
+	// 作るときのノード(点の範囲とその箱)
+	struct BuildTask {
+		uint32_t begin;
+		uint32_t end;
+		Vector3 min;
+		Vector3 max;
+	};
+
+	// 探すときに後回しにしたノード
+	struct StackEntry {
+		uint32_t begin;
+		uint32_t end;
+		float planeDistanceSquared;	// 分割面までの距離の2乗(これより近い点が見つかっていれば調べない)
+	};
+
+	// k 近傍の途中結果(distances の大きい順のヒープ)
+	struct KNearestHeap {
+		uint32_t* indices;
+		float* distances;
+		size_t capacity;
+		size_t count;
+
+		float GetBound() const { return count < capacity ? (std::numeric_limits<float>::infinity)() : distances[0]; }
+
+		// a の方が遠い(同じ距離なら番号の大きい方を遠いとみなす)
+		bool IsFarther(size_t a, size_t b) const {
+			return distances[a] > distances[b] || (distances[a] == distances[b] && indices[a] > indices[b]);
+		}
+
+		void Swap(size_t a, size_t b) {
+			std::swap(indices[a], indices[b]);
+			std::swap(distances[a], distances[b]);
+		}
+
+		void SiftDown(size_t i, size_t size) {
+			for (;;) {
+				size_t largest = i;
+				size_t left = i * 2 + 1;
+				size_t right = left + 1;
+				if (left < size && IsFarther(left, largest)) { largest = left; }
+				if (right < size && IsFarther(right, largest)) { largest = right; }
+				if (largest == i) { return; }
+				Swap(i, largest);
+				i = largest;
+			}
+		}
+
+		void Push(uint32_t index, float distance) {
+			if (count < capacity) {
+				size_t i = count++;
+				indices[i] = index;
+				distances[i] = distance;
+				while (i > 0 && IsFarther(i, (i - 1) / 2)) {
+					Swap(i, (i - 1) / 2);
+					i = (i - 1) / 2;
+				}
+				return;
+			}
+			if (distance > distances[0] || (distance == distances[0] && index > indices[0])) { return; }
+			indices[0] = index;
+			distances[0] = distance;
+			SiftDown(0, count);
+		}
+
+		// ヒープソートで近い順にする
+		void SortAscending() {
+			for (size_t size = count; size > 1; --size) {
+				Swap(0, size - 1);
+				SiftDown(0, size - 1);
+			}
+		}
+	};
+
+	static float GetAxis(const Vector3& v, uint32_t axis) {
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	static float& GetAxis(Vector3& v, uint32_t axis) {
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	/// <summary>
+	/// ノードを箱の一番長い軸の中央値で分ける
+	/// 葉なら子は空のまま
+	/// </summary>
+	void Split(const BuildTask& task, BuildTask& left, BuildTask& right) {
+		if (task.end - task.begin <= kKdTreeLeafSize) { return; }
+		Vector3 extent = task.max - task.min;
+		uint32_t axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		uint32_t middle = (task.begin + task.end) / 2;
+		std::nth_element(points_.begin() + task.begin, points_.begin() + middle, points_.begin() + task.end,
+			[axis](const KdTreePoint& l, const KdTreePoint& r) { return GetAxis(l.position, axis) < GetAxis(r.position, axis); });
+		points_[middle].packed |= axis << kKdTreeIndexBits;
+		float split = GetAxis(points_[middle].position, axis);
+		left = { task.begin, middle, task.min, task.max };
+		GetAxis(left.max, axis) = split;
+		right = { middle + 1, task.end, task.min, task.max };
+		GetAxis(right.min, axis) = split;
+	}
+
+	void BuildSubtree(const BuildTask& task) {
+		BuildTask left = { 0, 0, {}, {} };
+		BuildTask right = { 0, 0, {}, {} };
+		Split(task, left, right);
+		if (left.end - left.begin > kKdTreeLeafSize) { BuildSubtree(left); }
+		if (right.end - right.begin > kKdTreeLeafSize) { BuildSubtree(right); }
+	}
+
+	/// <summary>
+	/// 近い側の子から深さ優先にたどる
+	/// </summary>
+	/// <param name="point">問い合わせる点</param>
+	/// <param name="getBound">getBound() これより遠い範囲は調べない(距離の2乗)</param>
+	/// <param name="visit">visit(point, distanceSquared) 調べた点ごとに呼ぶ</param>
+	template<typename GetBound, typename Visit>
+	void Traverse(const Vector3& point, const GetBound& getBound, const Visit& visit) const {
+		if (points_.empty()) { return; }
+		// 積んだものは浅い順に並び、1段に1つまでなので深さ(log2(点の数) 程度)を超えない
+		StackEntry stack[64];
+		int stackSize = 0;
+		stack[stackSize++] = { 0, uint32_t(points_.size()), 0.0f };
+		const KdTreePoint* points = points_.data();
+		while (stackSize > 0) {
+			StackEntry entry = stack[--stackSize];
+			if (entry.planeDistanceSquared > getBound()) { continue; }
+			uint32_t begin = entry.begin;
+			uint32_t end = entry.end;
+			while (end - begin > kKdTreeLeafSize) {
+				uint32_t middle = (begin + end) / 2;
+				const KdTreePoint& splitPoint = points[middle];
+				visit(splitPoint, DistanceSquared(point, splitPoint.position));
+				const uint32_t axis = splitPoint.GetSplitAxis();
+				float difference = GetAxis(point, axis) - GetAxis(splitPoint.position, axis);
+				float planeDistanceSquared = difference * difference;
+				if (difference < 0.0f) {
+					if (planeDistanceSquared <= getBound()) { stack[stackSize++] = { middle + 1, end, planeDistanceSquared }; }
+					end = middle;
+				} else {
+					if (planeDistanceSquared <= getBound()) { stack[stackSize++] = { begin, middle, planeDistanceSquared }; }
+					begin = middle + 1;
+				}
+			}
+			for (uint32_t i = begin; i < end; ++i) {
+				visit(points[i], DistanceSquared(point, points[i].position));
+			}
+		}
+	}
+
+	// 半径内の点ごとに visit(point) を呼ぶ
+	template<typename Visit>
+	void VisitInRadius(const Vector3& point, float radius, const Visit& visit) const {
+		const float radiusSquared = radius * radius;
+		Traverse(point, [radiusSquared]() { return radiusSquared; }, [&](const KdTreePoint& candidate, float distance) {
+			if (distance <= radiusSquared) { visit(candidate); }
+		});
+	}
+
+	static float DistanceSquared(const Vector3& a, const Vector3& b) {
+		float x = a.x - b.x;
+		float y = a.y - b.y;
+		float z = a.z - b.z;
+		return x * x + y * y + z * z;
+	}
+
+	ThreadPool* threadPool_;
+	std::vector<KdTreePoint> points_;
+};
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+#include "Collision.h"
+#include "LaneMath.h"
+#include "Profiler.h"
+#include "Shape.h"
+#include <cstddef>
+
+// 多数の形状をレーン型にまとめて判定する一括版
+// 判定本体は Collision.h のテンプレート(float 版の CheckCollision/GetContact と同じもの)を T = FloatLanes で使う
+
+// ---- float の形状をレーン型にまとめる ----
+
+template<typename L>
+SphereT<L> GatherSpheres(const Sphere* spheres) {
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	Vector3 centers[kWidth];
+	alignas(32) float radius[kWidth];
+	for (int i = 0; i < kWidth; ++i) {
+		centers[i] = spheres[i].center;
+		radius[i] = spheres[i].radius;
+	}
+	return { GatherVector3<L>(centers), L::Load(radius) };
+}
+
+template<typename L>
+AABBT<L> GatherAABBs(const AABB* aabbs) {
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	Vector3 mins[kWidth];
+	Vector3 maxs[kWidth];
+	for (int i = 0; i < kWidth; ++i) {
+		mins[i] = aabbs[i].min;
+		maxs[i] = aabbs[i].max;
+	}
+	return { GatherVector3<L>(mins), GatherVector3<L>(maxs) };
+}
+
+template<typename L>
+TriangleT<L> GatherTriangles(const Triangle* triangles) {
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	TriangleT<L> result;
+	for (int v = 0; v < 3; ++v) {
+		Vector3 vertices[kWidth];
+		for (int i = 0; i < kWidth; ++i) {
+			vertices[i] = triangles[i].vertices[v];
+		}
+		result.vertices[v] = GatherVector3<L>(vertices);
+	}
+	return result;
+}
+
+// マスクを bool 配列に書き出す
+template<typename M>
+void StoreMask(const M& mask, int width, bool* results) {
+	int bits = MoveMask(mask);
+	for (int i = 0; i < width; ++i) {
+		results[i] = ((bits >> i) & 1) != 0;
+	}
+}
+
+// ---- 1つの形状と多数の形状をまとめて判定 ----
+
+/// <summary>
+/// 多数の球と1枚の平面
+/// </summary>
+/// <param name="spheres">球の配列</param>
+/// <param name="count">球の数</param>
+/// <param name="plane">平面</param>
+/// <param name="results">判定結果(count 個)</param>
+void CheckCollisionBatch(const Sphere* spheres, size_t count, const Plane& plane, bool* results) {
+	MT3_PROFILE_SCOPE("CheckCollisionBatch(Sphere,Plane)");
+	using L = FloatLanes;
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	PlaneT<L> lanePlane = { SplatVector3<L>(plane.normal), L(plane.distance) };
+	size_t i = 0;
+	for (; i + kWidth <= count; i += kWidth) {
+		StoreMask(CheckCollision<L>(GatherSpheres<L>(spheres + i), lanePlane), kWidth, results + i);
+	}
+	for (; i < count; ++i) {
+		results[i] = CheckCollision<float>(spheres[i], plane);
+	}
+}
+
+/// <summary>
+/// 多数のAABBと1つの球
+/// </summary>
+/// <param name="aabbs">AABBの配列</param>
+/// <param name="count">AABBの数</param>
+/// <param name="sphere">球</param>
+/// <param name="results">判定結果(count 個)</param>
+void CheckCollisionBatch(const AABB* aabbs, size_t count, const Sphere& sphere, bool* results) {
+	MT3_PROFILE_SCOPE("CheckCollisionBatch(AABB,Sphere)");
+	using L = FloatLanes;
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	SphereT<L> laneSphere = { SplatVector3<L>(sphere.center), L(sphere.radius) };
+	size_t i = 0;
+	for (; i + kWidth <= count; i += kWidth) {
+		StoreMask(CheckCollision<L>(GatherAABBs<L>(aabbs + i), laneSphere), kWidth, results + i);
+	}
+	for (; i < count; ++i) {
+		results[i] = CheckCollision<float>(aabbs[i], sphere);
+	}
+}
+
+/// <summary>
+/// 多数のAABBと1本の線分
+/// </summary>
+/// <param name="aabbs">AABBの配列</param>
+/// <param name="count">AABBの数</param>
+/// <param name="segment">線分</param>
+/// <param name="results">判定結果(count 個)</param>
+void CheckCollisionBatch(const AABB* aabbs, size_t count, const Segment& segment, bool* results) {
+	MT3_PROFILE_SCOPE("CheckCollisionBatch(AABB,Segment)");
+	using L = FloatLanes;
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	SegmentT<L> laneSegment = { SplatVector3<L>(segment.origin), SplatVector3<L>(segment.diff) };
+	size_t i = 0;
+	for (; i + kWidth <= count; i += kWidth) {
+		StoreMask(CheckCollision<L>(GatherAABBs<L>(aabbs + i), laneSegment), kWidth, results + i);
+	}
+	for (; i < count; ++i) {
+		results[i] = CheckCollision<float>(aabbs[i], segment);
+	}
+}
+
+/// <summary>
+/// 多数の三角形と1本の半直線
+/// </summary>
+/// <param name="triangles">三角形の配列</param>
+/// <param name="count">三角形の数</param>
+/// <param name="ray">半直線</param>
+/// <param name="results">判定結果(count 個)</param>
+void CheckCollisionBatch(const Triangle* triangles, size_t count, const Ray& ray, bool* results) {
+	MT3_PROFILE_SCOPE("CheckCollisionBatch(Triangle,Ray)");
+	using L = FloatLanes;
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	RayT<L> laneRay = { SplatVector3<L>(ray.origin), SplatVector3<L>(ray.diff) };
+	size_t i = 0;
+	for (; i + kWidth <= count; i += kWidth) {
+		StoreMask(CheckCollision<L>(GatherTriangles<L>(triangles + i), laneRay), kWidth, results + i);
+	}
+	for (; i < count; ++i) {
+		results[i] = CheckCollision<float>(triangles[i], ray);
+	}
+}
\ No newline at end of file
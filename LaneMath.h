@@ -0,0 +1,384 @@
+#pragma once
+#include "Vector3.h"
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+// x86 の SSE2 があるときだけ組み込み関数でレーン型を作る
+// それ以外(または MT3_LANE_DISABLE_SIMD を定義したとき)は配列で同じ演算をするスカラー版になる
+#if !defined(MT3_LANE_DISABLE_SIMD) && (defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MT3_LANE_SSE 1
+#include <immintrin.h>
+#else
+#define MT3_LANE_SSE 0
+#endif
+
+// Matrix4x4.h が FastMath.h(このヘッダー)を使うので、行列は宣言だけにする
+template<typename T>
+struct Matrix4x4T;
+
+// スカラー型に依存しない演算
+// T は float/double のほか、4本(Float4)・8本(Float8)の値をまとめて扱うレーン型を使える
+// レーン型では比較結果がマスクになるので、分岐の代わりに Select で値を選ぶ
+
+// ---- スカラー ----
+
+// 比較結果(スカラーは bool)
+bool Any(bool mask) { return mask; }
+bool All(bool mask) { return mask; }
+
+template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+T Select(bool mask, T a, T b) { return mask ? a : b; }
+
+float Sqrt(float v) { return std::sqrt(v); }
+double Sqrt(double v) { return std::sqrt(v); }
+float Abs(float v) { return std::fabs(v); }
+double Abs(double v) { return std::fabs(v); }
+float Round(float v) { return std::nearbyint(v); }
+double Round(double v) { return std::nearbyint(v); }
+// 1/sqrt の近似(相対誤差 1.5 * 2^-12 以下、SSE がなければ正確な値)
+#if MT3_LANE_SSE
+float RsqrtEstimate(float v) { return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(v))); }
+#else
+float RsqrtEstimate(float v) { return 1.0f / std::sqrt(v); }
+#endif
+double RsqrtEstimate(double v) { return 1.0 / std::sqrt(v); }
+
+template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+T Min(T a, T b) { return b < a ? b : a; }
+
+template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+T Max(T a, T b) { return a < b ? b : a; }
+
+// ---- Float4 ----
+#if MT3_LANE_SSE
+
+// 4レーン分の比較結果
+struct Mask4 {
+	__m128 v;
+};
+
+Mask4 operator&(Mask4 a, Mask4 b) { return { _mm_and_ps(a.v, b.v) }; }
+Mask4 operator|(Mask4 a, Mask4 b) { return { _mm_or_ps(a.v, b.v) }; }
+Mask4 operator!(Mask4 a) { return { _mm_xor_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(-1))) }; }
+// レーン i が真なら i ビット目が立つ
+int MoveMask(Mask4 mask) { return _mm_movemask_ps(mask.v); }
+bool Any(Mask4 mask) { return MoveMask(mask) != 0; }
+bool All(Mask4 mask) { return MoveMask(mask) == 0xF; }
+
+// float 4つを同時に計算するレーン型
+struct Float4 {
+	__m128 v;
+
+	Float4() = default;
+	Float4(float s) : v(_mm_set1_ps(s)) {}
+	explicit Float4(__m128 value) : v(value) {}
+
+	static Float4 Load(const float* p) { return Float4(_mm_loadu_ps(p)); }
+	void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+	Float4& operator+=(Float4 o) { v = _mm_add_ps(v, o.v); return *this; }
+	Float4& operator-=(Float4 o) { v = _mm_sub_ps(v, o.v); return *this; }
+	Float4& operator*=(Float4 o) { v = _mm_mul_ps(v, o.v); return *this; }
+	Float4& operator/=(Float4 o) { v = _mm_div_ps(v, o.v); return *this; }
+};
+
+Float4 operator+(Float4 a, Float4 b) { return Float4(_mm_add_ps(a.v, b.v)); }
+Float4 operator-(Float4 a, Float4 b) { return Float4(_mm_sub_ps(a.v, b.v)); }
+Float4 operator*(Float4 a, Float4 b) { return Float4(_mm_mul_ps(a.v, b.v)); }
+Float4 operator/(Float4 a, Float4 b) { return Float4(_mm_div_ps(a.v, b.v)); }
+Float4 operator-(Float4 a) { return Float4(_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))); }
+Mask4 operator<(Float4 a, Float4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+Mask4 operator<=(Float4 a, Float4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+Mask4 operator>(Float4 a, Float4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+Mask4 operator>=(Float4 a, Float4 b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+Mask4 operator==(Float4 a, Float4 b) { return { _mm_cmpeq_ps(a.v, b.v) }; }
+Mask4 operator!=(Float4 a, Float4 b) { return { _mm_cmpneq_ps(a.v, b.v) }; }
+
+// mask が真のレーンは a、偽のレーンは b
+Float4 Select(Mask4 mask, Float4 a, Float4 b) {
+	return Float4(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)));
+}
+Float4 Sqrt(Float4 a) { return Float4(_mm_sqrt_ps(a.v)); }
+Float4 Abs(Float4 a) { return Float4(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+Float4 Min(Float4 a, Float4 b) { return Float4(_mm_min_ps(a.v, b.v)); }
+Float4 Max(Float4 a, Float4 b) { return Float4(_mm_max_ps(a.v, b.v)); }
+// 最も近い整数(|a| < 2^31 の範囲)
+Float4 Round(Float4 a) { return Float4(_mm_cvtepi32_ps(_mm_cvtps_epi32(a.v))); }
+Float4 RsqrtEstimate(Float4 a) { return Float4(_mm_rsqrt_ps(a.v)); }
+
+#else
+
+// 4レーン分の比較結果(スカラー版)
+struct Mask4 {
+	bool v[4];
+};
+
+Mask4 operator&(Mask4 a, Mask4 b) { return { { a.v[0] && b.v[0], a.v[1] && b.v[1], a.v[2] && b.v[2], a.v[3] && b.v[3] } }; }
+Mask4 operator|(Mask4 a, Mask4 b) { return { { a.v[0] || b.v[0], a.v[1] || b.v[1], a.v[2] || b.v[2], a.v[3] || b.v[3] } }; }
+Mask4 operator!(Mask4 a) { return { { !a.v[0], !a.v[1], !a.v[2], !a.v[3] } }; }
+int MoveMask(Mask4 mask) { return int(mask.v[0]) | (int(mask.v[1]) << 1) | (int(mask.v[2]) << 2) | (int(mask.v[3]) << 3); }
+bool Any(Mask4 mask) { return MoveMask(mask) != 0; }
+bool All(Mask4 mask) { return MoveMask(mask) == 0xF; }
+
+// float 4つを同時に計算するレーン型(スカラー版)
+struct Float4 {
+	float v[4];
+
+	Float4() = default;
+	Float4(float s) : v{ s, s, s, s } {}
+
+	static Float4 Load(const float* p) { Float4 r; for (int i = 0; i < 4; ++i) { r.v[i] = p[i]; } return r; }
+	void Store(float* p) const { for (int i = 0; i < 4; ++i) { p[i] = v[i]; } }
+
+	Float4& operator+=(Float4 o) { for (int i = 0; i < 4; ++i) { v[i] += o.v[i]; } return *this; }
+	Float4& operator-=(Float4 o) { for (int i = 0; i < 4; ++i) { v[i] -= o.v[i]; } return *this; }
+	Float4& operator*=(Float4 o) { for (int i = 0; i < 4; ++i) { v[i] *= o.v[i]; } return *this; }
+	Float4& operator/=(Float4 o) { for (int i = 0; i < 4; ++i) { v[i] /= o.v[i]; } return *this; }
+};
+
+// レーンごとに f を適用する
+template<typename F>
+Float4 MapLanes(Float4 a, Float4 b, F f) { Float4 r; for (int i = 0; i < 4; ++i) { r.v[i] = f(a.v[i], b.v[i]); } return r; }
+template<typename F>
+Mask4 CompareLanes(Float4 a, Float4 b, F f) { Mask4 r; for (int i = 0; i < 4; ++i) { r.v[i] = f(a.v[i], b.v[i]); } return r; }
+
+Float4 operator+(Float4 a, Float4 b) { return a += b; }
+Float4 operator-(Float4 a, Float4 b) { return a -= b; }
+Float4 operator*(Float4 a, Float4 b) { return a *= b; }
+Float4 operator/(Float4 a, Float4 b) { return a /= b; }
+Float4 operator-(Float4 a) { return MapLanes(a, a, [](float x, float) { return -x; }); }
+Mask4 operator<(Float4 a, Float4 b) { return CompareLanes(a, b, [](float x, float y) { return x < y; }); }
+Mask4 operator<=(Float4 a, Float4 b) { return CompareLanes(a, b, [](float x, float y) { return x <= y; }); }
+Mask4 operator>(Float4 a, Float4 b) { return CompareLanes(a, b, [](float x, float y) { return x > y; }); }
+Mask4 operator>=(Float4 a, Float4 b) { return CompareLanes(a, b, [](float x, float y) { return x >= y; }); }
+Mask4 operator==(Float4 a, Float4 b) { return CompareLanes(a, b, [](float x, float y) { return x == y; }); }
+Mask4 operator!=(Float4 a, Float4 b) { return CompareLanes(a, b, [](float x, float y) { return x != y; }); }
+
+Float4 Select(Mask4 mask, Float4 a, Float4 b) {
+	Float4 r;
+	for (int i = 0; i < 4; ++i) { r.v[i] = mask.v[i] ? a.v[i] : b.v[i]; }
+	return r;
+}
+Float4 Sqrt(Float4 a) { return MapLanes(a, a, [](float x, float) { return std::sqrt(x); }); }
+Float4 Abs(Float4 a) { return MapLanes(a, a, [](float x, float) { return std::fabs(x); }); }
+// SSE の minps/maxps と同じく、NaN があれば b を返す
+Float4 Min(Float4 a, Float4 b) { return MapLanes(a, b, [](float x, float y) { return x < y ? x : y; }); }
+Float4 Max(Float4 a, Float4 b) { return MapLanes(a, b, [](float x, float y) { return x > y ? x : y; }); }
+Float4 Round(Float4 a) { return MapLanes(a, a, [](float x, float) { return std::nearbyint(x); }); }
+Float4 RsqrtEstimate(Float4 a) { return MapLanes(a, a, [](float x, float) { return 1.0f / std::sqrt(x); }); }
+
+#endif
+
+#if MT3_LANE_SSE && defined(__AVX__)
+// ---- Float8 ----
+
+// 8レーン分の比較結果
+struct Mask8 {
+	__m256 v;
+};
+
+Mask8 operator&(Mask8 a, Mask8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+Mask8 operator|(Mask8 a, Mask8 b) { return { _mm256_or_ps(a.v, b.v) }; }
+Mask8 operator!(Mask8 a) { return { _mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) }; }
+int MoveMask(Mask8 mask) { return _mm256_movemask_ps(mask.v); }
+bool Any(Mask8 mask) { return MoveMask(mask) != 0; }
+bool All(Mask8 mask) { return MoveMask(mask) == 0xFF; }
+
+// float 8つを同時に計算するレーン型(AVXが有効なときだけ)
+struct Float8 {
+	__m256 v;
+
+	Float8() = default;
+	Float8(float s) : v(_mm256_set1_ps(s)) {}
+	explicit Float8(__m256 value) : v(value) {}
+
+	static Float8 Load(const float* p) { return Float8(_mm256_loadu_ps(p)); }
+	void Store(float* p) const { _mm256_storeu_ps(p, v); }
+
+	Float8& operator+=(Float8 o) { v = _mm256_add_ps(v, o.v); return *this; }
+	Float8& operator-=(Float8 o) { v = _mm256_sub_ps(v, o.v); return *this; }
+	Float8& operator*=(Float8 o) { v = _mm256_mul_ps(v, o.v); return *this; }
+	Float8& operator/=(Float8 o) { v = _mm256_div_ps(v, o.v); return *this; }
+};
+
+Float8 operator+(Float8 a, Float8 b) { return Float8(_mm256_add_ps(a.v, b.v)); }
+Float8 operator-(Float8 a, Float8 b) { return Float8(_mm256_sub_ps(a.v, b.v)); }
+Float8 operator*(Float8 a, Float8 b) { return Float8(_mm256_mul_ps(a.v, b.v)); }
+Float8 operator/(Float8 a, Float8 b) { return Float8(_mm256_div_ps(a.v, b.v)); }
+Float8 operator-(Float8 a) { return Float8(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))); }
+Mask8 operator<(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+Mask8 operator<=(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+Mask8 operator>(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+Mask8 operator>=(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+Mask8 operator==(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+Mask8 operator!=(Float8 a, Float8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ) }; }
+
+Float8 Select(Mask8 mask, Float8 a, Float8 b) { return Float8(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+Float8 Sqrt(Float8 a) { return Float8(_mm256_sqrt_ps(a.v)); }
+Float8 Abs(Float8 a) { return Float8(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)); }
+Float8 Min(Float8 a, Float8 b) { return Float8(_mm256_min_ps(a.v, b.v)); }
+Float8 Max(Float8 a, Float8 b) { return Float8(_mm256_max_ps(a.v, b.v)); }
+Float8 Round(Float8 a) { return Float8(_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); }
+Float8 RsqrtEstimate(Float8 a) { return Float8(_mm256_rsqrt_ps(a.v)); }
+#endif
+
+// ---- レーン情報 ----
+
+// レーン数と比較結果の型
+template<typename T>
+struct LaneTraits {
+	using Mask = bool;
+	static constexpr int kWidth = 1;
+};
+
+template<>
+struct LaneTraits<Float4> {
+	using Mask = Mask4;
+	static constexpr int kWidth = 4;
+};
+
+#if MT3_LANE_SSE && defined(__AVX__)
+template<>
+struct LaneTraits<Float8> {
+	using Mask = Mask8;
+	static constexpr int kWidth = 8;
+};
+// 一番幅の広いレーン型
+using FloatLanes = Float8;
+#else
+using FloatLanes = Float4;
+#endif
+
+template<typename T>
+using LaneMask = typename LaneTraits<T>::Mask;
+
+/// <summary>
+/// float版の Vector3 を kWidth 個まとめてレーン型にする
+/// </summary>
+/// <param name="vectors">kWidth 個のベクトル</param>
+template<typename L>
+Vector3T<L> GatherVector3(const Vector3* vectors) {
+	constexpr int kWidth = LaneTraits<L>::kWidth;
+	alignas(32) float x[kWidth];
+	alignas(32) float y[kWidth];
+	alignas(32) float z[kWidth];
+	for (int i = 0; i < kWidth; ++i) {
+		x[i] = vectors[i].x;
+		y[i] = vectors[i].y;
+		z[i] = vectors[i].z;
+	}
+	return { L::Load(x), L::Load(y), L::Load(z) };
+}
+
+// 全レーンに同じベクトルを入れる
+template<typename L>
+Vector3T<L> SplatVector3(const Vector3& v) {
+	return { L(v.x), L(v.y), L(v.z) };
+}
+
+// 配列の先頭からレーン数分を読む(スカラーなら1つ)
+template<typename T>
+T LoadLanes(const float* p) {
+	if constexpr (std::is_arithmetic_v<T>) {
+		return T(*p);
+	} else {
+		return T::Load(p);
+	}
+}
+
+// レーン数分を書き出す(スカラーなら1つ)
+template<typename T>
+void StoreLanes(const T& v, float* p) {
+	if constexpr (std::is_arithmetic_v<T>) {
+		*p = float(v);
+	} else {
+		v.Store(p);
+	}
+}
+
+// ---- Vector3T/Matrix4x4T の演算 ----
+// float版の非テンプレート関数がある場合はそちらが優先される
+
+template<typename T>
+Vector3T<T> Add(const Vector3T<T>& v1, const Vector3T<T>& v2) {
+	return { v1.x + v2.x, v1.y + v2.y, v1.z + v2.z };
+}
+
+template<typename T>
+Vector3T<T> Subtract(const Vector3T<T>& v1, const Vector3T<T>& v2) {
+	return { v1.x - v2.x, v1.y - v2.y, v1.z - v2.z };
+}
+
+template<typename T>
+Vector3T<T> Multiply(const T& scalar, const Vector3T<T>& v) {
+	return { scalar * v.x, scalar * v.y, scalar * v.z };
+}
+
+template<typename T>
+T Dot(const Vector3T<T>& v1, const Vector3T<T>& v2) {
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+template<typename T>
+T Length(const Vector3T<T>& v) {
+	return Sqrt(Dot(v, v));
+}
+
+template<typename T>
+Vector3T<T> Normalize(const Vector3T<T>& v) {
+	return Multiply(T(1) / Length(v), v);
+}
+
+template<typename T>
+Vector3T<T> Cross(const Vector3T<T>& v1, const Vector3T<T>& v2) {
+	return {
+		v1.y * v2.z - v1.z * v2.y,
+		v1.z * v2.x - v1.x * v2.z,
+		v1.x * v2.y - v1.y * v2.x
+	};
+}
+
+template<typename T>
+Vector3T<T> Lerp(const Vector3T<T>& v1, const Vector3T<T>& v2, const T& t) {
+	return {
+		v1.x + (v2.x - v1.x) * t,
+		v1.y + (v2.y - v1.y) * t,
+		v1.z + (v2.z - v1.z) * t
+	};
+}
+
+// v を [low, high] に収める
+template<typename T>
+T Clamp(const T& v, const T& low, const T& high) {
+	return Min(Max(v, low), high);
+}
+
+template<typename T>
+Vector3T<T> Select(const LaneMask<T>& mask, const Vector3T<T>& a, const Vector3T<T>& b) {
+	return { Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z) };
+}
+
+template<typename T>
+Vector3T<T> Min(const Vector3T<T>& a, const Vector3T<T>& b) {
+	return { Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z) };
+}
+
+template<typename T>
+Vector3T<T> Max(const Vector3T<T>& a, const Vector3T<T>& b) {
+	return { Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z) };
+}
+
+// 座標変換(w が 0 のレーンは 0 になる)
+template<typename T>
+Vector3T<T> TransformVector(const Vector3T<T>& vector, const Matrix4x4T<T>& matrix) {
+	Vector3T<T> result = {
+		vector.x * matrix.m[0][0] + vector.y * matrix.m[1][0] + vector.z * matrix.m[2][0] + matrix.m[3][0],
+		vector.x * matrix.m[0][1] + vector.y * matrix.m[1][1] + vector.z * matrix.m[2][1] + matrix.m[3][1],
+		vector.x * matrix.m[0][2] + vector.y * matrix.m[1][2] + vector.z * matrix.m[2][2] + matrix.m[3][2]
+	};
+	T w = vector.x * matrix.m[0][3] + vector.y * matrix.m[1][3] + vector.z * matrix.m[2][3] + matrix.m[3][3];
+	LaneMask<T> isZero = (w == T(0));
+	T inverseW = T(1) / Select(isZero, T(1), w);
+	return Select(isZero, Vector3T<T>{ T(0), T(0), T(0) }, Multiply(inverseW, result));
+}
\ No newline at end of file
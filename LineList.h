@@ -0,0 +1,150 @@
+#pragma once
+#include "PerfCounters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 0の向きに切り捨てる(int への変換と同じ画素になる)
+/// 2^23 以上の値は元から整数なので、int に収まらない座標でもそのまま返す
+/// </summary>
+/// <param name="value">値</param>
+float TruncateToPixel(float value) {
+	return std::abs(value) < 8388608.0f ? float(int(value)) : value;
+}
+
+/// <summary>
+/// スクリーン座標の線分1本
+/// </summary>
+struct ScreenLine {
+	float x0;
+	float y0;
+	float x1;
+	float y1;
+	uint32_t color; // 0xRRGGBBAA
+};
+
+/// <summary>
+/// 描画する線分のリスト
+/// Draw*関数はここに線分を積み、描画先(Novice、ソフトウェアラスタライザなど)がまとめて受け取る
+/// </summary>
+struct LineList {
+	std::vector<ScreenLine> lines;
+
+	void Add(float x0, float y0, float x1, float y1, uint32_t color) {
+		lines.push_back({ x0, y0, x1, y1, color });
+	}
+
+	void Clear() { lines.clear(); }
+
+	size_t Size() const { return lines.size(); }
+
+	/// <summary>
+	/// 画面に映らない線分を取り除く(両端が同じ辺の外側にあるもの)
+	/// </summary>
+	/// <param name="width">画面の幅</param>
+	/// <param name="height">画面の高さ</param>
+	void CullOutside(float width, float height) {
+		lines.erase(std::remove_if(lines.begin(), lines.end(), [width, height](const ScreenLine& line) {
+			return (line.x0 < 0.0f && line.x1 < 0.0f) || (line.x0 > width && line.x1 > width) ||
+				(line.y0 < 0.0f && line.y1 < 0.0f) || (line.y0 > height && line.y1 > height);
+		}), lines.end());
+	}
+	/// <summary>
+	/// 画面上で線分を減らす
+	/// 端点を int への変換と同じく0の向きに切り捨てて画素にそろえ、続いて並ぶ同じ色の線分のうち
+	/// ほぼ一直線のものを1本にまとめる(1画素に収まる線分はここで消える)
+	/// 1回なめるだけでその場で詰めるので、積んだ順番は変わらない
+	/// 線分が前の線分の終点から始まるときだけつなぐので、Draw* は折れ線の順に積んでおく
+	/// </summary>
+	/// <param name="tolerance">まとめた線分から元の頂点が離れてよい距離(画素)</param>
+	void Simplify(float tolerance = 0.5f) {
+		MT3_PERF_SCOPE("LineList::Simplify", lines.size());
+		// まとめている途中の線分
+		ScreenLine run = {};
+		bool hasRun = false;
+		// 始点から見て終点を置いてよい向きの範囲(lower から反時計回りに upper まで)
+		// 途中の頂点ごとに、始点からの直線がその頂点の tolerance 以内を通る向きの範囲を重ねていく
+		bool isBounded = false;
+		float lowerX = 0.0f;
+		float lowerY = 0.0f;
+		float upperX = 0.0f;
+		float upperY = 0.0f;
+		float maxDistance = 0.0f;	// 途中の頂点の始点からの距離の最大(終点がこれより手前で終わらないように)
+		// 今の終点を途中の頂点にして (x, y) まで延ばせるなら延ばす
+		auto extendRun = [&](float x, float y) {
+			float px = x - run.x0;
+			float py = y - run.y0;
+			float ex = run.x1 - run.x0;
+			float ey = run.y1 - run.y0;
+			float distanceSquared = ex * ex + ey * ey;
+			float distance = 0.0f;
+			bool isNextBounded = isBounded;
+			float nextLowerX = lowerX;
+			float nextLowerY = lowerY;
+			float nextUpperX = upperX;
+			float nextUpperY = upperY;
+			if (distanceSquared > tolerance * tolerance) {
+				distance = std::sqrt(distanceSquared);
+				// 今の終点の tolerance 以内を通る向きは、終点の向きから ±asin(tolerance / distance)
+				float sine = tolerance / distance;
+				float cosine = std::sqrt(1.0f - sine * sine);
+				float vertexLowerX = ex * cosine + ey * sine;
+				float vertexLowerY = ey * cosine - ex * sine;
+				float vertexUpperX = ex * cosine - ey * sine;
+				float vertexUpperY = ey * cosine + ex * sine;
+				if (!isNextBounded) {
+					nextLowerX = vertexLowerX;
+					nextLowerY = vertexLowerY;
+					nextUpperX = vertexUpperX;
+					nextUpperY = vertexUpperY;
+					isNextBounded = true;
+				} else {
+					if (nextLowerX * vertexLowerY - nextLowerY * vertexLowerX > 0.0f) {
+						nextLowerX = vertexLowerX;
+						nextLowerY = vertexLowerY;
+					}
+					if (vertexUpperX * nextUpperY - vertexUpperY * nextUpperX > 0.0f) {
+						nextUpperX = vertexUpperX;
+						nextUpperY = vertexUpperY;
+					}
+				}
+			}
+			float nextMaxDistance = (std::max)(maxDistance, distance);
+			if (isNextBounded && (nextLowerX * py - nextLowerY * px < 0.0f || px * nextUpperY - py * nextUpperX < 0.0f)) { return false; }
+			float minDistance = nextMaxDistance - tolerance;
+			if (minDistance > 0.0f && px * px + py * py < minDistance * minDistance) { return false; }
+			isBounded = isNextBounded;
+			lowerX = nextLowerX;
+			lowerY = nextLowerY;
+			upperX = nextUpperX;
+			upperY = nextUpperY;
+			maxDistance = nextMaxDistance;
+			run.x1 = x;
+			run.y1 = y;
+			return true;
+		};
+
+		size_t writeIndex = 0;
+		const size_t count = lines.size();
+		for (size_t i = 0; i < count; ++i) {
+			ScreenLine line = lines[i];
+			float x0 = TruncateToPixel(line.x0);
+			float y0 = TruncateToPixel(line.y0);
+			float x1 = TruncateToPixel(line.x1);
+			float y1 = TruncateToPixel(line.y1);
+			if (x1 == x0 && y1 == y0) { continue; } // 同じ画素の中で終わる
+			bool isConnected = hasRun && line.color == run.color && x0 == run.x1 && y0 == run.y1;
+			if (isConnected && extendRun(x1, y1)) { continue; }
+			// 書き込む位置は読んだ位置より前なので、その場で詰められる
+			if (hasRun) { lines[writeIndex++] = run; }
+			run = { x0, y0, x1, y1, line.color };
+			hasRun = true;
+			isBounded = false;
+			maxDistance = 0.0f;
+		}
+		if (hasRun) { lines[writeIndex++] = run; }
+		lines.resize(writeIndex);
+	}
+};
\ No newline at end of file
@@ -1,16 +1,27 @@
 #pragma once
+#include "FastMath.h"
 #include "Vector2.h"
 #include "Vector3.h"
 #include "Transform.h"
 #include <cassert>
+#include <cmath>
+#include <type_traits>
 
-struct Matrix4x4 {
-	float m[4][4];
+// 4x4行列(T は Vector3T と同じ)
+template<typename T>
+struct Matrix4x4T {
+	T m[4][4];
 };
 
+using Matrix4x4 = Matrix4x4T<float>;
+
+// 行列の関数はスカラー型 T のテンプレートで、double の行列にもそのまま使える
+// スカラーだけを受け取る Make* 関数は T を推論しないので、float 以外は <T> を明示する(float 版は同名の非テンプレート関数)
+
 // 4x4行列の加法
-Matrix4x4 Add(const Matrix4x4& m1, const Matrix4x4& m2) {
-	Matrix4x4 result;
+template<typename T>
+Matrix4x4T<T> Add(const Matrix4x4T<T>& m1, const Matrix4x4T<T>& m2) {
+	Matrix4x4T<T> result;
 	for (int i = 0; i < 4; ++i) {
 		for (int j = 0; j < 4; ++j) {
 			result.m[i][j] = m1.m[i][j] + m2.m[i][j];
@@ -20,8 +31,9 @@ Matrix4x4 Add(const Matrix4x4& m1, const Matrix4x4& m2) {
 };
 
 // 4x4行列の減法
-Matrix4x4 Subtract(const Matrix4x4& m1, const Matrix4x4& m2) {
-	Matrix4x4 result;
+template<typename T>
+Matrix4x4T<T> Subtract(const Matrix4x4T<T>& m1, const Matrix4x4T<T>& m2) {
+	Matrix4x4T<T> result;
 	for (int i = 0; i < 4; ++i) {
 		for (int j = 0; j < 4; ++j) {
 			result.m[i][j] = m1.m[i][j] - m2.m[i][j];
@@ -31,8 +43,9 @@ Matrix4x4 Subtract(const Matrix4x4& m1, const Matrix4x4& m2) {
 };
 
 // 4x4行列の積
-Matrix4x4 Multiply(const Matrix4x4& m1, const Matrix4x4& m2) {
-	Matrix4x4 result;
+template<typename T>
+Matrix4x4T<T> Multiply(const Matrix4x4T<T>& m1, const Matrix4x4T<T>& m2) {
+	Matrix4x4T<T> result;
 	result.m[0][0] = m1.m[0][0] * m2.m[0][0] + m1.m[0][1] * m2.m[1][0] + m1.m[0][2] * m2.m[2][0] + m1.m[0][3] * m2.m[3][0];
 	result.m[0][1] = m1.m[0][0] * m2.m[0][1] + m1.m[0][1] * m2.m[1][1] + m1.m[0][2] * m2.m[2][1] + m1.m[0][3] * m2.m[3][1];
 	result.m[0][2] = m1.m[0][0] * m2.m[0][2] + m1.m[0][1] * m2.m[1][2] + m1.m[0][2] * m2.m[2][2] + m1.m[0][3] * m2.m[3][2];
@@ -56,8 +69,9 @@ Matrix4x4 Multiply(const Matrix4x4& m1, const Matrix4x4& m2) {
 /// 4x4逆行列
 /// </summary>
 /// <param name="m">元となる行列</param>
-Matrix4x4 Inverse(const Matrix4x4& m) {
-	float det =
+template<typename T>
+Matrix4x4T<T> Inverse(const Matrix4x4T<T>& m) {
+	T det =
 		m.m[0][0] * m.m[1][1] * m.m[2][2] * m.m[3][3] +
 		m.m[0][0] * m.m[1][2] * m.m[2][3] * m.m[3][1] +
 		m.m[0][0] * m.m[1][3] * m.m[2][1] * m.m[3][2] -
@@ -83,7 +97,7 @@ Matrix4x4 Inverse(const Matrix4x4& m) {
 		m.m[0][2] * m.m[1][1] * m.m[2][3] * m.m[3][0] +
 		m.m[0][1] * m.m[1][3] * m.m[2][2] * m.m[3][0];
 
-	Matrix4x4 result;
+	Matrix4x4T<T> result;
 	result.m[0][0] = (
 		m.m[1][1] * m.m[2][2] * m.m[3][3] + m.m[1][2] * m.m[2][3] * m.m[3][1] + m.m[1][3] * m.m[2][1] * m.m[3][2] -
 		m.m[1][3] * m.m[2][2] * m.m[3][1] - m.m[1][2] * m.m[2][1] * m.m[3][3] - m.m[1][1] * m.m[2][3] * m.m[3][2]) / det;
@@ -140,8 +154,9 @@ Matrix4x4 Inverse(const Matrix4x4& m) {
 /// </summary>
 /// <param name="m">元となる行列</param>
 /// <returns>行と列を入れ替えた行列</returns>
-Matrix4x4 Transpose(const Matrix4x4& m) {
-	Matrix4x4 result;
+template<typename T>
+Matrix4x4T<T> Transpose(const Matrix4x4T<T>& m) {
+	Matrix4x4T<T> result;
 	for (int i = 0; i < 4; ++i) {
 		for (int j = 0; j < 4; ++j) {
 			result.m[i][j] = m.m[j][i];
@@ -154,27 +169,33 @@ Matrix4x4 Transpose(const Matrix4x4& m) {
 /// 4x4単位行列
 /// </summary>
 /// <returns>対角成分が1、他が0の行列</returns>
-Matrix4x4 MakeIdentity4x4() {
-	Matrix4x4 result = { 0 };
+template<typename T>
+Matrix4x4T<T> MakeIdentity4x4() {
+	Matrix4x4T<T> result = {};
 	for (int i = 0; i < 4; ++i) {
-		result.m[i][i] = 1.0f;
+		result.m[i][i] = T(1);
 	}
 	return result;
 };
 
+Matrix4x4 MakeIdentity4x4() { return MakeIdentity4x4<float>(); }
+
 /// <summary>
 /// 4x4拡大縮小行列
 /// </summary>
 /// <param name="scale">倍率</param>
-Matrix4x4 MakeScaleMatrix(const Vector3& scale) {
-	Matrix4x4 result = { 0 };
+template<typename T>
+Matrix4x4T<T> MakeScaleMatrix(const Vector3T<T>& scale) {
+	Matrix4x4T<T> result = {};
 	result.m[0][0] = scale.x;
 	result.m[1][1] = scale.y;
 	result.m[2][2] = scale.z;
-	result.m[3][3] = 1.0f;
+	result.m[3][3] = T(1);
 	return result;
 };
 
+Matrix4x4 MakeScaleMatrix(const Vector3& scale) { return MakeScaleMatrix<float>(scale); }
+
 /// <summary>
 /// 3D座標変換
 /// </summary>
@@ -200,62 +221,83 @@ Vector3 TransformVector(const Vector3& vector, const Matrix4x4 matrix) {
 /// 4x4平行移動行列の作成
 /// </summary>
 /// <param name="translate">移動量</param>
-Matrix4x4 MakeTranslateMatrix(const Vector3& translate) {
-	Matrix4x4 result = { 0 };
+template<typename T>
+Matrix4x4T<T> MakeTranslateMatrix(const Vector3T<T>& translate) {
+	Matrix4x4T<T> result = {};
 	result.m[3][0] = translate.x;
 	result.m[3][1] = translate.y;
 	result.m[3][2] = translate.z;
 	for (int i = 0; i < 4; ++i) {
-		result.m[i][i] = 1.0f;
+		result.m[i][i] = T(1);
 	}
 	return result;
 };
 
+Matrix4x4 MakeTranslateMatrix(const Vector3& translate) { return MakeTranslateMatrix<float>(translate); }
+
 /// <summary>
 /// X軸回転行列の作成
 /// </summary>
 /// <param name="radian">回転量(ラジアン)</param>
-Matrix4x4 MakeRotateXMatrix(float radian) {
-	Matrix4x4 result = { 0 };
-	result.m[0][0] = 1.0f;
-	result.m[1][1] = std::cosf(radian);
-	result.m[1][2] = std::sinf(radian);
-	result.m[2][1] = -std::sinf(radian);
-	result.m[2][2] = std::cosf(radian);
-	result.m[3][3] = 1.0f;
+template<typename T>
+Matrix4x4T<T> MakeRotateXMatrix(std::type_identity_t<T> radian) {
+	T sinValue;
+	T cosValue;
+	SinCos(radian, sinValue, cosValue);
+	Matrix4x4T<T> result = {};
+	result.m[0][0] = T(1);
+	result.m[1][1] = cosValue;
+	result.m[1][2] = sinValue;
+	result.m[2][1] = -sinValue;
+	result.m[2][2] = cosValue;
+	result.m[3][3] = T(1);
 	return result;
 };
 
+Matrix4x4 MakeRotateXMatrix(float radian) { return MakeRotateXMatrix<float>(radian); }
+
 /// <summary>
 /// Y軸回転行列の作成
 /// </summary>
 /// <param name="radian">回転量(ラジアン)</param>
-Matrix4x4 MakeRotateYMatrix(float radian) {
-	Matrix4x4 result = { 0 };
-	result.m[0][0] = std::cosf(radian);
-	result.m[0][2] = -std::sinf(radian);
-	result.m[1][1] = 1.0f;
-	result.m[2][0] = std::sinf(radian);
-	result.m[2][2] = std::cosf(radian);
-	result.m[3][3] = 1.0f;
+template<typename T>
+Matrix4x4T<T> MakeRotateYMatrix(std::type_identity_t<T> radian) {
+	T sinValue;
+	T cosValue;
+	SinCos(radian, sinValue, cosValue);
+	Matrix4x4T<T> result = {};
+	result.m[0][0] = cosValue;
+	result.m[0][2] = -sinValue;
+	result.m[1][1] = T(1);
+	result.m[2][0] = sinValue;
+	result.m[2][2] = cosValue;
+	result.m[3][3] = T(1);
 	return result;
 };
 
+Matrix4x4 MakeRotateYMatrix(float radian) { return MakeRotateYMatrix<float>(radian); }
+
 /// <summary>
 /// Z軸回転行列の作成
 /// </summary>
 /// <param name="radian">回転量(ラジアン)</param>
-Matrix4x4 MakeRotateZMatrix(float radian) {
-	Matrix4x4 result = { 0 };
-	result.m[0][0] = std::cosf(radian);
-	result.m[0][1] = std::sinf(radian);
-	result.m[1][0] = -std::sinf(radian);
-	result.m[1][1] = std::cosf(radian);
-	result.m[2][2] = 1.0f;
-	result.m[3][3] = 1.0f;
+template<typename T>
+Matrix4x4T<T> MakeRotateZMatrix(std::type_identity_t<T> radian) {
+	T sinValue;
+	T cosValue;
+	SinCos(radian, sinValue, cosValue);
+	Matrix4x4T<T> result = {};
+	result.m[0][0] = cosValue;
+	result.m[0][1] = sinValue;
+	result.m[1][0] = -sinValue;
+	result.m[1][1] = cosValue;
+	result.m[2][2] = T(1);
+	result.m[3][3] = T(1);
 	return result;
 };
 
+Matrix4x4 MakeRotateZMatrix(float radian) { return MakeRotateZMatrix<float>(radian); }
+
 /// <summary>
 /// 4x4アフィン変換行列作成
 /// </summary>
@@ -285,9 +327,10 @@ Matrix4x4 MakeAffineMatrix(const Transform &transform) {
 /// <param name="scale">拡大縮小</param>
 /// <param name="rotate">回転</param>
 /// <param name="translate">平行移動</param>
-Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
-	Matrix4x4 result = { 0 };
-	Matrix4x4 rotateXYZMatrix = Multiply(MakeRotateXMatrix(rotate.x), Multiply(MakeRotateYMatrix(rotate.y), MakeRotateZMatrix(rotate.z)));
+template<typename T>
+Matrix4x4T<T> MakeAffineMatrix(const Vector3T<T>& scale, const Vector3T<T>& rotate, const Vector3T<T>& translate) {
+	Matrix4x4T<T> result = {};
+	Matrix4x4T<T> rotateXYZMatrix = Multiply(MakeRotateXMatrix<T>(rotate.x), Multiply(MakeRotateYMatrix<T>(rotate.y), MakeRotateZMatrix<T>(rotate.z)));
 	result.m[0][0] = scale.x * rotateXYZMatrix.m[0][0];
 	result.m[0][1] = scale.x * rotateXYZMatrix.m[0][1];
 	result.m[0][2] = scale.x * rotateXYZMatrix.m[0][2];
@@ -300,10 +343,14 @@ Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Ve
 	result.m[3][0] = translate.x;
 	result.m[3][1] = translate.y;
 	result.m[3][2] = translate.z;
-	result.m[3][3] = 1.0f;
+	result.m[3][3] = T(1);
 	return result;
 };
 
+Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
+	return MakeAffineMatrix<float>(scale, rotate, translate);
+}
+
 /// <summary>
 /// 透視投影行列作成
 /// </summary>
@@ -311,20 +358,25 @@ Matrix4x4 MakeAffineMatrix(const Vector3& scale, const Vector3& rotate, const Ve
 /// <param name="aspectRatio">アスペクト比</param>
 /// <param name="nearClip">近平面</param>
 /// <param name="farClip">遠平面</param>
-Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip = 0.1f, float farClip = 1000.0f) {
+template<typename T>
+Matrix4x4T<T> MakePerspectiveFovMatrix(std::type_identity_t<T> fovY, std::type_identity_t<T> aspectRatio, std::type_identity_t<T> nearClip = T(0.1), std::type_identity_t<T> farClip = T(1000)) {
 	// 0除算の回避
 	assert(aspectRatio != 0);
 	assert(farClip != nearClip);
 
-	Matrix4x4 result = { 0 };
-	result.m[0][0] = (1.0f / aspectRatio) * (1.0f / std::tanf(fovY / 2.0f));
-	result.m[1][1] = (1.0f / std::tanf(fovY / 2.0f));
+	Matrix4x4T<T> result = {};
+	result.m[0][0] = (T(1) / aspectRatio) * (T(1) / std::tan(fovY / T(2)));
+	result.m[1][1] = (T(1) / std::tan(fovY / T(2)));
 	result.m[2][2] = farClip / (farClip - nearClip);
-	result.m[2][3] = 1.0f;
+	result.m[2][3] = T(1);
 	result.m[3][2] = (-nearClip * farClip) / (farClip - nearClip);
 	return result;
 };
 
+Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip = 0.1f, float farClip = 1000.0f) {
+	return MakePerspectiveFovMatrix<float>(fovY, aspectRatio, nearClip, farClip);
+}
+
 /// <summary>
 /// 3D正射影行列作成
 /// </summary>
@@ -334,23 +386,29 @@ Matrix4x4 MakePerspectiveFovMatrix(float fovY, float aspectRatio, float nearClip
 /// <param name="bottom">下端</param>
 /// <param name="nearClip">近平面</param>
 /// <param name="farClip">遠平面</param>
-Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float bottom, float nearClip = 0.0f, float farClip = 1000.0f) {
+template<typename T>
+Matrix4x4T<T> MakeOrthographicMatrix(std::type_identity_t<T> left, std::type_identity_t<T> top, std::type_identity_t<T> right, std::type_identity_t<T> bottom,
+	std::type_identity_t<T> nearClip = T(0), std::type_identity_t<T> farClip = T(1000)) {
 	// 0除算の回避
 	assert(right != left);
 	assert(top != bottom);
 	assert(farClip != nearClip);
 
-	Matrix4x4 result = { 0 };
-	result.m[0][0] = 2.0f / (right - left);
-	result.m[1][1] = 2.0f / (top - bottom);
-	result.m[2][2] = 1.0f / (farClip - nearClip);
+	Matrix4x4T<T> result = {};
+	result.m[0][0] = T(2) / (right - left);
+	result.m[1][1] = T(2) / (top - bottom);
+	result.m[2][2] = T(1) / (farClip - nearClip);
 	result.m[3][0] = (left + right) / (left - right);
 	result.m[3][1] = (top + bottom) / (bottom - top);
 	result.m[3][2] = nearClip / (nearClip - farClip);
-	result.m[3][3] = 1.0f;
+	result.m[3][3] = T(1);
 	return result;
 };
 
+Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float bottom, float nearClip = 0.0f, float farClip = 1000.0f) {
+	return MakeOrthographicMatrix<float>(left, top, right, bottom, nearClip, farClip);
+}
+
 /// <summary>
 /// ビューポート行列作成
 /// </summary>
@@ -360,18 +418,24 @@ Matrix4x4 MakeOrthographicMatrix(float left, float top, float right, float botto
 /// <param name="height">画面縦幅</param>
 /// <param name="minDepth">最小深度</param>
 /// <param name="maxDepth">最大深度</param>
-Matrix4x4 MakeViewportMatrix(float left, float top, float width, float height, float minDepth = 0.0f, float maxDepth = 1.0f) {
-	Matrix4x4 result = { 0 };
-	result.m[0][0] = width / 2.0f;
-	result.m[1][1] = -height / 2.0f;
+template<typename T>
+Matrix4x4T<T> MakeViewportMatrix(std::type_identity_t<T> left, std::type_identity_t<T> top, std::type_identity_t<T> width, std::type_identity_t<T> height,
+	std::type_identity_t<T> minDepth = T(0), std::type_identity_t<T> maxDepth = T(1)) {
+	Matrix4x4T<T> result = {};
+	result.m[0][0] = width / T(2);
+	result.m[1][1] = -height / T(2);
 	result.m[2][2] = maxDepth - minDepth;
-	result.m[3][0] = left + (width / 2.0f);
-	result.m[3][1] = top + (height / 2.0f);
+	result.m[3][0] = left + (width / T(2));
+	result.m[3][1] = top + (height / T(2));
 	result.m[3][2] = minDepth;
-	result.m[3][3] = 1.0f;
+	result.m[3][3] = T(1);
 	return result;
 };
 
+Matrix4x4 MakeViewportMatrix(float left, float top, float width, float height, float minDepth = 0.0f, float maxDepth = 1.0f) {
+	return MakeViewportMatrix<float>(left, top, width, height, minDepth, maxDepth);
+}
+
 /// <summary>
 /// viewProjection行列作成
 /// </summary>
@@ -403,14 +467,17 @@ Matrix4x4 MakeViewProjectionMatrix(Transform cameraTransform, Matrix4x4 perspect
 };
 
 // 演算子オーバーロード
-Matrix4x4 operator+(const Matrix4x4& m1, const Matrix4x4& m2) {
+template<typename T>
+Matrix4x4T<T> operator+(const Matrix4x4T<T>& m1, const Matrix4x4T<T>& m2) {
 	return Add(m1, m2);
 };
 
-Matrix4x4 operator-(const Matrix4x4& m1, const Matrix4x4& m2) {
+template<typename T>
+Matrix4x4T<T> operator-(const Matrix4x4T<T>& m1, const Matrix4x4T<T>& m2) {
 	return Subtract(m1, m2);
 };
 
-Matrix4x4 operator*(const Matrix4x4& m1, const Matrix4x4& m2) {
+template<typename T>
+Matrix4x4T<T> operator*(const Matrix4x4T<T>& m1, const Matrix4x4T<T>& m2) {
 	return Multiply(m1, m2);
 };
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+#include "Collision.h"
+#include "Gjk.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// 候補ペアの詳細判定(ナローフェーズ)を並列に行う
+// 結果はスレッドごとのバッファに追記し(共有するものへの書き込みが無いのでロック不要)、
+// 最後にペア番号で並べて1つにまとめるので、スレッド数や処理順によらず同じ結果になる
+
+static const size_t kNarrowPhaseGrainSize = 256;	// 並列処理の1回の区切り
+
+// 判定する2つの図形の番号
+struct CollisionPair {
+	uint32_t a;
+	uint32_t b;
+};
+
+// ペア番号(並べる順)
+uint64_t GetPairId(const CollisionPair& pair) {
+	return (uint64_t(pair.a) << 32) | pair.b;
+}
+
+// 当たったペアと結果
+template<typename Result>
+struct PairResult {
+	uint64_t pairId;
+	Result result;
+};
+
+/// <summary>
+/// ナローフェーズ(バッファは使い回す)
+/// 同じインスタンスを複数のスレッドから同時に Run しないこと
+/// </summary>
+template<typename Result = Contact>
+class NarrowPhase {
+public:
+	explicit NarrowPhase(ThreadPool* threadPool = nullptr)
+		: threadPool_(threadPool ? threadPool : &ThreadPool::GetDefault()),
+		threadBuffers_(threadPool_->GetThreadCount()) {}
+
+	/// <summary>
+	/// ペアを並列に判定し、当たったものをペア番号の順に返す
+	/// </summary>
+	/// <param name="pairs">候補ペア(ペア番号は重複しないこと)</param>
+	/// <param name="count">ペアの数</param>
+	/// <param name="test">test(pair, result) 当たれば result を埋めて true を返す(複数のスレッドから呼ばれる)</param>
+	/// <returns>次の Run まで有効</returns>
+	template<typename TestFunction>
+	const std::vector<PairResult<Result>>& Run(const CollisionPair* pairs, size_t count, const TestFunction& test) {
+		MT3_PROFILE_SCOPE("NarrowPhase::Run");
+		for (ThreadBuffer& buffer : threadBuffers_) {
+			buffer.results.clear();
+		}
+		threadPool_->ParallelFor(count, kNarrowPhaseGrainSize, [&](size_t begin, size_t end, uint32_t workerIndex) {
+			// カウンタはスレッドごとなのでワーカーの中で数える
+			MT3_PERF_SCOPE("NarrowPhase::Test", end - begin);
+			std::vector<PairResult<Result>>& results = threadBuffers_[workerIndex].results;
+			for (size_t i = begin; i < end; ++i) {
+				PairResult<Result> pairResult;
+				if (test(pairs[i], pairResult.result)) {
+					pairResult.pairId = GetPairId(pairs[i]);
+					results.push_back(pairResult);
+				}
+			}
+		});
+
+		// スレッドごとの結果をまとめてペア番号で並べる
+		MT3_PROFILE_SCOPE("NarrowPhase::Merge");
+		size_t total = 0;
+		for (const ThreadBuffer& buffer : threadBuffers_) {
+			total += buffer.results.size();
+		}
+		results_.clear();
+		results_.reserve(total);
+		for (const ThreadBuffer& buffer : threadBuffers_) {
+			results_.insert(results_.end(), buffer.results.begin(), buffer.results.end());
+		}
+		std::sort(results_.begin(), results_.end(), [](const PairResult<Result>& l, const PairResult<Result>& r) {
+			return l.pairId < r.pairId;
+		});
+		return results_;
+	}
+
+	/// <summary>
+	/// 図形の配列同士のペアを GetContact で判定する
+	/// </summary>
+	/// <param name="shapesA">pair.a が指す図形</param>
+	/// <param name="shapesB">pair.b が指す図形</param>
+	/// <param name="pairs">候補ペア</param>
+	/// <param name="count">ペアの数</param>
+	template<typename ShapeA, typename ShapeB>
+	const std::vector<PairResult<Result>>& RunContacts(const ShapeA* shapesA, const ShapeB* shapesB, const CollisionPair* pairs, size_t count) {
+		return Run(pairs, count, [shapesA, shapesB](const CollisionPair& pair, Result& result) {
+			result = GetContact(shapesA[pair.a], shapesB[pair.b]);
+			return result.hit;
+		});
+	}
+
+	const std::vector<PairResult<Result>>& GetResults() const { return results_; }
+
+private:
+	// 隣のスレッドのバッファと同じキャッシュラインに載らないようにする
+	struct alignas(64) ThreadBuffer {
+		std::vector<PairResult<Result>> results;
+	};
+
+	ThreadPool* threadPool_;
+	std::vector<ThreadBuffer> threadBuffers_;	// ParallelFor の workerIndex ごと
+	std::vector<PairResult<Result>> results_;
+};
\ No newline at end of file
@@ -0,0 +1,499 @@
+#pragma once
+#include "Shape.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 並列に解析するファイルサイズの下限(これより小さければ1スレッドで読む)
+static const size_t kObjParallelThreshold = 1u << 20;
+// バイナリキャッシュの識別子と版
+static const uint32_t kCollisionMeshCacheMagic = 0x4D33544D; // "MT3M"
+static const uint32_t kCollisionMeshCacheVersion = 1;
+
+/// <summary>
+/// 衝突判定用のメッシュ(SoAの頂点配列 + 三角形の頂点番号)
+/// </summary>
+struct CollisionMesh {
+	std::vector<float> x;			// 頂点のx座標
+	std::vector<float> y;			// 頂点のy座標
+	std::vector<float> z;			// 頂点のz座標
+	std::vector<uint32_t> indices;	// 三角形ごとに3つ
+
+	size_t GetVertexCount() const { return x.size(); }
+	size_t GetTriangleCount() const { return indices.size() / 3; }
+
+	Vector3 GetVertex(size_t index) const { return { x[index], y[index], z[index] }; }
+
+	// CheckCollisionにそのまま渡せる三角形
+	Triangle GetTriangle(size_t triangleIndex) const {
+		const uint32_t* corner = &indices[triangleIndex * 3];
+		return { { GetVertex(corner[0]), GetVertex(corner[1]), GetVertex(corner[2]) } };
+	}
+};
+
+/// <summary>
+/// 読み取り専用でメモリに割り当てたファイル
+/// </summary>
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/// <summary>
+	/// ファイルを開いて割り当てる
+	/// </summary>
+	/// <param name="path">ファイルパス</param>
+	/// <returns>成功したらtrue</returns>
+	bool Open(const char* path) {
+		Close();
+#if defined(_WIN32)
+		file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE) { return false; }
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file_, &size)) { Close(); return false; }
+		size_ = size_t(size.QuadPart);
+		if (size_ == 0) { return true; }
+		mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping_) { Close(); return false; }
+		data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+		if (!data_) { Close(); return false; }
+#else
+		file_ = open(path, O_RDONLY);
+		if (file_ < 0) { return false; }
+		struct stat status;
+		if (fstat(file_, &status) != 0) { Close(); return false; }
+		size_ = size_t(status.st_size);
+		if (size_ == 0) { return true; }
+		void* address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_, 0);
+		if (address == MAP_FAILED) { Close(); return false; }
+		madvise(address, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const char*>(address);
+#endif
+		return true;
+	}
+
+	void Close() {
+#if defined(_WIN32)
+		if (data_) { UnmapViewOfFile(data_); }
+		if (mapping_) { CloseHandle(mapping_); }
+		if (file_ != INVALID_HANDLE_VALUE) { CloseHandle(file_); }
+		mapping_ = nullptr;
+		file_ = INVALID_HANDLE_VALUE;
+#else
+		if (data_) { munmap(const_cast<char*>(data_), size_); }
+		if (file_ >= 0) { close(file_); }
+		file_ = -1;
+#endif
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+	const char* GetData() const { return data_; }
+	size_t GetSize() const { return size_; }
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+#if defined(_WIN32)
+	HANDLE file_ = INVALID_HANDLE_VALUE;
+	HANDLE mapping_ = nullptr;
+#else
+	int file_ = -1;
+#endif
+};
+
+/// <summary>
+/// 小数を読む(ロケールに依存しない)
+/// </summary>
+/// <param name="cursor">読み始める位置(読んだ分進む)</param>
+/// <param name="end">読める範囲の末尾</param>
+/// <param name="value">結果</param>
+/// <returns>数字を読めたらtrue</returns>
+bool ParseObjFloat(const char*& cursor, const char* end, float& value) {
+	static const double kPowers[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const char* p = cursor;
+	while (p < end && (*p == ' ' || *p == '\t')) { ++p; }
+	bool isNegative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		isNegative = *p == '-';
+		++p;
+	}
+	const char* digitsBegin = p;
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digitCount = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+		// 19桁を超える分は精度に影響しないので桁数だけ数える
+		if (digitCount < 19) { mantissa = mantissa * 10 + uint64_t(*p - '0'); ++digitCount; } else { ++exponent; }
+	}
+	if (p < end && *p == '.') {
+		++p;
+		for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+			if (digitCount < 19) { mantissa = mantissa * 10 + uint64_t(*p - '0'); ++digitCount; --exponent; }
+		}
+	}
+	if (p == digitsBegin || (p == digitsBegin + 1 && *digitsBegin == '.')) {
+		return false;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* e = p + 1;
+		bool isExponentNegative = false;
+		if (e < end && (*e == '-' || *e == '+')) {
+			isExponentNegative = *e == '-';
+			++e;
+		}
+		if (e < end && *e >= '0' && *e <= '9') {
+			int exponentValue = 0;
+			for (; e < end && *e >= '0' && *e <= '9'; ++e) {
+				if (exponentValue < 10000) { exponentValue = exponentValue * 10 + (*e - '0'); }
+			}
+			exponent += isExponentNegative ? -exponentValue : exponentValue;
+			p = e;
+		}
+	}
+	double result = double(mantissa);
+	while (exponent > 22) { result *= 1e22; exponent -= 22; }
+	while (exponent < -22) { result /= 1e22; exponent += 22; }
+	result = exponent >= 0 ? result * kPowers[exponent] : result / kPowers[-exponent];
+	value = float(isNegative ? -result : result);
+	cursor = p;
+	return true;
+}
+
+/// <summary>
+/// 整数を読む
+/// </summary>
+bool ParseObjInt(const char*& cursor, const char* end, int64_t& value) {
+	const char* p = cursor;
+	bool isNegative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		isNegative = *p == '-';
+		++p;
+	}
+	if (p >= end || *p < '0' || *p > '9') { return false; }
+	int64_t result = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+		result = result * 10 + (*p - '0');
+	}
+	value = isNegative ? -result : result;
+	cursor = p;
+	return true;
+}
+
+/// <summary>
+/// OBJの一部分を解析した結果
+/// </summary>
+struct ObjChunk {
+	std::vector<float> positions;	// x,y,z の順
+	std::vector<uint64_t> corners;	// 三角形の頂点番号(負の番号は kObjRelativeFlag 付きのチャンク内番号)
+	bool hasError = false;
+};
+
+// チャンク内の頂点数を基準にした番号であることを示す
+static const uint64_t kObjRelativeFlag = 1ull << 62;
+
+/// <summary>
+/// [begin, end) の行を解析する(begin は行頭であること)
+/// </summary>
+void ParseObjChunk(const char* begin, const char* end, ObjChunk& chunk) {
+	const char* p = begin;
+	std::vector<uint64_t> polygon;
+	while (p < end) {
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+		if (!lineEnd) { lineEnd = end; }
+		while (p < lineEnd && (*p == ' ' || *p == '\t')) { ++p; }
+
+		if (lineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			// 頂点座標
+			p += 2;
+			float v[3];
+			for (int i = 0; i < 3; ++i) {
+				if (!ParseObjFloat(p, lineEnd, v[i])) {
+					chunk.hasError = true;
+					v[i] = 0.0f;
+				}
+			}
+			chunk.positions.insert(chunk.positions.end(), v, v + 3);
+		} else if (lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			// 面(v, v/vt, v/vt/vn, v//vn のいずれも位置の番号だけ使う)
+			p += 2;
+			polygon.clear();
+			uint64_t localCount = chunk.positions.size() / 3;
+			for (;;) {
+				while (p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r')) { ++p; }
+				int64_t index;
+				if (!ParseObjInt(p, lineEnd, index)) { break; }
+				while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r') { ++p; }
+				if (index > 0) {
+					polygon.push_back(uint64_t(index - 1));
+				} else if (index < 0) {
+					// 負の番号は直前の頂点からの相対位置。前のチャンクを指すこともあるので 2^62 を法として持つ
+					polygon.push_back(kObjRelativeFlag | (uint64_t(int64_t(localCount) + index) & (kObjRelativeFlag - 1)));
+				} else {
+					chunk.hasError = true;
+				}
+			}
+			// 多角形は扇状に三角形に分ける
+			for (size_t i = 2; i < polygon.size(); ++i) {
+				chunk.corners.push_back(polygon[0]);
+				chunk.corners.push_back(polygon[i - 1]);
+				chunk.corners.push_back(polygon[i]);
+			}
+		}
+		p = lineEnd + 1;
+	}
+}
+
+/// <summary>
+/// 同じ座標の頂点を1つにまとめる
+/// </summary>
+/// <param name="mesh">対象のメッシュ</param>
+void WeldCollisionMeshVertices(CollisionMesh& mesh) {
+	struct Key {
+		uint32_t bits[3];
+		bool operator==(const Key& other) const { return std::memcmp(bits, other.bits, sizeof(bits)) == 0; }
+	};
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			uint64_t hash = 14695981039346656037ull;
+			for (uint32_t bits : key.bits) {
+				hash = (hash ^ bits) * 1099511628211ull;
+			}
+			return size_t(hash);
+		}
+	};
+
+	std::unordered_map<Key, uint32_t, KeyHash> lookup;
+	lookup.reserve(mesh.GetVertexCount());
+	std::vector<uint32_t> remap(mesh.GetVertexCount());
+	CollisionMesh welded;
+	for (size_t i = 0; i < mesh.GetVertexCount(); ++i) {
+		// -0.0 と 0.0 を同じにする
+		float v[3] = { mesh.x[i] + 0.0f, mesh.y[i] + 0.0f, mesh.z[i] + 0.0f };
+		Key key;
+		std::memcpy(key.bits, v, sizeof(v));
+		auto result = lookup.emplace(key, uint32_t(welded.x.size()));
+		if (result.second) {
+			welded.x.push_back(v[0]);
+			welded.y.push_back(v[1]);
+			welded.z.push_back(v[2]);
+		}
+		remap[i] = result.first->second;
+	}
+	for (uint32_t& index : mesh.indices) {
+		index = remap[index];
+	}
+	mesh.x.swap(welded.x);
+	mesh.y.swap(welded.y);
+	mesh.z.swap(welded.z);
+}
+
+/// <summary>
+/// メモリ上のOBJを解析する
+/// </summary>
+/// <param name="data">ファイルの中身</param>
+/// <param name="size">サイズ</param>
+/// <param name="mesh">結果</param>
+/// <param name="weldVertices">同じ座標の頂点をまとめるか</param>
+/// <returns>面が参照する頂点がすべて存在すればtrue</returns>
+bool ParseObjMesh(const char* data, size_t size, CollisionMesh& mesh, bool weldVertices = true) {
+	mesh = CollisionMesh();
+
+	// 改行位置で区切ってチャンクに分ける
+	ThreadPool& threadPool = ThreadPool::GetDefault();
+	size_t chunkCount = size < kObjParallelThreshold ? 1 : size_t(threadPool.GetThreadCount()) * 4;
+	std::vector<const char*> bounds(chunkCount + 1);
+	bounds[0] = data;
+	for (size_t i = 1; i < chunkCount; ++i) {
+		const char* p = data + size * i / chunkCount;
+		if (p < bounds[i - 1]) { p = bounds[i - 1]; }
+		const char* newline = static_cast<const char*>(std::memchr(p, '\n', size_t(data + size - p)));
+		bounds[i] = newline ? newline + 1 : data + size;
+	}
+	bounds[chunkCount] = data + size;
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	threadPool.ParallelFor(chunkCount, 1, [&](size_t begin, size_t end, uint32_t) {
+		for (size_t i = begin; i < end; ++i) {
+			ParseObjChunk(bounds[i], bounds[i + 1], chunks[i]);
+		}
+	});
+
+	// チャンクごとの頂点の開始位置
+	std::vector<uint64_t> vertexBase(chunkCount + 1, 0);
+	size_t cornerCount = 0;
+	for (size_t i = 0; i < chunkCount; ++i) {
+		vertexBase[i + 1] = vertexBase[i] + chunks[i].positions.size() / 3;
+		cornerCount += chunks[i].corners.size();
+	}
+	const uint64_t vertexCount = vertexBase[chunkCount];
+	mesh.x.resize(size_t(vertexCount));
+	mesh.y.resize(size_t(vertexCount));
+	mesh.z.resize(size_t(vertexCount));
+	mesh.indices.resize(cornerCount);
+
+	// 結合(SoAへの並べ替えと負の番号の解決)
+	std::vector<size_t> cornerBase(chunkCount + 1, 0);
+	for (size_t i = 0; i < chunkCount; ++i) {
+		cornerBase[i + 1] = cornerBase[i] + chunks[i].corners.size();
+	}
+	std::atomic<bool> isValid{ true };
+	threadPool.ParallelFor(chunkCount, 1, [&](size_t begin, size_t end, uint32_t) {
+		for (size_t i = begin; i < end; ++i) {
+			const ObjChunk& chunk = chunks[i];
+			size_t base = size_t(vertexBase[i]);
+			for (size_t v = 0; v < chunk.positions.size() / 3; ++v) {
+				mesh.x[base + v] = chunk.positions[v * 3 + 0];
+				mesh.y[base + v] = chunk.positions[v * 3 + 1];
+				mesh.z[base + v] = chunk.positions[v * 3 + 2];
+			}
+			for (size_t c = 0; c < chunk.corners.size(); ++c) {
+				uint64_t corner = chunk.corners[c];
+				uint64_t index = corner;
+				if (corner & kObjRelativeFlag) {
+					index = (vertexBase[i] + (corner & (kObjRelativeFlag - 1))) & (kObjRelativeFlag - 1);
+				}
+				if (index >= vertexCount) {
+					isValid = false;
+					index = 0;
+				}
+				mesh.indices[cornerBase[i] + c] = uint32_t(index);
+			}
+			if (chunk.hasError) {
+				isValid = false;
+			}
+		}
+	});
+
+	if (weldVertices) {
+		WeldCollisionMeshVertices(mesh);
+	}
+	return isValid;
+}
+
+/// <summary>
+/// メッシュをバイナリキャッシュとして保存
+/// </summary>
+/// <param name="path">出力先</param>
+/// <param name="mesh">メッシュ</param>
+/// <param name="sourceSize">元のOBJのサイズ(更新の確認用)</param>
+/// <param name="sourceTime">元のOBJの更新時刻(更新の確認用)</param>
+bool SaveCollisionMeshCache(const char* path, const CollisionMesh& mesh, uint64_t sourceSize, int64_t sourceTime) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) { return false; }
+	uint32_t header[2] = { kCollisionMeshCacheMagic, kCollisionMeshCacheVersion };
+	uint64_t counts[2] = { mesh.GetVertexCount(), mesh.indices.size() };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&sourceSize), sizeof(sourceSize));
+	file.write(reinterpret_cast<const char*>(&sourceTime), sizeof(sourceTime));
+	file.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+	file.write(reinterpret_cast<const char*>(mesh.x.data()), std::streamsize(sizeof(float) * mesh.x.size()));
+	file.write(reinterpret_cast<const char*>(mesh.y.data()), std::streamsize(sizeof(float) * mesh.y.size()));
+	file.write(reinterpret_cast<const char*>(mesh.z.data()), std::streamsize(sizeof(float) * mesh.z.size()));
+	file.write(reinterpret_cast<const char*>(mesh.indices.data()), std::streamsize(sizeof(uint32_t) * mesh.indices.size()));
+	return bool(file);
+}
+
+/// <summary>
+/// バイナリキャッシュを読み込む
+/// </summary>
+/// <param name="path">キャッシュのパス</param>
+/// <param name="mesh">結果</param>
+/// <param name="sourceSize">元のOBJのサイズ</param>
+/// <param name="sourceTime">元のOBJの更新時刻</param>
+/// <returns>キャッシュが有効で読み込めたらtrue</returns>
+bool LoadCollisionMeshCache(const char* path, CollisionMesh& mesh, uint64_t sourceSize, int64_t sourceTime) {
+	MappedFile file;
+	if (!file.Open(path)) { return false; }
+	const size_t kHeaderSize = sizeof(uint32_t) * 2 + sizeof(uint64_t) * 4;
+	if (file.GetSize() < kHeaderSize) { return false; }
+	const char* p = file.GetData();
+	uint32_t header[2];
+	uint64_t cachedSize;
+	int64_t cachedTime;
+	uint64_t counts[2];
+	std::memcpy(header, p, sizeof(header));
+	std::memcpy(&cachedSize, p + 8, sizeof(cachedSize));
+	std::memcpy(&cachedTime, p + 16, sizeof(cachedTime));
+	std::memcpy(counts, p + 24, sizeof(counts));
+	if (header[0] != kCollisionMeshCacheMagic || header[1] != kCollisionMeshCacheVersion ||
+		cachedSize != sourceSize || cachedTime != sourceTime) {
+		return false;
+	}
+	if (file.GetSize() != kHeaderSize + counts[0] * sizeof(float) * 3 + counts[1] * sizeof(uint32_t)) {
+		return false;
+	}
+	p += kHeaderSize;
+	mesh.x.resize(size_t(counts[0]));
+	mesh.y.resize(size_t(counts[0]));
+	mesh.z.resize(size_t(counts[0]));
+	mesh.indices.resize(size_t(counts[1]));
+	std::memcpy(mesh.x.data(), p, sizeof(float) * mesh.x.size());
+	p += sizeof(float) * mesh.x.size();
+	std::memcpy(mesh.y.data(), p, sizeof(float) * mesh.y.size());
+	p += sizeof(float) * mesh.y.size();
+	std::memcpy(mesh.z.data(), p, sizeof(float) * mesh.z.size());
+	p += sizeof(float) * mesh.z.size();
+	std::memcpy(mesh.indices.data(), p, sizeof(uint32_t) * mesh.indices.size());
+	return true;
+}
+
+/// <summary>
+/// OBJを読み込む
+/// キャッシュのパスを指定すると、有効なキャッシュがあれば解析を省き、なければ解析後に書き出す
+/// </summary>
+/// <param name="path">OBJのパス</param>
+/// <param name="mesh">結果</param>
+/// <param name="cachePath">バイナリキャッシュのパス(nullptrなら使わない)</param>
+/// <returns>読み込めたらtrue</returns>
+bool LoadObjMesh(const char* path, CollisionMesh& mesh, const char* cachePath = nullptr) {
+	std::error_code error;
+	uint64_t sourceSize = std::filesystem::file_size(path, error);
+	if (error) { return false; }
+	int64_t sourceTime = int64_t(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+	if (error) { return false; }
+
+	if (cachePath && LoadCollisionMeshCache(cachePath, mesh, sourceSize, sourceTime)) {
+		return true;
+	}
+
+	MappedFile file;
+	if (!file.Open(path)) { return false; }
+	if (!ParseObjMesh(file.GetData(), file.GetSize(), mesh)) { return false; }
+	if (cachePath) {
+		SaveCollisionMeshCache(cachePath, mesh, sourceSize, sourceTime);
+	}
+	return true;
+}
+
+/// <summary>
+/// メッシュの全三角形を Triangle の配列として取り出す
+/// </summary>
+/// <param name="mesh">メッシュ</param>
+/// <param name="triangles">追加先</param>
+void AppendCollisionMeshTriangles(const CollisionMesh& mesh, std::vector<Triangle>& triangles) {
+	triangles.reserve(triangles.size() + mesh.GetTriangleCount());
+	for (size_t i = 0; i < mesh.GetTriangleCount(); ++i) {
+		triangles.push_back(mesh.GetTriangle(i));
+	}
+}
\ No newline at end of file
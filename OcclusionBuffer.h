@@ -0,0 +1,392 @@
+#pragma once
+#include "LaneMath.h"
+#include "Matrix4x4.h"
+#include "Profiler.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// 遮蔽カリング用の低解像度の深度バッファ
+// 大きな図形(遮蔽物)の三角形を粗い解像度でCPUラスタライズし、2x2の最大値を重ねた階層(Hi-Z)を作る
+// 物体の境界ボックスが全て手前の遮蔽物より奥にあれば、描画や衝突判定の前に省ける
+
+// ラスタライズを分担する行の帯の高さ(ピクセル)
+static const uint32_t kOcclusionBandHeight = 8;
+
+/// <summary>
+/// 遮蔽カリング用の深度バッファ
+/// 深度は射影後の z/w(手前0、奥1)で、何も描いていない画素は1
+/// 遮蔽物は画素の中心で描き、Hi-Z の0段目を周囲3x3の最も奥の値にすることで
+/// 輪郭で一部だけ覆われた画素も奥として扱う(見える物を誤って省かない)
+/// </summary>
+class OcclusionBuffer {
+public:
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="width">横幅(画面の解像度とは別で、粗くてよい)</param>
+	/// <param name="height">縦幅</param>
+	/// <param name="threadPool">使うスレッドプール(nullptrなら共有のもの)</param>
+	OcclusionBuffer(uint32_t width = 256, uint32_t height = 144, ThreadPool* threadPool = nullptr)
+		: width_(width), height_(height),
+		threadPool_(threadPool ? threadPool : &ThreadPool::GetDefault()) {
+		// 1行をレーン幅の倍数にしておき、行の端でもまとめて読み書きできるようにする
+		const uint32_t laneWidth = LaneTraits<FloatLanes>::kWidth;
+		stride_ = (width_ + laneWidth - 1) / laneWidth * laneWidth;
+		// Hi-Z の各段(0段目が元の解像度)
+		uint32_t levelWidth = width_;
+		uint32_t levelHeight = height_;
+		while (true) {
+			levels_.push_back({ levelWidth, levelHeight, std::vector<float>(size_t(levelWidth) * levelHeight, 1.0f) });
+			if (levelWidth == 1 && levelHeight == 1) { break; }
+			levelWidth = (levelWidth + 1) / 2;
+			levelHeight = (levelHeight + 1) / 2;
+		}
+		depth_.resize(size_t(stride_) * height_, 1.0f);
+	}
+
+	/// <summary>
+	/// フレームの始めに深度を消して、使うビュー射影行列を決める
+	/// </summary>
+	/// <param name="viewProjectionMatrix">ビュー射影行列</param>
+	void Begin(const Matrix4x4& viewProjectionMatrix) {
+		viewProjectionMatrix_ = viewProjectionMatrix;
+		triangles_.clear();
+		std::fill(depth_.begin(), depth_.end(), 1.0f);
+	}
+
+	/// <summary>
+	/// 遮蔽物の三角形を登録する(表裏は問わない)
+	/// </summary>
+	/// <param name="triangle">三角形</param>
+	void AddOccluder(const Triangle& triangle) {
+		ClipVertex vertices[3] = {
+			ToClip(triangle.vertices[0]), ToClip(triangle.vertices[1]), ToClip(triangle.vertices[2]) };
+		AddClipTriangle(vertices);
+	}
+
+	/// <summary>
+	/// 遮蔽物の箱を登録する
+	/// </summary>
+	/// <param name="aabb">AABB</param>
+	void AddOccluder(const AABB& aabb) {
+		Vector3 corners[8];
+		for (int i = 0; i < 8; ++i) {
+			corners[i] = { (i & 1) ? aabb.max.x : aabb.min.x, (i & 2) ? aabb.max.y : aabb.min.y, (i & 4) ? aabb.max.z : aabb.min.z };
+		}
+		AddBoxCorners(corners);
+	}
+
+	/// <summary>
+	/// 遮蔽物の箱を登録する
+	/// </summary>
+	/// <param name="obb">OBB</param>
+	void AddOccluder(const OBB& obb) {
+		Vector3 corners[8];
+		for (int i = 0; i < 8; ++i) {
+			corners[i] = obb.center +
+				obb.orientations[0] * ((i & 1) ? obb.size.x : -obb.size.x) +
+				obb.orientations[1] * ((i & 2) ? obb.size.y : -obb.size.y) +
+				obb.orientations[2] * ((i & 4) ? obb.size.z : -obb.size.z);
+		}
+		AddBoxCorners(corners);
+	}
+
+	/// <summary>
+	/// 登録した遮蔽物を描き、Hi-Z を作る
+	/// 行の帯ごとに並列に描く(各画素は手前の値を残すだけなので、分け方によらず同じ結果になる)
+	/// </summary>
+	void Rasterize() {
+		MT3_PROFILE_SCOPE("OcclusionBuffer::Rasterize");
+		uint32_t bandCount = (height_ + kOcclusionBandHeight - 1) / kOcclusionBandHeight;
+		threadPool_->ParallelFor(bandCount, 1, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t band = begin; band < end; ++band) {
+				int bandTop = int(band * kOcclusionBandHeight);
+				int bandBottom = (std::min)(bandTop + int(kOcclusionBandHeight), int(height_));
+				for (const ScreenTriangle& triangle : triangles_) {
+					DrawTriangle(triangle, bandTop, bandBottom);
+				}
+			}
+		});
+		BuildHierarchy();
+	}
+
+	/// <summary>
+	/// 箱が見えるかどうか(画面外、または全て遮蔽物の奥にあればfalse)
+	/// 近くの面をまたぐ箱は見えるものとする
+	/// </summary>
+	/// <param name="aabb">AABB</param>
+	bool IsVisible(const AABB& aabb) const {
+		float minX = (std::numeric_limits<float>::max)();
+		float minY = (std::numeric_limits<float>::max)();
+		float maxX = -(std::numeric_limits<float>::max)();
+		float maxY = -(std::numeric_limits<float>::max)();
+		float minDepth = (std::numeric_limits<float>::max)();
+		for (int i = 0; i < 8; ++i) {
+			Vector3 corner = { (i & 1) ? aabb.max.x : aabb.min.x, (i & 2) ? aabb.max.y : aabb.min.y, (i & 4) ? aabb.max.z : aabb.min.z };
+			ClipVertex clip = ToClip(corner);
+			if (clip.z <= 0.0f) { return true; }
+			Vector3 screen = ToScreen(clip);
+			minX = (std::min)(minX, screen.x);
+			minY = (std::min)(minY, screen.y);
+			maxX = (std::max)(maxX, screen.x);
+			maxY = (std::max)(maxY, screen.y);
+			minDepth = (std::min)(minDepth, screen.z);
+		}
+		// 覆う画素の範囲(画面外なら見えない)
+		int x0 = (std::max)(int(std::floor(minX)), 0);
+		int y0 = (std::max)(int(std::floor(minY)), 0);
+		int x1 = (std::min)(int(std::floor(maxX)), int(width_) - 1);
+		int y1 = (std::min)(int(std::floor(maxY)), int(height_) - 1);
+		if (x0 > x1 || y0 > y1 || minDepth > 1.0f) { return false; }
+
+		// 範囲が2x2テクセル程度に収まる段で調べる
+		uint32_t level = 0;
+		while (level + 1 < levels_.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+			++level;
+		}
+		const HiZLevel& hiZ = levels_[level];
+		for (int y = y0 >> level; y <= (y1 >> level); ++y) {
+			for (int x = x0 >> level; x <= (x1 >> level); ++x) {
+				if (minDepth <= hiZ.depth[size_t(y) * hiZ.width + x]) { return true; }
+			}
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// 球が見えるかどうか(球を囲む箱で調べる)
+	/// </summary>
+	/// <param name="sphere">球</param>
+	bool IsVisible(const Sphere& sphere) const {
+		Vector3 extent = { sphere.radius, sphere.radius, sphere.radius };
+		return IsVisible(AABB{ sphere.center - extent, sphere.center + extent });
+	}
+
+	/// <summary>
+	/// 複数の箱をまとめて調べる
+	/// </summary>
+	/// <param name="aabbs">AABB</param>
+	/// <param name="count">数</param>
+	/// <param name="visible">結果(見えるなら1)</param>
+	void TestVisibility(const AABB* aabbs, size_t count, uint8_t* visible) const {
+		MT3_PROFILE_SCOPE("OcclusionBuffer::TestVisibility");
+		threadPool_->ParallelFor(count, 256, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				visible[i] = IsVisible(aabbs[i]) ? 1 : 0;
+			}
+		});
+	}
+
+	uint32_t GetWidth() const { return width_; }
+	uint32_t GetHeight() const { return height_; }
+	// 深度(1行は GetStride() 個で、右端の余りは使わない)
+	const std::vector<float>& GetDepth() const { return depth_; }
+	uint32_t GetStride() const { return stride_; }
+	size_t GetOccluderTriangleCount() const { return triangles_.size(); }
+
+private:
+	// 射影後の同次座標
+	struct ClipVertex {
+		float x;
+		float y;
+		float z;
+		float w;
+	};
+
+	// 描く三角形(バッファのピクセル座標、反時計回りにそろえる)
+	struct ScreenTriangle {
+		float edgeA[3];	// 辺の式 a*x + b*y + c >= 0 で内側
+		float edgeB[3];
+		float edgeC[3];
+		float depthA;	// 深度の平面 a*x + b*y + c
+		float depthB;
+		float depthC;
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+	};
+
+	// Hi-Z の1段
+	struct HiZLevel {
+		uint32_t width;
+		uint32_t height;
+		std::vector<float> depth;
+	};
+
+	ClipVertex ToClip(const Vector3& v) const {
+		const Matrix4x4& m = viewProjectionMatrix_;
+		return {
+			v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + m.m[3][0],
+			v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + m.m[3][1],
+			v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + m.m[3][2],
+			v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + m.m[3][3] };
+	}
+
+	// バッファのピクセル座標と深度(左上が原点、y は下向き)
+	Vector3 ToScreen(const ClipVertex& v) const {
+		float inverseW = 1.0f / v.w;
+		return {
+			(v.x * inverseW * 0.5f + 0.5f) * float(width_),
+			(0.5f - v.y * inverseW * 0.5f) * float(height_),
+			v.z * inverseW };
+	}
+
+	void AddBoxCorners(const Vector3 (&corners)[8]) {
+		// 各面を2つの三角形にする(角の番号はビット0がx、1がy、2がz)
+		static const int kFaces[6][4] = {
+			{ 0, 2, 6, 4 }, { 1, 5, 7, 3 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 6, 7, 5 } };
+		ClipVertex clip[8];
+		for (int i = 0; i < 8; ++i) {
+			clip[i] = ToClip(corners[i]);
+		}
+		for (const int* face : kFaces) {
+			ClipVertex first[3] = { clip[face[0]], clip[face[1]], clip[face[2]] };
+			ClipVertex second[3] = { clip[face[0]], clip[face[2]], clip[face[3]] };
+			AddClipTriangle(first);
+			AddClipTriangle(second);
+		}
+	}
+
+	/// <summary>
+	/// 近くの面(z = 0)で切り取ってから登録する
+	/// </summary>
+	void AddClipTriangle(const ClipVertex (&vertices)[3]) {
+		ClipVertex polygon[4];
+		int count = 0;
+		for (int i = 0; i < 3; ++i) {
+			const ClipVertex& a = vertices[i];
+			const ClipVertex& b = vertices[(i + 1) % 3];
+			if (a.z >= 0.0f) { polygon[count++] = a; }
+			if ((a.z >= 0.0f) != (b.z >= 0.0f)) {
+				float t = a.z / (a.z - b.z);
+				polygon[count++] = {
+					a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, 0.0f, a.w + (b.w - a.w) * t };
+			}
+		}
+		for (int i = 1; i + 1 < count; ++i) {
+			AddScreenTriangle(ToScreen(polygon[0]), ToScreen(polygon[i]), ToScreen(polygon[i + 1]));
+		}
+	}
+
+	void AddScreenTriangle(Vector3 v0, Vector3 v1, Vector3 v2) {
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		if (area == 0.0f || !std::isfinite(area)) { return; }
+		if (area < 0.0f) {
+			std::swap(v1, v2);
+			area = -area;
+		}
+		ScreenTriangle triangle;
+		const Vector3* v[3] = { &v0, &v1, &v2 };
+		for (int i = 0; i < 3; ++i) {
+			const Vector3& a = *v[i];
+			const Vector3& b = *v[(i + 1) % 3];
+			triangle.edgeA[i] = a.y - b.y;
+			triangle.edgeB[i] = b.x - a.x;
+			triangle.edgeC[i] = a.x * b.y - a.y * b.x;
+		}
+		// 深度は画面上で線形なので、重心座標から平面の式を作る
+		float inverseArea = 1.0f / area;
+		float depth1 = (v1.z - v0.z) * inverseArea;
+		float depth2 = (v2.z - v0.z) * inverseArea;
+		triangle.depthA = depth1 * (v2.y - v0.y) - depth2 * (v1.y - v0.y);
+		triangle.depthB = depth2 * (v1.x - v0.x) - depth1 * (v2.x - v0.x);
+		triangle.depthC = v0.z - triangle.depthA * v0.x - triangle.depthB * v0.y;
+		// 画素の中心が入りうる範囲
+		triangle.minX = (std::max)(int(std::floor((std::min)({ v0.x, v1.x, v2.x }))), 0);
+		triangle.minY = (std::max)(int(std::floor((std::min)({ v0.y, v1.y, v2.y }))), 0);
+		triangle.maxX = (std::min)(int(std::ceil((std::max)({ v0.x, v1.x, v2.x }))), int(width_) - 1);
+		triangle.maxY = (std::min)(int(std::ceil((std::max)({ v0.y, v1.y, v2.y }))), int(height_) - 1);
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) { return; }
+		triangles_.push_back(triangle);
+	}
+
+	/// <summary>
+	/// 三角形のうち [bandTop, bandBottom) の行を描く
+	/// 1行をレーン幅ずつまとめて、内側の画素だけ手前の深度を残す
+	/// </summary>
+	void DrawTriangle(const ScreenTriangle& triangle, int bandTop, int bandBottom) {
+		using L = FloatLanes;
+		const int laneWidth = LaneTraits<L>::kWidth;
+		alignas(32) static const float kLaneOffsets[8] = { 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f };
+		const L laneOffsets = LoadLanes<L>(kLaneOffsets);
+		const L zero(0.0f);
+		int top = (std::max)(triangle.minY, bandTop);
+		int bottom = (std::min)(triangle.maxY + 1, bandBottom);
+		int left = triangle.minX / laneWidth * laneWidth;
+		for (int y = top; y < bottom; ++y) {
+			float centerY = float(y) + 0.5f;
+			float* row = depth_.data() + size_t(y) * stride_;
+			for (int x = left; x <= triangle.maxX; x += laneWidth) {
+				L centerX = L(float(x)) + laneOffsets;
+				L e0 = L(triangle.edgeA[0]) * centerX + L(triangle.edgeB[0] * centerY + triangle.edgeC[0]);
+				L e1 = L(triangle.edgeA[1]) * centerX + L(triangle.edgeB[1] * centerY + triangle.edgeC[1]);
+				L e2 = L(triangle.edgeA[2]) * centerX + L(triangle.edgeB[2] * centerY + triangle.edgeC[2]);
+				LaneMask<L> inside = (e0 >= zero) & (e1 >= zero) & (e2 >= zero);
+				if (!Any(inside)) { continue; }
+				L depth = L(triangle.depthA) * centerX + L(triangle.depthB * centerY + triangle.depthC);
+				L stored = LoadLanes<L>(row + x);
+				StoreLanes(Select(inside, Min(stored, depth), stored), row + x);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Hi-Z を作る
+	/// 0段目は周囲3x3の最も奥の値(輪郭の画素は外側の隣の画素が奥なので、遮蔽物が小さめになる)
+	/// 上の段は2x2の最も奥の値を重ねる(はみ出す行・列は端の値を使う)
+	/// </summary>
+	void BuildHierarchy() {
+		MT3_PROFILE_SCOPE("OcclusionBuffer::BuildHierarchy");
+		// 横方向、縦方向の順に3画素の最大をとる(画面の外は何もない=奥とする)
+		HiZLevel& base = levels_[0];
+		rowMax_.resize(depth_.size());
+		for (uint32_t y = 0; y < height_; ++y) {
+			const float* row = depth_.data() + size_t(y) * stride_;
+			float* out = rowMax_.data() + size_t(y) * width_;
+			for (uint32_t x = 0; x < width_; ++x) {
+				float left = x > 0 ? row[x - 1] : 1.0f;
+				float right = x + 1 < width_ ? row[x + 1] : 1.0f;
+				out[x] = (std::max)((std::max)(left, row[x]), right);
+			}
+		}
+		for (uint32_t y = 0; y < height_; ++y) {
+			const float* center = rowMax_.data() + size_t(y) * width_;
+			const float* up = y > 0 ? center - width_ : nullptr;
+			const float* down = y + 1 < height_ ? center + width_ : nullptr;
+			float* out = base.depth.data() + size_t(y) * width_;
+			for (uint32_t x = 0; x < width_; ++x) {
+				out[x] = (std::max)((std::max)(up ? up[x] : 1.0f, center[x]), down ? down[x] : 1.0f);
+			}
+		}
+		for (size_t level = 1; level < levels_.size(); ++level) {
+			const HiZLevel& source = levels_[level - 1];
+			HiZLevel& target = levels_[level];
+			for (uint32_t y = 0; y < target.height; ++y) {
+				uint32_t sourceY0 = y * 2;
+				uint32_t sourceY1 = (std::min)(sourceY0 + 1, source.height - 1);
+				for (uint32_t x = 0; x < target.width; ++x) {
+					uint32_t sourceX0 = x * 2;
+					uint32_t sourceX1 = (std::min)(sourceX0 + 1, source.width - 1);
+					target.depth[size_t(y) * target.width + x] = (std::max)(
+						(std::max)(source.depth[size_t(sourceY0) * source.width + sourceX0], source.depth[size_t(sourceY0) * source.width + sourceX1]),
+						(std::max)(source.depth[size_t(sourceY1) * source.width + sourceX0], source.depth[size_t(sourceY1) * source.width + sourceX1]));
+				}
+			}
+		}
+	}
+
+	uint32_t width_;
+	uint32_t height_;
+	uint32_t stride_;
+	ThreadPool* threadPool_;
+	Matrix4x4 viewProjectionMatrix_ = {};
+	std::vector<float> depth_;
+	std::vector<float> rowMax_;	// 0段目を作るときの作業用
+	std::vector<HiZLevel> levels_;
+	std::vector<ScreenTriangle> triangles_;
+};
\ No newline at end of file
@@ -0,0 +1,197 @@
+#pragma once
+#include "Collision.h"
+#include "Gjk.h"
+#include "NarrowPhase.h"
+#include "Profiler.h"
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+// 毎フレーム同じペアを調べるときの、前フレームの結果のキャッシュ(時間的な連続性)
+// 離れていたペアは見つけた分離軸を覚えておき、次のフレームはその軸1本で離れているかをまず調べる
+// ゆっくり動く場面ではほとんどのペアが軸1本で済み、詳しい判定は分離軸で離れていると言えなかったものだけになる
+// GetContact が当たりとみなす隙間より広く離れているときだけ省くので、接触は毎回詳しく判定したときと値まで同じ
+// (ScenarioRunner --kernels で、あり・なしの接触を毎フレーム比べて確かめる)
+// 覚えた軸で離れていると言えなかったペアは、前回の結果で1回だけ判定する
+// 前回離れていれば分離軸を探し直し、前回当たっていれば GetContact で判定する(同じフレームに両方を呼ぶのは入れ替わったときだけ)
+
+static const uint32_t kPairCacheMaxAge = 4;	// この数のフレームの間候補に上がらなかったペアは捨てる
+// 分離軸で離れているとみなす隙間の下限
+// GJK は距離 sqrt(kGjkEpsilon) = 1e-5 以下を重なりとして当たりを返すので、それより大きく取る
+static const float kPairCacheSeparationTolerance = 1.0e-4f;
+
+/// <summary>
+/// 1つのペアの前フレームの結果
+/// </summary>
+struct PairCacheEntry {
+	Vector3 axis = { 0.0f, 0.0f, 0.0f };	// A から B へ向かう分離軸(単位ベクトル)
+	bool hasAxis = false;					// 前回離れていて分離軸を覚えている
+	bool isCacheHit = false;				// 直前の判定を分離軸だけで済ませた
+	bool wasHit = false;					// 前回の判定で当たっていた(初めてのペアは離れているとみなす)
+	uint32_t generation = 0;				// 最後に候補に上がったフレーム
+	GjkCache gjk;							// 分離軸を探すときの GJK の初期値
+};
+
+// ---- 分離軸 ----
+
+/// <summary>
+/// 軸に射影した範囲で A が B より手前にあるか(axis の向きに A、B の順で離れているか)
+/// 隙間が kPairCacheSeparationTolerance 以下なら GetContact が当たりを返しうるので離れていないとする
+/// </summary>
+/// <param name="a">形状A</param>
+/// <param name="b">形状B</param>
+/// <param name="axis">A から B へ向かう軸(単位ベクトル)</param>
+template<typename ShapeA, typename ShapeB>
+bool IsSeparatedAlong(const ShapeA& a, const ShapeB& b, const Vector3& axis) {
+	float maxA = Dot(GetSupport(a, axis), axis) + GetMargin(a);
+	float minB = Dot(GetSupport(b, Multiply(-1.0f, axis)), axis) - GetMargin(b);
+	return maxA + kPairCacheSeparationTolerance < minB;
+}
+
+// 球と平面(平面の射影は1点なので、軸は法線か逆向きだけ)
+bool IsSeparatedAlong(const Sphere& sphere, const Plane& plane, const Vector3& axis) {
+	float side = Dot(axis, plane.normal);
+	return Dot(sphere.center, axis) + sphere.radius + kPairCacheSeparationTolerance < side * plane.distance;
+}
+
+/// <summary>
+/// 離れている2つの形状の分離軸を求める(GJK の最近接点を結ぶ向き)
+/// </summary>
+/// <param name="a">形状A</param>
+/// <param name="b">形状B</param>
+/// <param name="axis">A から B へ向かう分離軸の出力</param>
+/// <param name="cache">GJK の初期値(nullptr可)</param>
+/// <returns>離れていて軸が求まったらtrue</returns>
+template<typename ShapeA, typename ShapeB>
+bool FindSeparatingAxis(const ShapeA& a, const ShapeB& b, Vector3& axis, GjkCache* cache) {
+	Vector3 pointA;
+	Vector3 pointB;
+	if (GjkDistance(a, b, &pointA, &pointB, cache) <= 0.0f) { return false; }
+	Vector3 difference = Subtract(pointB, pointA);
+	float length = Length(difference);
+	if (length <= 0.0f) { return false; }
+	axis = Multiply(1.0f / length, difference);
+	return true;
+}
+
+// AABB同士(隙間が一番大きいスラブの軸)
+bool FindSeparatingAxis(const AABB& aabb1, const AABB& aabb2, Vector3& axis, GjkCache*) {
+	const float gapsPositive[3] = { aabb2.min.x - aabb1.max.x, aabb2.min.y - aabb1.max.y, aabb2.min.z - aabb1.max.z };
+	const float gapsNegative[3] = { aabb1.min.x - aabb2.max.x, aabb1.min.y - aabb2.max.y, aabb1.min.z - aabb2.max.z };
+	int bestAxis = -1;
+	float bestSign = 1.0f;
+	float bestGap = 0.0f;
+	for (int i = 0; i < 3; ++i) {
+		if (gapsPositive[i] > bestGap) {
+			bestGap = gapsPositive[i];
+			bestAxis = i;
+			bestSign = 1.0f;
+		}
+		if (gapsNegative[i] > bestGap) {
+			bestGap = gapsNegative[i];
+			bestAxis = i;
+			bestSign = -1.0f;
+		}
+	}
+	if (bestAxis < 0) { return false; }
+	axis = { 0.0f, 0.0f, 0.0f };
+	(bestAxis == 0 ? axis.x : bestAxis == 1 ? axis.y : axis.z) = bestSign;
+	return true;
+}
+
+// 球と平面(球のある側から平面へ向かう法線)
+bool FindSeparatingAxis(const Sphere& sphere, const Plane& plane, Vector3& axis, GjkCache*) {
+	float signedDistance = Dot(plane.normal, sphere.center) - plane.distance;
+	if (std::fabs(signedDistance) <= sphere.radius) { return false; }
+	axis = signedDistance >= 0.0f ? Multiply(-1.0f, plane.normal) : plane.normal;
+	return true;
+}
+
+/// <summary>
+/// 前フレームの分離軸を使う GetContact
+/// 覚えた軸で離れていれば詳しい判定をせずに当たっていないと返す
+/// そうでなければ、前回離れていたペアは分離軸を探し直し、その軸で離れていれば GetContact を呼ばずに当たっていないと返す
+/// 前回当たっていたか、探した軸で離れていると言えなかったペアだけ GetContact で判定する
+/// </summary>
+/// <param name="a">形状A</param>
+/// <param name="b">形状B</param>
+/// <param name="entry">このペアのキャッシュ</param>
+template<typename ShapeA, typename ShapeB>
+	requires requires(const ShapeA& a, const ShapeB& b) { GetContact(a, b); }
+Contact GetCachedContact(const ShapeA& a, const ShapeB& b, PairCacheEntry& entry) {
+	if (entry.hasAxis && IsSeparatedAlong(a, b, entry.axis)) {
+		entry.isCacheHit = true;
+		return Contact{};
+	}
+	entry.isCacheHit = false;
+	if (!entry.wasHit) {
+		entry.hasAxis = FindSeparatingAxis(a, b, entry.axis, &entry.gjk) && IsSeparatedAlong(a, b, entry.axis);
+		if (entry.hasAxis) { return Contact{}; }
+	}
+	// 離れていても軸はここでは探さず、次のフレームに探す
+	Contact contact = GetContact(a, b);
+	entry.hasAxis = false;
+	entry.wasHit = contact.hit;
+	return contact;
+}
+
+/// <summary>
+/// ペア番号ごとのキャッシュ
+/// Prepare をメインスレッドで呼んでから、ナローフェーズのスレッドで Find して使う
+/// (Prepare の後は要素が増減しないので、別々のペアなら同時に読み書きしてよい)
+/// </summary>
+class PairCache {
+public:
+	/// <summary>
+	/// このフレームの候補ペアのキャッシュを用意する(1フレームに1回)
+	/// しばらく候補に上がらなかったペアはここで捨てる
+	/// </summary>
+	/// <param name="pairs">候補ペア</param>
+	/// <param name="count">ペアの数</param>
+	void Prepare(const CollisionPair* pairs, size_t count) {
+		MT3_PROFILE_SCOPE("PairCache::Prepare");
+		++generation_;
+		for (size_t i = 0; i < count; ++i) {
+			PairCacheEntry& entry = entries_[GetPairId(pairs[i])];
+			entry.generation = generation_;
+			entry.isCacheHit = false;
+		}
+		for (auto it = entries_.begin(); it != entries_.end();) {
+			if (generation_ - it->second.generation > kPairCacheMaxAge) {
+				it = entries_.erase(it);
+			} else {
+				++it;
+			}
+		}
+		activeCount_ = count;
+	}
+
+	// Prepare したペアのキャッシュ
+	PairCacheEntry& Find(const CollisionPair& pair) {
+		return entries_.find(GetPairId(pair))->second;
+	}
+
+	// 直前の Prepare からの判定のうち、分離軸だけで済んだ数
+	size_t GetCacheHitCount() const {
+		size_t count = 0;
+		for (const auto& [pairId, entry] : entries_) {
+			if (entry.generation == generation_ && entry.isCacheHit) { ++count; }
+		}
+		return count;
+	}
+
+	// 直前の Prepare で用意したペアの数
+	size_t GetActiveCount() const { return activeCount_; }
+	// 覚えているペアの数(少し前のフレームのものも含む)
+	size_t GetSize() const { return entries_.size(); }
+
+	void Clear() {
+		entries_.clear();
+		activeCount_ = 0;
+	}
+
+private:
+	std::unordered_map<uint64_t, PairCacheEntry> entries_;	// 要素の位置は rehash しても変わらない
+	uint32_t generation_ = 0;
+	size_t activeCount_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,377 @@
+#pragma once
+#include "Profiler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define MT3_PERF_COUNTERS_SUPPORTED 1
+#endif
+
+// ハードウェアの性能カウンタ(Linux の perf_event_open)
+// 計測区間ごとにサイクル数・命令数・キャッシュミス・分岐予測ミスを数え、IPC や要素あたりのミス数を求める
+// 計算が重いのか、分岐が重いのか、メモリ待ちなのかを見分けて、効く最適化を選ぶために使う
+// 対応していない環境や権限が無い場合は使えないことを返すだけで、計測そのものは止めない
+
+// 数えるカウンタ
+enum class PerfCounter {
+	Cycles,					// CPUサイクル
+	Instructions,			// 実行した命令
+	L1DataMisses,			// L1データキャッシュの読み込みミス
+	LastLevelCacheMisses,	// 最後のレベルのキャッシュのミス(メモリまで行った)
+	BranchMisses,			// 分岐予測ミス
+	Count,
+};
+
+static const char* const kPerfCounterNames[] = { "cycles", "instructions", "l1dMisses", "llcMisses", "branchMisses" };
+static const uint32_t kPerfCounterCount = uint32_t(PerfCounter::Count);
+static const uint32_t kPerfCounterAllMask = (1u << kPerfCounterCount) - 1;
+
+/// <summary>
+/// ある時点のカウンタの値
+/// </summary>
+struct PerfCounterSample {
+	uint64_t values[kPerfCounterCount] = {};
+	uint32_t validMask = 0;		// 読めたカウンタ(1 << PerfCounter)
+};
+
+/// <summary>
+/// 呼び出したスレッドのカウンタ(グループで開いて1回の read でまとめて読む)
+/// </summary>
+class PerfCounterGroup {
+public:
+	PerfCounterGroup() { Open(); }
+	~PerfCounterGroup() { Close(); }
+	PerfCounterGroup(const PerfCounterGroup&) = delete;
+	PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+	// 1つでもカウンタが使えるか
+	bool IsAvailable() const { return openMask_ != 0; }
+	// 開けたカウンタ(1 << PerfCounter)
+	uint32_t GetOpenMask() const { return openMask_; }
+	// 使えない理由(使えるなら空)
+	const std::string& GetStatus() const { return status_; }
+
+	/// <summary>
+	/// 今の値を読む(累計値。区間の値は2回読んだ差で求める)
+	/// 他のイベントと取り合って一部の時間しか数えられなかった場合は、数えた時間の割合で補正する
+	/// </summary>
+	/// <param name="sample">読んだ値</param>
+	/// <returns>読めたらtrue</returns>
+	bool Read(PerfCounterSample& sample) const {
+		sample.validMask = 0;
+#if defined(MT3_PERF_COUNTERS_SUPPORTED)
+		if (leaderFd_ < 0) { return false; }
+		// PERF_FORMAT_GROUP: nr, time_enabled, time_running, value[nr]
+		uint64_t buffer[3 + kPerfCounterCount];
+		ssize_t size = read(leaderFd_, buffer, sizeof(buffer));
+		if (size < ssize_t(3 * sizeof(uint64_t))) { return false; }
+		uint64_t memberCount = buffer[0];
+		uint64_t timeEnabled = buffer[1];
+		uint64_t timeRunning = buffer[2];
+		if (timeRunning == 0 || memberCount != memberCount_) { return false; }
+		const double scale = double(timeEnabled) / double(timeRunning);
+		for (uint32_t i = 0; i < memberCount_; ++i) {
+			uint32_t counter = members_[i];
+			sample.values[counter] = timeEnabled == timeRunning ? buffer[3 + i] : uint64_t(double(buffer[3 + i]) * scale);
+			sample.validMask |= 1u << counter;
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+private:
+#if defined(MT3_PERF_COUNTERS_SUPPORTED)
+	// 自分のスレッドのユーザー空間だけを数える
+	static int OpenEvent(uint32_t type, uint64_t config, int groupFd) {
+		perf_event_attr attribute;
+		std::memset(&attribute, 0, sizeof(attribute));
+		attribute.size = sizeof(attribute);
+		attribute.type = type;
+		attribute.config = config;
+		attribute.disabled = groupFd < 0 ? 1 : 0;
+		attribute.exclude_kernel = 1;
+		attribute.exclude_hv = 1;
+		attribute.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		return int(syscall(SYS_perf_event_open, &attribute, 0, -1, groupFd, 0));
+	}
+
+	static uint64_t GetCacheConfig(uint64_t cache) {
+		return cache | (uint64_t(PERF_COUNT_HW_CACHE_OP_READ) << 8) | (uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+	}
+#endif
+
+	void Open() {
+#if defined(MT3_PERF_COUNTERS_SUPPORTED)
+		struct EventDesc {
+			uint32_t type;
+			uint64_t config;
+		};
+		const EventDesc events[kPerfCounterCount] = {
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HW_CACHE, GetCacheConfig(PERF_COUNT_HW_CACHE_L1D) },
+			{ PERF_TYPE_HW_CACHE, GetCacheConfig(PERF_COUNT_HW_CACHE_LL) },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		};
+		// サイクル数をグループの先頭にする(開けなければ何も数えられない)
+		// 他は開けたものだけ使う(仮想マシンではキャッシュのカウンタが無いことが多い)
+		for (uint32_t counter = 0; counter < kPerfCounterCount; ++counter) {
+			int fd = OpenEvent(events[counter].type, events[counter].config, leaderFd_);
+			if (fd < 0) {
+				if (counter == 0) {
+					int error = errno;
+					status_ = std::string("perf_event_open failed: ") + std::strerror(error);
+					if (error == EACCES || error == EPERM) {
+						status_ += " (check /proc/sys/kernel/perf_event_paranoid)";
+					} else if (error == ENOENT || error == EOPNOTSUPP) {
+						status_ += " (no hardware counters, e.g. in a virtual machine)";
+					}
+					return;
+				}
+				continue;
+			}
+			if (leaderFd_ < 0) {
+				leaderFd_ = fd;
+			}
+			fds_[memberCount_] = fd;
+			members_[memberCount_++] = counter;
+			openMask_ |= 1u << counter;
+		}
+		ioctl(leaderFd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(leaderFd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+		status_ = "hardware counters are only supported on Linux";
+#endif
+	}
+
+	void Close() {
+#if defined(MT3_PERF_COUNTERS_SUPPORTED)
+		for (uint32_t i = 0; i < memberCount_; ++i) {
+			close(fds_[i]);
+		}
+		memberCount_ = 0;
+		leaderFd_ = -1;
+		openMask_ = 0;
+#endif
+	}
+
+#if defined(MT3_PERF_COUNTERS_SUPPORTED)
+	int leaderFd_ = -1;
+	int fds_[kPerfCounterCount] = {};
+	uint32_t members_[kPerfCounterCount] = {};	// グループの中の順番 → PerfCounter
+	uint32_t memberCount_ = 0;
+#endif
+	uint32_t openMask_ = 0;
+	std::string status_;
+};
+
+/// <summary>
+/// 区間ごとのカウンタの合計
+/// </summary>
+struct PerfScopeStat {
+	const char* name;
+	uint64_t callCount = 0;
+	uint64_t elementCount = 0;			// 処理した要素の数(要素あたりの値に使う)
+	double milliseconds = 0.0;
+	uint64_t values[kPerfCounterCount] = {};
+	uint32_t validMask = kPerfCounterAllMask;	// 全ての呼び出しで読めたカウンタ
+
+	bool HasCounter(PerfCounter counter) const { return callCount > 0 && (validMask & (1u << uint32_t(counter))) != 0; }
+
+	// 1サイクルあたりの命令数(読めなければ0)
+	double GetInstructionsPerCycle() const {
+		if (!HasCounter(PerfCounter::Cycles) || !HasCounter(PerfCounter::Instructions) || values[uint32_t(PerfCounter::Cycles)] == 0) { return 0.0; }
+		return double(values[uint32_t(PerfCounter::Instructions)]) / double(values[uint32_t(PerfCounter::Cycles)]);
+	}
+
+	// 1要素あたりの値(要素数が0なら1回の呼び出しあたり)
+	double GetPerElement(PerfCounter counter) const {
+		uint64_t divisor = elementCount > 0 ? elementCount : callCount;
+		return divisor > 0 ? double(values[uint32_t(counter)]) / double(divisor) : 0.0;
+	}
+
+	// 1要素あたりの時間(ナノ秒)
+	double GetNanosecondsPerElement() const {
+		uint64_t divisor = elementCount > 0 ? elementCount : callCount;
+		return divisor > 0 ? milliseconds * 1.0e6 / double(divisor) : 0.0;
+	}
+};
+
+/// <summary>
+/// スレッドごとの区間の合計(集計するスレッドと同時に触るのでロックする。所有スレッド以外はほぼ取らない)
+/// </summary>
+struct PerfThreadStats {
+	std::mutex mutex;
+	std::vector<PerfScopeStat> stats;
+};
+
+/// <summary>
+/// カウンタ全体の状態
+/// </summary>
+struct PerfCounterState {
+	std::atomic<bool> enabled{ false };
+	std::mutex mutex;
+	std::vector<PerfThreadStats*> threads;	// スレッドが終了しても読めるよう解放しない
+};
+
+PerfCounterState& GetPerfCounterState() {
+	static PerfCounterState state;
+	return state;
+}
+
+/// <summary>
+/// 呼び出したスレッドのカウンタ(初回に開く)
+/// </summary>
+PerfCounterGroup& GetThreadPerfCounters() {
+	thread_local PerfCounterGroup group;
+	return group;
+}
+
+/// <summary>
+/// 呼び出したスレッドの区間の合計(初回のみ登録)
+/// </summary>
+PerfThreadStats& GetPerfThreadStats() {
+	thread_local PerfThreadStats* stats = [] {
+		PerfCounterState& state = GetPerfCounterState();
+		PerfThreadStats* newStats = new PerfThreadStats();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.threads.push_back(newStats);
+		return newStats;
+	}();
+	return *stats;
+}
+
+/// <summary>
+/// 計測の有効・無効(既定は無効。無効なら MT3_PERF_SCOPE はフラグを見るだけ)
+/// 有効にするとカウンタを読むたびにシステムコールが入るので、細かい区間ほど値が重くなる
+/// </summary>
+void SetPerfCountersEnabled(bool enabled) {
+	GetPerfCounterState().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsPerfCountersEnabled() {
+	return GetPerfCounterState().enabled.load(std::memory_order_relaxed);
+}
+
+/// <summary>
+/// スコープの開始から終了までのカウンタの差を区間名ごとに足す
+/// カウンタは呼び出したスレッドの分だけなので、並列処理ではワーカーの中で使う
+/// </summary>
+class PerfCounterScope {
+public:
+	/// <param name="name">区間名(文字列リテラル)</param>
+	/// <param name="elementCount">この区間で処理する要素の数</param>
+	PerfCounterScope(const char* name, uint64_t elementCount) : name_(name), elementCount_(elementCount) {
+		if (!IsPerfCountersEnabled()) { return; }
+		isActive_ = true;
+		begin_ = std::chrono::steady_clock::now();
+		GetThreadPerfCounters().Read(beginSample_);
+	}
+
+	~PerfCounterScope() {
+		if (!isActive_) { return; }
+		PerfCounterSample endSample;
+		GetThreadPerfCounters().Read(endSample);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_).count();
+
+		PerfThreadStats& threadStats = GetPerfThreadStats();
+		std::lock_guard<std::mutex> lock(threadStats.mutex);
+		PerfScopeStat* stat = nullptr;
+		for (PerfScopeStat& candidate : threadStats.stats) {
+			if (candidate.name == name_) {
+				stat = &candidate;
+				break;
+			}
+		}
+		if (!stat) {
+			threadStats.stats.push_back({ name_ });
+			stat = &threadStats.stats.back();
+		}
+		++stat->callCount;
+		stat->elementCount += elementCount_;
+		stat->milliseconds += milliseconds;
+		uint32_t validMask = beginSample_.validMask & endSample.validMask;
+		stat->validMask &= validMask;
+		for (uint32_t counter = 0; counter < kPerfCounterCount; ++counter) {
+			// 補正のせいで減ることがあるので負にはしない
+			if ((validMask & (1u << counter)) && endSample.values[counter] > beginSample_.values[counter]) {
+				stat->values[counter] += endSample.values[counter] - beginSample_.values[counter];
+			}
+		}
+	}
+
+	PerfCounterScope(const PerfCounterScope&) = delete;
+	PerfCounterScope& operator=(const PerfCounterScope&) = delete;
+
+private:
+	const char* name_;
+	uint64_t elementCount_;
+	bool isActive_ = false;
+	std::chrono::steady_clock::time_point begin_;
+	PerfCounterSample beginSample_;
+};
+
+// プロファイラの区間と同時にカウンタも数える(elementCount は要素あたりの値を求めるための要素数)
+#if MT3_PROFILER_ENABLED
+#define MT3_PERF_SCOPE(name, elementCount) \
+	MT3_PROFILE_SCOPE(name); \
+	PerfCounterScope MT3_PROFILE_CONCAT(perfCounterScope, __LINE__)(name, elementCount)
+#else
+#define MT3_PERF_SCOPE(name, elementCount)
+#endif
+
+/// <summary>
+/// 全スレッドの区間の合計を区間名ごとにまとめる(最初に現れた順)
+/// </summary>
+std::vector<PerfScopeStat> GetPerfScopeStats() {
+	PerfCounterState& state = GetPerfCounterState();
+	std::vector<PerfScopeStat> merged;
+	std::lock_guard<std::mutex> lock(state.mutex);
+	for (PerfThreadStats* threadStats : state.threads) {
+		std::lock_guard<std::mutex> threadLock(threadStats->mutex);
+		for (const PerfScopeStat& stat : threadStats->stats) {
+			PerfScopeStat* target = nullptr;
+			for (PerfScopeStat& candidate : merged) {
+				if (std::strcmp(candidate.name, stat.name) == 0) {
+					target = &candidate;
+					break;
+				}
+			}
+			if (!target) {
+				merged.push_back({ stat.name });
+				target = &merged.back();
+			}
+			target->callCount += stat.callCount;
+			target->elementCount += stat.elementCount;
+			target->milliseconds += stat.milliseconds;
+			target->validMask &= stat.validMask;
+			for (uint32_t counter = 0; counter < kPerfCounterCount; ++counter) {
+				target->values[counter] += stat.values[counter];
+			}
+		}
+	}
+	return merged;
+}
+
+/// <summary>
+/// 区間の合計を0に戻す(シナリオやカーネルごとに測り直すとき)
+/// </summary>
+void ResetPerfScopeStats() {
+	PerfCounterState& state = GetPerfCounterState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	for (PerfThreadStats* threadStats : state.threads) {
+		std::lock_guard<std::mutex> threadLock(threadStats->mutex);
+		threadStats->stats.clear();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,340 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#if defined(_M_X64) || defined(__x86_64__)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define MT3_PROFILER_USE_RDTSC 1
+#endif
+
+// 0にすると計測マクロが空になる
+#ifndef MT3_PROFILER_ENABLED
+#define MT3_PROFILER_ENABLED 1
+#endif
+
+static const uint32_t kProfilerRingCapacity = 1u << 14;	// スレッドごとに保持するイベント数(2のべき乗)
+static const uint32_t kProfilerMaxThreads = 64;				// 計測できるスレッド数の上限
+static const float kProfilerAverageWeight = 0.05f;			// 平均値の更新の重み
+
+/// <summary>
+/// 計測区間1回分の記録
+/// </summary>
+struct ProfileEvent {
+	const char* name;	// 区間名(文字列リテラル)
+	uint64_t begin;		// 開始時刻(tick)
+	uint64_t end;		// 終了時刻(tick)
+};
+
+/// <summary>
+/// リングバッファの1要素
+/// 読む側が写している最中に上書きされることがあるので、値はそれぞれ atomic で持つ
+/// </summary>
+struct ProfileEventSlot {
+	std::atomic<const char*> name{ nullptr };
+	std::atomic<uint64_t> begin{ 0 };
+	std::atomic<uint64_t> end{ 0 };
+};
+
+/// <summary>
+/// スレッドごとのリングバッファ
+/// 書き込むのは所有スレッドだけなので、head の更新だけでロックなしに読める
+/// (読む側は写した後に head を読み直し、その間に上書きされたかもしれないものを捨てる)
+/// </summary>
+struct ProfilerThreadBuffer {
+	ProfileEventSlot events[kProfilerRingCapacity];
+	std::atomic<uint64_t> head{ 0 };	// 次に書き込む位置(単調増加)
+	uint32_t threadIndex = 0;
+	uint64_t aggregateCursor = 0;		// 集計済みの位置(集計スレッドのみが触る)
+};
+
+/// <summary>
+/// 区間ごとの集計結果
+/// </summary>
+struct ProfileScopeStat {
+	const char* name;
+	float lastMilliseconds;		// 直前のフレームでの合計時間
+	float averageMilliseconds;	// 平均
+	float maxMilliseconds;		// 最大
+	uint32_t callCount;			// 直前のフレームでの呼び出し回数
+};
+
+/// <summary>
+/// プロファイラ全体の状態
+/// </summary>
+struct ProfilerState {
+	std::atomic<ProfilerThreadBuffer*> threads[kProfilerMaxThreads] = {};
+	std::atomic<uint32_t> threadCount{ 0 };
+	uint64_t baseTick = 0;				// トレース出力の時刻0
+	uint64_t frameBeginTick = 0;
+	float frameMilliseconds = 0.0f;
+	std::vector<ProfileScopeStat> stats;
+	std::vector<ProfileEvent> snapshot;	// 集計するときに写したイベント(使い回す)
+	uint64_t droppedEventCount = 0;		// 集計する前に上書きされて失われたイベントの数
+};
+
+ProfilerState& GetProfilerState() {
+	static ProfilerState state;
+	return state;
+}
+
+/// <summary>
+/// 現在時刻(tick)
+/// </summary>
+uint64_t ProfilerNow() {
+#if defined(MT3_PROFILER_USE_RDTSC)
+	return __rdtsc();
+#else
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/// <summary>
+/// 1マイクロ秒あたりのtick数
+/// rdtscの場合は初回呼び出し時にsteady_clockと比べて求める
+/// </summary>
+double ProfilerTicksPerMicrosecond() {
+#if defined(MT3_PROFILER_USE_RDTSC)
+	static const double ticksPerMicrosecond = [] {
+		auto clockBegin = std::chrono::steady_clock::now();
+		uint64_t tickBegin = __rdtsc();
+		while (std::chrono::steady_clock::now() - clockBegin < std::chrono::milliseconds(5)) {
+		}
+		auto clockEnd = std::chrono::steady_clock::now();
+		uint64_t tickEnd = __rdtsc();
+		double microseconds = std::chrono::duration<double, std::micro>(clockEnd - clockBegin).count();
+		return double(tickEnd - tickBegin) / microseconds;
+	}();
+	return ticksPerMicrosecond;
+#else
+	return 1000.0;
+#endif
+}
+
+/// <summary>
+/// 呼び出したスレッドのリングバッファを取得(初回のみ登録)
+/// </summary>
+/// <returns>登録数の上限を超えたらnullptr</returns>
+ProfilerThreadBuffer* GetProfilerThreadBuffer() {
+	thread_local ProfilerThreadBuffer* buffer = [] () -> ProfilerThreadBuffer* {
+		ProfilerState& state = GetProfilerState();
+		uint32_t index = state.threadCount.fetch_add(1);
+		if (index >= kProfilerMaxThreads) {
+			return nullptr;
+		}
+		// スレッドが終了しても読めるよう解放しない
+		ProfilerThreadBuffer* newBuffer = new ProfilerThreadBuffer();
+		newBuffer->threadIndex = index;
+		state.threads[index].store(newBuffer, std::memory_order_release);
+		return newBuffer;
+	}();
+	return buffer;
+}
+
+/// <summary>
+/// 計測区間を記録
+/// </summary>
+/// <param name="name">区間名(文字列リテラル)</param>
+/// <param name="begin">開始時刻</param>
+/// <param name="end">終了時刻</param>
+void ProfilerRecord(const char* name, uint64_t begin, uint64_t end) {
+	ProfilerThreadBuffer* buffer = GetProfilerThreadBuffer();
+	if (!buffer) { return; }
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	// 前の head の更新より後に書き換える(読む側は head を読み直せば上書きされたかが分かる)
+	std::atomic_thread_fence(std::memory_order_release);
+	ProfileEventSlot& slot = buffer->events[head & (kProfilerRingCapacity - 1)];
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.begin.store(begin, std::memory_order_relaxed);
+	slot.end.store(end, std::memory_order_relaxed);
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+/// <summary>
+/// スコープの開始から終了までを計測する
+/// </summary>
+class ProfileScope {
+public:
+	explicit ProfileScope(const char* name) : name_(name), begin_(ProfilerNow()) {}
+	~ProfileScope() { ProfilerRecord(name_, begin_, ProfilerNow()); }
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* name_;
+	uint64_t begin_;
+};
+
+#define MT3_PROFILE_CONCAT_INNER(a, b) a##b
+#define MT3_PROFILE_CONCAT(a, b) MT3_PROFILE_CONCAT_INNER(a, b)
+#if MT3_PROFILER_ENABLED
+#define MT3_PROFILE_SCOPE(name) ProfileScope MT3_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define MT3_PROFILE_SCOPE(name)
+#endif
+
+/// <summary>
+/// リングバッファの from 以降のイベントを写す(所有スレッドが書き込んでいる最中でもよい)
+/// 写した後に head を読み直し、写している間に上書きされたかもしれないものは捨てる
+/// </summary>
+/// <param name="buffer">リングバッファ</param>
+/// <param name="from">読み始めたい位置</param>
+/// <param name="events">写したイベントの出力(古い順)</param>
+/// <param name="next">次に読み始める位置の出力</param>
+/// <returns>from 以降で、読む前に上書きされて失われたイベントの数</returns>
+uint64_t SnapshotProfilerEvents(const ProfilerThreadBuffer& buffer, uint64_t from, std::vector<ProfileEvent>& events, uint64_t& next) {
+	events.clear();
+	const uint64_t end = buffer.head.load(std::memory_order_acquire);
+	const uint64_t oldest = end > kProfilerRingCapacity ? end - kProfilerRingCapacity : 0;
+	const uint64_t begin = from > oldest ? from : oldest;
+	for (uint64_t i = begin; i < end; ++i) {
+		const ProfileEventSlot& slot = buffer.events[i & (kProfilerRingCapacity - 1)];
+		events.push_back({ slot.name.load(std::memory_order_relaxed),
+			slot.begin.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed) });
+	}
+	// head が h なら位置 h のイベントを書き込み中かもしれず、それは h - 容量 の要素を上書きする
+	std::atomic_thread_fence(std::memory_order_acquire);
+	const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	const uint64_t valid = head >= kProfilerRingCapacity ? head - kProfilerRingCapacity + 1 : 0;
+	uint64_t first = begin;
+	if (valid > first) {
+		uint64_t discard = (valid < end ? valid : end) - first;
+		events.erase(events.begin(), events.begin() + ptrdiff_t(discard));
+		first += discard;
+	}
+	next = end > from ? end : from;
+	return first > from ? first - from : 0;
+}
+
+/// <summary>
+/// フレームの開始
+/// </summary>
+void ProfilerBeginFrame() {
+	ProfilerState& state = GetProfilerState();
+	state.frameBeginTick = ProfilerNow();
+	if (state.baseTick == 0) {
+		state.baseTick = state.frameBeginTick;
+		ProfilerTicksPerMicrosecond();
+	}
+}
+
+/// <summary>
+/// フレームの終了
+/// 全スレッドの新しいイベントを区間名ごとに集計する
+/// </summary>
+void ProfilerEndFrame() {
+	ProfilerState& state = GetProfilerState();
+	const double millisecondsPerTick = 1.0 / (ProfilerTicksPerMicrosecond() * 1000.0);
+	state.frameMilliseconds = float(double(ProfilerNow() - state.frameBeginTick) * millisecondsPerTick);
+
+	for (ProfileScopeStat& stat : state.stats) {
+		stat.lastMilliseconds = 0.0f;
+		stat.callCount = 0;
+	}
+
+	uint32_t threadCount = state.threadCount.load(std::memory_order_acquire);
+	if (threadCount > kProfilerMaxThreads) {
+		threadCount = kProfilerMaxThreads;
+	}
+	for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+		ProfilerThreadBuffer* buffer = state.threads[threadIndex].load(std::memory_order_acquire);
+		if (!buffer) { continue; }
+		state.droppedEventCount += SnapshotProfilerEvents(*buffer, buffer->aggregateCursor, state.snapshot, buffer->aggregateCursor);
+		for (const ProfileEvent& event : state.snapshot) {
+			// 区間名は文字列リテラルなのでポインタで比較できる
+			ProfileScopeStat* stat = nullptr;
+			for (ProfileScopeStat& candidate : state.stats) {
+				if (candidate.name == event.name) {
+					stat = &candidate;
+					break;
+				}
+			}
+			if (!stat) {
+				state.stats.push_back({ event.name, 0.0f, 0.0f, 0.0f, 0 });
+				stat = &state.stats.back();
+			}
+			stat->lastMilliseconds += float(double(event.end - event.begin) * millisecondsPerTick);
+			++stat->callCount;
+		}
+	}
+
+	for (ProfileScopeStat& stat : state.stats) {
+		stat.averageMilliseconds += (stat.lastMilliseconds - stat.averageMilliseconds) * kProfilerAverageWeight;
+		if (stat.lastMilliseconds > stat.maxMilliseconds) {
+			stat.maxMilliseconds = stat.lastMilliseconds;
+		}
+	}
+}
+
+/// <summary>
+/// 区間ごとの集計結果を取得
+/// </summary>
+const std::vector<ProfileScopeStat>& GetProfileScopeStats() {
+	return GetProfilerState().stats;
+}
+
+/// <summary>
+/// 直前のフレームの時間(ミリ秒)
+/// </summary>
+float GetProfilerFrameMilliseconds() {
+	return GetProfilerState().frameMilliseconds;
+}
+
+/// <summary>
+/// 集計する前にリングバッファが一周して失われたイベントの数(起動してからの合計)
+/// 多いときは kProfilerRingCapacity を増やす
+/// </summary>
+uint64_t GetProfilerDroppedEventCount() {
+	return GetProfilerState().droppedEventCount;
+}
+
+/// <summary>
+/// リングバッファに残っているイベントをChromeのトレース形式(JSON)で書き出す
+/// chrome://tracing や Perfetto で開ける
+/// 他のスレッドが計測中でもよい(書き出す前に上書きされたイベントの数は otherData.droppedEvents に入れる)
+/// </summary>
+/// <param name="path">出力先のファイルパス</param>
+/// <returns>書き出せたらtrue</returns>
+bool ExportChromeTrace(const char* path) {
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+	ProfilerState& state = GetProfilerState();
+	const double ticksPerMicrosecond = ProfilerTicksPerMicrosecond();
+
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	file << "{\"traceEvents\":[";
+	bool first = true;
+	uint64_t droppedEventCount = 0;
+	std::vector<ProfileEvent> events;
+	uint32_t threadCount = state.threadCount.load(std::memory_order_acquire);
+	if (threadCount > kProfilerMaxThreads) {
+		threadCount = kProfilerMaxThreads;
+	}
+	for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+		ProfilerThreadBuffer* buffer = state.threads[threadIndex].load(std::memory_order_acquire);
+		if (!buffer) { continue; }
+		uint64_t next;
+		droppedEventCount += SnapshotProfilerEvents(*buffer, 0, events, next);
+		for (const ProfileEvent& event : events) {
+			if (event.begin < state.baseTick) { continue; }
+			double timestamp = double(event.begin - state.baseTick) / ticksPerMicrosecond;
+			double duration = double(event.end - event.begin) / ticksPerMicrosecond;
+			file << (first ? "" : ",") << "\n{\"name\":\"" << event.name
+				<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadIndex
+				<< ",\"ts\":" << timestamp << ",\"dur\":" << duration << "}";
+			first = false;
+		}
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":\"" << droppedEventCount << "\"}}\n";
+	return bool(file);
+}
\ No newline at end of file
@@ -0,0 +1,289 @@
+#pragma once
+#include "LaneMath.h"
+#include "Profiler.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// レイと三角形の判定(Möller–Trumbore)をまとめて行う
+// 1本のレイと kRayLaneWidth 個の三角形、または kRayLaneWidth 本のレイと1つの三角形を1回で判定し、一番近い交点を求める
+// Ray の diff は正規化しなくてよく、t は diff の長さ単位
+
+static const int kRayLaneWidth = LaneTraits<FloatLanes>::kWidth;	// 一度に判定する数(AVX なら8、無ければ4)
+static const float kRayTriangleEpsilon = 1.0e-12f;				// これより行列式が小さければ平行とみなす
+
+/// <summary>
+/// 三角形の頂点0と2辺(レイ判定用に前もって求めておく)
+/// kRayLaneWidth 個ずつ成分ごとに並べる
+/// </summary>
+struct TriangleBlock {
+	float v0[3][kRayLaneWidth];		// [x/y/z][三角形]
+	float edge1[3][kRayLaneWidth];	// v1 - v0
+	float edge2[3][kRayLaneWidth];	// v2 - v0
+};
+
+// レイ判定用の三角形の配列
+struct TriangleBlocks {
+	std::vector<TriangleBlock> blocks;	// 余ったレーンは辺が0(どのレイとも当たらない)
+	size_t count = 0;
+
+	void Add(const Triangle& triangle) {
+		size_t lane = count % kRayLaneWidth;
+		if (lane == 0) {
+			blocks.push_back({});
+		}
+		TriangleBlock& block = blocks.back();
+		Vector3 edge1 = Subtract(triangle.vertices[1], triangle.vertices[0]);
+		Vector3 edge2 = Subtract(triangle.vertices[2], triangle.vertices[0]);
+		const float v0[3] = { triangle.vertices[0].x, triangle.vertices[0].y, triangle.vertices[0].z };
+		const float e1[3] = { edge1.x, edge1.y, edge1.z };
+		const float e2[3] = { edge2.x, edge2.y, edge2.z };
+		for (int axis = 0; axis < 3; ++axis) {
+			block.v0[axis][lane] = v0[axis];
+			block.edge1[axis][lane] = e1[axis];
+			block.edge2[axis][lane] = e2[axis];
+		}
+		++count;
+	}
+
+	void Clear() {
+		blocks.clear();
+		count = 0;
+	}
+
+	size_t Size() const { return count; }
+
+	// index 番目の三角形の頂点0と2辺
+	void GetTriangle(size_t index, Vector3& v0, Vector3& edge1, Vector3& edge2) const {
+		const TriangleBlock& block = blocks[index / kRayLaneWidth];
+		size_t lane = index % kRayLaneWidth;
+		v0 = { block.v0[0][lane], block.v0[1][lane], block.v0[2][lane] };
+		edge1 = { block.edge1[0][lane], block.edge1[1][lane], block.edge1[2][lane] };
+		edge2 = { block.edge2[0][lane], block.edge2[1][lane], block.edge2[2][lane] };
+	}
+};
+
+// レイの判定結果
+struct RayHit {
+	bool hit;
+	float t;				// 交点の媒介変数
+	uint32_t triangleIndex;	// 当たった三角形(TriangleBlocks に追加した順)
+	float u;				// 重心座標(交点 = v0 + u * edge1 + v * edge2)
+	float v;
+};
+
+/// <summary>
+/// レイと三角形(Möller–Trumbore)
+/// 割り算は行列式の逆数の1回だけ
+/// </summary>
+/// <param name="origin">レイの始点</param>
+/// <param name="direction">レイの向き</param>
+/// <param name="v0">頂点0</param>
+/// <param name="edge1">v1 - v0</param>
+/// <param name="edge2">v2 - v0</param>
+/// <param name="tMax">これより遠い交点は無視する</param>
+/// <param name="t">交点の媒介変数の出力</param>
+/// <param name="u">重心座標の出力</param>
+/// <param name="v">重心座標の出力</param>
+/// <returns>0 <= t < tMax で当たったレーン</returns>
+template<typename T>
+LaneMask<T> IntersectRayTriangle(const Vector3T<T>& origin, const Vector3T<T>& direction,
+	const Vector3T<T>& v0, const Vector3T<T>& edge1, const Vector3T<T>& edge2, const T& tMax, T& t, T& u, T& v) {
+	Vector3T<T> p = Cross(direction, edge2);
+	T determinant = Dot(edge1, p);
+	T inverseDeterminant = T(1.0f) / determinant;
+	Vector3T<T> s = Subtract(origin, v0);
+	u = Dot(s, p) * inverseDeterminant;
+	Vector3T<T> q = Cross(s, edge1);
+	v = Dot(direction, q) * inverseDeterminant;
+	t = Dot(edge2, q) * inverseDeterminant;
+	// 平行なときは u, v, t が inf/NaN になるが、行列式の判定で落とす
+	return (Abs(determinant) > T(kRayTriangleEpsilon)) & (u >= T(0.0f)) & (v >= T(0.0f)) & (u + v <= T(1.0f)) &
+		(t >= T(0.0f)) & (t < tMax);
+}
+
+// ブロックの成分をレーン型で読む
+template<typename L>
+Vector3T<L> LoadBlockVector(const float (&components)[3][kRayLaneWidth]) {
+	return { L::Load(components[0]), L::Load(components[1]), L::Load(components[2]) };
+}
+
+/// <summary>
+/// 1本のレイと全ての三角形(kRayLaneWidth 個ずつ判定する)
+/// </summary>
+/// <param name="ray">レイ</param>
+/// <param name="triangles">三角形</param>
+/// <param name="tMax">これより遠い交点は無視する</param>
+/// <returns>一番近い交点</returns>
+RayHit IntersectNearest(const Ray& ray, const TriangleBlocks& triangles, float tMax = (std::numeric_limits<float>::infinity)()) {
+	using L = FloatLanes;
+	Vector3T<L> origin = SplatVector3<L>(ray.origin);
+	Vector3T<L> direction = SplatVector3<L>(ray.diff);
+	// レーンごとの一番近い交点
+	L bestT(tMax);
+	L bestBlock(-1.0f);
+	L bestU(0.0f);
+	L bestV(0.0f);
+	for (size_t b = 0; b < triangles.blocks.size(); ++b) {
+		const TriangleBlock& block = triangles.blocks[b];
+		L t;
+		L u;
+		L v;
+		LaneMask<L> isHit = IntersectRayTriangle(origin, direction,
+			LoadBlockVector<L>(block.v0), LoadBlockVector<L>(block.edge1), LoadBlockVector<L>(block.edge2), bestT, t, u, v);
+		bestT = Select(isHit, t, bestT);
+		bestBlock = Select(isHit, L(float(b)), bestBlock);
+		bestU = Select(isHit, u, bestU);
+		bestV = Select(isHit, v, bestV);
+	}
+
+	// レーンの中で一番近いもの
+	alignas(32) float ts[kRayLaneWidth];
+	alignas(32) float blocks[kRayLaneWidth];
+	alignas(32) float us[kRayLaneWidth];
+	alignas(32) float vs[kRayLaneWidth];
+	bestT.Store(ts);
+	bestBlock.Store(blocks);
+	bestU.Store(us);
+	bestV.Store(vs);
+	RayHit result = { false, tMax, UINT32_MAX, 0.0f, 0.0f };
+	for (int lane = 0; lane < kRayLaneWidth; ++lane) {
+		if (blocks[lane] >= 0.0f && ts[lane] < result.t) {
+			result = { true, ts[lane], uint32_t(blocks[lane]) * kRayLaneWidth + lane, us[lane], vs[lane] };
+		}
+	}
+	return result;
+}
+
+/// <summary>
+/// まとめて判定する kRayLaneWidth 本のレイ
+/// 向きの近いレイ(同じピクセル付近から出るものなど)をまとめると無駄が少ない
+/// </summary>
+struct RayPacket {
+	Vector3T<FloatLanes> origin;
+	Vector3T<FloatLanes> direction;
+	FloatLanes tMax;
+};
+
+// パケットの判定結果(レーンごと)
+struct RayPacketHit {
+	FloatLanes t;
+	FloatLanes triangleIndex;	// 当たらなければ -1
+	FloatLanes u;
+	FloatLanes v;
+};
+
+/// <summary>
+/// レイの配列からパケットを作る
+/// </summary>
+/// <param name="rays">レイ</param>
+/// <param name="count">レイの数(kRayLaneWidth 未満なら残りは何にも当たらない)</param>
+/// <param name="tMax">これより遠い交点は無視する</param>
+RayPacket MakeRayPacket(const Ray* rays, size_t count, float tMax = (std::numeric_limits<float>::infinity)()) {
+	alignas(32) float values[7][kRayLaneWidth] = {};
+	for (int lane = 0; lane < kRayLaneWidth; ++lane) {
+		if (size_t(lane) < count) {
+			const Ray& ray = rays[lane];
+			values[0][lane] = ray.origin.x;
+			values[1][lane] = ray.origin.y;
+			values[2][lane] = ray.origin.z;
+			values[3][lane] = ray.diff.x;
+			values[4][lane] = ray.diff.y;
+			values[5][lane] = ray.diff.z;
+			values[6][lane] = tMax;
+		} else {
+			values[6][lane] = -1.0f; // t >= 0 を満たさないので当たらない
+		}
+	}
+	using L = FloatLanes;
+	return { { L::Load(values[0]), L::Load(values[1]), L::Load(values[2]) },
+		{ L::Load(values[3]), L::Load(values[4]), L::Load(values[5]) }, L::Load(values[6]) };
+}
+
+// パケットの結果を、当たっていない状態にする
+RayPacketHit MakeRayPacketHit(const RayPacket& packet) {
+	return { packet.tMax, FloatLanes(-1.0f), FloatLanes(0.0f), FloatLanes(0.0f) };
+}
+
+/// <summary>
+/// パケットと1つの三角形(近い交点が見つかったレーンだけ hit を更新する)
+/// </summary>
+/// <param name="packet">レイのパケット</param>
+/// <param name="v0">頂点0</param>
+/// <param name="edge1">v1 - v0</param>
+/// <param name="edge2">v2 - v0</param>
+/// <param name="triangleIndex">三角形の番号</param>
+/// <param name="hit">これまでの結果(hit.t より遠い交点は無視する)</param>
+void IntersectPacket(const RayPacket& packet, const Vector3& v0, const Vector3& edge1, const Vector3& edge2, uint32_t triangleIndex, RayPacketHit& hit) {
+	using L = FloatLanes;
+	L t;
+	L u;
+	L v;
+	LaneMask<L> isHit = IntersectRayTriangle(packet.origin, packet.direction,
+		SplatVector3<L>(v0), SplatVector3<L>(edge1), SplatVector3<L>(edge2), hit.t, t, u, v);
+	hit.t = Select(isHit, t, hit.t);
+	hit.triangleIndex = Select(isHit, L(float(triangleIndex)), hit.triangleIndex);
+	hit.u = Select(isHit, u, hit.u);
+	hit.v = Select(isHit, v, hit.v);
+}
+
+// パケットと1つの三角形
+void IntersectPacket(const RayPacket& packet, const Triangle& triangle, uint32_t triangleIndex, RayPacketHit& hit) {
+	IntersectPacket(packet, triangle.vertices[0], Subtract(triangle.vertices[1], triangle.vertices[0]),
+		Subtract(triangle.vertices[2], triangle.vertices[0]), triangleIndex, hit);
+}
+
+// パケットと全ての三角形
+void IntersectPacket(const RayPacket& packet, const TriangleBlocks& triangles, RayPacketHit& hit) {
+	Vector3 v0;
+	Vector3 edge1;
+	Vector3 edge2;
+	for (size_t i = 0; i < triangles.Size(); ++i) {
+		triangles.GetTriangle(i, v0, edge1, edge2);
+		IntersectPacket(packet, v0, edge1, edge2, uint32_t(i), hit);
+	}
+}
+
+/// <summary>
+/// たくさんのレイを、それぞれ一番近い三角形と判定する(パケットごとに並列)
+/// 三角形の番号は 2^24 未満であること(レーンの中では float で持つため)
+/// </summary>
+/// <param name="rays">レイ(並び順が近いもの同士をパケットにする)</param>
+/// <param name="count">レイの数</param>
+/// <param name="triangles">三角形</param>
+/// <param name="hits">結果の出力(count 個)</param>
+/// <param name="tMax">これより遠い交点は無視する</param>
+/// <param name="threadPool">使うスレッドプール(nullptr なら共有のもの)</param>
+void IntersectRays(const Ray* rays, size_t count, const TriangleBlocks& triangles, RayHit* hits,
+	float tMax = (std::numeric_limits<float>::infinity)(), ThreadPool* threadPool = nullptr) {
+	MT3_PROFILE_SCOPE("IntersectRays");
+	if (!threadPool) {
+		threadPool = &ThreadPool::GetDefault();
+	}
+	size_t packetCount = (count + kRayLaneWidth - 1) / kRayLaneWidth;
+	threadPool->ParallelFor(packetCount, 16, [&](size_t begin, size_t end, uint32_t) {
+		for (size_t p = begin; p < end; ++p) {
+			size_t first = p * kRayLaneWidth;
+			size_t rayCount = (std::min)(count - first, size_t(kRayLaneWidth));
+			RayPacket packet = MakeRayPacket(rays + first, rayCount, tMax);
+			RayPacketHit hit = MakeRayPacketHit(packet);
+			IntersectPacket(packet, triangles, hit);
+
+			alignas(32) float ts[kRayLaneWidth];
+			alignas(32) float indices[kRayLaneWidth];
+			alignas(32) float us[kRayLaneWidth];
+			alignas(32) float vs[kRayLaneWidth];
+			hit.t.Store(ts);
+			hit.triangleIndex.Store(indices);
+			hit.u.Store(us);
+			hit.v.Store(vs);
+			for (size_t lane = 0; lane < rayCount; ++lane) {
+				bool isHit = indices[lane] >= 0.0f;
+				hits[first + lane] = { isHit, ts[lane], isHit ? uint32_t(indices[lane]) : UINT32_MAX, us[lane], vs[lane] };
+			}
+		}
+	});
+}
\ No newline at end of file
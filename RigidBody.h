@@ -0,0 +1,949 @@
+#pragma once
+#include "Distance.h"
+#include "FrameArena.h"
+#include "NarrowPhase.h"
+#include "Profiler.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+// 剛体シミュレーション
+// 半陰的オイラー法で積分し、接触は逐次インパルス法(前フレームのインパルスで warm start)で解く
+// めり込みを戻す速度は位置の更新にだけ使い、更新後にその速度を抜く反復(緩和)をして跳ね返りを残さない
+// 接触でつながった剛体の集まり(アイランド)ごとに並列に解き、止まったアイランドは眠らせて飛ばす
+
+static const float kContactMargin = 0.02f;			// この距離まで近づいたら接触点を作る
+static const float kContactSlop = 0.005f;			// 位置補正しないめり込み量
+static const float kBaumgarte = 0.2f;				// めり込みを1ステップで戻す割合
+static const float kRestitutionThreshold = 1.0f;	// これより遅い衝突は反発させない
+static const float kSleepLinearTolerance = 0.05f;	// 眠らせる速度
+static const float kSleepAngularTolerance = 0.05f;	// 眠らせる角速度
+static const float kTimeToSleep = 0.5f;				// この時間止まっていたら眠らせる
+static const float kWarmStartMatchDistance = 0.05f;	// 前フレームの接触点と同じとみなす距離
+static const uint32_t kStaticPlaneFlag = 0x80000000u; // 接触の相手が静的な平面であることを表す
+
+// 剛体の形
+enum class RigidBodyShape {
+	SphereShape,
+	BoxShape,
+};
+
+// 剛体
+struct RigidBody {
+	RigidBodyShape shape = RigidBodyShape::SphereShape;
+	Vector3 position = {};
+	Vector3 orientations[3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+	Vector3 halfSize = {};		// 箱の各軸の長さの半分
+	float radius = 0.0f;		// 球の半径
+	Vector3 velocity = {};
+	Vector3 angularVelocity = {};
+	float inverseMass = 0.0f;	// 0なら動かない
+	Vector3 inverseInertia = {}; // ローカル軸ごとの慣性モーメントの逆数(0なら回転しない)
+	float friction = 0.5f;
+	float restitution = 0.0f;
+	bool isAwake = true;
+	float sleepTime = 0.0f;
+};
+
+/// <summary>
+/// 球の剛体を作る
+/// </summary>
+/// <param name="sphere">球</param>
+/// <param name="mass">質量(0なら静的)</param>
+RigidBody MakeSphereBody(const Sphere& sphere, float mass) {
+	RigidBody body;
+	body.shape = RigidBodyShape::SphereShape;
+	body.position = sphere.center;
+	body.radius = sphere.radius;
+	if (mass > 0.0f) {
+		body.inverseMass = 1.0f / mass;
+		float inverseInertia = 1.0f / (0.4f * mass * sphere.radius * sphere.radius);
+		body.inverseInertia = { inverseInertia, inverseInertia, inverseInertia };
+	}
+	return body;
+}
+
+/// <summary>
+/// 回転する箱の剛体を作る
+/// </summary>
+/// <param name="obb">OBB</param>
+/// <param name="mass">質量(0なら静的)</param>
+RigidBody MakeBoxBody(const OBB& obb, float mass) {
+	RigidBody body;
+	body.shape = RigidBodyShape::BoxShape;
+	body.position = obb.center;
+	for (int axis = 0; axis < 3; ++axis) {
+		body.orientations[axis] = obb.orientations[axis];
+	}
+	body.halfSize = obb.size;
+	if (mass > 0.0f) {
+		body.inverseMass = 1.0f / mass;
+		const Vector3& h = obb.size;
+		body.inverseInertia = {
+			3.0f / (mass * (h.y * h.y + h.z * h.z)),
+			3.0f / (mass * (h.x * h.x + h.z * h.z)),
+			3.0f / (mass * (h.x * h.x + h.y * h.y))
+		};
+	}
+	return body;
+}
+
+/// <summary>
+/// 回転しない箱(AABB)の剛体を作る
+/// </summary>
+/// <param name="aabb">AABB</param>
+/// <param name="mass">質量(0なら静的)</param>
+RigidBody MakeAABBBody(const AABB& aabb, float mass) {
+	RigidBody body;
+	body.shape = RigidBodyShape::BoxShape;
+	body.position = Multiply(0.5f, Add(aabb.min, aabb.max));
+	body.halfSize = Multiply(0.5f, Subtract(aabb.max, aabb.min));
+	if (mass > 0.0f) {
+		body.inverseMass = 1.0f / mass;
+	}
+	return body;
+}
+
+// 剛体をOBBとして取り出す
+OBB GetBodyOBB(const RigidBody& body) {
+	return { body.position, { body.orientations[0], body.orientations[1], body.orientations[2] }, body.halfSize };
+}
+
+// ワールド座標での慣性テンソルの逆行列をベクトルに掛ける
+Vector3 ApplyInverseInertia(const RigidBody& body, const Vector3& v) {
+	Vector3 local = {
+		Dot(body.orientations[0], v) * body.inverseInertia.x,
+		Dot(body.orientations[1], v) * body.inverseInertia.y,
+		Dot(body.orientations[2], v) * body.inverseInertia.z
+	};
+	return Add(Add(Multiply(local.x, body.orientations[0]), Multiply(local.y, body.orientations[1])), Multiply(local.z, body.orientations[2]));
+}
+
+// 剛体を囲むAABB
+AABB GetBodyBounds(const RigidBody& body) {
+	Vector3 extent;
+	if (body.shape == RigidBodyShape::SphereShape) {
+		extent = { body.radius, body.radius, body.radius };
+	} else {
+		extent = { 0.0f, 0.0f, 0.0f };
+		const float sizes[3] = { body.halfSize.x, body.halfSize.y, body.halfSize.z };
+		for (int axis = 0; axis < 3; ++axis) {
+			const Vector3& o = body.orientations[axis];
+			extent = Add(extent, Multiply(sizes[axis], { std::fabs(o.x), std::fabs(o.y), std::fabs(o.z) }));
+		}
+	}
+	extent = Add(extent, { kContactMargin, kContactMargin, kContactMargin });
+	return { Subtract(body.position, extent), Add(body.position, extent) };
+}
+
+// ---- 接触 ----
+
+// 接触点
+struct ContactPoint {
+	Vector3 position;		// ワールド座標
+	float depth;			// めり込み量(負なら離れている)
+	float normalImpulse;	// 累積インパルス(warm start に使う)
+	float tangentImpulse[2];
+	// 以下は毎ステップ求め直す
+	Vector3 rA;
+	Vector3 rB;
+	float normalMass;
+	float tangentMass[2];
+	float velocityBias;		// 目標の法線速度(離れている分だけ近づくのを許す・反発)
+	float positionBias;		// めり込みを戻す速度(位置の更新にだけ使う)
+};
+
+/// <summary>
+/// 2つの剛体(または剛体と静的な平面)の接触点の集まり
+/// normal は A から B へ向く
+/// </summary>
+struct ContactManifold {
+	uint32_t bodyA;			// kStaticPlaneFlag が立っていれば平面の番号
+	uint32_t bodyB;
+	Vector3 normal;
+	Vector3 tangents[2];
+	float friction;
+	float restitution;
+	ContactPoint points[4];
+	int pointCount;
+};
+
+// 接触点の候補
+struct ContactCandidate {
+	Vector3 position;
+	float depth;
+};
+
+/// <summary>
+/// 候補を4点以下に減らして接触に加える(一番深い点と、そこから広がる点を残す)
+/// </summary>
+void AddContactPoints(ContactManifold& manifold, const ContactCandidate* candidates, int count) {
+	manifold.pointCount = 0;
+	if (count <= 0) { return; }
+	bool isUsed[16] = {};
+	auto add = [&](int index) {
+		isUsed[index] = true;
+		ContactPoint& point = manifold.points[manifold.pointCount++];
+		point = {};
+		point.position = candidates[index].position;
+		point.depth = candidates[index].depth;
+	};
+	if (count <= 4) {
+		for (int i = 0; i < count; ++i) {
+			add(i);
+		}
+		return;
+	}
+
+	// 1点目: 一番深い点
+	int best = 0;
+	for (int i = 1; i < count; ++i) {
+		if (candidates[i].depth > candidates[best].depth) { best = i; }
+	}
+	add(best);
+	// 2~4点目: すでに選んだ点から一番遠い点
+	while (manifold.pointCount < 4) {
+		best = -1;
+		float bestDistance = -1.0f;
+		for (int i = 0; i < count; ++i) {
+			if (isUsed[i]) { continue; }
+			float nearest = (std::numeric_limits<float>::max)();
+			for (int k = 0; k < manifold.pointCount; ++k) {
+				nearest = (std::min)(nearest, DistanceSquared(candidates[i].position, manifold.points[k].position));
+			}
+			if (nearest > bestDistance) {
+				bestDistance = nearest;
+				best = i;
+			}
+		}
+		add(best);
+	}
+}
+
+// 球同士
+bool CollideSpheres(const RigidBody& a, const RigidBody& b, ContactManifold& manifold) {
+	Vector3 difference = Subtract(b.position, a.position);
+	float distance = Length(difference);
+	float separation = distance - a.radius - b.radius;
+	if (separation > kContactMargin) { return false; }
+	manifold.normal = distance > 0.0f ? Multiply(1.0f / distance, difference) : Vector3{ 0.0f, 1.0f, 0.0f };
+	ContactCandidate candidate = { Add(a.position, Multiply(a.radius + 0.5f * separation, manifold.normal)), -separation };
+	AddContactPoints(manifold, &candidate, 1);
+	return true;
+}
+
+// 箱(A)と球(B)
+bool CollideBoxSphere(const RigidBody& box, const RigidBody& sphere, ContactManifold& manifold) {
+	Vector3 closest = ClosestPoint(sphere.position, GetBodyOBB(box));
+	Vector3 difference = Subtract(sphere.position, closest);
+	float distanceSquared = Dot(difference, difference);
+	float separation;
+	if (distanceSquared > 0.0f) {
+		float distance = std::sqrt(distanceSquared);
+		separation = distance - sphere.radius;
+		if (separation > kContactMargin) { return false; }
+		manifold.normal = Multiply(1.0f / distance, difference);
+	} else {
+		// 中心が箱の中にあるときは一番近い面から押し出す
+		Vector3 toCenter = Subtract(sphere.position, box.position);
+		const float sizes[3] = { box.halfSize.x, box.halfSize.y, box.halfSize.z };
+		float bestGap = (std::numeric_limits<float>::max)();
+		for (int axis = 0; axis < 3; ++axis) {
+			float local = Dot(toCenter, box.orientations[axis]);
+			float gap = sizes[axis] - std::fabs(local);
+			if (gap < bestGap) {
+				bestGap = gap;
+				manifold.normal = Multiply(local >= 0.0f ? 1.0f : -1.0f, box.orientations[axis]);
+			}
+		}
+		separation = -bestGap - sphere.radius;
+	}
+	ContactCandidate candidate = { Subtract(sphere.position, Multiply(sphere.radius + 0.5f * separation, manifold.normal)), -separation };
+	AddContactPoints(manifold, &candidate, 1);
+	return true;
+}
+
+// 箱の頂点
+void GetBoxCorners(const RigidBody& box, Vector3 corners[8]) {
+	for (int i = 0; i < 8; ++i) {
+		Vector3 corner = box.position;
+		corner = Add(corner, Multiply((i & 1) ? box.halfSize.x : -box.halfSize.x, box.orientations[0]));
+		corner = Add(corner, Multiply((i & 2) ? box.halfSize.y : -box.halfSize.y, box.orientations[1]));
+		corner = Add(corner, Multiply((i & 4) ? box.halfSize.z : -box.halfSize.z, box.orientations[2]));
+		corners[i] = corner;
+	}
+}
+
+/// <summary>
+/// 参照面に対して入射面を切り取り、接触点を作る
+/// </summary>
+/// <param name="reference">参照面を持つ箱</param>
+/// <param name="incident">入射面を持つ箱</param>
+/// <param name="referenceAxis">参照面の軸</param>
+/// <param name="normal">参照面の法線(incident 側を向く)</param>
+/// <param name="candidates">接触点の出力(最大8)</param>
+int ClipBoxFaces(const RigidBody& reference, const RigidBody& incident, int referenceAxis, const Vector3& normal, ContactCandidate candidates[8]) {
+	const float referenceSizes[3] = { reference.halfSize.x, reference.halfSize.y, reference.halfSize.z };
+	const float incidentSizes[3] = { incident.halfSize.x, incident.halfSize.y, incident.halfSize.z };
+
+	// 入射面: 法線と一番逆を向く面
+	int incidentAxis = 0;
+	float bestDot = 0.0f;
+	for (int axis = 0; axis < 3; ++axis) {
+		float d = std::fabs(Dot(incident.orientations[axis], normal));
+		if (d > bestDot) {
+			bestDot = d;
+			incidentAxis = axis;
+		}
+	}
+	float incidentSign = Dot(incident.orientations[incidentAxis], normal) > 0.0f ? -1.0f : 1.0f;
+	Vector3 incidentCenter = Add(incident.position, Multiply(incidentSign * incidentSizes[incidentAxis], incident.orientations[incidentAxis]));
+	int u = (incidentAxis + 1) % 3;
+	int v = (incidentAxis + 2) % 3;
+	Vector3 du = Multiply(incidentSizes[u], incident.orientations[u]);
+	Vector3 dv = Multiply(incidentSizes[v], incident.orientations[v]);
+	Vector3 polygon[8] = {
+		Add(Add(incidentCenter, du), dv),
+		Add(Subtract(incidentCenter, du), dv),
+		Subtract(Subtract(incidentCenter, du), dv),
+		Subtract(Add(incidentCenter, du), dv),
+	};
+	int polygonCount = 4;
+
+	// 参照面の4辺で切り取る
+	Vector3 referenceCenter = Add(reference.position, Multiply(referenceSizes[referenceAxis], normal));
+	for (int side = 0; side < 4; ++side) {
+		int axis = (referenceAxis + 1 + side / 2) % 3;
+		Vector3 sideNormal = Multiply((side & 1) ? -1.0f : 1.0f, reference.orientations[axis]);
+		float offset = Dot(sideNormal, reference.position) + referenceSizes[axis];
+		Vector3 clipped[8];
+		int clippedCount = 0;
+		for (int i = 0; i < polygonCount; ++i) {
+			const Vector3& p0 = polygon[i];
+			const Vector3& p1 = polygon[(i + 1) % polygonCount];
+			float d0 = Dot(sideNormal, p0) - offset;
+			float d1 = Dot(sideNormal, p1) - offset;
+			if (d0 <= 0.0f) {
+				clipped[clippedCount++] = p0;
+			}
+			if ((d0 < 0.0f && d1 > 0.0f) || (d0 > 0.0f && d1 < 0.0f)) {
+				clipped[clippedCount++] = Lerp(p0, p1, d0 / (d0 - d1));
+			}
+		}
+		std::copy(clipped, clipped + clippedCount, polygon);
+		polygonCount = clippedCount;
+		if (polygonCount == 0) { break; }
+	}
+
+	// 参照面より下にある点が接触点
+	int count = 0;
+	for (int i = 0; i < polygonCount; ++i) {
+		float separation = Dot(Subtract(polygon[i], referenceCenter), normal);
+		if (separation <= kContactMargin) {
+			candidates[count++] = { Subtract(polygon[i], Multiply(0.5f * separation, normal)), -separation };
+		}
+	}
+	return count;
+}
+
+/// <summary>
+/// 箱同士(分離軸判定 + 面の切り取り)
+/// </summary>
+bool CollideBoxes(const RigidBody& a, const RigidBody& b, ContactManifold& manifold) {
+	const float sizesA[3] = { a.halfSize.x, a.halfSize.y, a.halfSize.z };
+	const float sizesB[3] = { b.halfSize.x, b.halfSize.y, b.halfSize.z };
+	Vector3 difference = Subtract(b.position, a.position);
+
+	// 軸 axis での離れ具合
+	auto getSeparation = [&](const Vector3& axis) {
+		float projectionA = 0.0f;
+		float projectionB = 0.0f;
+		for (int k = 0; k < 3; ++k) {
+			projectionA += sizesA[k] * std::fabs(Dot(a.orientations[k], axis));
+			projectionB += sizesB[k] * std::fabs(Dot(b.orientations[k], axis));
+		}
+		return std::fabs(Dot(difference, axis)) - projectionA - projectionB;
+	};
+
+	// 面の軸
+	float faceSeparationA = -(std::numeric_limits<float>::max)();
+	float faceSeparationB = -(std::numeric_limits<float>::max)();
+	int faceAxisA = 0;
+	int faceAxisB = 0;
+	for (int axis = 0; axis < 3; ++axis) {
+		float separation = getSeparation(a.orientations[axis]);
+		if (separation > kContactMargin) { return false; }
+		if (separation > faceSeparationA) {
+			faceSeparationA = separation;
+			faceAxisA = axis;
+		}
+	}
+	for (int axis = 0; axis < 3; ++axis) {
+		float separation = getSeparation(b.orientations[axis]);
+		if (separation > kContactMargin) { return false; }
+		if (separation > faceSeparationB) {
+			faceSeparationB = separation;
+			faceAxisB = axis;
+		}
+	}
+	// 辺同士の軸
+	float edgeSeparation = -(std::numeric_limits<float>::max)();
+	int edgeAxisA = 0;
+	int edgeAxisB = 0;
+	Vector3 edgeNormal = {};
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			Vector3 axis = Cross(a.orientations[i], b.orientations[j]);
+			float length = Length(axis);
+			if (length < 1.0e-4f) { continue; } // 平行な辺は面の軸で足りる
+			axis = Multiply(1.0f / length, axis);
+			float separation = getSeparation(axis);
+			if (separation > kContactMargin) { return false; }
+			if (separation > edgeSeparation) {
+				edgeSeparation = separation;
+				edgeAxisA = i;
+				edgeAxisB = j;
+				edgeNormal = axis;
+			}
+		}
+	}
+
+	// 面の軸を優先する(辺の接触は面よりはっきり浅いときだけ)
+	const float kRelativeTolerance = 0.95f;
+	const float kAbsoluteTolerance = 0.01f;
+	ContactCandidate candidates[8];
+	int count = 0;
+	if (edgeSeparation > kRelativeTolerance * (std::max)(faceSeparationA, faceSeparationB) + kAbsoluteTolerance) {
+		if (Dot(edgeNormal, difference) < 0.0f) {
+			edgeNormal = Multiply(-1.0f, edgeNormal);
+		}
+		// 法線の向きで一番外側にある辺同士の最近接点
+		Vector3 edgeCenterA = a.position;
+		Vector3 edgeCenterB = b.position;
+		for (int k = 0; k < 3; ++k) {
+			if (k != edgeAxisA) {
+				float sign = Dot(a.orientations[k], edgeNormal) > 0.0f ? 1.0f : -1.0f;
+				edgeCenterA = Add(edgeCenterA, Multiply(sign * sizesA[k], a.orientations[k]));
+			}
+			if (k != edgeAxisB) {
+				float sign = Dot(b.orientations[k], edgeNormal) > 0.0f ? -1.0f : 1.0f;
+				edgeCenterB = Add(edgeCenterB, Multiply(sign * sizesB[k], b.orientations[k]));
+			}
+		}
+		Vector3 halfEdgeA = Multiply(sizesA[edgeAxisA], a.orientations[edgeAxisA]);
+		Vector3 halfEdgeB = Multiply(sizesB[edgeAxisB], b.orientations[edgeAxisB]);
+		Segment edgeA = { Subtract(edgeCenterA, halfEdgeA), Multiply(2.0f, halfEdgeA) };
+		Segment edgeB = { Subtract(edgeCenterB, halfEdgeB), Multiply(2.0f, halfEdgeB) };
+		Vector3 pointA;
+		Vector3 pointB;
+		ClosestPoints(edgeA, edgeB, pointA, pointB);
+		manifold.normal = edgeNormal;
+		candidates[0] = { Multiply(0.5f, Add(pointA, pointB)), -edgeSeparation };
+		count = 1;
+	} else if (faceSeparationB > kRelativeTolerance * faceSeparationA + kAbsoluteTolerance) {
+		// B の面が参照面
+		Vector3 normal = b.orientations[faceAxisB];
+		if (Dot(normal, difference) > 0.0f) {
+			normal = Multiply(-1.0f, normal);
+		}
+		count = ClipBoxFaces(b, a, faceAxisB, normal, candidates);
+		manifold.normal = Multiply(-1.0f, normal);
+	} else {
+		// A の面が参照面
+		Vector3 normal = a.orientations[faceAxisA];
+		if (Dot(normal, difference) < 0.0f) {
+			normal = Multiply(-1.0f, normal);
+		}
+		count = ClipBoxFaces(a, b, faceAxisA, normal, candidates);
+		manifold.normal = normal;
+	}
+	if (count == 0) { return false; }
+	AddContactPoints(manifold, candidates, count);
+	return true;
+}
+
+// 平面(A)と剛体(B)
+bool CollidePlaneBody(const Plane& plane, const RigidBody& body, ContactManifold& manifold) {
+	manifold.normal = plane.normal;
+	if (body.shape == RigidBodyShape::SphereShape) {
+		float separation = Dot(plane.normal, body.position) - plane.distance - body.radius;
+		if (separation > kContactMargin) { return false; }
+		ContactCandidate candidate = { Subtract(body.position, Multiply(body.radius + 0.5f * separation, plane.normal)), -separation };
+		AddContactPoints(manifold, &candidate, 1);
+		return true;
+	}
+	Vector3 corners[8];
+	GetBoxCorners(body, corners);
+	ContactCandidate candidates[8];
+	int count = 0;
+	for (const Vector3& corner : corners) {
+		float separation = Dot(plane.normal, corner) - plane.distance;
+		if (separation <= kContactMargin) {
+			candidates[count++] = { Subtract(corner, Multiply(0.5f * separation, plane.normal)), -separation };
+		}
+	}
+	if (count == 0) { return false; }
+	AddContactPoints(manifold, candidates, count);
+	return true;
+}
+
+// ---- ワールド ----
+
+// シミュレーションの設定
+struct PhysicsSettings {
+	Vector3 gravity = { 0.0f, -9.8f, 0.0f };
+	int velocityIterations = 8;	// 速度の反復回数
+	bool isSleepEnabled = true;	// 止まった剛体を眠らせるか
+};
+
+/// <summary>
+/// 剛体と静的な平面を持ち、時間を進める
+/// </summary>
+class PhysicsWorld {
+public:
+	explicit PhysicsWorld(ThreadPool* threadPool = nullptr)
+		: threadPool_(threadPool ? threadPool : &ThreadPool::GetDefault()), narrowPhase_(threadPool_) {}
+
+	PhysicsSettings settings;
+
+	// 剛体を追加して番号を返す
+	uint32_t AddBody(const RigidBody& body) {
+		bodies_.push_back(body);
+		return uint32_t(bodies_.size() - 1);
+	}
+
+	// 動かない平面(地面など)を追加
+	void AddPlane(const Plane& plane) { planes_.push_back(plane); }
+
+	// 剛体を起こす
+	void WakeBody(uint32_t index) {
+		bodies_[index].isAwake = true;
+		bodies_[index].sleepTime = 0.0f;
+	}
+
+	RigidBody& GetBody(uint32_t index) { return bodies_[index]; }
+	const std::vector<RigidBody>& GetBodies() const { return bodies_; }
+	const std::vector<ContactManifold>& GetManifolds() const { return manifolds_; }
+	// 最後のステップで解いたアイランドの数
+	size_t GetActiveIslandCount() const { return islandStarts_.empty() ? 0 : islandStarts_.size() - 1; }
+	// 起きている動的な剛体の数
+	size_t GetAwakeBodyCount() const {
+		size_t count = 0;
+		for (const RigidBody& body : bodies_) {
+			if (body.inverseMass > 0.0f && body.isAwake) { ++count; }
+		}
+		return count;
+	}
+
+	/// <summary>
+	/// 時間を進める
+	/// </summary>
+	/// <param name="deltaTime">経過時間(秒)</param>
+	void Step(float deltaTime) {
+		MT3_PROFILE_SCOPE("PhysicsWorld::Step");
+		if (deltaTime <= 0.0f) { return; }
+		IntegrateVelocities(deltaTime);
+		UpdateContacts();
+		BuildIslands();
+		SolveIslands(deltaTime);
+		IntegratePositions(deltaTime);
+		RelaxIslands();
+		if (settings.isSleepEnabled) {
+			UpdateSleep(deltaTime);
+		}
+	}
+
+private:
+	bool IsDynamic(uint32_t index) const {
+		return (index & kStaticPlaneFlag) == 0 && bodies_[index].inverseMass > 0.0f;
+	}
+
+	// 動いていて起きている(静的な相手や平面は false)
+	bool IsActive(uint32_t index) const {
+		return IsDynamic(index) && bodies_[index].isAwake;
+	}
+
+	RigidBody& GetSolverBody(uint32_t index) {
+		return (index & kStaticPlaneFlag) ? staticBody_ : bodies_[index];
+	}
+
+	// 重力で速度を更新
+	void IntegrateVelocities(float deltaTime) {
+		MT3_PROFILE_SCOPE("IntegrateVelocities");
+		Vector3 gravityStep = Multiply(deltaTime, settings.gravity);
+		threadPool_->ParallelFor(bodies_.size(), 256, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				RigidBody& body = bodies_[i];
+				if (body.inverseMass > 0.0f && body.isAwake) {
+					body.velocity = Add(body.velocity, gravityStep);
+				}
+			}
+		});
+	}
+
+	/// <summary>
+	/// 接触を求め直す(x軸のソートで候補を絞り、前フレームの同じ接触点からインパルスを引き継ぐ)
+	/// </summary>
+	void UpdateContacts() {
+		MT3_PROFILE_SCOPE("UpdateContacts");
+		// 一時的な配列はフレーム用アロケータから取る
+		std::unordered_map<uint64_t, size_t, std::hash<uint64_t>, std::equal_to<uint64_t>, ArenaAllocator<std::pair<const uint64_t, size_t>>> previousIndices;
+		previousIndices.reserve(manifolds_.size());
+		for (size_t i = 0; i < manifolds_.size(); ++i) {
+			previousIndices[GetPairId({ manifolds_[i].bodyA, manifolds_[i].bodyB })] = i;
+		}
+		std::vector<ContactManifold>& previous = previousManifolds_;
+		previous.swap(manifolds_);
+		manifolds_.clear();
+
+		// 1つのペアの接触を求める(ナローフェーズのスレッドから呼ばれるので、読むだけにする)
+		auto getManifold = [&](const CollisionPair& pair, ContactManifold& manifold) {
+			uint32_t a = pair.a;
+			uint32_t b = pair.b;
+			auto found = previousIndices.find(GetPairId(pair));
+			const ContactManifold* old = found != previousIndices.end() ? &previous[found->second] : nullptr;
+			// どちらも起きていなければ前の接触をそのまま残す
+			if (!IsActive(a) && !IsActive(b)) {
+				if (!old) { return false; }
+				manifold = *old;
+				return true;
+			}
+			manifold = {};
+			manifold.bodyA = a;
+			manifold.bodyB = b;
+			bool isHit = false;
+			if (a & kStaticPlaneFlag) {
+				isHit = CollidePlaneBody(planes_[a & ~kStaticPlaneFlag], bodies_[b], manifold);
+			} else {
+				const RigidBody& bodyA = bodies_[a];
+				const RigidBody& bodyB = bodies_[b];
+				if (bodyA.shape == RigidBodyShape::SphereShape && bodyB.shape == RigidBodyShape::SphereShape) {
+					isHit = CollideSpheres(bodyA, bodyB, manifold);
+				} else if (bodyA.shape == RigidBodyShape::BoxShape && bodyB.shape == RigidBodyShape::BoxShape) {
+					isHit = CollideBoxes(bodyA, bodyB, manifold);
+				} else {
+					isHit = CollideBoxSphere(bodyA, bodyB, manifold);
+				}
+			}
+			if (!isHit) { return false; }
+
+			const RigidBody& bodyA = (a & kStaticPlaneFlag) ? staticBody_ : bodies_[a];
+			const RigidBody& bodyB = bodies_[b];
+			manifold.friction = std::sqrt(bodyA.friction * bodyB.friction);
+			manifold.restitution = (std::max)(bodyA.restitution, bodyB.restitution);
+			manifold.tangents[0] = Normalize(Perpendicular(manifold.normal));
+			manifold.tangents[1] = Cross(manifold.normal, manifold.tangents[0]);
+			// warm start: 前フレームの近い接触点のインパルスを引き継ぐ
+			if (old) {
+				for (int i = 0; i < manifold.pointCount; ++i) {
+					ContactPoint& point = manifold.points[i];
+					for (int k = 0; k < old->pointCount; ++k) {
+						const ContactPoint& oldPoint = old->points[k];
+						if (DistanceSquared(point.position, oldPoint.position) <= kWarmStartMatchDistance * kWarmStartMatchDistance) {
+							point.normalImpulse = oldPoint.normalImpulse;
+							point.tangentImpulse[0] = oldPoint.tangentImpulse[0];
+							point.tangentImpulse[1] = oldPoint.tangentImpulse[1];
+							break;
+						}
+					}
+				}
+			}
+			return true;
+		};
+
+		// 剛体同士(x軸で並べて重なる範囲だけ調べる)
+		FrameVector<CollisionPair> pairs;
+		FrameVector<AABB> bounds(bodies_.size());
+		FrameVector<uint32_t> order(bodies_.size());
+		for (size_t i = 0; i < bodies_.size(); ++i) {
+			bounds[i] = GetBodyBounds(bodies_[i]);
+		}
+		std::iota(order.begin(), order.end(), 0u);
+		std::sort(order.begin(), order.end(), [&](uint32_t l, uint32_t r) { return bounds[l].min.x < bounds[r].min.x; });
+		for (size_t i = 0; i < order.size(); ++i) {
+			uint32_t first = order[i];
+			for (size_t j = i + 1; j < order.size(); ++j) {
+				uint32_t second = order[j];
+				if (bounds[second].min.x > bounds[first].max.x) { break; }
+				if (!IsDynamic(first) && !IsDynamic(second)) { continue; }
+				const AABB& b0 = bounds[first];
+				const AABB& b1 = bounds[second];
+				if (b0.min.y > b1.max.y || b1.min.y > b0.max.y || b0.min.z > b1.max.z || b1.min.z > b0.max.z) { continue; }
+				// 箱と球の組は箱を A にする
+				uint32_t a = (std::min)(first, second);
+				uint32_t b = (std::max)(first, second);
+				if (bodies_[a].shape == RigidBodyShape::SphereShape && bodies_[b].shape == RigidBodyShape::BoxShape) {
+					std::swap(a, b);
+				}
+				pairs.push_back({ a, b });
+			}
+		}
+		// 剛体と平面
+		for (uint32_t p = 0; p < uint32_t(planes_.size()); ++p) {
+			for (uint32_t i = 0; i < uint32_t(bodies_.size()); ++i) {
+				if (IsDynamic(i)) {
+					pairs.push_back({ kStaticPlaneFlag | p, i });
+				}
+			}
+		}
+
+		// 並列に判定し、ペア番号の順に受け取る(スレッド数によらず同じ順番で解く)
+		for (const PairResult<ContactManifold>& result : narrowPhase_.Run(pairs.data(), pairs.size(), getManifold)) {
+			manifolds_.push_back(result.result);
+		}
+	}
+
+	// 接触でつながった動的な剛体をアイランドにまとめる
+	void BuildIslands() {
+		MT3_PROFILE_SCOPE("BuildIslands");
+		FrameVector<uint32_t> parent(bodies_.size());
+		std::iota(parent.begin(), parent.end(), 0u);
+		auto find = [&](uint32_t i) {
+			while (parent[i] != i) {
+				parent[i] = parent[parent[i]];
+				i = parent[i];
+			}
+			return i;
+		};
+		for (const ContactManifold& manifold : manifolds_) {
+			if (IsDynamic(manifold.bodyA) && IsDynamic(manifold.bodyB)) {
+				uint32_t rootA = find(manifold.bodyA);
+				uint32_t rootB = find(manifold.bodyB);
+				// 小さい番号を根にして結果を順序に依存させない
+				if (rootA < rootB) { parent[rootB] = rootA; } else { parent[rootA] = rootB; }
+			}
+		}
+
+		// 起きている剛体を含むアイランドは全員起こす
+		FrameVector<uint8_t> isIslandAwake(bodies_.size(), 0);
+		for (uint32_t i = 0; i < uint32_t(bodies_.size()); ++i) {
+			if (IsActive(i)) { isIslandAwake[find(i)] = 1; }
+		}
+		islandBodies_.clear();
+		islandOfBody_.assign(bodies_.size(), UINT32_MAX);
+		FrameVector<uint32_t> islandOfRoot(bodies_.size(), UINT32_MAX);
+		FrameVector<FrameVector<uint32_t>> members;
+		for (uint32_t i = 0; i < uint32_t(bodies_.size()); ++i) {
+			if (!IsDynamic(i)) { continue; }
+			uint32_t root = find(i);
+			if (!isIslandAwake[root]) { continue; }
+			if (!bodies_[i].isAwake) { WakeBody(i); }
+			if (islandOfRoot[root] == UINT32_MAX) {
+				islandOfRoot[root] = uint32_t(members.size());
+				members.emplace_back();
+			}
+			islandOfBody_[i] = islandOfRoot[root];
+			members[islandOfRoot[root]].push_back(i);
+		}
+
+		// アイランドごとに接触を並べ替える
+		FrameVector<FrameVector<uint32_t>> manifoldsOfIsland(members.size());
+		for (uint32_t m = 0; m < uint32_t(manifolds_.size()); ++m) {
+			uint32_t dynamicBody = IsDynamic(manifolds_[m].bodyA) ? manifolds_[m].bodyA : manifolds_[m].bodyB;
+			uint32_t island = islandOfBody_[dynamicBody];
+			if (island != UINT32_MAX) {
+				manifoldsOfIsland[island].push_back(m);
+			}
+		}
+		islandStarts_.assign(1, 0);
+		islandManifolds_.clear();
+		islandBodyStarts_.assign(1, 0);
+		for (size_t island = 0; island < members.size(); ++island) {
+			islandManifolds_.insert(islandManifolds_.end(), manifoldsOfIsland[island].begin(), manifoldsOfIsland[island].end());
+			islandStarts_.push_back(uint32_t(islandManifolds_.size()));
+			islandBodies_.insert(islandBodies_.end(), members[island].begin(), members[island].end());
+			islandBodyStarts_.push_back(uint32_t(islandBodies_.size()));
+		}
+	}
+
+	// インパルスを加える(静的な相手には書き込まない)
+	void ApplyImpulse(RigidBody& body, const Vector3& impulse, const Vector3& r) {
+		if (body.inverseMass <= 0.0f) { return; }
+		body.velocity = Add(body.velocity, Multiply(body.inverseMass, impulse));
+		body.angularVelocity = Add(body.angularVelocity, ApplyInverseInertia(body, Cross(r, impulse)));
+	}
+
+	// 接触点での相対速度(B - A)
+	static Vector3 GetRelativeVelocity(const RigidBody& a, const RigidBody& b, const ContactPoint& point) {
+		Vector3 velocityA = Add(a.velocity, Cross(a.angularVelocity, point.rA));
+		Vector3 velocityB = Add(b.velocity, Cross(b.angularVelocity, point.rB));
+		return Subtract(velocityB, velocityA);
+	}
+
+	// 方向 direction の有効質量
+	static float GetEffectiveMass(const RigidBody& a, const RigidBody& b, const ContactPoint& point, const Vector3& direction) {
+		Vector3 crossA = Cross(point.rA, direction);
+		Vector3 crossB = Cross(point.rB, direction);
+		float k = a.inverseMass + b.inverseMass +
+			Dot(crossA, ApplyInverseInertia(a, crossA)) + Dot(crossB, ApplyInverseInertia(b, crossB));
+		return k > 0.0f ? 1.0f / k : 0.0f;
+	}
+
+	/// <summary>
+	/// 1つのアイランドの接触の速度の反復
+	/// </summary>
+	/// <param name="island">アイランドの番号</param>
+	/// <param name="useBias">めり込みを戻す速度を含めるか(緩和では含めない)</param>
+	void SolveIslandVelocities(uint32_t island, bool useBias) {
+		const uint32_t* begin = islandManifolds_.data() + islandStarts_[island];
+		const uint32_t* end = islandManifolds_.data() + islandStarts_[island + 1];
+		for (int iteration = 0; iteration < settings.velocityIterations; ++iteration) {
+			for (const uint32_t* m = begin; m != end; ++m) {
+				ContactManifold& manifold = manifolds_[*m];
+				RigidBody& a = GetSolverBody(manifold.bodyA);
+				RigidBody& b = GetSolverBody(manifold.bodyB);
+				// 接触点を解く順番を反復ごとに逆にして、順番による片寄り(積み重ねの揺れ)を打ち消す
+				for (int k = 0; k < manifold.pointCount; ++k) {
+					int i = (iteration & 1) ? manifold.pointCount - 1 - k : k;
+					ContactPoint& point = manifold.points[i];
+					// 摩擦(法線方向のインパルスに比例する範囲に収める)
+					float maxFriction = manifold.friction * point.normalImpulse;
+					for (int t = 0; t < 2; ++t) {
+						float lambda = -point.tangentMass[t] * Dot(GetRelativeVelocity(a, b, point), manifold.tangents[t]);
+						float accumulated = std::clamp(point.tangentImpulse[t] + lambda, -maxFriction, maxFriction);
+						lambda = accumulated - point.tangentImpulse[t];
+						point.tangentImpulse[t] = accumulated;
+						Vector3 impulse = Multiply(lambda, manifold.tangents[t]);
+						ApplyImpulse(a, Multiply(-1.0f, impulse), point.rA);
+						ApplyImpulse(b, impulse, point.rB);
+					}
+					// 法線(押す方向だけ)
+					float bias = useBias ? (std::max)(point.velocityBias, point.positionBias) : point.velocityBias;
+					float normalVelocity = Dot(GetRelativeVelocity(a, b, point), manifold.normal);
+					float lambda = -point.normalMass * (normalVelocity - bias);
+					float accumulated = (std::max)(point.normalImpulse + lambda, 0.0f);
+					lambda = accumulated - point.normalImpulse;
+					point.normalImpulse = accumulated;
+					Vector3 impulse = Multiply(lambda, manifold.normal);
+					ApplyImpulse(a, Multiply(-1.0f, impulse), point.rA);
+					ApplyImpulse(b, impulse, point.rB);
+				}
+			}
+		}
+	}
+
+	// 1つのアイランドの接触を解く
+	void SolveIsland(uint32_t island, float deltaTime) {
+		const uint32_t* begin = islandManifolds_.data() + islandStarts_[island];
+		const uint32_t* end = islandManifolds_.data() + islandStarts_[island + 1];
+		float inverseDeltaTime = 1.0f / deltaTime;
+
+		// 準備と warm start
+		for (const uint32_t* m = begin; m != end; ++m) {
+			ContactManifold& manifold = manifolds_[*m];
+			RigidBody& a = GetSolverBody(manifold.bodyA);
+			RigidBody& b = GetSolverBody(manifold.bodyB);
+			for (int i = 0; i < manifold.pointCount; ++i) {
+				ContactPoint& point = manifold.points[i];
+				point.rA = Subtract(point.position, a.position);
+				point.rB = Subtract(point.position, b.position);
+				point.normalMass = GetEffectiveMass(a, b, point, manifold.normal);
+				point.tangentMass[0] = GetEffectiveMass(a, b, point, manifold.tangents[0]);
+				point.tangentMass[1] = GetEffectiveMass(a, b, point, manifold.tangents[1]);
+
+				// 離れていれば隙間の分だけ近づくのを許し、めり込みは位置の更新で少しずつ戻す
+				point.velocityBias = (std::min)(point.depth, 0.0f) * inverseDeltaTime;
+				point.positionBias = kBaumgarte * inverseDeltaTime * (std::max)(point.depth - kContactSlop, 0.0f);
+				// 反発はこのステップで実際に触れる接触だけ(隙間が残る接触を跳ね返さない)
+				float normalVelocity = Dot(GetRelativeVelocity(a, b, point), manifold.normal);
+				if (normalVelocity < -kRestitutionThreshold && -normalVelocity * deltaTime >= -point.depth) {
+					point.velocityBias = (std::max)(point.velocityBias, -manifold.restitution * normalVelocity);
+				}
+
+				Vector3 impulse = Add(Multiply(point.normalImpulse, manifold.normal),
+					Add(Multiply(point.tangentImpulse[0], manifold.tangents[0]), Multiply(point.tangentImpulse[1], manifold.tangents[1])));
+				ApplyImpulse(a, Multiply(-1.0f, impulse), point.rA);
+				ApplyImpulse(b, impulse, point.rB);
+			}
+		}
+
+		SolveIslandVelocities(island, true);
+	}
+
+	// 独立したアイランドを並列に解く
+	void SolveIslands(float deltaTime) {
+		MT3_PROFILE_SCOPE("SolveIslands");
+		threadPool_->ParallelFor(GetActiveIslandCount(), 1, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t island = begin; island < end; ++island) {
+				SolveIsland(uint32_t(island), deltaTime);
+			}
+		});
+	}
+
+	// 位置の更新後、めり込みを戻す速度を抜くためにもう一度解く(緩和)
+	void RelaxIslands() {
+		MT3_PROFILE_SCOPE("RelaxIslands");
+		threadPool_->ParallelFor(GetActiveIslandCount(), 1, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t island = begin; island < end; ++island) {
+				SolveIslandVelocities(uint32_t(island), false);
+			}
+		});
+	}
+
+	// 速度で位置と向きを更新
+	void IntegratePositions(float deltaTime) {
+		MT3_PROFILE_SCOPE("IntegratePositions");
+		threadPool_->ParallelFor(bodies_.size(), 256, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				RigidBody& body = bodies_[i];
+				if (body.inverseMass <= 0.0f || !body.isAwake) { continue; }
+				body.position = Add(body.position, Multiply(deltaTime, body.velocity));
+				if (Dot(body.angularVelocity, body.angularVelocity) > 0.0f) {
+					for (Vector3& axis : body.orientations) {
+						axis = Add(axis, Multiply(deltaTime, Cross(body.angularVelocity, axis)));
+					}
+					// 直交に戻す
+					body.orientations[0] = Normalize(body.orientations[0]);
+					body.orientations[1] = Normalize(Subtract(body.orientations[1], Multiply(Dot(body.orientations[0], body.orientations[1]), body.orientations[0])));
+					body.orientations[2] = Cross(body.orientations[0], body.orientations[1]);
+				}
+			}
+		});
+	}
+
+	// アイランド全員がしばらく止まっていたら眠らせる
+	void UpdateSleep(float deltaTime) {
+		MT3_PROFILE_SCOPE("UpdateSleep");
+		for (size_t island = 0; island + 1 < islandBodyStarts_.size(); ++island) {
+			float minSleepTime = (std::numeric_limits<float>::max)();
+			for (uint32_t k = islandBodyStarts_[island]; k < islandBodyStarts_[island + 1]; ++k) {
+				RigidBody& body = bodies_[islandBodies_[k]];
+				if (Dot(body.velocity, body.velocity) > kSleepLinearTolerance * kSleepLinearTolerance ||
+					Dot(body.angularVelocity, body.angularVelocity) > kSleepAngularTolerance * kSleepAngularTolerance) {
+					body.sleepTime = 0.0f;
+				} else {
+					body.sleepTime += deltaTime;
+				}
+				minSleepTime = (std::min)(minSleepTime, body.sleepTime);
+			}
+			if (minSleepTime >= kTimeToSleep) {
+				for (uint32_t k = islandBodyStarts_[island]; k < islandBodyStarts_[island + 1]; ++k) {
+					RigidBody& body = bodies_[islandBodies_[k]];
+					body.isAwake = false;
+					body.velocity = { 0.0f, 0.0f, 0.0f };
+					body.angularVelocity = { 0.0f, 0.0f, 0.0f };
+				}
+			}
+		}
+	}
+
+	ThreadPool* threadPool_;
+	NarrowPhase<ContactManifold> narrowPhase_;
+	std::vector<RigidBody> bodies_;
+	std::vector<Plane> planes_;
+	RigidBody staticBody_;	// 平面の代わりに解く静的な剛体(書き込まれない)
+	std::vector<ContactManifold> manifolds_;
+	std::vector<ContactManifold> previousManifolds_;	// 前のステップの接触(warm start 用、確保した領域を使い回す)
+
+	// アイランド(起きているものだけ)
+	std::vector<uint32_t> islandStarts_;		// islandManifolds_ の区切り
+	std::vector<uint32_t> islandManifolds_;		// 接触の番号
+	std::vector<uint32_t> islandBodyStarts_;	// islandBodies_ の区切り
+	std::vector<uint32_t> islandBodies_;		// 剛体の番号
+	std::vector<uint32_t> islandOfBody_;
+};
\ No newline at end of file
@@ -0,0 +1,548 @@
+#pragma once
+#include "Collision.h"
+#include "DebugDraw.h"
+#include "FixedTimestep.h"
+#include "FrameArena.h"
+#include "Gjk.h"
+#include "LineList.h"
+#include "Matrix4x4.h"
+#include "NarrowPhase.h"
+#include "PairCache.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ベンチマーク用のシナリオ(シーンの記述と、それを動かす描画なしのシーン)
+//
+// シナリオファイルは1行に1項目のテキスト(# 以降はコメント)
+//   name dense_indoor
+//   frames 600                       計測するフレーム数
+//   warmup 30                        計測前に捨てるフレーム数
+//   seed 42                          乱数の種
+//   timestep 0.0166667               1フレームの時間(秒)
+//   viewport 1280 720                画面の大きさ
+//   simplify 0.5                     LineList::Simplify の許容誤差(負なら使わない)
+//   paircache on                     前フレームの分離軸を使うか(on / off)
+//   camera rotate 0.26 0 0 translate 0 1.9 -6.49
+//   sphere count 2000 uniform -8 0 -8 8 4 8 size 0.05 0.3 speed 1
+//   aabb count 500 normal 0 1 0 3 1 3 size 0.1 0.5 speed 0.5
+//   obb / triangle / pendulum も同じ書き方
+// 分布は uniform(最小点と最大点)か normal(平均と標準偏差)
+// size は球なら半径、箱なら各辺の半分、三角形なら頂点の広がり、振り子なら紐の長さの範囲
+// speed は動く速さの最大(三角形は動かない)
+
+// 図形の種類(ナローフェーズで GetContact の引数の順になるよう、前に来るものほど小さい)
+enum class ScenarioShapeKind : uint32_t {
+	OBBKind,
+	AABBKind,
+	TriangleKind,
+	SphereKind,
+	Count,
+};
+
+// 図形の種類ごとの名前(JSON や表示用、ScenarioShapeKind の順)
+static const char* const kScenarioShapeNames[] = { "obb", "aabb", "triangle", "sphere" };
+
+/// <summary>
+/// 1種類の図形の置き方
+/// </summary>
+struct ScenarioGroup {
+	uint32_t count = 0;
+	bool isNormal = false;				// 正規分布(false なら一様分布)
+	Vector3 first = { 0.0f, 0.0f, 0.0f };	// 一様分布なら最小点、正規分布なら平均
+	Vector3 second = { 0.0f, 0.0f, 0.0f };	// 一様分布なら最大点、正規分布なら標準偏差
+	float minSize = 0.1f;
+	float maxSize = 0.1f;
+	float speed = 0.0f;
+};
+
+/// <summary>
+/// シナリオの記述
+/// </summary>
+struct ScenarioDesc {
+	std::string name = "scenario";
+	uint32_t frameCount = 300;
+	uint32_t warmupFrameCount = 30;
+	uint32_t seed = 1;
+	float timestep = 1.0f / 60.0f;
+	uint32_t viewportWidth = 1280;
+	uint32_t viewportHeight = 720;
+	float simplifyTolerance = 0.5f;
+	bool usePairCache = true;
+	Transform camera = { { 1.0f, 1.0f, 1.0f }, { 0.26f, 0.0f, 0.0f }, { 0.0f, 1.9f, -6.49f } };
+	ScenarioGroup groups[uint32_t(ScenarioShapeKind::Count)];
+	ScenarioGroup pendulums;
+};
+
+/// <summary>
+/// シナリオファイルを読み込む
+/// </summary>
+/// <param name="path">パス</param>
+/// <param name="desc">結果</param>
+/// <param name="error">失敗したときの理由</param>
+/// <returns>読み込めたらtrue</returns>
+bool LoadScenario(const char* path, ScenarioDesc& desc, std::string& error) {
+	std::ifstream file(path);
+	if (!file) {
+		error = std::string("cannot open ") + path;
+		return false;
+	}
+	desc = ScenarioDesc();
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line)) {
+		++lineNumber;
+		line = line.substr(0, line.find('#'));
+		std::istringstream stream(line);
+		std::string key;
+		if (!(stream >> key)) { continue; }
+		bool isValid = true;
+		auto readVector = [&stream, &isValid](Vector3& v) { isValid = isValid && bool(stream >> v.x >> v.y >> v.z); };
+
+		if (key == "name") {
+			isValid = bool(stream >> desc.name);
+		} else if (key == "frames") {
+			isValid = bool(stream >> desc.frameCount);
+		} else if (key == "warmup") {
+			isValid = bool(stream >> desc.warmupFrameCount);
+		} else if (key == "seed") {
+			isValid = bool(stream >> desc.seed);
+		} else if (key == "timestep") {
+			isValid = bool(stream >> desc.timestep) && desc.timestep > 0.0f;
+		} else if (key == "viewport") {
+			isValid = bool(stream >> desc.viewportWidth >> desc.viewportHeight) && desc.viewportWidth > 0 && desc.viewportHeight > 0;
+		} else if (key == "simplify") {
+			isValid = bool(stream >> desc.simplifyTolerance);
+		} else if (key == "paircache") {
+			std::string value;
+			isValid = bool(stream >> value) && (value == "on" || value == "off");
+			desc.usePairCache = value == "on";
+		} else if (key == "camera") {
+			std::string field;
+			while (isValid && stream >> field) {
+				if (field == "rotate") {
+					readVector(desc.camera.rotate);
+				} else if (field == "translate") {
+					readVector(desc.camera.translate);
+				} else {
+					isValid = false;
+				}
+			}
+		} else {
+			// 図形の置き方
+			ScenarioGroup* group = nullptr;
+			if (key == "pendulum") {
+				group = &desc.pendulums;
+			}
+			for (uint32_t kind = 0; kind < uint32_t(ScenarioShapeKind::Count); ++kind) {
+				if (key == kScenarioShapeNames[kind]) { group = &desc.groups[kind]; }
+			}
+			if (!group) {
+				error = std::string(path) + ":" + std::to_string(lineNumber) + ": unknown key '" + key + "'";
+				return false;
+			}
+			std::string field;
+			while (isValid && stream >> field) {
+				if (field == "count") {
+					isValid = bool(stream >> group->count);
+				} else if (field == "uniform" || field == "normal") {
+					group->isNormal = field == "normal";
+					readVector(group->first);
+					readVector(group->second);
+				} else if (field == "size") {
+					isValid = bool(stream >> group->minSize >> group->maxSize) && group->minSize <= group->maxSize;
+				} else if (field == "speed") {
+					isValid = bool(stream >> group->speed);
+				} else {
+					isValid = false;
+				}
+			}
+		}
+		if (!isValid) {
+			error = std::string(path) + ":" + std::to_string(lineNumber) + ": invalid '" + key + "' line";
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// 乱数(標準ライブラリの分布は実装ごとに結果が違うので、値の作り方は自前で決める)
+/// </summary>
+class ScenarioRandom {
+public:
+	explicit ScenarioRandom(uint32_t seed) : engine_(seed) {}
+
+	// [0, 1)
+	float Next() { return float(engine_() >> 8) * (1.0f / 16777216.0f); }
+
+	float Range(float min, float max) { return min + (max - min) * Next(); }
+
+	// 標準正規分布(Box-Muller)
+	float Normal() {
+		float u = 1.0f - Next();
+		float v = Next();
+		return std::sqrt(-2.0f * std::log(u)) * std::cos(6.28318531f * v);
+	}
+
+	// 単位球面上の一様な向き
+	Vector3 Direction() {
+		float z = Range(-1.0f, 1.0f);
+		float angle = Range(0.0f, 6.28318531f);
+		float radius = std::sqrt((std::max)(1.0f - z * z, 0.0f));
+		return { radius * std::cos(angle), radius * std::sin(angle), z };
+	}
+
+	// 置き方に従った位置
+	Vector3 Position(const ScenarioGroup& group) {
+		if (group.isNormal) {
+			return {
+				group.first.x + group.second.x * Normal(),
+				group.first.y + group.second.y * Normal(),
+				group.first.z + group.second.z * Normal() };
+		}
+		return {
+			Range(group.first.x, group.second.x),
+			Range(group.first.y, group.second.y),
+			Range(group.first.z, group.second.z) };
+	}
+
+private:
+	std::mt19937 engine_;
+};
+
+/// <summary>
+/// 描画なしで動かすシーン
+/// 1フレームは Update(動かす)、Collide(ブロードフェーズとナローフェーズ)、BuildDrawList(線分を作る)の順に呼ぶ
+/// </summary>
+class ScenarioScene {
+public:
+	/// <param name="desc">シナリオ</param>
+	/// <param name="threadPool">使うスレッドプール(nullptrなら共有のもの)</param>
+	explicit ScenarioScene(const ScenarioDesc& desc, ThreadPool* threadPool = nullptr)
+		: desc_(desc), narrowPhase_(threadPool) {
+		ScenarioRandom random(desc.seed);
+		for (uint32_t kind = 0; kind < uint32_t(ScenarioShapeKind::Count); ++kind) {
+			const ScenarioGroup& group = desc.groups[kind];
+			for (uint32_t i = 0; i < group.count; ++i) {
+				Vector3 center = random.Position(group);
+				float size = random.Range(group.minSize, group.maxSize);
+				uint32_t localIndex = 0;
+				switch (ScenarioShapeKind(kind)) {
+				case ScenarioShapeKind::OBBKind: {
+					OBB obb;
+					obb.center = center;
+					// ランダムな回転の行ベクトルを軸にする
+					Matrix4x4 rotate = Multiply(Multiply(MakeRotateXMatrix(random.Range(0.0f, 6.28f)),
+						MakeRotateYMatrix(random.Range(0.0f, 6.28f))), MakeRotateZMatrix(random.Range(0.0f, 6.28f)));
+					for (int axis = 0; axis < 3; ++axis) {
+						obb.orientations[axis] = { rotate.m[axis][0], rotate.m[axis][1], rotate.m[axis][2] };
+					}
+					obb.size = { size * random.Range(0.5f, 1.0f), size * random.Range(0.5f, 1.0f), size * random.Range(0.5f, 1.0f) };
+					localIndex = uint32_t(obbs_.size());
+					obbs_.push_back(obb);
+					break;
+				}
+				case ScenarioShapeKind::AABBKind: {
+					Vector3 halfSize = { size * random.Range(0.5f, 1.0f), size * random.Range(0.5f, 1.0f), size * random.Range(0.5f, 1.0f) };
+					localIndex = uint32_t(aabbs_.size());
+					aabbs_.push_back({ center - halfSize, center + halfSize });
+					break;
+				}
+				case ScenarioShapeKind::TriangleKind: {
+					Triangle triangle;
+					for (Vector3& vertex : triangle.vertices) {
+						vertex = center + random.Direction() * size;
+					}
+					localIndex = uint32_t(triangles_.size());
+					triangles_.push_back(triangle);
+					break;
+				}
+				default: {
+					localIndex = uint32_t(spheres_.size());
+					spheres_.push_back({ center, size });
+					break;
+				}
+				}
+				kinds_.push_back(ScenarioShapeKind(kind));
+				localIndices_.push_back(localIndex);
+				// 三角形は動かさない
+				float speed = ScenarioShapeKind(kind) == ScenarioShapeKind::TriangleKind ? 0.0f : random.Range(0.0f, group.speed);
+				velocities_.push_back(random.Direction() * speed);
+				moveBounds_.push_back(GetMoveBounds(group));
+			}
+		}
+		for (uint32_t i = 0; i < desc.pendulums.count; ++i) {
+			Pendulum pendulum;
+			pendulum.anchor = random.Position(desc.pendulums);
+			pendulum.length = random.Range(desc.pendulums.minSize, desc.pendulums.maxSize);
+			pendulum.direction = random.Range(0.0f, 6.28318531f);
+			pendulum.angle = random.Range(-1.2f, 1.2f);
+			pendulum.angularVelocity = 0.0f;
+			pendulums_.push_back(pendulum);
+		}
+		viewProjectionMatrix_ = MakeViewProjectionMatrix(desc.camera, float(desc.viewportWidth) / float(desc.viewportHeight));
+		viewportMatrix_ = MakeViewportMatrix(0.0f, 0.0f, float(desc.viewportWidth), float(desc.viewportHeight), 0.0f, 1.0f);
+	}
+
+	/// <summary>
+	/// 図形と振り子を1フレーム分動かす(図形は置いた範囲の端で跳ね返る)
+	/// </summary>
+	void Update() {
+		MT3_PERF_SCOPE("Scenario::Update", kinds_.size() + pendulums_.size());
+		const float deltaTime = desc_.timestep;
+		for (size_t i = 0; i < kinds_.size(); ++i) {
+			Vector3& velocity = velocities_[i];
+			if (velocity.x == 0.0f && velocity.y == 0.0f && velocity.z == 0.0f) { continue; }
+			Vector3 center = GetCenter(i);
+			Vector3 next = center + velocity * deltaTime;
+			const AABB& bounds = moveBounds_[i];
+			if (next.x < bounds.min.x || next.x > bounds.max.x) { velocity.x = -velocity.x; }
+			if (next.y < bounds.min.y || next.y > bounds.max.y) { velocity.y = -velocity.y; }
+			if (next.z < bounds.min.z || next.z > bounds.max.z) { velocity.z = -velocity.z; }
+			Translate(i, velocity * deltaTime);
+		}
+		for (Pendulum& pendulum : pendulums_) {
+			const float gravityOverLength = 9.8f / pendulum.length;
+			Integrate(Integrator::RungeKutta4, pendulum.angle, pendulum.angularVelocity, deltaTime,
+				[gravityOverLength](float angle, float) { return -gravityOverLength * std::sin(angle); });
+		}
+	}
+
+	/// <summary>
+	/// x軸のソートとスイープで候補ペアを集め、ナローフェーズで接触を求める
+	/// 動かない図形同士(三角形同士)は調べない
+	/// </summary>
+	/// <returns>接触の数</returns>
+	size_t Collide() {
+		MT3_PROFILE_SCOPE("Scenario::Collide");
+		const size_t shapeCount = kinds_.size();
+		FrameVector<AABB> bounds(shapeCount);
+		FrameVector<uint32_t> order(shapeCount);
+		for (size_t i = 0; i < shapeCount; ++i) {
+			bounds[i] = GetBounds(i);
+			order[i] = uint32_t(i);
+		}
+		std::sort(order.begin(), order.end(), [&bounds](uint32_t l, uint32_t r) { return bounds[l].min.x < bounds[r].min.x; });
+		FrameVector<CollisionPair> pairs;
+		{
+			MT3_PERF_SCOPE("Scenario::BroadPhase", shapeCount);
+			for (size_t i = 0; i < shapeCount; ++i) {
+				uint32_t a = order[i];
+				for (size_t j = i + 1; j < shapeCount && bounds[order[j]].min.x <= bounds[a].max.x; ++j) {
+					uint32_t b = order[j];
+					if (kinds_[a] == ScenarioShapeKind::TriangleKind && kinds_[b] == ScenarioShapeKind::TriangleKind) { continue; }
+					if (!Overlaps(bounds[a], bounds[b])) { continue; }
+					// GetContact がある引数の順にそろえる
+					if (kinds_[b] < kinds_[a] || (kinds_[b] == kinds_[a] && b < a)) {
+						pairs.push_back({ b, a });
+					} else {
+						pairs.push_back({ a, b });
+					}
+				}
+			}
+		}
+		if (desc_.usePairCache) {
+			pairCache_.Prepare(pairs.data(), pairs.size());
+		}
+		const std::vector<PairResult<Contact>>& contacts = narrowPhase_.Run(pairs.data(), pairs.size(), [this](const CollisionPair& pair, Contact& contact) {
+			contact = desc_.usePairCache ? GetCachedContact(pair.a, pair.b, pairCache_.Find(pair)) : GetContact(pair.a, pair.b);
+			return contact.hit;
+		});
+		candidatePairCount_ = pairs.size();
+		return contacts.size();
+	}
+
+	/// <summary>
+	/// 全ての図形と振り子の線分を作る(画面外を除き、Simplify まで行う)
+	/// </summary>
+	/// <param name="lineList">線分の追加先</param>
+	void BuildDrawList(LineList& lineList) {
+		MT3_PROFILE_SCOPE("Scenario::BuildDrawList");
+		const Matrix4x4& vp = viewProjectionMatrix_;
+		const Matrix4x4& viewport = viewportMatrix_;
+		DrawGrid(lineList, vp, viewport);
+		for (const Sphere& sphere : spheres_) { DrawSphere(lineList, sphere, vp, viewport, 0xFFFFFFFF); }
+		for (const AABB& aabb : aabbs_) { DrawAABB(lineList, aabb, vp, viewport, 0x00FF00FF); }
+		for (const OBB& obb : obbs_) { DrawOBB(lineList, obb, vp, viewport, 0x0000FFFF); }
+		for (const Triangle& triangle : triangles_) { DrawTriangle(lineList, triangle, vp, viewport, 0xFFFF00FF); }
+		Matrix4x4 screenTransformMatrix = Multiply(vp, viewport);
+		for (const Pendulum& pendulum : pendulums_) {
+			float angleSin, angleCos;
+			SinCos(pendulum.angle, angleSin, angleCos);
+			Vector3 swing = { std::cos(pendulum.direction) * angleSin, -angleCos, std::sin(pendulum.direction) * angleSin };
+			Vector3 anchorScreen = TransformVector(pendulum.anchor, screenTransformMatrix);
+			Vector3 bobScreen = TransformVector(pendulum.anchor + swing * pendulum.length, screenTransformMatrix);
+			lineList.Add(anchorScreen.x, anchorScreen.y, bobScreen.x, bobScreen.y, 0xFFFFFFFF);
+		}
+		lineList.CullOutside(float(desc_.viewportWidth), float(desc_.viewportHeight));
+		if (desc_.simplifyTolerance >= 0.0f) {
+			lineList.Simplify(desc_.simplifyTolerance);
+		}
+	}
+
+	// 種類ごとの図形の数
+	size_t GetShapeCount(ScenarioShapeKind kind) const {
+		switch (kind) {
+		case ScenarioShapeKind::OBBKind: return obbs_.size();
+		case ScenarioShapeKind::AABBKind: return aabbs_.size();
+		case ScenarioShapeKind::TriangleKind: return triangles_.size();
+		default: return spheres_.size();
+		}
+	}
+	size_t GetPendulumCount() const { return pendulums_.size(); }
+	// 直前の Collide で調べた候補ペアの数
+	size_t GetCandidatePairCount() const { return candidatePairCount_; }
+	// 直前の Collide で当たったペアと接触(ペア番号の順)
+	const std::vector<PairResult<Contact>>& GetContacts() const { return narrowPhase_.GetResults(); }
+	// 直前の Collide で前フレームの分離軸だけで済んだペアの数
+	size_t GetPairCacheHitCount() const { return desc_.usePairCache ? pairCache_.GetCacheHitCount() : 0; }
+
+private:
+	struct Pendulum {
+		Vector3 anchor;
+		float length;
+		float direction;		// 揺れる向き(水平面の角度)
+		float angle;			// 鉛直からの角度
+		float angularVelocity;
+	};
+
+	static bool Overlaps(const AABB& a, const AABB& b) {
+		return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+			a.min.y <= b.max.y && b.min.y <= a.max.y &&
+			a.min.z <= b.max.z && b.min.z <= a.max.z;
+	}
+
+	// 動ける範囲(一様分布なら置いた範囲、正規分布なら平均から標準偏差の3倍)
+	static AABB GetMoveBounds(const ScenarioGroup& group) {
+		if (group.isNormal) {
+			return { group.first - group.second * 3.0f, group.first + group.second * 3.0f };
+		}
+		return { group.first, group.second };
+	}
+
+	// 種類に応じた図形を渡して呼ぶ
+	template<typename Function>
+	auto Visit(size_t index, const Function& function) const {
+		uint32_t local = localIndices_[index];
+		switch (kinds_[index]) {
+		case ScenarioShapeKind::OBBKind: return function(obbs_[local]);
+		case ScenarioShapeKind::AABBKind: return function(aabbs_[local]);
+		case ScenarioShapeKind::TriangleKind: return function(triangles_[local]);
+		default: return function(spheres_[local]);
+		}
+	}
+
+	// 図形の組の GetContact(逆の順番の関数しか無ければ入れ替えて呼び、法線を反転する)
+	// 種類の順にそろえて呼ぶので入れ替えは実際には通らないが、Visit は全ての組を作るので必要
+	template<typename ShapeA, typename ShapeB>
+	static Contact GetShapeContact(const ShapeA& shapeA, const ShapeB& shapeB) {
+		if constexpr (requires { ::GetContact(shapeA, shapeB); }) {
+			return ::GetContact(shapeA, shapeB);
+		} else {
+			static_assert(requires { ::GetContact(shapeB, shapeA); }, "GetContact is missing for this shape pair");
+			Contact contact = ::GetContact(shapeB, shapeA);
+			contact.normal = -contact.normal;
+			return contact;
+		}
+	}
+
+	// GetShapeContact の PairCache 版
+	template<typename ShapeA, typename ShapeB>
+	static Contact GetShapeCachedContact(const ShapeA& shapeA, const ShapeB& shapeB, PairCacheEntry& entry) {
+		if constexpr (requires { ::GetCachedContact(shapeA, shapeB, entry); }) {
+			return ::GetCachedContact(shapeA, shapeB, entry);
+		} else {
+			static_assert(requires { ::GetCachedContact(shapeB, shapeA, entry); }, "GetCachedContact is missing for this shape pair");
+			Contact contact = ::GetCachedContact(shapeB, shapeA, entry);
+			contact.normal = -contact.normal;
+			return contact;
+		}
+	}
+
+	Contact GetContact(uint32_t a, uint32_t b) const {
+		return Visit(a, [this, b](const auto& shapeA) {
+			return Visit(b, [&shapeA](const auto& shapeB) { return GetShapeContact(shapeA, shapeB); });
+		});
+	}
+
+	Contact GetCachedContact(uint32_t a, uint32_t b, PairCacheEntry& entry) const {
+		return Visit(a, [this, b, &entry](const auto& shapeA) {
+			return Visit(b, [&shapeA, &entry](const auto& shapeB) { return GetShapeCachedContact(shapeA, shapeB, entry); });
+		});
+	}
+
+	AABB GetBounds(size_t index) const {
+		uint32_t local = localIndices_[index];
+		switch (kinds_[index]) {
+		case ScenarioShapeKind::OBBKind: {
+			const OBB& obb = obbs_[local];
+			Vector3 extent = { 0.0f, 0.0f, 0.0f };
+			for (int axis = 0; axis < 3; ++axis) {
+				const float size = axis == 0 ? obb.size.x : (axis == 1 ? obb.size.y : obb.size.z);
+				extent.x += std::abs(obb.orientations[axis].x) * size;
+				extent.y += std::abs(obb.orientations[axis].y) * size;
+				extent.z += std::abs(obb.orientations[axis].z) * size;
+			}
+			return { obb.center - extent, obb.center + extent };
+		}
+		case ScenarioShapeKind::AABBKind:
+			return aabbs_[local];
+		case ScenarioShapeKind::TriangleKind: {
+			const Triangle& triangle = triangles_[local];
+			AABB bounds = { triangle.vertices[0], triangle.vertices[0] };
+			for (const Vector3& vertex : triangle.vertices) {
+				bounds.min = { (std::min)(bounds.min.x, vertex.x), (std::min)(bounds.min.y, vertex.y), (std::min)(bounds.min.z, vertex.z) };
+				bounds.max = { (std::max)(bounds.max.x, vertex.x), (std::max)(bounds.max.y, vertex.y), (std::max)(bounds.max.z, vertex.z) };
+			}
+			return bounds;
+		}
+		default: {
+			const Sphere& sphere = spheres_[local];
+			Vector3 extent = { sphere.radius, sphere.radius, sphere.radius };
+			return { sphere.center - extent, sphere.center + extent };
+		}
+		}
+	}
+
+	Vector3 GetCenter(size_t index) const {
+		AABB bounds = GetBounds(index);
+		return (bounds.min + bounds.max) * 0.5f;
+	}
+
+	void Translate(size_t index, const Vector3& offset) {
+		uint32_t local = localIndices_[index];
+		switch (kinds_[index]) {
+		case ScenarioShapeKind::OBBKind: obbs_[local].center = obbs_[local].center + offset; break;
+		case ScenarioShapeKind::AABBKind: aabbs_[local] = { aabbs_[local].min + offset, aabbs_[local].max + offset }; break;
+		case ScenarioShapeKind::TriangleKind: break;
+		default: spheres_[local].center = spheres_[local].center + offset; break;
+		}
+	}
+
+	ScenarioDesc desc_;
+	Matrix4x4 viewProjectionMatrix_;
+	Matrix4x4 viewportMatrix_;
+	std::vector<Sphere> spheres_;
+	std::vector<AABB> aabbs_;
+	std::vector<OBB> obbs_;
+	std::vector<Triangle> triangles_;
+	std::vector<Pendulum> pendulums_;
+	// 全図形の通し番号ごと
+	std::vector<ScenarioShapeKind> kinds_;
+	std::vector<uint32_t> localIndices_;
+	std::vector<Vector3> velocities_;
+	std::vector<AABB> moveBounds_;
+	NarrowPhase<Contact> narrowPhase_;
+	PairCache pairCache_;
+	size_t candidatePairCount_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,798 @@
+#include "FastMath.h"
+#include "LaneCollision.h"
+#include "PerfCounters.h"
+#include "RigidBody.h"
+#include "Scenario.h"
+#include "SoftwareRasterizer.h"
+#include "VerletSolver.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// 描画なしでシナリオを動かし、フェーズごとの時間を JSON で書き出すベンチマーク
+// 使い方: ScenarioRunner [--threads N] [--frames N] [--output path] [--counters] [--kernels] [--raster] [--png prefix] scenario...
+// --counters: ハードウェアカウンタ(PerfCounters.h)で区間ごとの IPC やキャッシュミスも書き出す
+// --raster: 描画先を TileRasterizer にして、実際に線分を画素へ描く時間と画素のチェックサムを書き出す
+// --png: --raster の最後のフレームを prefix + シナリオ名 + ".png" に書き出す
+// --kernels: 数学と衝突判定の関数を単体で回した結果も書き出す
+//            近似計算の誤差が FastMath.h の範囲を超えるか、GJK/EPA が分離軸の総当たりと食い違うか、
+//            PairCache あり・なしで接触が変わるか、箱の積み重ねが崩れる・眠らないか、
+//            ロープと布の粒子が有限でなくなれば失敗で終わる(ロープと布は1ミリ秒あたりの粒子数も書く)
+
+// 計測するフェーズ
+enum class ScenarioPhase {
+	Update,		// 図形と振り子を動かす
+	Collide,	// ブロードフェーズとナローフェーズ
+	Draw,		// 線分を作る(画面外を除く・Simplify を含む)
+	Submit,		// 描画先へ渡す(NullLineBackend か RasterLineBackend)
+	Frame,		// 1フレーム全体
+	Count,
+};
+
+static const char* const kScenarioPhaseNames[] = { "update", "collide", "draw", "submit", "frame" };
+
+/// <summary>
+/// 何も描かない描画先(線分を数え、結果が同じかを比べられるよう座標のチェックサムを取る)
+/// </summary>
+struct NullLineBackend {
+	static constexpr const char* kName = "null";
+	uint64_t lineCount = 0;
+	uint64_t checksum = 14695981039346656037ull;
+
+	void Submit(const LineList& lineList) {
+		for (const ScreenLine& line : lineList.lines) {
+			const int32_t values[5] = { int32_t(line.x0), int32_t(line.y0), int32_t(line.x1), int32_t(line.y1), int32_t(line.color) };
+			for (int32_t value : values) {
+				checksum = (checksum ^ uint32_t(value)) * 1099511628211ull;
+			}
+		}
+		lineCount += lineList.lines.size();
+	}
+};
+
+/// <summary>
+/// CPU のタイルラスタライザで線分を描く描画先(毎フレーム描き直し、画素のチェックサムを取る)
+/// 線分の数だけでなく長さや重なりにかかる時間も測れる
+/// </summary>
+struct RasterLineBackend {
+	static constexpr const char* kName = "raster";
+	TileRasterizer rasterizer;
+	uint64_t lineCount = 0;
+	uint64_t checksum = 14695981039346656037ull;
+
+	RasterLineBackend(uint32_t width, uint32_t height, ThreadPool* threadPool)
+		: rasterizer(width, height, 64, threadPool) {}
+
+	void Submit(const LineList& lineList) {
+		rasterizer.Clear();
+		rasterizer.Rasterize(lineList);
+		for (uint32_t pixel : rasterizer.GetPixels()) {
+			checksum = (checksum ^ pixel) * 1099511628211ull;
+		}
+		lineCount += lineList.lines.size();
+	}
+};
+
+/// <summary>
+/// プロセスの最大の使用メモリ(バイト、取れなければ0)
+/// </summary>
+uint64_t GetPeakMemoryBytes() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return uint64_t(counters.PeakWorkingSetSize);
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#if defined(__APPLE__)
+	return uint64_t(usage.ru_maxrss);
+#else
+	return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/// <summary>
+/// 並べ替えた値の百分位数(最も近い順位)
+/// </summary>
+/// <param name="sorted">昇順の値</param>
+/// <param name="percent">0~100</param>
+double GetPercentile(const std::vector<double>& sorted, double percent) {
+	if (sorted.empty()) { return 0.0; }
+	size_t rank = size_t(std::ceil(percent / 100.0 * double(sorted.size())));
+	return sorted[(std::min)((std::max)(rank, size_t(1)), sorted.size()) - 1];
+}
+
+// JSON の文字列(" と \ と制御文字を逃がす)
+std::string ToJsonString(const std::string& text) {
+	std::string result = "\"";
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			char escaped[8];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			result += escaped;
+		} else {
+			result += c;
+		}
+	}
+	return result + "\"";
+}
+
+/// <summary>
+/// カウンタの状態を JSON のオブジェクトとして書く
+/// </summary>
+void WritePerfCounterStatus(std::ostream& out) {
+	const PerfCounterGroup& group = GetThreadPerfCounters();
+	out << "{\"enabled\": " << (IsPerfCountersEnabled() ? "true" : "false")
+		<< ", \"available\": " << (group.IsAvailable() ? "true" : "false") << ", \"counters\": [";
+	bool isFirst = true;
+	for (uint32_t counter = 0; counter < kPerfCounterCount; ++counter) {
+		if (!(group.GetOpenMask() & (1u << counter))) { continue; }
+		out << (isFirst ? "\"" : ", \"") << kPerfCounterNames[counter] << "\"";
+		isFirst = false;
+	}
+	out << "], \"status\": " << ToJsonString(group.GetStatus()) << "}";
+}
+
+/// <summary>
+/// 区間ごとのカウンタを JSON の配列として書く
+/// 読めなかったカウンタは書かない(時間と要素あたりの時間は常に書く)
+/// </summary>
+/// <param name="stats">GetPerfScopeStats() の結果</param>
+/// <param name="out">書き出し先</param>
+void WritePerfScopeStats(const std::vector<PerfScopeStat>& stats, std::ostream& out) {
+	char buffer[256];
+	out << "[";
+	bool isFirst = true;
+	for (const PerfScopeStat& stat : stats) {
+		out << (isFirst ? "\n      " : ",\n      ");
+		isFirst = false;
+		std::snprintf(buffer, sizeof(buffer), "{\"name\": %s, \"calls\": %llu, \"elements\": %llu, \"ms\": %.4f, \"nsPerElement\": %.3f",
+			ToJsonString(stat.name).c_str(), static_cast<unsigned long long>(stat.callCount), static_cast<unsigned long long>(stat.elementCount),
+			stat.milliseconds, stat.GetNanosecondsPerElement());
+		out << buffer;
+		if (stat.HasCounter(PerfCounter::Cycles) && stat.HasCounter(PerfCounter::Instructions)) {
+			std::snprintf(buffer, sizeof(buffer), ", \"ipc\": %.3f", stat.GetInstructionsPerCycle());
+			out << buffer;
+		}
+		for (uint32_t counter = 0; counter < kPerfCounterCount; ++counter) {
+			if (!stat.HasCounter(PerfCounter(counter))) { continue; }
+			std::snprintf(buffer, sizeof(buffer), ", \"%s\": %llu, \"%sPerElement\": %.4f", kPerfCounterNames[counter],
+				static_cast<unsigned long long>(stat.values[counter]), kPerfCounterNames[counter], stat.GetPerElement(PerfCounter(counter)));
+			out << buffer;
+		}
+		out << "}";
+	}
+	out << (isFirst ? "]" : "\n    ]");
+}
+
+static const uint32_t kGjkSatStepCount = 16;		// GJK と分離軸を比べるときに組を近づける段数
+static const float kGjkSatTolerance = 1.0e-4f;		// これより境界に近い組は比べない(どちらの判定も誤差で変わる)
+
+// GJK/EPA と分離軸の総当たりが食い違った数
+struct GjkSatReport {
+	uint32_t pairCount;			// 比べた組の数
+	uint32_t hitMismatches;		// 当たったかどうかが違った
+	uint32_t depthMismatches;	// めり込み量が違った(GJK の距離が分離軸の隙間より小さい場合も含む)
+	float maxDepthError;		// めり込み量の差の最大
+};
+
+/// <summary>
+/// 隣り合う OBB を少しずつ近づけながら GJK/EPA(キャッシュあり・なし)と GetSeparationSat で調べて比べる
+/// キャッシュは組ごとに持ち続けるので、前回の単体から始める場合も確かめられる
+/// </summary>
+/// <param name="obbs">OBB の配列</param>
+GjkSatReport CheckGjkAgainstSat(const std::vector<OBB>& obbs) {
+	GjkSatReport report = {};
+	std::vector<GjkCache> caches(obbs.size());
+	for (uint32_t step = 0; step < kGjkSatStepCount; ++step) {
+		float t = float(step) / float(kGjkSatStepCount - 1);
+		for (size_t i = 0; i < obbs.size(); ++i) {
+			const OBB& a = obbs[i];
+			OBB b = obbs[(i + 1) % obbs.size()];
+			b.center = Lerp(b.center, a.center, t);
+			float separation = GetSeparationSat(a, b);
+			if (std::fabs(separation) <= kGjkSatTolerance) { continue; }
+			++report.pairCount;
+
+			bool isSatHit = separation < 0.0f;
+			bool isCachedHit = GjkIntersect(a, b, &caches[i]);
+			Contact contact = GetContact(a, b);
+			if (isCachedHit != isSatHit || contact.hit != isSatHit) {
+				++report.hitMismatches;
+				continue;
+			}
+			if (isSatHit) {
+				// 凸多面体同士なら最小の押し出し量は15軸のどれかに沿う
+				float depthError = std::fabs(contact.penetration + separation);
+				report.maxDepthError = (std::max)(report.maxDepthError, depthError);
+				if (depthError > kGjkSatTolerance * 10.0f * (1.0f - separation)) { ++report.depthMismatches; }
+			} else if (GjkDistance(a, b) < separation - kGjkSatTolerance) {
+				// 分離軸の隙間は距離の下限
+				++report.depthMismatches;
+			}
+		}
+	}
+	return report;
+}
+
+static const uint32_t kPairCacheCheckFrameCount = 120;	// PairCache あり・なしを比べるフレーム数
+
+// PairCache あり・なしで動かした結果
+struct PairCacheReport {
+	uint32_t frameCount;		// 比べたフレーム数
+	uint64_t contactCount;		// キャッシュなしの接触の合計
+	uint64_t cacheHitCount;		// 分離軸だけで済んだペアの合計
+	uint32_t mismatchFrames;	// 当たったペアか接触の値が1つでも違ったフレームの数
+	double cachedMilliseconds;	// Collide の時間の合計(キャッシュあり)
+	double directMilliseconds;	// Collide の時間の合計(キャッシュなし)
+};
+
+/// <summary>
+/// 同じシーンを PairCache あり・なしで並べて動かし、毎フレームの接触が値まで同じかを調べる
+/// 分離軸で離れていると言えるペアは GetContact でも当たらないはずなので、1つでも違えば誤り
+/// </summary>
+/// <param name="desc">シナリオ(usePairCache は無視する)</param>
+PairCacheReport CheckPairCache(const ScenarioDesc& desc) {
+	using Clock = std::chrono::steady_clock;
+	ScenarioDesc cachedDesc = desc;
+	cachedDesc.usePairCache = true;
+	ScenarioDesc directDesc = desc;
+	directDesc.usePairCache = false;
+	ScenarioScene cachedScene(cachedDesc);
+	ScenarioScene directScene(directDesc);
+	PairCacheReport report = {};
+	report.frameCount = kPairCacheCheckFrameCount;
+	for (uint32_t frame = 0; frame < kPairCacheCheckFrameCount; ++frame) {
+		cachedScene.Update();
+		directScene.Update();
+		Clock::time_point start = Clock::now();
+		cachedScene.Collide();
+		Clock::time_point middle = Clock::now();
+		directScene.Collide();
+		Clock::time_point end = Clock::now();
+		report.cachedMilliseconds += std::chrono::duration<double, std::milli>(middle - start).count();
+		report.directMilliseconds += std::chrono::duration<double, std::milli>(end - middle).count();
+
+		const std::vector<PairResult<Contact>>& cached = cachedScene.GetContacts();
+		const std::vector<PairResult<Contact>>& direct = directScene.GetContacts();
+		report.contactCount += direct.size();
+		report.cacheHitCount += cachedScene.GetPairCacheHitCount();
+		bool isSame = cached.size() == direct.size();
+		for (size_t i = 0; isSame && i < direct.size(); ++i) {
+			const Contact& a = cached[i].result;
+			const Contact& b = direct[i].result;
+			isSame = cached[i].pairId == direct[i].pairId && a.hit == b.hit && a.t == b.t && a.penetration == b.penetration &&
+				a.point.x == b.point.x && a.point.y == b.point.y && a.point.z == b.point.z &&
+				a.normal.x == b.normal.x && a.normal.y == b.normal.y && a.normal.z == b.normal.z;
+		}
+		if (!isSame) { ++report.mismatchFrames; }
+	}
+	return report;
+}
+
+static const uint32_t kBoxStackHeights[] = { 8, 10 };	// 確かめる積み重ねの段数
+static const float kBoxStackSeconds = 20.0f;			// 動かす時間
+static const float kBoxStackMaxDrift = 0.1f;			// 一番上の箱が横にずれてよい距離
+static const float kBoxStackMaxHeightError = 0.02f;		// 各段の高さの誤差の上限(浮き・沈み)
+
+// 箱を積み重ねて動かした結果
+struct BoxStackReport {
+	uint32_t height;			// 段数
+	float sleepSeconds;			// 全て眠った時刻(眠らなければ負)
+	float topDrift;				// 一番上の箱の横のずれ
+	float maxHeightError;		// 各段の高さの誤差の最大
+};
+
+/// <summary>
+/// 1辺1の箱を床の上にまっすぐ積み、60Hz で動かして崩れずに眠るかを調べる
+/// </summary>
+/// <param name="height">段数</param>
+BoxStackReport CheckBoxStack(uint32_t height) {
+	const float deltaTime = 1.0f / 60.0f;
+	PhysicsWorld world;
+	world.AddPlane({ { 0.0f, 1.0f, 0.0f }, 0.0f });
+	std::vector<uint32_t> bodies;
+	for (uint32_t i = 0; i < height; ++i) {
+		OBB box;
+		box.center = { 0.0f, 0.5f + float(i), 0.0f };
+		box.orientations[0] = { 1.0f, 0.0f, 0.0f };
+		box.orientations[1] = { 0.0f, 1.0f, 0.0f };
+		box.orientations[2] = { 0.0f, 0.0f, 1.0f };
+		box.size = { 0.5f, 0.5f, 0.5f };
+		bodies.push_back(world.AddBody(MakeBoxBody(box, 1.0f)));
+	}
+
+	BoxStackReport report = {};
+	report.height = height;
+	report.sleepSeconds = -1.0f;
+	const uint32_t stepCount = uint32_t(kBoxStackSeconds / deltaTime);
+	for (uint32_t step = 0; step < stepCount; ++step) {
+		world.Step(deltaTime);
+		if (world.GetAwakeBodyCount() == 0) {
+			if (report.sleepSeconds < 0.0f) { report.sleepSeconds = float(step + 1) * deltaTime; }
+		} else {
+			report.sleepSeconds = -1.0f;
+		}
+	}
+	const Vector3& top = world.GetBody(bodies.back()).position;
+	report.topDrift = std::sqrt(top.x * top.x + top.z * top.z);
+	for (uint32_t i = 0; i < height; ++i) {
+		float error = std::fabs(world.GetBody(bodies[i]).position.y - (0.5f + float(i)));
+		report.maxHeightError = (std::max)(report.maxHeightError, error);
+	}
+	return report;
+}
+
+static const uint32_t kVerletClothSize = 128;		// 布の1辺の粒子数
+static const uint32_t kVerletRopeCount = 64;		// ロープの本数
+static const uint32_t kVerletRopeSegments = 64;		// ロープ1本の分割数
+static const uint32_t kVerletStepCount = 120;		// 動かすステップ数
+
+// ロープと布を動かした結果
+struct VerletReport {
+	uint32_t particleCount;		// 粒子の数
+	uint32_t constraintCount;	// 拘束の数
+	uint32_t colorCount;		// 拘束の色の数
+	uint32_t stepCount;			// 動かしたステップ数
+	double particlesPerMillisecond;	// 1ミリ秒あたりに進めた粒子の数(粒子数 x ステップ数 / 時間)
+	bool isFinite;				// 全ての粒子の位置が有限か
+};
+
+/// <summary>
+/// 布とロープ(分割数0のロープ、1列の布も含む)を球と床の上で 60Hz で動かし、速さと結果が有限かを調べる
+/// </summary>
+/// <param name="threadPool">使うスレッドプール</param>
+VerletReport CheckVerlet(ThreadPool& threadPool) {
+	using Clock = std::chrono::steady_clock;
+	VerletSolver solver(&threadPool);
+	solver.CreateCloth({ -4.0f, 6.0f, -4.0f }, { 8.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 8.0f }, kVerletClothSize, kVerletClothSize);
+	for (uint32_t i = 0; i < kVerletRopeCount; ++i) {
+		float x = -4.0f + 8.0f * float(i) / float(kVerletRopeCount);
+		solver.CreateRope({ x, 8.0f, 5.0f }, { x + 1.0f, 4.0f, 5.0f }, kVerletRopeSegments);
+	}
+	// 割り算が0除算にならないか確かめる形
+	solver.CreateRope({ 0.0f, 3.0f, -6.0f }, { 1.0f, 3.0f, -6.0f }, 0, false);
+	solver.CreateCloth({ 0.0f, 3.0f, -7.0f }, { 2.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 2.0f }, 1, 8);
+	solver.CreateCloth({ 0.0f, 3.0f, -8.0f }, { 2.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 2.0f }, 8, 1, false);
+	solver.AddCollider(Sphere{ { 0.0f, 2.0f, 0.0f }, 1.5f });
+	solver.AddCollider(Plane{ { 0.0f, 1.0f, 0.0f }, 0.0f });
+
+	const float deltaTime = 1.0f / 60.0f;
+	solver.Step(deltaTime);	// 色分けは最初の Step で行うので数えない
+	Clock::time_point start = Clock::now();
+	for (uint32_t step = 0; step < kVerletStepCount; ++step) {
+		solver.Step(deltaTime);
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	const VerletParticles& particles = solver.GetParticles();
+	VerletReport report = {};
+	report.particleCount = uint32_t(particles.Size());
+	report.constraintCount = uint32_t(solver.GetConstraints().Size());
+	report.colorCount = solver.GetColorCount();
+	report.stepCount = kVerletStepCount;
+	report.particlesPerMillisecond = milliseconds > 0.0 ? double(particles.Size()) * kVerletStepCount / milliseconds : 0.0;
+	report.isFinite = true;
+	for (size_t i = 0; i < particles.Size(); ++i) {
+		report.isFinite = report.isFinite && std::isfinite(particles.x[i]) && std::isfinite(particles.y[i]) && std::isfinite(particles.z[i]);
+	}
+	return report;
+}
+
+static const size_t kKernelElementCount = 1u << 14;	// 1つのカーネルで処理する要素の数
+static const uint32_t kKernelRepeatCount = 16;		// 繰り返す回数(1回目はキャッシュを温めるため数えない)
+
+/// <summary>
+/// 数学と衝突判定の関数を同じ入力の配列で回し、区間ごとのカウンタを書く
+/// 要素あたりの命令数・IPC・ミスの数を比べて、計算・分岐・メモリのどれが重いかを見る
+/// </summary>
+/// <param name="threadPool">ロープと布に使うスレッドプール</param>
+/// <param name="out">書き出し先</param>
+/// <returns>近似計算の誤差が範囲内で、GJK と分離軸の結果が一致し、PairCache で接触が変わらず、箱の積み重ねが眠り、ロープと布が有限なら true</returns>
+bool RunKernels(ThreadPool& threadPool, std::ostream& out) {
+	ScenarioRandom random(12345);
+	const size_t count = kKernelElementCount;
+	ScenarioGroup box;
+	box.first = { -10.0f, -10.0f, -10.0f };
+	box.second = { 10.0f, 10.0f, 10.0f };
+	std::vector<Matrix4x4> matrices(count);
+	std::vector<Vector3> points(count);
+	std::vector<AABB> aabbs(count);
+	std::vector<Sphere> spheres(count);
+	std::vector<OBB> obbs(count);
+	for (size_t i = 0; i < count; ++i) {
+		Vector3 rotate = { random.Range(-3.14f, 3.14f), random.Range(-3.14f, 3.14f), random.Range(-3.14f, 3.14f) };
+		Vector3 scale = { random.Range(0.5f, 2.0f), random.Range(0.5f, 2.0f), random.Range(0.5f, 2.0f) };
+		matrices[i] = MakeAffineMatrix(scale, rotate, random.Position(box));
+		points[i] = random.Position(box);
+		Vector3 center = random.Position(box);
+		Vector3 halfSize = { random.Range(0.2f, 2.0f), random.Range(0.2f, 2.0f), random.Range(0.2f, 2.0f) };
+		aabbs[i] = { center - halfSize, center + halfSize };
+		spheres[i] = { random.Position(box), random.Range(0.2f, 2.0f) };
+		Matrix4x4 rotateMatrix = MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, rotate, { 0.0f, 0.0f, 0.0f });
+		obbs[i].center = random.Position(box);
+		for (int axis = 0; axis < 3; ++axis) {
+			obbs[i].orientations[axis] = { rotateMatrix.m[axis][0], rotateMatrix.m[axis][1], rotateMatrix.m[axis][2] };
+		}
+		obbs[i].size = halfSize;
+	}
+	std::vector<Matrix4x4> matrixResults(count);
+	std::vector<Vector3> pointResults(count);
+	std::vector<float> radians(count);
+	std::vector<float> sinResults(count);
+	std::vector<float> cosResults(count);
+	for (size_t i = 0; i < count; ++i) {
+		radians[i] = random.Range(-kPi * 4.0f, kPi * 4.0f);
+	}
+	std::vector<uint8_t> hitResults(count);
+	std::unique_ptr<bool[]> batchResults(new bool[count]);
+
+	// 隣り合う要素を組にする(i と i + 1)
+	auto run = [&](const char* name, auto kernel) {
+		for (uint32_t repeat = 0; repeat < kKernelRepeatCount; ++repeat) {
+			if (repeat == 1) { ResetPerfScopeStats(); }
+			PerfCounterScope perfScope(name, count);
+			kernel();
+		}
+		std::vector<PerfScopeStat> stats = GetPerfScopeStats();
+		for (const PerfScopeStat& stat : stats) {
+			if (stat.name == name) { return stat; }
+		}
+		return PerfScopeStat{ name };
+	};
+	const bool wasEnabled = IsPerfCountersEnabled();
+	SetPerfCountersEnabled(true);
+	std::vector<PerfScopeStat> results;
+	results.push_back(run("Multiply", [&] {
+		for (size_t i = 0; i < count; ++i) { matrixResults[i] = Multiply(matrices[i], matrices[(i + 1) % count]); }
+	}));
+	results.push_back(run("Inverse", [&] {
+		for (size_t i = 0; i < count; ++i) { matrixResults[i] = Inverse(matrices[i]); }
+	}));
+	results.push_back(run("TransformVector", [&] {
+		for (size_t i = 0; i < count; ++i) { pointResults[i] = TransformVector(points[i], matrices[i]); }
+	}));
+	results.push_back(run("Normalize", [&] {
+		for (size_t i = 0; i < count; ++i) { pointResults[i] = Normalize(points[i]); }
+	}));
+	results.push_back(run("FastNormalize", [&] {
+		for (size_t i = 0; i < count; ++i) { pointResults[i] = FastNormalize(points[i]); }
+	}));
+	results.push_back(run("SinCos", [&] {
+		for (size_t i = 0; i < count; ++i) { SinCos(radians[i], sinResults[i], cosResults[i]); }
+	}));
+	results.push_back(run("SinCosArray", [&] {
+		SinCosArray(radians.data(), count, sinResults.data(), cosResults.data());
+	}));
+	results.push_back(run("GetContact(AABB,AABB)", [&] {
+		for (size_t i = 0; i < count; ++i) { hitResults[i] = GetContact(aabbs[i], aabbs[(i + 1) % count]).hit; }
+	}));
+	results.push_back(run("GetContact(AABB,Sphere)", [&] {
+		for (size_t i = 0; i < count; ++i) { hitResults[i] = GetContact(aabbs[i], spheres[i]).hit; }
+	}));
+	results.push_back(run("GetContact(Sphere,Sphere)", [&] {
+		for (size_t i = 0; i < count; ++i) { hitResults[i] = GetContact(spheres[i], spheres[(i + 1) % count]).hit; }
+	}));
+	results.push_back(run("GetContact(OBB,OBB)", [&] {
+		for (size_t i = 0; i < count; ++i) { hitResults[i] = GetContact(obbs[i], obbs[(i + 1) % count]).hit; }
+	}));
+	results.push_back(run("CheckCollisionBatch(AABB,Sphere)", [&] {
+		CheckCollisionBatch(aabbs.data(), count, spheres[0], batchResults.get());
+	}));
+	SetPerfCountersEnabled(wasEnabled);
+	ResetPerfScopeStats();
+
+	// 結果を使って最適化で消されないようにする
+	uint64_t checksum = 0;
+	for (size_t i = 0; i < count; ++i) {
+		checksum += hitResults[i] + uint64_t(batchResults[i]) + uint64_t(matrixResults[i].m[3][3] != 0.0f) + uint64_t(pointResults[i].x > 0.0f) +
+			uint64_t(sinResults[i] > cosResults[i]);
+	}
+
+	// 近似計算の誤差を確認する
+	FastMathErrorReport fastMathError = VerifyFastMath();
+	std::string fastMathMessage;
+	const bool isFastMathValid = CheckFastMathError(fastMathError, fastMathMessage);
+	if (!isFastMathValid) {
+		std::fprintf(stderr, "fast math error out of range:\n%s", fastMathMessage.c_str());
+	}
+	// GJK/EPA を分離軸の総当たりと比べる
+	GjkSatReport gjkSat = CheckGjkAgainstSat(obbs);
+	const bool isGjkValid = gjkSat.hitMismatches == 0 && gjkSat.depthMismatches == 0;
+	if (!isGjkValid) {
+		std::fprintf(stderr, "GJK/EPA disagrees with SAT: %u hit and %u depth mismatches in %u pairs\n",
+			gjkSat.hitMismatches, gjkSat.depthMismatches, gjkSat.pairCount);
+	}
+	// PairCache で接触が変わらないか(dense_indoor と同じ置き方)
+	ScenarioDesc pairCacheDesc;
+	pairCacheDesc.seed = 42;
+	pairCacheDesc.camera.rotate = { 0.2f, 0.0f, 0.0f };
+	pairCacheDesc.camera.translate = { 0.0f, 1.5f, -4.0f };
+	pairCacheDesc.groups[uint32_t(ScenarioShapeKind::SphereKind)] = { 1500, true, { 0.0f, 1.5f, 6.0f }, { 2.5f, 1.0f, 2.5f }, 0.02f, 0.1f, 0.5f };
+	pairCacheDesc.groups[uint32_t(ScenarioShapeKind::AABBKind)] = { 1000, true, { 0.0f, 1.0f, 6.0f }, { 3.0f, 1.0f, 3.0f }, 0.05f, 0.3f, 0.2f };
+	pairCacheDesc.groups[uint32_t(ScenarioShapeKind::OBBKind)] = { 500, true, { 0.0f, 1.0f, 6.0f }, { 3.0f, 1.0f, 3.0f }, 0.05f, 0.3f, 0.2f };
+	pairCacheDesc.groups[uint32_t(ScenarioShapeKind::TriangleKind)] = { 2000, false, { -8.0f, 0.0f, 0.0f }, { 8.0f, 3.0f, 14.0f }, 0.2f, 0.81f, 0.0f };
+	PairCacheReport pairCache = CheckPairCache(pairCacheDesc);
+	const bool isPairCacheValid = pairCache.mismatchFrames == 0;
+	if (!isPairCacheValid) {
+		std::fprintf(stderr, "PairCache changed contacts in %u of %u frames\n", pairCache.mismatchFrames, pairCache.frameCount);
+	}
+	// 箱の積み重ねが崩れず、浮かずに眠るか
+	std::vector<BoxStackReport> boxStacks;
+	bool isBoxStackValid = true;
+	for (uint32_t height : kBoxStackHeights) {
+		BoxStackReport stack = CheckBoxStack(height);
+		if (stack.sleepSeconds < 0.0f || stack.topDrift > kBoxStackMaxDrift || stack.maxHeightError > kBoxStackMaxHeightError) {
+			std::fprintf(stderr, "%u box stack failed: sleep %.2f s, top drift %g, height error %g\n",
+				stack.height, stack.sleepSeconds, stack.topDrift, stack.maxHeightError);
+			isBoxStackValid = false;
+		}
+		boxStacks.push_back(stack);
+	}
+	// ロープと布の速さと、結果が有限か
+	VerletReport verlet = CheckVerlet(threadPool);
+	if (!verlet.isFinite) {
+		std::fprintf(stderr, "VerletSolver produced a non-finite particle position\n");
+	}
+	out << "  {\n    \"kernels\": ";
+	WritePerfScopeStats(results, out);
+	out << ",\n    \"elementCount\": " << count << ",\n    \"resultChecksum\": " << checksum << ",\n";
+	out << "    \"fastMathUlp\": {\"rsqrt\": " << fastMathError.rsqrtUlp << ", \"length\": " << fastMathError.lengthUlp <<
+		", \"normalize\": " << fastMathError.normalizeUlp << ", \"sin\": " << fastMathError.sinUlp << ", \"cos\": " << fastMathError.cosUlp <<
+		", \"sinCosArray\": " << fastMathError.arrayUlp << ", \"withinBounds\": " << (isFastMathValid ? "true" : "false") << "},\n";
+	out << "    \"gjkVersusSat\": {\"pairs\": " << gjkSat.pairCount << ", \"hitMismatches\": " << gjkSat.hitMismatches <<
+		", \"depthMismatches\": " << gjkSat.depthMismatches << ", \"maxDepthError\": " << gjkSat.maxDepthError << "},\n";
+	out << "    \"pairCache\": {\"frames\": " << pairCache.frameCount << ", \"contacts\": " << pairCache.contactCount <<
+		", \"cacheHits\": " << pairCache.cacheHitCount << ", \"mismatchFrames\": " << pairCache.mismatchFrames <<
+		", \"collideMsCached\": " << pairCache.cachedMilliseconds / pairCache.frameCount <<
+		", \"collideMsDirect\": " << pairCache.directMilliseconds / pairCache.frameCount << "},\n";
+	out << "    \"boxStacks\": [";
+	for (size_t i = 0; i < boxStacks.size(); ++i) {
+		const BoxStackReport& stack = boxStacks[i];
+		out << (i == 0 ? "" : ", ") << "{\"height\": " << stack.height << ", \"sleepSeconds\": " << stack.sleepSeconds <<
+			", \"topDrift\": " << stack.topDrift << ", \"maxHeightError\": " << stack.maxHeightError << "}";
+	}
+	out << "],\n";
+	out << "    \"verlet\": {\"particles\": " << verlet.particleCount << ", \"constraints\": " << verlet.constraintCount <<
+		", \"colors\": " << verlet.colorCount << ", \"steps\": " << verlet.stepCount <<
+		", \"particlesPerMs\": " << verlet.particlesPerMillisecond << ", \"finite\": " << (verlet.isFinite ? "true" : "false") << "},\n";
+	out << "    \"perfCounters\": ";
+	WritePerfCounterStatus(out);
+	out << "\n  }";
+	return isFastMathValid && isGjkValid && isPairCacheValid && isBoxStackValid && verlet.isFinite;
+}
+
+/// <summary>
+/// シナリオを1つ動かして結果を JSON のオブジェクトとして書く
+/// </summary>
+/// <param name="desc">シナリオ</param>
+/// <param name="threadPool">使うスレッドプール</param>
+/// <param name="backend">描画先(NullLineBackend か RasterLineBackend)</param>
+/// <param name="out">書き出し先</param>
+template<typename Backend>
+void RunScenario(const ScenarioDesc& desc, ThreadPool& threadPool, Backend& backend, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	ScenarioScene scene(desc, &threadPool);
+	LineList lineList;
+	std::vector<double> phaseMilliseconds[size_t(ScenarioPhase::Count)];
+	for (std::vector<double>& samples : phaseMilliseconds) {
+		samples.reserve(desc.frameCount);
+	}
+	uint64_t contactCount = 0;
+	uint64_t candidatePairCount = 0;
+	uint64_t pairCacheHitCount = 0;
+	uint64_t measuredLineCount = 0;
+
+	const uint32_t totalFrames = desc.warmupFrameCount + desc.frameCount;
+	for (uint32_t frame = 0; frame < totalFrames; ++frame) {
+		if (frame == desc.warmupFrameCount) {
+			ResetPerfScopeStats();
+		}
+		ProfilerBeginFrame();
+		Clock::time_point times[size_t(ScenarioPhase::Count)];
+		size_t contacts = 0;
+		// カウンタはメインスレッドの分だけ(ワーカーの分は NarrowPhase::Test などの区間で数える)
+		times[0] = Clock::now();
+		{
+			PerfCounterScope perfScope(kScenarioPhaseNames[size_t(ScenarioPhase::Update)], 0);
+			scene.Update();
+		}
+		times[1] = Clock::now();
+		{
+			PerfCounterScope perfScope(kScenarioPhaseNames[size_t(ScenarioPhase::Collide)], 0);
+			contacts = scene.Collide();
+		}
+		times[2] = Clock::now();
+		{
+			PerfCounterScope perfScope(kScenarioPhaseNames[size_t(ScenarioPhase::Draw)], 0);
+			lineList.Clear();
+			scene.BuildDrawList(lineList);
+		}
+		times[3] = Clock::now();
+		{
+			PerfCounterScope perfScope(kScenarioPhaseNames[size_t(ScenarioPhase::Submit)], 0);
+			backend.Submit(lineList);
+		}
+		times[4] = Clock::now();
+		ProfilerEndFrame();
+		FrameArenaEndFrame();
+
+		if (frame < desc.warmupFrameCount) { continue; }
+		for (size_t phase = 0; phase < size_t(ScenarioPhase::Frame); ++phase) {
+			phaseMilliseconds[phase].push_back(std::chrono::duration<double, std::milli>(times[phase + 1] - times[phase]).count());
+		}
+		phaseMilliseconds[size_t(ScenarioPhase::Frame)].push_back(std::chrono::duration<double, std::milli>(times[4] - times[0]).count());
+		contactCount += contacts;
+		candidatePairCount += scene.GetCandidatePairCount();
+		pairCacheHitCount += scene.GetPairCacheHitCount();
+		measuredLineCount += lineList.Size();
+	}
+
+	const double frameCount = (std::max)(double(desc.frameCount), 1.0);
+	char buffer[256];
+	out << "  {\n    \"scenario\": " << ToJsonString(desc.name) << ",\n";
+	out << "    \"frames\": " << desc.frameCount << ",\n    \"warmupFrames\": " << desc.warmupFrameCount << ",\n";
+	out << "    \"threads\": " << threadPool.GetThreadCount() << ",\n";
+	out << "    \"pairCache\": " << (desc.usePairCache ? "true" : "false") << ",\n";
+	out << "    \"backend\": \"" << Backend::kName << "\",\n";
+	out << "    \"counts\": {";
+	for (uint32_t kind = 0; kind < uint32_t(ScenarioShapeKind::Count); ++kind) {
+		out << "\"" << kScenarioShapeNames[kind] << "\": " << scene.GetShapeCount(ScenarioShapeKind(kind)) << ", ";
+	}
+	out << "\"pendulum\": " << scene.GetPendulumCount() << "},\n";
+	out << "    \"phases\": {\n";
+	for (size_t phase = 0; phase < size_t(ScenarioPhase::Count); ++phase) {
+		std::vector<double>& samples = phaseMilliseconds[phase];
+		std::sort(samples.begin(), samples.end());
+		double sum = 0.0;
+		for (double sample : samples) { sum += sample; }
+		std::snprintf(buffer, sizeof(buffer),
+			"\"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f",
+			samples.empty() ? 0.0 : sum / double(samples.size()), samples.empty() ? 0.0 : samples.front(),
+			GetPercentile(samples, 50.0), GetPercentile(samples, 90.0), GetPercentile(samples, 95.0), GetPercentile(samples, 99.0),
+			samples.empty() ? 0.0 : samples.back());
+		out << "      \"" << kScenarioPhaseNames[phase] << "\": {" << buffer << "}"
+			<< (phase + 1 < size_t(ScenarioPhase::Count) ? ",\n" : "\n");
+	}
+	out << "    },\n";
+	std::snprintf(buffer, sizeof(buffer), "%.1f", double(candidatePairCount) / frameCount);
+	out << "    \"candidatePairsPerFrame\": " << buffer << ",\n";
+	std::snprintf(buffer, sizeof(buffer), "%.1f", double(pairCacheHitCount) / frameCount);
+	out << "    \"pairCacheHitsPerFrame\": " << buffer << ",\n";
+	std::snprintf(buffer, sizeof(buffer), "%.1f", double(contactCount) / frameCount);
+	out << "    \"contactsPerFrame\": " << buffer << ",\n";
+	std::snprintf(buffer, sizeof(buffer), "%.1f", double(measuredLineCount) / frameCount);
+	out << "    \"linesPerFrame\": " << buffer << ",\n";
+	std::snprintf(buffer, sizeof(buffer), "\"%016llx\"", static_cast<unsigned long long>(backend.checksum));
+	out << "    \"checksum\": " << buffer << ",\n";
+	FrameArenaReport arenaReport = GetFrameArenaReport();
+	out << "    \"peakMemoryBytes\": " << GetPeakMemoryBytes() << ",\n";
+	out << "    \"frameArenaPeakBytes\": " << arenaReport.highWaterBytes << ",\n";
+	out << "    \"profilerDroppedEvents\": " << GetProfilerDroppedEventCount() << ",\n";
+	// プロファイラのスコープ(直前のフレームの値と全体の平均・最大)
+	out << "    \"scopes\": [";
+	bool isFirst = true;
+	for (const ProfileScopeStat& stat : GetProfileScopeStats()) {
+		std::snprintf(buffer, sizeof(buffer), "{\"name\": %s, \"averageMs\": %.4f, \"maxMs\": %.4f}",
+			ToJsonString(stat.name).c_str(), stat.averageMilliseconds, stat.maxMilliseconds);
+		out << (isFirst ? "\n      " : ",\n      ") << buffer;
+		isFirst = false;
+	}
+	out << (isFirst ? "]" : "\n    ]");
+	if (IsPerfCountersEnabled()) {
+		// 計測したフレームのカウンタ(フェーズは1フレームあたり、他は1要素あたり)
+		out << ",\n    \"counters\": ";
+		WritePerfScopeStats(GetPerfScopeStats(), out);
+		out << ",\n    \"perfCounters\": ";
+		WritePerfCounterStatus(out);
+	}
+	out << "\n  }";
+}
+
+int main(int argc, char** argv) {
+	uint32_t threadCount = 0;
+	int64_t frameOverride = -1;
+	const char* outputPath = nullptr;
+	bool runKernels = false;
+	bool useRaster = false;
+	const char* pngPrefix = nullptr;
+	std::vector<const char*> scenarioPaths;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threadCount = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frameOverride = std::strtoll(argv[++i], nullptr, 10);
+		} else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			outputPath = argv[++i];
+		} else if (std::strcmp(argv[i], "--counters") == 0) {
+			SetPerfCountersEnabled(true);
+		} else if (std::strcmp(argv[i], "--kernels") == 0) {
+			runKernels = true;
+		} else if (std::strcmp(argv[i], "--raster") == 0) {
+			useRaster = true;
+		} else if (std::strcmp(argv[i], "--png") == 0 && i + 1 < argc) {
+			pngPrefix = argv[++i];
+			useRaster = true;
+		} else {
+			scenarioPaths.push_back(argv[i]);
+		}
+	}
+	if (scenarioPaths.empty() && !runKernels) {
+		std::fprintf(stderr, "usage: %s [--threads N] [--frames N] [--output path] [--counters] [--kernels] [--raster] [--png prefix] scenario...\n", argv[0]);
+		return 2;
+	}
+
+	// 全てのシナリオを先に読み、記述の誤りで途中まで動かして止まらないようにする
+	std::vector<ScenarioDesc> descs(scenarioPaths.size());
+	for (size_t i = 0; i < scenarioPaths.size(); ++i) {
+		std::string error;
+		if (!LoadScenario(scenarioPaths[i], descs[i], error)) {
+			std::fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		if (frameOverride >= 0) {
+			descs[i].frameCount = uint32_t(frameOverride);
+		}
+	}
+
+	std::unique_ptr<ThreadPool> ownedThreadPool;
+	ThreadPool* threadPool = &ThreadPool::GetDefault();
+	if (threadCount > 0) {
+		ownedThreadPool = std::make_unique<ThreadPool>(threadCount);
+		threadPool = ownedThreadPool.get();
+	}
+
+	std::ostringstream json;
+	json << "[\n";
+	bool isKernelValid = true;
+	if (runKernels) {
+		isKernelValid = RunKernels(*threadPool, json);
+		json << (descs.empty() ? "\n" : ",\n");
+	}
+	for (size_t i = 0; i < descs.size(); ++i) {
+		if (useRaster) {
+			RasterLineBackend backend(descs[i].viewportWidth, descs[i].viewportHeight, threadPool);
+			RunScenario(descs[i], *threadPool, backend, json);
+			std::string pngPath = pngPrefix ? std::string(pngPrefix) + descs[i].name + ".png" : std::string();
+			const TileRasterizer& rasterizer = backend.rasterizer;
+			if (pngPrefix && !WritePng(pngPath.c_str(), rasterizer.GetPixels().data(), rasterizer.GetWidth(), rasterizer.GetHeight())) {
+				std::fprintf(stderr, "cannot write %s\n", pngPath.c_str());
+				return 1;
+			}
+		} else {
+			NullLineBackend backend;
+			RunScenario(descs[i], *threadPool, backend, json);
+		}
+		json << (i + 1 < descs.size() ? ",\n" : "\n");
+	}
+	json << "]\n";
+
+	if (outputPath) {
+		std::ofstream file(outputPath);
+		if (!(file << json.str())) {
+			std::fprintf(stderr, "cannot write %s\n", outputPath);
+			return 1;
+		}
+	} else {
+		std::fputs(json.str().c_str(), stdout);
+	}
+	return isKernelValid ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include "Vector3.h"
+
+// 形状はすべてスカラー型 T のテンプレートで、float版を別名で使う
+
+// 球
+template<typename T>
+struct SphereT {
+	Vector3T<T> center;
+	T radius;
+};
+
+//  線分
+template<typename T>
+struct SegmentT {
+	Vector3T<T> origin;
+	Vector3T<T> diff;
+};
+
+// 直線
+template<typename T>
+struct LineT {
+	Vector3T<T> origin;
+	Vector3T<T> diff;
+};
+
+// 半直線
+template<typename T>
+struct RayT {
+	Vector3T<T> origin;
+	Vector3T<T> diff;
+};
+
+// 平面
+template<typename T>
+struct PlaneT {
+	Vector3T<T> normal; // 法線
+	T distance; // 距離
+};
+
+// 三角形
+template<typename T>
+struct TriangleT {
+	Vector3T<T> vertices[3];
+};
+
+// AABB
+template<typename T>
+struct AABBT {
+	Vector3T<T> min; // 最小点
+	Vector3T<T> max; // 最大点
+};
+
+// OBB
+template<typename T>
+struct OBBT {
+	Vector3T<T> center; // 中心点
+	Vector3T<T> orientations[3]; // 各軸の方向ベクトル
+	Vector3T<T> size; // 各軸の長さの半分
+};
+
+using Sphere = SphereT<float>;
+using Segment = SegmentT<float>;
+using Line = LineT<float>;
+using Ray = RayT<float>;
+using Plane = PlaneT<float>;
+using Triangle = TriangleT<float>;
+using AABB = AABBT<float>;
+using OBB = OBBT<float>;
\ No newline at end of file
@@ -0,0 +1,785 @@
+#pragma once
+#include "Collision.h"
+#include "Distance.h"
+#include "ObjLoader.h"
+#include "Profiler.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+// 静的な地形の符号付き距離場(SDF)
+// 平面・AABB・OBB・三角形を前もって格子に焼き込み、実行時は8点の補間だけで距離と法線を求める
+// 表面から bandWidth 以内のブリック(8x8x8セル)だけを持ち、それ以外は「遠い外側/内側」の印だけを持つ
+// 印だけのブリックでは、ブリック単位の粗い距離(値を持つブリックまでの距離)の差分で法線を決める
+
+// 1ブリックのセル数(1辺)
+static const int kSdfBrickSize = 8;
+// 1ブリックのサンプル数(1辺、隣のブリックと境界のサンプルを重複して持つので補間が1ブリックで閉じる)
+static const int kSdfBrickSamples = kSdfBrickSize + 1;
+static const size_t kSdfBrickSampleCount = size_t(kSdfBrickSamples) * kSdfBrickSamples * kSdfBrickSamples;
+// ブリック表の特別な値(サンプルを持たないブリック)
+static const uint32_t kSdfEmptyOutside = 0xFFFFFFFF;
+static const uint32_t kSdfEmptyInside = 0xFFFFFFFE;
+// 焼き込みで三角形を絞り込みながら並列に処理する塊の数の目安
+static const size_t kSdfBakeParallelCells = 256;
+// サンプルの量子化の最大値(±bandWidth を ±この値に割り当てる)
+static const float kSdfQuantizeScale = 32767.0f;
+// ファイルの識別子と版
+static const uint32_t kSignedDistanceFieldMagic = 0x5333544D; // "MT3S"
+static const uint32_t kSignedDistanceFieldVersion = 1;
+
+/// <summary>
+/// 焼き込む図形
+/// 三角形は表側(頂点が反時計回りに見える側)を外側として符号を決めるので、閉じたメッシュは向きをそろえておく
+/// </summary>
+struct SdfSource {
+	std::vector<Plane> planes;
+	std::vector<AABB> aabbs;
+	std::vector<OBB> obbs;
+	std::vector<Triangle> triangles;
+};
+
+// ファイルの先頭(この後にブリック表、サンプルの順に並ぶ)
+struct SdfFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	float origin[3];			// 格子の原点(最小点)
+	float voxelSize;			// セルの大きさ
+	float bandWidth;			// 値を持つ範囲(表面からの距離)
+	uint32_t brickCounts[3];	// 各軸のブリック数
+	uint32_t allocatedBrickCount; // サンプルを持つブリックの数
+	uint32_t reserved;
+};
+
+/// <summary>
+/// 箱の符号付き距離(箱の座標系)
+/// </summary>
+/// <param name="local">箱の中心からの位置</param>
+/// <param name="halfSize">各軸の長さの半分</param>
+float SignedDistanceBox(const Vector3& local, const Vector3& halfSize) {
+	Vector3 d = { std::abs(local.x) - halfSize.x, std::abs(local.y) - halfSize.y, std::abs(local.z) - halfSize.z };
+	Vector3 outside = { (std::max)(d.x, 0.0f), (std::max)(d.y, 0.0f), (std::max)(d.z, 0.0f) };
+	float inside = (std::min)((std::max)(d.x, (std::max)(d.y, d.z)), 0.0f);
+	return Length(outside) + inside;
+}
+
+float SignedDistance(const Vector3& point, const Plane& plane) {
+	return Dot(plane.normal, point) - plane.distance;
+}
+
+float SignedDistance(const Vector3& point, const AABB& aabb) {
+	Vector3 center = (aabb.min + aabb.max) * 0.5f;
+	Vector3 halfSize = (aabb.max - aabb.min) * 0.5f;
+	return SignedDistanceBox(point - center, halfSize);
+}
+
+float SignedDistance(const Vector3& point, const OBB& obb) {
+	Vector3 difference = point - obb.center;
+	Vector3 local = { Dot(difference, obb.orientations[0]), Dot(difference, obb.orientations[1]), Dot(difference, obb.orientations[2]) };
+	return SignedDistanceBox(local, obb.size);
+}
+
+/// <summary>
+/// 三角形の最近接点と、その点での角度(角度で重み付けした擬似法線の重み)を求める
+/// 頂点の領域ならその頂点の内角、辺の領域ならπ、面の内側なら2π
+/// 領域は符号の判定で決めるので、辺や頂点を共有する三角形どうしで判定が食い違いにくい
+/// </summary>
+/// <param name="point">点</param>
+/// <param name="triangle">三角形</param>
+/// <param name="angle">最近接点での角度</param>
+Vector3 ClosestPoint(const Vector3& point, const Triangle& triangle, float& angle) {
+	static const float kPi = 3.14159265f;
+	const Vector3& a = triangle.vertices[0];
+	const Vector3& b = triangle.vertices[1];
+	const Vector3& c = triangle.vertices[2];
+	// 頂点の内角
+	auto vertexAngle = [](const Vector3& edge1, const Vector3& edge2) {
+		float cosine = Dot(edge1, edge2) / std::sqrt(Dot(edge1, edge1) * Dot(edge2, edge2) + 1e-30f);
+		return std::acos((std::min)((std::max)(cosine, -1.0f), 1.0f));
+	};
+	Vector3 ab = b - a;
+	Vector3 ac = c - a;
+	Vector3 ap = point - a;
+	float d1 = Dot(ab, ap);
+	float d2 = Dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		angle = vertexAngle(ab, ac);
+		return a;
+	}
+	Vector3 bp = point - b;
+	float d3 = Dot(ab, bp);
+	float d4 = Dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) {
+		angle = vertexAngle(a - b, c - b);
+		return b;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		angle = kPi;
+		return a + ab * (d1 / (d1 - d3));
+	}
+	Vector3 cp = point - c;
+	float d5 = Dot(ab, cp);
+	float d6 = Dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) {
+		angle = vertexAngle(a - c, b - c);
+		return c;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		angle = kPi;
+		return a + ac * (d2 / (d2 - d6));
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		angle = kPi;
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+	angle = 2.0f * kPi;
+	float denominator = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+/// <summary>
+/// 三角形の集まりの符号付き距離
+/// 一番近い三角形までの距離に、最近接点での角度で重み付けした擬似法線の向きで符号を付ける
+/// (辺や頂点が一番近いときも、閉じたメッシュなら正しい符号になる)
+/// </summary>
+/// <param name="point">点</param>
+/// <param name="triangles">三角形</param>
+/// <param name="indices">調べる三角形の番号</param>
+/// <param name="count">indices の数</param>
+float SignedDistance(const Vector3& point, const std::vector<Triangle>& triangles, const uint32_t* indices, size_t count) {
+	float bestDistanceSquared = (std::numeric_limits<float>::max)();
+	Vector3 bestClosest = point;
+	Vector3 pseudoNormal = { 0.0f, 0.0f, 0.0f };
+	for (size_t i = 0; i < count; ++i) {
+		const Triangle& triangle = triangles[indices[i]];
+		float angle;
+		Vector3 closest = ClosestPoint(point, triangle, angle);
+		Vector3 difference = point - closest;
+		float distanceSquared = Dot(difference, difference);
+		// 同じ頂点や辺を共有する三角形は距離が並ぶので、少しの誤差は同じ距離とみなして法線を足し合わせる
+		float tolerance = 1e-6f * bestDistanceSquared + 1e-12f;
+		if (distanceSquared > bestDistanceSquared + tolerance) { continue; }
+		if (distanceSquared < bestDistanceSquared - tolerance) {
+			bestDistanceSquared = distanceSquared;
+			bestClosest = closest;
+			pseudoNormal = { 0.0f, 0.0f, 0.0f };
+		}
+		Vector3 normal = Cross(triangle.vertices[1] - triangle.vertices[0], triangle.vertices[2] - triangle.vertices[0]);
+		float length = Length(normal);
+		if (length > 0.0f) {
+			pseudoNormal = pseudoNormal + normal * (angle / length);
+		}
+	}
+	float sign = Dot(point - bestClosest, pseudoNormal) < 0.0f ? -1.0f : 1.0f;
+	return sign * std::sqrt(bestDistanceSquared);
+}
+
+// 焼き込みで三角形を絞り込むブリックの塊([min, max) のブリック)
+struct SdfBakeCell {
+	uint32_t min[3] = { 0, 0, 0 };
+	uint32_t max[3] = { 0, 0, 0 };
+	std::vector<uint32_t> triangles;	// 塊の中で一番近くなりうるか、帯に入りうる三角形
+	float nearestDistance = 0.0f;		// 塊の中心から一番近い三角形までの距離
+	float halfSize = (std::numeric_limits<float>::max)();	// 塊の対角線の半分
+};
+
+/// <summary>
+/// 焼き込んだ符号付き距離場
+/// Bake で作るか Load でファイルを割り当てて使う(Load したときはファイルのメモリを直接読む)
+/// </summary>
+class SignedDistanceField {
+public:
+	SignedDistanceField() = default;
+	SignedDistanceField(const SignedDistanceField&) = delete;
+	SignedDistanceField& operator=(const SignedDistanceField&) = delete;
+
+	bool IsValid() const { return brickTable_ != nullptr; }
+	float GetVoxelSize() const { return voxelSize_; }
+	float GetBandWidth() const { return bandWidth_; }
+	size_t GetAllocatedBrickCount() const { return allocatedBrickCount_; }
+
+	// 格子の範囲
+	AABB GetBounds() const {
+		Vector3 size = {
+			float(brickCounts_[0] * kSdfBrickSize) * voxelSize_,
+			float(brickCounts_[1] * kSdfBrickSize) * voxelSize_,
+			float(brickCounts_[2] * kSdfBrickSize) * voxelSize_ };
+		return { origin_, origin_ + size };
+	}
+
+	// ブリック表・粗い距離・サンプルのバイト数
+	size_t GetMemorySize() const {
+		return (sizeof(uint32_t) + sizeof(float)) * GetBrickCount() + sizeof(int16_t) * kSdfBrickSampleCount * allocatedBrickCount_;
+	}
+
+	/// <summary>
+	/// 図形を焼き込む
+	/// ブリックごとに中心での距離で関係する図形を絞り込んでから、各サンプルの正確な距離を求める
+	/// 三角形はブリックの塊を半分ずつに分けながら絞り込むので、ブリックごとに全ての三角形を調べることはない
+	/// </summary>
+	/// <param name="source">図形</param>
+	/// <param name="bounds">焼き込む範囲(ブリック単位に切り上げる)</param>
+	/// <param name="voxelSize">セルの大きさ</param>
+	/// <param name="bandWidth">値を持つ範囲(表面からの距離、これより遠い場所は ±bandWidth になる)</param>
+	/// <param name="threadPool">使うスレッドプール(nullptrなら既定のもの)</param>
+	void Bake(const SdfSource& source, const AABB& bounds, float voxelSize, float bandWidth, ThreadPool* threadPool = nullptr) {
+		MT3_PROFILE_SCOPE("SignedDistanceField::Bake");
+		Release();
+		if (!threadPool) { threadPool = &ThreadPool::GetDefault(); }
+		origin_ = bounds.min;
+		voxelSize_ = voxelSize;
+		bandWidth_ = bandWidth;
+		float brickLength = voxelSize * float(kSdfBrickSize);
+		brickCounts_[0] = (std::max)(uint32_t(std::ceil((bounds.max.x - bounds.min.x) / brickLength)), 1u);
+		brickCounts_[1] = (std::max)(uint32_t(std::ceil((bounds.max.y - bounds.min.y) / brickLength)), 1u);
+		brickCounts_[2] = (std::max)(uint32_t(std::ceil((bounds.max.z - bounds.min.z) / brickLength)), 1u);
+		size_t brickCount = GetBrickCount();
+		float halfDiagonal = 0.5f * brickLength * std::sqrt(3.0f);
+		float cullDistance = bandWidth + halfDiagonal;
+
+		// ブリックごとに焼いて一時的に持ち、後で詰める(スレッド数によらず同じ並びになる)
+		std::vector<std::vector<int16_t>> brickSamples(brickCount);
+		std::vector<uint32_t> table(brickCount, kSdfEmptyOutside);
+
+		// 1つのブリックを焼く(nearTriangles はブリックのどこかで一番近くなりうるか、帯に入りうる三角形)
+		// farTriangleDistance が0でなければ三角形は全て帯より遠く、中心の三角形の距離の代わりにこれを使う
+		auto bakeBrick = [&](size_t brick, const std::vector<uint32_t>& nearTriangles, std::vector<uint32_t>* scratch, float farTriangleDistance) {
+			std::vector<uint32_t>& planes = scratch[0];
+			std::vector<uint32_t>& aabbs = scratch[1];
+			std::vector<uint32_t>& obbs = scratch[2];
+			std::vector<uint32_t>& triangles = scratch[3];
+			uint32_t bx = uint32_t(brick % brickCounts_[0]);
+			uint32_t by = uint32_t(brick / brickCounts_[0] % brickCounts_[1]);
+			uint32_t bz = uint32_t(brick / (size_t(brickCounts_[0]) * brickCounts_[1]));
+			Vector3 brickOrigin = origin_ + Vector3{ float(bx), float(by), float(bz) } * brickLength;
+			Vector3 center = brickOrigin + Vector3{ 0.5f, 0.5f, 0.5f } * brickLength;
+
+			// 中心の距離で、ブリック内で帯の中に入りうる図形だけを残す
+			planes.clear();
+			aabbs.clear();
+			obbs.clear();
+			triangles.clear();
+			float centerDistance = (std::numeric_limits<float>::max)();
+			for (size_t i = 0; i < source.planes.size(); ++i) {
+				float distance = SignedDistance(center, source.planes[i]);
+				centerDistance = (std::min)(centerDistance, distance);
+				if (distance < cullDistance) { planes.push_back(uint32_t(i)); }
+			}
+			for (size_t i = 0; i < source.aabbs.size(); ++i) {
+				float distance = SignedDistance(center, source.aabbs[i]);
+				centerDistance = (std::min)(centerDistance, distance);
+				if (distance < cullDistance) { aabbs.push_back(uint32_t(i)); }
+			}
+			for (size_t i = 0; i < source.obbs.size(); ++i) {
+				float distance = SignedDistance(center, source.obbs[i]);
+				centerDistance = (std::min)(centerDistance, distance);
+				if (distance < cullDistance) { obbs.push_back(uint32_t(i)); }
+			}
+			// 三角形は符号に一番近い三角形が要るので、中心では一番近くなりうるもの全てを調べる
+			float triangleCenterDistance = (std::numeric_limits<float>::max)();
+			if (farTriangleDistance != 0.0f) {
+				triangleCenterDistance = farTriangleDistance;
+				centerDistance = (std::min)(centerDistance, triangleCenterDistance);
+			} else if (!source.triangles.empty()) {
+				triangleCenterDistance = SignedDistance(center, source.triangles, nearTriangles.data(), nearTriangles.size());
+				centerDistance = (std::min)(centerDistance, triangleCenterDistance);
+				for (uint32_t i : nearTriangles) {
+					if (DistanceSquared(center, source.triangles[i]) < cullDistance * cullDistance) { triangles.push_back(i); }
+				}
+			}
+			// ブリック内の距離は中心から halfDiagonal 以上変わらないので、遠ければ印だけ付ける
+			if (std::abs(centerDistance) >= cullDistance) {
+				table[brick] = centerDistance < 0.0f ? kSdfEmptyInside : kSdfEmptyOutside;
+				return;
+			}
+
+			std::vector<int16_t> samples(kSdfBrickSampleCount);
+			bool isInside = false;
+			bool isOutside = false;
+			bool hasBand = false;
+			size_t sampleIndex = 0;
+			for (int z = 0; z < kSdfBrickSamples; ++z) {
+				for (int y = 0; y < kSdfBrickSamples; ++y) {
+					for (int x = 0; x < kSdfBrickSamples; ++x) {
+						Vector3 point = brickOrigin + Vector3{ float(x), float(y), float(z) } * voxelSize;
+						float distance = (std::numeric_limits<float>::max)();
+						for (uint32_t i : planes) { distance = (std::min)(distance, SignedDistance(point, source.planes[i])); }
+						for (uint32_t i : aabbs) { distance = (std::min)(distance, SignedDistance(point, source.aabbs[i])); }
+						for (uint32_t i : obbs) { distance = (std::min)(distance, SignedDistance(point, source.obbs[i])); }
+						if (!source.triangles.empty()) {
+							float triangleDistance = SignedDistance(point, source.triangles, triangles.data(), triangles.size());
+							// 近くに三角形がなければ符号は中心のものを使う
+							if (std::abs(triangleDistance) >= bandWidth) {
+								triangleDistance = triangleCenterDistance < 0.0f ? -bandWidth : bandWidth;
+							}
+							distance = (std::min)(distance, triangleDistance);
+						}
+						// 帯の外では、図形から離れていれば遠い外側として扱う
+						if (distance >= bandWidth) {
+							distance = bandWidth;
+							isOutside = true;
+						} else if (distance <= -bandWidth) {
+							distance = -bandWidth;
+							isInside = true;
+						} else {
+							hasBand = true;
+						}
+						samples[sampleIndex++] = int16_t(std::lround(distance / bandWidth * kSdfQuantizeScale));
+					}
+				}
+			}
+			if (!hasBand && !(isInside && isOutside)) {
+				table[brick] = isInside ? kSdfEmptyInside : kSdfEmptyOutside;
+				return;
+			}
+			brickSamples[brick] = std::move(samples);
+			table[brick] = 0;
+		};
+
+		// ブリックの塊を一番長い軸で半分に分け、それぞれに関係する三角形だけを残す
+		// 塊の中心から距離 d の三角形は、塊の中の点から d - h 以上離れている(h は塊の対角線の半分)
+		// なので一番近い三角形の距離を dMin として、d <= dMin + 2h か帯に入りうるものだけが要る
+		auto splitCell = [&](const SdfBakeCell& cell, SdfBakeCell children[2]) {
+			int axis = 0;
+			for (int i = 1; i < 3; ++i) {
+				if (cell.max[i] - cell.min[i] > cell.max[axis] - cell.min[axis]) { axis = i; }
+			}
+			if (cell.max[axis] - cell.min[axis] <= 1) { return false; }
+			uint32_t middle = cell.min[axis] + (cell.max[axis] - cell.min[axis]) / 2;
+			std::vector<float> distances(cell.triangles.size());
+			for (int c = 0; c < 2; ++c) {
+				SdfBakeCell& child = children[c];
+				std::copy(cell.min, cell.min + 3, child.min);
+				std::copy(cell.max, cell.max + 3, child.max);
+				(c == 0 ? child.max[axis] : child.min[axis]) = middle;
+				Vector3 cellMin = origin_ + Vector3{ float(child.min[0]), float(child.min[1]), float(child.min[2]) } * brickLength;
+				Vector3 cellMax = origin_ + Vector3{ float(child.max[0]), float(child.max[1]), float(child.max[2]) } * brickLength;
+				Vector3 center = (cellMin + cellMax) * 0.5f;
+				float halfSize = Length(cellMax - cellMin) * 0.5f;
+				float nearest = (std::numeric_limits<float>::max)();
+				for (size_t i = 0; i < cell.triangles.size(); ++i) {
+					distances[i] = std::sqrt(DistanceSquared(center, source.triangles[cell.triangles[i]]));
+					nearest = (std::min)(nearest, distances[i]);
+				}
+				// 丸めで同じ距離の三角形を落とさないように少し広げる
+				float keepDistance = (std::max)(nearest + 2.0f * halfSize, cullDistance + halfSize) * (1.0f + 1.0e-4f);
+				child.nearestDistance = nearest;
+				child.halfSize = halfSize;
+				child.triangles.clear();
+				for (size_t i = 0; i < cell.triangles.size(); ++i) {
+					if (distances[i] <= keepDistance) { child.triangles.push_back(cell.triangles[i]); }
+				}
+			}
+			return true;
+		};
+
+		// 並列にするのに十分な数になるまで幅優先で分け、その先は塊ごとに深さ優先で分けながら焼く
+		std::vector<SdfBakeCell> cells(1);
+		cells[0].max[0] = brickCounts_[0];
+		cells[0].max[1] = brickCounts_[1];
+		cells[0].max[2] = brickCounts_[2];
+		cells[0].triangles.resize(source.triangles.size());
+		for (size_t i = 0; i < source.triangles.size(); ++i) { cells[0].triangles[i] = uint32_t(i); }
+		while (cells.size() < kSdfBakeParallelCells) {
+			std::vector<SdfBakeCell> nextCells;
+			bool isSplit = false;
+			for (const SdfBakeCell& cell : cells) {
+				SdfBakeCell children[2];
+				if (splitCell(cell, children)) {
+					nextCells.push_back(std::move(children[0]));
+					nextCells.push_back(std::move(children[1]));
+					isSplit = true;
+				} else {
+					nextCells.push_back(cell);
+				}
+			}
+			cells = std::move(nextCells);
+			if (!isSplit) { break; }
+		}
+		threadPool->ParallelFor(cells.size(), 1, [&](size_t begin, size_t end, uint32_t) {
+			std::vector<uint32_t> scratch[4];
+			const std::vector<uint32_t> noTriangles;
+			auto bakeCell = [&](auto& self, const SdfBakeCell& cell) -> void {
+				// 塊の全ての点が三角形から帯より遠ければ、塊の中で表面を横切らないので符号は1つに決まる
+				// (閉じたメッシュのとき)その塊のブリックは中心の符号と距離の下限だけで焼ける
+				float farDistance = cell.nearestDistance - cell.halfSize;
+				if (!source.triangles.empty() && farDistance >= cullDistance) {
+					Vector3 cellMin = origin_ + Vector3{ float(cell.min[0]), float(cell.min[1]), float(cell.min[2]) } * brickLength;
+					Vector3 cellMax = origin_ + Vector3{ float(cell.max[0]), float(cell.max[1]), float(cell.max[2]) } * brickLength;
+					float sign = SignedDistance((cellMin + cellMax) * 0.5f, source.triangles, cell.triangles.data(), cell.triangles.size()) < 0.0f ? -1.0f : 1.0f;
+					for (uint32_t z = cell.min[2]; z < cell.max[2]; ++z) {
+						for (uint32_t y = cell.min[1]; y < cell.max[1]; ++y) {
+							for (uint32_t x = cell.min[0]; x < cell.max[0]; ++x) {
+								bakeBrick(x + brickCounts_[0] * (y + size_t(brickCounts_[1]) * z), noTriangles, scratch, sign * farDistance);
+							}
+						}
+					}
+					return;
+				}
+				SdfBakeCell children[2];
+				if (splitCell(cell, children)) {
+					self(self, children[0]);
+					self(self, children[1]);
+					return;
+				}
+				size_t brick = cell.min[0] + brickCounts_[0] * (cell.min[1] + size_t(brickCounts_[1]) * cell.min[2]);
+				bakeBrick(brick, cell.triangles, scratch, 0.0f);
+			};
+			for (size_t i = begin; i < end; ++i) {
+				bakeCell(bakeCell, cells[i]);
+			}
+		});
+
+		// 値を持つブリックを詰める
+		ownedTable_ = std::move(table);
+		for (size_t brick = 0; brick < brickCount; ++brick) {
+			if (brickSamples[brick].empty()) { continue; }
+			ownedTable_[brick] = uint32_t(allocatedBrickCount_++);
+		}
+		ownedSamples_.resize(kSdfBrickSampleCount * allocatedBrickCount_);
+		for (size_t brick = 0; brick < brickCount; ++brick) {
+			if (brickSamples[brick].empty()) { continue; }
+			std::memcpy(ownedSamples_.data() + kSdfBrickSampleCount * ownedTable_[brick], brickSamples[brick].data(), sizeof(int16_t) * kSdfBrickSampleCount);
+		}
+		brickTable_ = ownedTable_.data();
+		samples_ = ownedSamples_.data();
+		BuildCoarseDistances();
+	}
+
+	/// <summary>
+	/// ファイルに書き出す
+	/// </summary>
+	/// <param name="path">パス</param>
+	/// <returns>書き出せたらtrue</returns>
+	bool Save(const char* path) const {
+		if (!IsValid()) { return false; }
+		std::ofstream file(path, std::ios::binary);
+		if (!file) { return false; }
+		SdfFileHeader header = {};
+		header.magic = kSignedDistanceFieldMagic;
+		header.version = kSignedDistanceFieldVersion;
+		header.origin[0] = origin_.x;
+		header.origin[1] = origin_.y;
+		header.origin[2] = origin_.z;
+		header.voxelSize = voxelSize_;
+		header.bandWidth = bandWidth_;
+		std::memcpy(header.brickCounts, brickCounts_, sizeof(brickCounts_));
+		header.allocatedBrickCount = uint32_t(allocatedBrickCount_);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(brickTable_), std::streamsize(sizeof(uint32_t) * GetBrickCount()));
+		file.write(reinterpret_cast<const char*>(samples_), std::streamsize(sizeof(int16_t) * kSdfBrickSampleCount * allocatedBrickCount_));
+		return bool(file);
+	}
+
+	/// <summary>
+	/// ファイルを割り当てて読み込む(コピーせず、ファイルのメモリをそのまま参照する)
+	/// </summary>
+	/// <param name="path">パス</param>
+	/// <returns>有効なファイルを読み込めたらtrue</returns>
+	bool Load(const char* path) {
+		Release();
+		if (!mappedFile_.Open(path)) { return false; }
+		if (mappedFile_.GetSize() < sizeof(SdfFileHeader)) { Release(); return false; }
+		SdfFileHeader header;
+		std::memcpy(&header, mappedFile_.GetData(), sizeof(header));
+		if (header.magic != kSignedDistanceFieldMagic || header.version != kSignedDistanceFieldVersion) { Release(); return false; }
+		// 格子の大きさと原点は有限で、セルの大きさと帯は正でなければならない
+		bool isValid = std::isfinite(header.voxelSize) && std::isfinite(header.bandWidth) && header.voxelSize > 0.0f && header.bandWidth > 0.0f;
+		for (int axis = 0; axis < 3; ++axis) {
+			// Sample はセルの番号を int で持つので、1軸のセル数が int に収まらなければならない
+			isValid = isValid && std::isfinite(header.origin[axis]) &&
+				header.brickCounts[axis] > 0 && header.brickCounts[axis] <= uint32_t((std::numeric_limits<int>::max)() / kSdfBrickSize);
+		}
+		if (!isValid) { Release(); return false; }
+		// 掛け算があふれて偶然ファイルの大きさと一致しないよう、1回ずつ確かめる
+		auto multiply = [](size_t a, size_t b, size_t& result) {
+			if (a != 0 && b > (std::numeric_limits<size_t>::max)() / a) { return false; }
+			result = a * b;
+			return true;
+		};
+		size_t brickCount = 0;
+		size_t tableBytes = 0;
+		size_t sampleCount = 0;
+		size_t sampleBytes = 0;
+		if (!multiply(header.brickCounts[0], header.brickCounts[1], brickCount) || !multiply(brickCount, header.brickCounts[2], brickCount) ||
+			!multiply(sizeof(uint32_t), brickCount, tableBytes) ||
+			!multiply(kSdfBrickSampleCount, header.allocatedBrickCount, sampleCount) || !multiply(sizeof(int16_t), sampleCount, sampleBytes) ||
+			tableBytes > mappedFile_.GetSize() - sizeof(header) || sampleBytes != mappedFile_.GetSize() - sizeof(header) - tableBytes) {
+			Release();
+			return false;
+		}
+		// 表の値は印か、サンプルの範囲の中でなければならない
+		const uint32_t* table = reinterpret_cast<const uint32_t*>(mappedFile_.GetData() + sizeof(header));
+		for (size_t brick = 0; brick < brickCount; ++brick) {
+			uint32_t entry = table[brick];
+			if (entry != kSdfEmptyOutside && entry != kSdfEmptyInside && entry >= header.allocatedBrickCount) {
+				Release();
+				return false;
+			}
+		}
+		origin_ = { header.origin[0], header.origin[1], header.origin[2] };
+		voxelSize_ = header.voxelSize;
+		bandWidth_ = header.bandWidth;
+		std::memcpy(brickCounts_, header.brickCounts, sizeof(brickCounts_));
+		allocatedBrickCount_ = header.allocatedBrickCount;
+		// ヘッダは48バイトなので、表とサンプルはそれぞれの型の境界にそろっている
+		brickTable_ = table;
+		samples_ = reinterpret_cast<const int16_t*>(mappedFile_.GetData() + sizeof(header) + sizeof(uint32_t) * brickCount);
+		BuildCoarseDistances();
+		return true;
+	}
+
+	/// <summary>
+	/// 距離を求める(格子の外では格子の端の値に格子までの距離を足す)
+	/// </summary>
+	/// <param name="point">点</param>
+	float GetDistance(const Vector3& point) const {
+		Vector3 gradient;
+		return Sample(point, gradient, false);
+	}
+
+	/// <summary>
+	/// 距離と、距離が増える向きの単位ベクトル(表面の法線)を求める
+	/// 値を持たないブリック(遠い内側・外側)では粗い距離の差分を使う
+	/// 粗い距離も平らな場所(どちらの表面にも同じ距離)では法線は0になる
+	/// </summary>
+	/// <param name="point">点</param>
+	/// <param name="normal">法線</param>
+	/// <returns>距離</returns>
+	float GetDistance(const Vector3& point, Vector3& normal) const {
+		float distance = Sample(point, normal, true);
+		float length = Length(normal);
+		if (length == 0.0f) {
+			normal = GetCoarseGradient(point);
+			length = Length(normal);
+		}
+		normal = length > 0.0f ? normal / length : Vector3{ 0.0f, 0.0f, 0.0f };
+		return distance;
+	}
+
+	/// <summary>
+	/// 複数の点の距離をまとめて求める
+	/// </summary>
+	/// <param name="points">点</param>
+	/// <param name="count">点の数</param>
+	/// <param name="distances">結果(count個)</param>
+	/// <param name="threadPool">使うスレッドプール(nullptrなら既定のもの)</param>
+	void GetDistances(const Vector3* points, size_t count, float* distances, ThreadPool* threadPool = nullptr) const {
+		MT3_PROFILE_SCOPE("SignedDistanceField::GetDistances");
+		if (!threadPool) { threadPool = &ThreadPool::GetDefault(); }
+		threadPool->ParallelFor(count, 4096, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				distances[i] = GetDistance(points[i]);
+			}
+		});
+	}
+
+private:
+	size_t GetBrickCount() const { return size_t(brickCounts_[0]) * brickCounts_[1] * brickCounts_[2]; }
+
+	void Release() {
+		mappedFile_.Close();
+		ownedTable_.clear();
+		ownedTable_.shrink_to_fit();
+		ownedSamples_.clear();
+		ownedSamples_.shrink_to_fit();
+		coarseDistances_.clear();
+		coarseDistances_.shrink_to_fit();
+		brickTable_ = nullptr;
+		samples_ = nullptr;
+		allocatedBrickCount_ = 0;
+	}
+
+	/// <summary>
+	/// ブリックごとの粗い符号付き距離を求める(値を持つブリックを0とした3x3x3の chamfer 距離)
+	/// 前向きと後ろ向きに1回ずつなめるだけなので、ブリック数に比例する時間で済む
+	/// </summary>
+	void BuildCoarseDistances() {
+		const int countX = int(brickCounts_[0]);
+		const int countY = int(brickCounts_[1]);
+		const int countZ = int(brickCounts_[2]);
+		const float infinity = (std::numeric_limits<float>::max)();
+		coarseDistances_.assign(GetBrickCount(), infinity);
+		for (size_t brick = 0; brick < coarseDistances_.size(); ++brick) {
+			if (brickTable_[brick] != kSdfEmptyOutside && brickTable_[brick] != kSdfEmptyInside) { coarseDistances_[brick] = 0.0f; }
+		}
+		// direction が 1 なら前のブリック、-1 なら後ろのブリックから伝える
+		auto sweep = [&](int direction) {
+			for (int step = 0; step < countX * countY * countZ; ++step) {
+				int index = direction > 0 ? step : countX * countY * countZ - 1 - step;
+				int x = index % countX;
+				int y = (index / countX) % countY;
+				int z = index / (countX * countY);
+				float& distance = coarseDistances_[index];
+				for (int dz = -1; dz <= 0; ++dz) {
+					for (int dy = -1; dy <= 1; ++dy) {
+						for (int dx = -1; dx <= 1; ++dx) {
+							// 走査順で先に来る13個の近傍だけを見る
+							if (dz == 0 && (dy > 0 || (dy == 0 && dx >= 0))) { continue; }
+							int nx = x + dx * direction;
+							int ny = y + dy * direction;
+							int nz = z + dz * direction;
+							if (nx < 0 || ny < 0 || nz < 0 || nx >= countX || ny >= countY || nz >= countZ) { continue; }
+							float neighbor = coarseDistances_[nx + countX * (ny + size_t(countY) * nz)];
+							if (neighbor == infinity) { continue; }
+							distance = (std::min)(distance, neighbor + std::sqrt(float(dx * dx + dy * dy + dz * dz)));
+						}
+					}
+				}
+			}
+		};
+		sweep(1);
+		sweep(-1);
+		// ブリック数を長さに直し、内側は負にする(値を持つブリックが無ければ全て0)
+		const float brickLength = voxelSize_ * float(kSdfBrickSize);
+		for (size_t brick = 0; brick < coarseDistances_.size(); ++brick) {
+			float distance = coarseDistances_[brick] == infinity ? 0.0f : coarseDistances_[brick] * brickLength;
+			coarseDistances_[brick] = brickTable_[brick] == kSdfEmptyInside ? -distance : distance;
+		}
+	}
+
+	// 点を含むブリックの粗い距離(格子の外では格子までの距離を足す)
+	float GetCoarseDistance(const Vector3& point) const {
+		const float brickLength = voxelSize_ * float(kSdfBrickSize);
+		const float coordinates[3] = { point.x - origin_.x, point.y - origin_.y, point.z - origin_.z };
+		float outsideSquared = 0.0f;
+		size_t bricks[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			float length = float(brickCounts_[axis]) * brickLength;
+			float clamped = (std::min)((std::max)(coordinates[axis], 0.0f), length);
+			outsideSquared += (coordinates[axis] - clamped) * (coordinates[axis] - clamped);
+			bricks[axis] = (std::min)(size_t(clamped / brickLength), size_t(brickCounts_[axis]) - 1);
+		}
+		float outsideDistance = outsideSquared > 0.0f ? std::sqrt(outsideSquared) : 0.0f;
+		return coarseDistances_[bricks[0] + brickCounts_[0] * (bricks[1] + size_t(brickCounts_[1]) * bricks[2])] + outsideDistance;
+	}
+
+	// 粗い距離の中心差分(1ブリックずつずらす、正規化前)
+	Vector3 GetCoarseGradient(const Vector3& point) const {
+		if (!IsValid()) { return { 0.0f, 0.0f, 0.0f }; }
+		const float brickLength = voxelSize_ * float(kSdfBrickSize);
+		Vector3 gradient;
+		gradient.x = GetCoarseDistance(point + Vector3{ brickLength, 0.0f, 0.0f }) - GetCoarseDistance(point - Vector3{ brickLength, 0.0f, 0.0f });
+		gradient.y = GetCoarseDistance(point + Vector3{ 0.0f, brickLength, 0.0f }) - GetCoarseDistance(point - Vector3{ 0.0f, brickLength, 0.0f });
+		gradient.z = GetCoarseDistance(point + Vector3{ 0.0f, 0.0f, brickLength }) - GetCoarseDistance(point - Vector3{ 0.0f, 0.0f, brickLength });
+		return gradient;
+	}
+
+	/// <summary>
+	/// 点を含むセルの8サンプルを三線形補間する
+	/// </summary>
+	/// <param name="point">点</param>
+	/// <param name="gradient">勾配(needsGradient のとき、正規化前)</param>
+	/// <param name="needsGradient">勾配も求めるか</param>
+	float Sample(const Vector3& point, Vector3& gradient, bool needsGradient) const {
+		if (!IsValid()) {
+			gradient = { 0.0f, 0.0f, 0.0f };
+			return (std::numeric_limits<float>::max)();
+		}
+		const float inverseVoxelSize = 1.0f / voxelSize_;
+		const float coordinates[3] = {
+			(point.x - origin_.x) * inverseVoxelSize,
+			(point.y - origin_.y) * inverseVoxelSize,
+			(point.z - origin_.z) * inverseVoxelSize };
+		// 格子の中に収め、はみ出した分は後で距離に足す
+		float outsideSquared = 0.0f;
+		int bricks[3];
+		int cells[3];
+		float fractions[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			float cellCount = float(brickCounts_[axis] * kSdfBrickSize);
+			float clamped = (std::min)((std::max)(coordinates[axis], 0.0f), cellCount);
+			float outside = (coordinates[axis] - clamped) * voxelSize_;
+			outsideSquared += outside * outside;
+			int cell = (std::min)(int(clamped), int(cellCount) - 1);
+			bricks[axis] = cell / kSdfBrickSize;
+			cells[axis] = cell - bricks[axis] * kSdfBrickSize;
+			fractions[axis] = clamped - float(cell);
+		}
+		float outsideDistance = outsideSquared > 0.0f ? std::sqrt(outsideSquared) : 0.0f;
+
+		uint32_t entry = brickTable_[bricks[0] + brickCounts_[0] * (bricks[1] + size_t(brickCounts_[1]) * bricks[2])];
+		if (entry == kSdfEmptyOutside || entry == kSdfEmptyInside) {
+			gradient = { 0.0f, 0.0f, 0.0f };
+			return (entry == kSdfEmptyOutside ? bandWidth_ : -bandWidth_) + outsideDistance;
+		}
+
+		const int16_t* s = samples_ + kSdfBrickSampleCount * entry +
+			cells[0] + kSdfBrickSamples * (cells[1] + kSdfBrickSamples * cells[2]);
+		const int strideY = kSdfBrickSamples;
+		const int strideZ = kSdfBrickSamples * kSdfBrickSamples;
+		float c000 = s[0], c100 = s[1];
+		float c010 = s[strideY], c110 = s[strideY + 1];
+		float c001 = s[strideZ], c101 = s[strideZ + 1];
+		float c011 = s[strideZ + strideY], c111 = s[strideZ + strideY + 1];
+		float fx = fractions[0], fy = fractions[1], fz = fractions[2];
+		float c00 = c000 + (c100 - c000) * fx;
+		float c10 = c010 + (c110 - c010) * fx;
+		float c01 = c001 + (c101 - c001) * fx;
+		float c11 = c011 + (c111 - c011) * fx;
+		float c0 = c00 + (c10 - c00) * fy;
+		float c1 = c01 + (c11 - c01) * fy;
+		float scale = bandWidth_ / kSdfQuantizeScale;
+		if (needsGradient) {
+			// 三線形補間をそのまま微分する
+			float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+			float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+			gradient = Vector3{
+				dx0 + (dx1 - dx0) * fz,
+				(c10 - c00) + ((c11 - c01) - (c10 - c00)) * fz,
+				c1 - c0 } * (scale * inverseVoxelSize);
+		}
+		return (c0 + (c1 - c0) * fz) * scale + outsideDistance;
+	}
+
+	Vector3 origin_ = { 0.0f, 0.0f, 0.0f };
+	float voxelSize_ = 1.0f;
+	float bandWidth_ = 1.0f;
+	uint32_t brickCounts_[3] = { 0, 0, 0 };
+	size_t allocatedBrickCount_ = 0;
+
+	// 参照するデータ(Bake なら own*、Load なら割り当てたファイルを指す)
+	const uint32_t* brickTable_ = nullptr;
+	const int16_t* samples_ = nullptr;
+	std::vector<uint32_t> ownedTable_;
+	std::vector<int16_t> ownedSamples_;
+	std::vector<float> coarseDistances_;	// ブリックごとの粗い符号付き距離(読み込み・焼き込みのたびに作る)
+	MappedFile mappedFile_;
+};
+
+/// <summary>
+/// 球と距離場の衝突判定
+/// </summary>
+/// <param name="sphere">球</param>
+/// <param name="field">距離場</param>
+bool CheckCollision(const Sphere& sphere, const SignedDistanceField& field) {
+	return field.GetDistance(sphere.center) <= sphere.radius;
+}
+
+/// <summary>
+/// 球と距離場の衝突情報(法線は地形から球へ向く)
+/// 深い内側で法線が決まらないときは CheckCollision と食い違わないよう上向きで当てる
+/// </summary>
+/// <param name="sphere">球</param>
+/// <param name="field">距離場</param>
+Contact GetContact(const Sphere& sphere, const SignedDistanceField& field) {
+	Contact contact = {};
+	Vector3 normal;
+	float distance = field.GetDistance(sphere.center, normal);
+	if (distance > sphere.radius) { return contact; }
+	if (Dot(normal, normal) == 0.0f) { normal = { 0.0f, 1.0f, 0.0f }; }
+	contact.hit = true;
+	contact.normal = normal;
+	contact.point = sphere.center - normal * distance;
+	contact.penetration = sphere.radius - distance;
+	return contact;
+}
\ No newline at end of file
@@ -0,0 +1,439 @@
+#pragma once
+#include "LineList.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/// <summary>
+/// 線分の描き方
+/// </summary>
+enum class LineRasterMode {
+	Aliased,	// Bresenham相当(Noviceと同じく端点を整数に切り捨てる)
+	Antialiased	// Xiaolin Wuのアンチエイリアス
+};
+
+/// <summary>
+/// タイル分割したCPUラスタライザ
+/// 線分をタイルごとに振り分けてから、タイル単位で並列に描く
+/// 各画素の値は線分の式だけで決まるので、タイルやスレッドの分け方によらず同じ結果になる
+/// </summary>
+class TileRasterizer {
+public:
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="width">横幅</param>
+	/// <param name="height">縦幅</param>
+	/// <param name="tileSize">タイルの一辺(ピクセル)</param>
+	/// <param name="threadPool">使うスレッドプール(nullptrなら共有のもの)</param>
+	TileRasterizer(uint32_t width = 1280, uint32_t height = 720, uint32_t tileSize = 64, ThreadPool* threadPool = nullptr)
+		: width_(width), height_(height), tileSize_(tileSize),
+		threadPool_(threadPool ? threadPool : &ThreadPool::GetDefault()) {
+		tileCountX_ = (width_ + tileSize_ - 1) / tileSize_;
+		tileCountY_ = (height_ + tileSize_ - 1) / tileSize_;
+		pixels_.resize(size_t(width_) * height_);
+	}
+
+	/// <summary>
+	/// 全画素を塗りつぶす
+	/// </summary>
+	/// <param name="color">色(0xRRGGBBAA)</param>
+	void Clear(uint32_t color = 0x000000FF) {
+		std::fill(pixels_.begin(), pixels_.end(), color);
+	}
+
+	/// <summary>
+	/// 線分リストを描く
+	/// </summary>
+	/// <param name="lineList">線分リスト</param>
+	/// <param name="mode">描き方</param>
+	void Rasterize(const LineList& lineList, LineRasterMode mode = LineRasterMode::Aliased) {
+		const std::vector<ScreenLine>& lines = lineList.lines;
+		const uint32_t tileCount = tileCountX_ * tileCountY_;
+		const uint32_t chunkCount = threadPool_->GetThreadCount();
+
+		// 線分の順番を保つため、連続した範囲ごとに振り分ける
+		clippedLines_.resize(lines.size());
+		bins_.resize(size_t(chunkCount) * tileCount);
+		for (std::vector<uint32_t>& bin : bins_) {
+			bin.clear();
+		}
+		threadPool_->ParallelFor(chunkCount, 1, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t chunk = begin; chunk < end; ++chunk) {
+				size_t first = lines.size() * chunk / chunkCount;
+				size_t last = lines.size() * (chunk + 1) / chunkCount;
+				for (size_t i = first; i < last; ++i) {
+					if (ClipLine(lines[i], clippedLines_[i])) {
+						BinLine(clippedLines_[i], uint32_t(i), &bins_[chunk * tileCount]);
+					}
+				}
+			}
+		});
+
+		// タイルごとに描く(タイル同士は画素を共有しないのでロック不要)
+		threadPool_->ParallelFor(tileCount, 1, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t tile = begin; tile < end; ++tile) {
+				TileRect rect = GetTileRect(uint32_t(tile));
+				for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+					for (uint32_t lineIndex : bins_[size_t(chunk) * tileCount + tile]) {
+						if (mode == LineRasterMode::Aliased) {
+							DrawAliasedLine(lines[lineIndex], rect);
+						} else {
+							DrawAntialiasedLine(clippedLines_[lineIndex], rect);
+						}
+					}
+				}
+			}
+		});
+	}
+
+	// 画素(0xRRGGBBAA、左上から行順)
+	const std::vector<uint32_t>& GetPixels() const { return pixels_; }
+	uint32_t GetWidth() const { return width_; }
+	uint32_t GetHeight() const { return height_; }
+
+private:
+	// タイルの範囲 [x0, x1) x [y0, y1)
+	struct TileRect {
+		int x0;
+		int y0;
+		int x1;
+		int y1;
+	};
+
+	TileRect GetTileRect(uint32_t tile) const {
+		TileRect rect;
+		rect.x0 = int((tile % tileCountX_) * tileSize_);
+		rect.y0 = int((tile / tileCountX_) * tileSize_);
+		rect.x1 = (std::min)(rect.x0 + int(tileSize_), int(width_));
+		rect.y1 = (std::min)(rect.y0 + int(tileSize_), int(height_));
+		return rect;
+	}
+
+	/// <summary>
+	/// 画面より少し広い範囲で線分を切り取る(Liang-Barsky)
+	/// カメラの後ろの点などで座標が極端に大きくても、振り分けとアンチエイリアスが画面の近くだけで済むようにする
+	/// (Bresenham は傾きを変えないよう、切り取る前の端点で描く)
+	/// </summary>
+	/// <returns>範囲内に残る部分があればtrue</returns>
+	bool ClipLine(const ScreenLine& line, ScreenLine& clipped) const {
+		if (!std::isfinite(line.x0) || !std::isfinite(line.y0) || !std::isfinite(line.x1) || !std::isfinite(line.y1)) {
+			return false;
+		}
+		const float kGuard = 2.0f;
+		float dx = line.x1 - line.x0;
+		float dy = line.y1 - line.y0;
+		float p[4] = { -dx, dx, -dy, dy };
+		float q[4] = { line.x0 + kGuard, float(width_) + kGuard - line.x0, line.y0 + kGuard, float(height_) + kGuard - line.y0 };
+		float t0 = 0.0f;
+		float t1 = 1.0f;
+		for (int i = 0; i < 4; ++i) {
+			if (p[i] == 0.0f) {
+				if (q[i] < 0.0f) { return false; }
+				continue;
+			}
+			float t = q[i] / p[i];
+			if (p[i] < 0.0f) {
+				t0 = (std::max)(t0, t);
+			} else {
+				t1 = (std::min)(t1, t);
+			}
+		}
+		if (t0 > t1) {
+			return false;
+		}
+		clipped = { line.x0 + dx * t0, line.y0 + dy * t0, line.x0 + dx * t1, line.y0 + dy * t1, line.color };
+		return true;
+	}
+
+	/// <summary>
+	/// 線分が通るタイルの振り分け先に線分番号を追加
+	/// </summary>
+	void BinLine(const ScreenLine& line, uint32_t lineIndex, std::vector<uint32_t>* bins) const {
+		// アンチエイリアスでは隣の画素に、Bresenhamでは切り捨てた端点にかかるので1画素広げる
+		const float margin = 1.0f;
+		float minX = (std::min)(line.x0, line.x1) - margin;
+		float maxX = (std::max)(line.x0, line.x1) + margin;
+		float minY = (std::min)(line.y0, line.y1) - margin;
+		float maxY = (std::max)(line.y0, line.y1) + margin;
+		if (maxX < 0.0f || maxY < 0.0f || minX >= float(width_) || minY >= float(height_)) {
+			return;
+		}
+		int tileX0 = int((std::max)(minX, 0.0f)) / int(tileSize_);
+		int tileY0 = int((std::max)(minY, 0.0f)) / int(tileSize_);
+		int tileX1 = int((std::min)(maxX, float(width_ - 1))) / int(tileSize_);
+		int tileY1 = int((std::min)(maxY, float(height_ - 1))) / int(tileSize_);
+
+		// 直線の式 a x + b y + c = 0 でタイルの四隅が全部同じ側にあれば通らない
+		float a = line.y1 - line.y0;
+		float b = line.x0 - line.x1;
+		float c = -(a * line.x0 + b * line.y0);
+		float slack = (std::abs(a) + std::abs(b)) * (margin + 1.0f);
+		for (int tileY = tileY0; tileY <= tileY1; ++tileY) {
+			for (int tileX = tileX0; tileX <= tileX1; ++tileX) {
+				TileRect rect = GetTileRect(uint32_t(tileY) * tileCountX_ + uint32_t(tileX));
+				float d0 = a * float(rect.x0) + b * float(rect.y0) + c;
+				float d1 = a * float(rect.x1) + b * float(rect.y0) + c;
+				float d2 = a * float(rect.x0) + b * float(rect.y1) + c;
+				float d3 = a * float(rect.x1) + b * float(rect.y1) + c;
+				float dMin = (std::min)((std::min)(d0, d1), (std::min)(d2, d3));
+				float dMax = (std::max)((std::max)(d0, d1), (std::max)(d2, d3));
+				if (dMin > slack || dMax < -slack) {
+					continue;
+				}
+				bins[tileY * tileCountX_ + tileX].push_back(lineIndex);
+			}
+		}
+	}
+
+	/// <summary>
+	/// 画素に色を重ねる
+	/// </summary>
+	/// <param name="x">x座標</param>
+	/// <param name="y">y座標</param>
+	/// <param name="color">色(0xRRGGBBAA)</param>
+	/// <param name="coverage">被覆率(0~1)</param>
+	void BlendPixel(int x, int y, uint32_t color, float coverage) {
+		uint32_t& destination = pixels_[size_t(y) * width_ + size_t(x)];
+		float alpha = float(color & 0xFF) / 255.0f * coverage;
+		if (alpha >= 1.0f) {
+			destination = color;
+			return;
+		}
+		if (alpha <= 0.0f) {
+			return;
+		}
+		uint32_t result = 0;
+		for (int shift = 8; shift <= 24; shift += 8) {
+			float source = float((color >> shift) & 0xFF);
+			float target = float((destination >> shift) & 0xFF);
+			result |= uint32_t(source * alpha + target * (1.0f - alpha) + 0.5f) << shift;
+		}
+		float targetAlpha = float(destination & 0xFF) / 255.0f;
+		result |= uint32_t((alpha + targetAlpha * (1.0f - alpha)) * 255.0f + 0.5f);
+		destination = result;
+	}
+
+	/// <summary>
+	/// Bresenham相当の線分をタイル内だけ描く
+	/// 主軸の各整数座標で副軸を丸めて求めるので、描く範囲を切り出しても結果は変わらない
+	/// 端点は切り取る前の線分のものを切り捨てて使う(切り取った端点を切り捨てると傾きが変わり、画面の端にかかる線分だけずれる)
+	/// 画面外の極端な座標でも int に溢れないよう、タイルの範囲に収めてから整数にする
+	/// </summary>
+	void DrawAliasedLine(const ScreenLine& line, const TileRect& rect) {
+		double x0 = std::trunc(double(line.x0));
+		double y0 = std::trunc(double(line.y0));
+		double x1 = std::trunc(double(line.x1));
+		double y1 = std::trunc(double(line.y1));
+		double dx = x1 - x0;
+		double dy = y1 - y0;
+		bool isSteep = std::abs(dy) > std::abs(dx);
+		if (isSteep) {
+			std::swap(x0, y0);
+			std::swap(x1, y1);
+			std::swap(dx, dy);
+		}
+		if (dx < 0.0) {
+			std::swap(x0, x1);
+			std::swap(y0, y1);
+			dx = -dx;
+			dy = -dy;
+		}
+		double slope = dx == 0.0 ? 0.0 : dy / dx;
+
+		// 主軸・副軸でのタイルの範囲
+		int majorBegin = isSteep ? rect.y0 : rect.x0;
+		int majorEnd = isSteep ? rect.y1 : rect.x1;
+		int minorBegin = isSteep ? rect.x0 : rect.y0;
+		int minorEnd = isSteep ? rect.x1 : rect.y1;
+
+		double begin = (std::max)(x0, double(majorBegin));
+		double end = (std::min)(x1, double(majorEnd - 1));
+		if (begin > end) { return; }
+		for (int major = int(begin); major <= int(end); ++major) {
+			double minor = std::floor(y0 + (double(major) - x0) * slope + 0.5);
+			if (minor < double(minorBegin) || minor >= double(minorEnd)) { continue; }
+			if (isSteep) {
+				BlendPixel(int(minor), major, line.color, 1.0f);
+			} else {
+				BlendPixel(major, int(minor), line.color, 1.0f);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Xiaolin Wuのアンチエイリアス線分をタイル内だけ描く
+	/// 主軸の各画素中心で線分の位置を求め、上下2画素に距離で按分する
+	/// </summary>
+	void DrawAntialiasedLine(const ScreenLine& line, const TileRect& rect) {
+		float x0 = line.x0;
+		float y0 = line.y0;
+		float x1 = line.x1;
+		float y1 = line.y1;
+		bool isSteep = std::abs(y1 - y0) > std::abs(x1 - x0);
+		if (isSteep) {
+			std::swap(x0, y0);
+			std::swap(x1, y1);
+		}
+		if (x0 > x1) {
+			std::swap(x0, x1);
+			std::swap(y0, y1);
+		}
+		float slope = x1 == x0 ? 0.0f : (y1 - y0) / (x1 - x0);
+
+		// 主軸・副軸でのタイルの範囲
+		int majorBegin = isSteep ? rect.y0 : rect.x0;
+		int majorEnd = isSteep ? rect.y1 : rect.x1;
+		int minorBegin = isSteep ? rect.x0 : rect.y0;
+		int minorEnd = isSteep ? rect.x1 : rect.y1;
+
+		int begin = (std::max)(int(std::ceil(x0 - 0.5f)), majorBegin);
+		int end = (std::min)(int(std::floor(x1 - 0.5f)), majorEnd - 1);
+		for (int major = begin; major <= end; ++major) {
+			float center = y0 + (float(major) + 0.5f - x0) * slope - 0.5f;
+			int minor = int(std::floor(center));
+			float fraction = center - float(minor);
+			for (int k = 0; k < 2; ++k) {
+				int m = minor + k;
+				if (m < minorBegin || m >= minorEnd) { continue; }
+				float coverage = k == 0 ? 1.0f - fraction : fraction;
+				if (isSteep) {
+					BlendPixel(m, major, line.color, coverage);
+				} else {
+					BlendPixel(major, m, line.color, coverage);
+				}
+			}
+		}
+	}
+
+	uint32_t width_;
+	uint32_t height_;
+	uint32_t tileSize_;
+	uint32_t tileCountX_;
+	uint32_t tileCountY_;
+	ThreadPool* threadPool_;
+	std::vector<uint32_t> pixels_;
+	std::vector<ScreenLine> clippedLines_; // 画面の範囲で切り取った線分(振り分けとアンチエイリアスに使う)
+	std::vector<std::vector<uint32_t>> bins_; // [chunk][tile] の線分番号
+};
+
+/// <summary>
+/// 画素をRGBAの生データとして書き出す
+/// </summary>
+/// <param name="path">出力先</param>
+/// <param name="pixels">画素(0xRRGGBBAA)</param>
+/// <param name="width">横幅</param>
+/// <param name="height">縦幅</param>
+bool WriteRawRgba(const char* path, const uint32_t* pixels, uint32_t width, uint32_t height) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) { return false; }
+	std::vector<unsigned char> row(size_t(width) * 4);
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			uint32_t color = pixels[size_t(y) * width + x];
+			row[x * 4 + 0] = (unsigned char)(color >> 24);
+			row[x * 4 + 1] = (unsigned char)(color >> 16);
+			row[x * 4 + 2] = (unsigned char)(color >> 8);
+			row[x * 4 + 3] = (unsigned char)(color);
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), std::streamsize(row.size()));
+	}
+	return bool(file);
+}
+
+/// <summary>
+/// 画素をPNGとして書き出す
+/// 外部ライブラリに頼らないよう、無圧縮のdeflateブロックで格納する
+/// </summary>
+/// <param name="path">出力先</param>
+/// <param name="pixels">画素(0xRRGGBBAA)</param>
+/// <param name="width">横幅</param>
+/// <param name="height">縦幅</param>
+bool WritePng(const char* path, const uint32_t* pixels, uint32_t width, uint32_t height) {
+	static const auto crcTable = [] {
+		std::vector<uint32_t> table(256);
+		for (uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k) {
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+		return table;
+	}();
+	auto crc32 = [](const unsigned char* data, size_t size) {
+		uint32_t c = 0xFFFFFFFFu;
+		for (size_t i = 0; i < size; ++i) {
+			c = crcTable[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+		}
+		return c ^ 0xFFFFFFFFu;
+	};
+	auto putUint32 = [](std::vector<unsigned char>& out, uint32_t value) {
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)(value));
+	};
+	auto writeChunk = [&](std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+		std::vector<unsigned char> chunk;
+		chunk.reserve(data.size() + 12);
+		putUint32(chunk, uint32_t(data.size()));
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		putUint32(chunk, crc32(chunk.data() + 4, data.size() + 4));
+		file.write(reinterpret_cast<const char*>(chunk.data()), std::streamsize(chunk.size()));
+	};
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file) { return false; }
+	static const unsigned char kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write(reinterpret_cast<const char*>(kSignature), 8);
+
+	// 8bit RGBA
+	std::vector<unsigned char> header;
+	putUint32(header, width);
+	putUint32(header, height);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+	writeChunk(file, "IHDR", header);
+
+	// 各行の先頭にフィルタ種別(0)を付けた生データ
+	std::vector<unsigned char> raw;
+	raw.reserve(size_t(height) * (size_t(width) * 4 + 1));
+	for (uint32_t y = 0; y < height; ++y) {
+		raw.push_back(0);
+		for (uint32_t x = 0; x < width; ++x) {
+			putUint32(raw, pixels[size_t(y) * width + x]);
+		}
+	}
+
+	// zlib(無圧縮ブロック) + Adler-32
+	std::vector<unsigned char> zlib;
+	zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	size_t offset = 0;
+	do {
+		size_t blockSize = (std::min)(raw.size() - offset, size_t(65535));
+		bool isFinal = offset + blockSize == raw.size();
+		zlib.push_back(isFinal ? 1 : 0);
+		zlib.push_back((unsigned char)(blockSize & 0xFF));
+		zlib.push_back((unsigned char)(blockSize >> 8));
+		zlib.push_back((unsigned char)(~blockSize & 0xFF));
+		zlib.push_back((unsigned char)((~blockSize >> 8) & 0xFF));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < raw.size());
+	uint32_t adlerA = 1;
+	uint32_t adlerB = 0;
+	for (unsigned char byte : raw) {
+		adlerA = (adlerA + byte) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+	putUint32(zlib, (adlerB << 16) | adlerA);
+	writeChunk(file, "IDAT", zlib);
+	writeChunk(file, "IEND", {});
+	return bool(file);
+}
\ No newline at end of file
@@ -0,0 +1,204 @@
+#pragma once
+#include "Matrix4x4.h"
+#include "Shape.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/// <summary>
+/// 動かない線分の集まり(グリッドや静的な平面・三角形・AABB)を保持するバッファ
+/// ワールド座標は登録時に一度だけ求め、スクリーン座標はカメラ行列が変わったときだけ変換し直す
+/// </summary>
+class StaticLineBuffer {
+public:
+	// スクリーン座標(描画用に整数化済み)
+	struct ScreenPoint {
+		int x;
+		int y;
+	};
+
+	/// <summary>
+	/// 線分リストを登録
+	/// </summary>
+	/// <param name="vertices">ワールド座標の頂点</param>
+	/// <param name="vertexCount">頂点数</param>
+	/// <param name="indices">線分ごとの頂点番号(2つで1本)</param>
+	/// <param name="indexCount">頂点番号の数</param>
+	/// <param name="color">色</param>
+	/// <returns>登録番号</returns>
+	uint32_t AddLines(const Vector3* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, uint32_t color) {
+		uint32_t baseVertex = uint32_t(worldVertices_.size());
+		Batch batch;
+		batch.firstIndex = uint32_t(indices_.size());
+		batch.indexCount = uint32_t(indexCount);
+		batch.color = color;
+		batch.visible = true;
+
+		worldVertices_.insert(worldVertices_.end(), vertices, vertices + vertexCount);
+		for (size_t i = 0; i < indexCount; ++i) {
+			indices_.push_back(baseVertex + indices[i]);
+		}
+		batches_.push_back(batch);
+		isDirty_ = true;
+		return uint32_t(batches_.size() - 1);
+	}
+
+	/// <summary>
+	/// グリッドを登録
+	/// </summary>
+	/// <param name="halfWidth">半分の幅</param>
+	/// <param name="subdivision">分割数</param>
+	/// <param name="color">色</param>
+	uint32_t AddGrid(float halfWidth = 2.0f, uint32_t subdivision = 10, uint32_t color = 0xAAAAAAFF) {
+		const float every = (halfWidth * 2.0f) / float(subdivision); // 1つ分の長さ
+		std::vector<Vector3> vertices;
+		std::vector<uint32_t> indices;
+		vertices.reserve((subdivision + 1) * 4);
+		indices.reserve((subdivision + 1) * 4);
+		for (uint32_t index = 0; index <= subdivision; ++index) {
+			float offset = -halfWidth + every * float(index);
+			// 奥から手前への線
+			vertices.push_back({ offset, 0.0f, -halfWidth });
+			vertices.push_back({ offset, 0.0f, halfWidth });
+			// 左から右への線
+			vertices.push_back({ -halfWidth, 0.0f, offset });
+			vertices.push_back({ halfWidth, 0.0f, offset });
+		}
+		for (uint32_t i = 0; i < uint32_t(vertices.size()); ++i) {
+			indices.push_back(i);
+		}
+		return AddLines(vertices.data(), vertices.size(), indices.data(), indices.size(), color);
+	}
+
+	/// <summary>
+	/// 平面を登録(DrawPlaneと同じ形)
+	/// </summary>
+	/// <param name="plane">平面</param>
+	/// <param name="color">色</param>
+	uint32_t AddPlane(const Plane& plane, uint32_t color) {
+		Vector3 center = Multiply(plane.distance, plane.normal);
+		Vector3 perpendiculars[4];
+		perpendiculars[0] = Normalize(Perpendicular(plane.normal));
+		perpendiculars[1] = -perpendiculars[0];
+		perpendiculars[2] = Cross(plane.normal, perpendiculars[0]);
+		perpendiculars[3] = -perpendiculars[2];
+		Vector3 vertices[4];
+		for (int32_t index = 0; index < 4; ++index) {
+			vertices[index] = Add(center, Multiply(2.0f, perpendiculars[index]));
+		}
+		static const uint32_t kIndices[8] = { 0,2, 2,1, 1,3, 3,0 };
+		return AddLines(vertices, 4, kIndices, 8, color);
+	}
+
+	/// <summary>
+	/// 三角形を登録
+	/// </summary>
+	/// <param name="triangle">三角形</param>
+	/// <param name="color">色</param>
+	uint32_t AddTriangle(const Triangle& triangle, uint32_t color) {
+		static const uint32_t kIndices[6] = { 0,1, 1,2, 2,0 };
+		return AddLines(triangle.vertices, 3, kIndices, 6, color);
+	}
+
+	/// <summary>
+	/// AABBを登録
+	/// </summary>
+	/// <param name="aabb">AABB</param>
+	/// <param name="color">色</param>
+	uint32_t AddAABB(const AABB& aabb, uint32_t color) {
+		Vector3 vertices[8] = {
+			{ aabb.min.x, aabb.min.y, aabb.min.z },
+			{ aabb.max.x, aabb.min.y, aabb.min.z },
+			{ aabb.min.x, aabb.max.y, aabb.min.z },
+			{ aabb.max.x, aabb.max.y, aabb.min.z },
+			{ aabb.min.x, aabb.min.y, aabb.max.z },
+			{ aabb.max.x, aabb.min.y, aabb.max.z },
+			{ aabb.min.x, aabb.max.y, aabb.max.z },
+			{ aabb.max.x, aabb.max.y, aabb.max.z },
+		};
+		static const uint32_t kIndices[24] = {
+			0,1, 1,3, 3,2, 2,0, // 下面
+			4,5, 5,7, 7,6, 6,4, // 上面
+			0,4, 1,5, 2,6, 3,7  // 側面
+		};
+		return AddLines(vertices, 8, kIndices, 24, color);
+	}
+
+	/// <summary>
+	/// 表示・非表示の切り替え
+	/// </summary>
+	/// <param name="handle">登録番号</param>
+	/// <param name="visible">表示するか</param>
+	void SetVisible(uint32_t handle, bool visible) {
+		batches_[handle].visible = visible;
+	}
+
+	// 登録をすべて消す
+	void Clear() {
+		worldVertices_.clear();
+		screenVertices_.clear();
+		indices_.clear();
+		batches_.clear();
+		isDirty_ = true;
+	}
+
+	/// <summary>
+	/// スクリーン座標を更新(行列が前回と同じなら何もしない)
+	/// </summary>
+	/// <param name="screenTransformMatrix">ビューx射影xビューポート行列</param>
+	/// <returns>変換し直したらtrue</returns>
+	bool Update(const Matrix4x4& screenTransformMatrix) {
+		if (!isDirty_ && std::memcmp(&screenTransformMatrix, &cachedMatrix_, sizeof(Matrix4x4)) == 0) {
+			return false;
+		}
+		cachedMatrix_ = screenTransformMatrix;
+		isDirty_ = false;
+
+		screenVertices_.resize(worldVertices_.size());
+		for (size_t i = 0; i < worldVertices_.size(); ++i) {
+			Vector3 screen = TransformVector(worldVertices_[i], screenTransformMatrix);
+			screenVertices_[i] = { int(screen.x), int(screen.y) };
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// 変換済みの線分を描画関数に渡す
+	/// </summary>
+	/// <param name="drawLine">drawLine(x0, y0, x1, y1, color)</param>
+	template<typename DrawLineFunction>
+	void Submit(DrawLineFunction&& drawLine) const {
+		for (const Batch& batch : batches_) {
+			if (!batch.visible) { continue; }
+			const uint32_t* indices = indices_.data() + batch.firstIndex;
+			for (uint32_t i = 0; i + 1 < batch.indexCount; i += 2) {
+				const ScreenPoint& p0 = screenVertices_[indices[i]];
+				const ScreenPoint& p1 = screenVertices_[indices[i + 1]];
+				drawLine(p0.x, p0.y, p1.x, p1.y, batch.color);
+			}
+		}
+	}
+
+	// 登録されている頂点
+	const std::vector<Vector3>& GetWorldVertices() const { return worldVertices_; }
+	// 変換済みの頂点
+	const std::vector<ScreenPoint>& GetScreenVertices() const { return screenVertices_; }
+	// 線分の頂点番号
+	const std::vector<uint32_t>& GetIndices() const { return indices_; }
+
+private:
+	// 登録単位
+	struct Batch {
+		uint32_t firstIndex;	// indices_ の先頭位置
+		uint32_t indexCount;	// 頂点番号の数
+		uint32_t color;			// 色
+		bool visible;			// 表示するか
+	};
+
+	std::vector<Vector3> worldVertices_;
+	std::vector<ScreenPoint> screenVertices_;
+	std::vector<uint32_t> indices_;
+	std::vector<Batch> batches_;
+	Matrix4x4 cachedMatrix_ = {};
+	bool isDirty_ = true;
+};
\ No newline at end of file
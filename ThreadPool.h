@@ -0,0 +1,148 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// 常駐するワーカースレッドで範囲を分割して処理する
+/// 毎フレーム呼んでもスレッドの生成コストがかからないようにしている
+/// </summary>
+class ThreadPool {
+public:
+	// func(begin, end, workerIndex) workerIndex は 0 ~ GetThreadCount() - 1
+	using RangeFunction = std::function<void(size_t, size_t, uint32_t)>;
+
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="threadCount">呼び出し元を含めたスレッド数(0ならコア数)</param>
+	explicit ThreadPool(uint32_t threadCount = 0) {
+		if (threadCount == 0) {
+			threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+		}
+		threadCount_ = threadCount;
+		for (uint32_t i = 1; i < threadCount_; ++i) {
+			workers_.emplace_back([this, i] { WorkerLoop(i); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			isQuit_ = true;
+			++generation_;
+		}
+		wakeCondition_.notify_all();
+		for (std::thread& worker : workers_) {
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// 呼び出し元を含めたスレッド数
+	uint32_t GetThreadCount() const { return threadCount_; }
+
+	/// <summary>
+	/// [0, count) を grainSize ずつに分けて全スレッドで処理し、終わるまで待つ
+	/// ワーカーの中から呼ばれた場合はその場で逐次処理する
+	/// </summary>
+	/// <param name="count">要素数</param>
+	/// <param name="grainSize">一度に取る要素数</param>
+	/// <param name="func">func(begin, end, workerIndex)</param>
+	void ParallelFor(size_t count, size_t grainSize, const RangeFunction& func) {
+		if (count == 0) { return; }
+		if (grainSize == 0) { grainSize = 1; }
+		if (threadCount_ == 1 || count <= grainSize || IsWorkerThread()) {
+			func(0, count, 0);
+			return;
+		}
+
+		std::lock_guard<std::mutex> submitLock(submitMutex_);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job_ = &func;
+			jobCount_ = count;
+			jobGrainSize_ = grainSize;
+			next_.store(0, std::memory_order_relaxed);
+			activeWorkers_ = uint32_t(workers_.size());
+			++generation_;
+		}
+		wakeCondition_.notify_all();
+
+		// 呼び出し元も0番として処理に加わる
+		RunJob(0);
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		doneCondition_.wait(lock, [this] { return activeWorkers_ == 0; });
+		job_ = nullptr;
+	}
+
+	/// <summary>
+	/// 共有のスレッドプール
+	/// </summary>
+	static ThreadPool& GetDefault() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+private:
+	static bool& IsWorkerThread() {
+		thread_local bool isWorker = false;
+		return isWorker;
+	}
+
+	void RunJob(uint32_t workerIndex) {
+		for (;;) {
+			size_t begin = next_.fetch_add(jobGrainSize_, std::memory_order_relaxed);
+			if (begin >= jobCount_) {
+				break;
+			}
+			size_t end = (std::min)(begin + jobGrainSize_, jobCount_);
+			(*job_)(begin, end, workerIndex);
+		}
+	}
+
+	void WorkerLoop(uint32_t workerIndex) {
+		IsWorkerThread() = true;
+		uint64_t seenGeneration = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wakeCondition_.wait(lock, [&] { return generation_ != seenGeneration; });
+				seenGeneration = generation_;
+				if (isQuit_) {
+					return;
+				}
+			}
+			RunJob(workerIndex);
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				--activeWorkers_;
+			}
+			doneCondition_.notify_one();
+		}
+	}
+
+	uint32_t threadCount_ = 1;
+	std::vector<std::thread> workers_;
+	std::mutex submitMutex_;	// 同時に一つのジョブだけ受け付ける
+	std::mutex mutex_;
+	std::condition_variable wakeCondition_;
+	std::condition_variable doneCondition_;
+	uint64_t generation_ = 0;
+	bool isQuit_ = false;
+	uint32_t activeWorkers_ = 0;
+
+	// 実行中のジョブ
+	const RangeFunction* job_ = nullptr;
+	size_t jobCount_ = 0;
+	size_t jobGrainSize_ = 1;
+	std::atomic<size_t> next_{ 0 };
+};
\ No newline at end of file
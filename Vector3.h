@@ -1,42 +1,49 @@
 #pragma once
 #include <cmath>
+#include <type_traits>
 
-struct Vector3 {
-	float x;
-	float y;
-	float z;
+// 3次元ベクトル(T は float/double のほか、LaneMath.h の Float4 などのレーン型も使える)
+template<typename T>
+struct Vector3T {
+	T x;
+	T y;
+	T z;
 
-	Vector3& operator*=(float s) {
+	Vector3T& operator*=(T s) {
 		x *= s;
 		y *= s;
 		z *= s;
 		return *this;
 	}
 
-	Vector3& operator-=(const Vector3& v) {
+	Vector3T& operator-=(const Vector3T& v) {
 		x -= v.x;
 		y -= v.y;
 		z -= v.z;
 		return *this;
 	}
 
-	Vector3& operator+=(const Vector3& v) {
+	Vector3T& operator+=(const Vector3T& v) {
 		x += v.x;
 		y += v.y;
 		z += v.z;
 		return *this;
 	}
 
-	Vector3& operator/=(float s) {
-		if (s != 0.0f) {
-			x /= s;
-			y /= s;
-			z /= s;
+	Vector3T& operator/=(T s) {
+		// レーン型は分岐できないのでそのまま割る
+		if constexpr (std::is_arithmetic_v<T>) {
+			if (s == T(0)) { return *this; }
 		}
+		x /= s;
+		y /= s;
+		z /= s;
 		return *this;
 	}
 };
 
+using Vector3 = Vector3T<float>;
+
 // 3次元ベクトル加算
 Vector3 Add(const Vector3& v1, const Vector3& v2) {
 	Vector3 result;
@@ -76,10 +83,11 @@ float Length(const Vector3& v) {
 
 // 3次元ベクトルの正規化
 Vector3 Normalize(const Vector3& v) {
+	float inverseLength = 1.0f / Length(v);
 	Vector3 result;
-	result.x = v.x / Length(v);
-	result.y = v.y / Length(v);
-	result.z = v.z / Length(v);
+	result.x = v.x * inverseLength;
+	result.y = v.y * inverseLength;
+	result.z = v.z * inverseLength;
 	return result;
 }
 
@@ -92,6 +100,14 @@ Vector3 Cross(const Vector3& v1, const Vector3& v2) {
 	return result;
 };
 
+// 垂直ベクトルを求める
+Vector3 Perpendicular(const Vector3& vector) {
+	if (vector.x != 0.0f || vector.y != 0.0f) {
+		return { -vector.y,vector.x,0.0f };
+	}
+	return { 0.0f,-vector.z,vector.y };
+}
+
 // 線形補間
 Vector3 Lerp(const Vector3& v1, const Vector3& v2, float t) {
 	return {
@@ -101,30 +117,38 @@ Vector3 Lerp(const Vector3& v1, const Vector3& v2, float t) {
 	};
 }
 
-Vector3 operator+(const Vector3& v1, const Vector3& v2) {
-	return Add(v1, v2);
+// 演算子はスカラー型 T のテンプレートで、Vector3T<double> やレーン型にもそのまま使える
+template<typename T>
+Vector3T<T> operator+(const Vector3T<T>& v1, const Vector3T<T>& v2) {
+	return { v1.x + v2.x, v1.y + v2.y, v1.z + v2.z };
 }
 
-Vector3 operator-(const Vector3& v1, const Vector3& v2) {
-	return Subtract(v1, v2);
+template<typename T>
+Vector3T<T> operator-(const Vector3T<T>& v1, const Vector3T<T>& v2) {
+	return { v1.x - v2.x, v1.y - v2.y, v1.z - v2.z };
 }
 
-Vector3 operator*(float scalar, const Vector3& v) {
-	return Multiply(scalar, v);
+template<typename T>
+Vector3T<T> operator*(std::type_identity_t<T> scalar, const Vector3T<T>& v) {
+	return { scalar * v.x, scalar * v.y, scalar * v.z };
 }
 
-Vector3 operator*(const Vector3& v, float scalar) {
+template<typename T>
+Vector3T<T> operator*(const Vector3T<T>& v, std::type_identity_t<T> scalar) {
 	return scalar * v;
 }
 
-Vector3 operator/(const Vector3& v, float scalar) {
-	return Multiply(1.0f / scalar, v);
+template<typename T>
+Vector3T<T> operator/(const Vector3T<T>& v, std::type_identity_t<T> scalar) {
+	return (T(1) / scalar) * v;
 }
 
-Vector3 operator-(const Vector3& v) {
+template<typename T>
+Vector3T<T> operator-(const Vector3T<T>& v) {
 	return { -v.x, -v.y, -v.z };
 }
 
-Vector3 operator+(const Vector3& v) {
+template<typename T>
+Vector3T<T> operator+(const Vector3T<T>& v) {
 	return v;
 }
\ No newline at end of file
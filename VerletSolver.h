@@ -0,0 +1,420 @@
+#pragma once
+#include "LineList.h"
+#include "Matrix4x4.h"
+#include "Profiler.h"
+#include "Shape.h"
+#include "SignedDistanceField.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// 位置ベース(Verlet)のロープ・布
+// 粒子と距離拘束は SoA で持ち、同じ粒子を共有しない拘束を同じ色(バッチ)にまとめる
+// 同じ色の拘束は書き込む粒子が重ならないので、ロック無しで並列に解ける
+// 色が足りない拘束(多くの拘束が集まる粒子)は最後にまとめて1スレッドで解く
+
+static const uint32_t kVerletMaxColors = 64;		// 拘束の色の上限(これを超えた拘束は順番に解く)
+static const size_t kVerletGrainSize = 2048;		// 並列処理の1回の区切り
+
+// 粒子(SoA)
+struct VerletParticles {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> previousX;	// 1ステップ前の位置
+	std::vector<float> previousY;
+	std::vector<float> previousZ;
+	std::vector<float> inverseMass;	// 0なら固定
+
+	size_t Size() const { return x.size(); }
+
+	Vector3 GetPosition(uint32_t index) const { return { x[index], y[index], z[index] }; }
+
+	void SetPosition(uint32_t index, const Vector3& position) {
+		x[index] = position.x;
+		y[index] = position.y;
+		z[index] = position.z;
+	}
+};
+
+// 距離拘束(SoA、色ごとに並べ替え済み)
+struct DistanceConstraints {
+	std::vector<uint32_t> indexA;
+	std::vector<uint32_t> indexB;
+	std::vector<float> restLength;
+	std::vector<uint32_t> colorStarts;	// 色 c の拘束は [colorStarts[c], colorStarts[c + 1])、残りは色の無い拘束
+
+	size_t Size() const { return indexA.size(); }
+};
+
+/// <summary>
+/// ロープと布のシミュレーション
+/// </summary>
+class VerletSolver {
+public:
+	explicit VerletSolver(ThreadPool* threadPool = nullptr)
+		: threadPool_(threadPool ? threadPool : &ThreadPool::GetDefault()) {}
+
+	Vector3 gravity = { 0.0f, -9.8f, 0.0f };
+	float damping = 0.6f;			// 速度の減衰率(1秒で exp(-damping) 倍になる、60Hz で1ステップ 1% 相当)
+	uint32_t iterations = 8;		// 拘束の反復回数
+	float stiffness = 1.0f;			// 1回の反復で直す割合(0~1)
+	float friction = 0.3f;			// 図形に当たったときに失う速度の割合(0~1)
+
+	/// <summary>
+	/// 粒子を追加
+	/// </summary>
+	/// <param name="position">位置</param>
+	/// <param name="inverseMass">質量の逆数(0なら固定)</param>
+	/// <returns>粒子の番号</returns>
+	uint32_t AddParticle(const Vector3& position, float inverseMass = 1.0f) {
+		particles_.x.push_back(position.x);
+		particles_.y.push_back(position.y);
+		particles_.z.push_back(position.z);
+		particles_.previousX.push_back(position.x);
+		particles_.previousY.push_back(position.y);
+		particles_.previousZ.push_back(position.z);
+		particles_.inverseMass.push_back(inverseMass);
+		return uint32_t(particles_.Size() - 1);
+	}
+
+	/// <summary>
+	/// 距離拘束を追加(色分けは次の Step でまとめて行う)
+	/// </summary>
+	/// <param name="a">粒子の番号</param>
+	/// <param name="b">粒子の番号</param>
+	/// <param name="isVisible">描画するか(布の斜めの拘束などは false)</param>
+	void AddConstraint(uint32_t a, uint32_t b, bool isVisible = true) {
+		float restLength = Length(Subtract(particles_.GetPosition(b), particles_.GetPosition(a)));
+		pendingA_.push_back(a);
+		pendingB_.push_back(b);
+		pendingRestLength_.push_back(restLength);
+		if (isVisible) {
+			lineIndices_.push_back(a);
+			lineIndices_.push_back(b);
+		}
+		isDirty_ = true;
+	}
+
+	/// <summary>
+	/// ロープを作る
+	/// </summary>
+	/// <param name="start">始点</param>
+	/// <param name="end">終点</param>
+	/// <param name="segmentCount">分割数(0なら始点に粒子を1つだけ置く)</param>
+	/// <param name="isStartPinned">始点を固定するか</param>
+	/// <returns>始点の粒子の番号</returns>
+	uint32_t CreateRope(const Vector3& start, const Vector3& end, uint32_t segmentCount, bool isStartPinned = true) {
+		uint32_t first = uint32_t(particles_.Size());
+		for (uint32_t i = 0; i <= segmentCount; ++i) {
+			float t = segmentCount > 0 ? float(i) / float(segmentCount) : 0.0f;
+			AddParticle(Lerp(start, end, t), (i == 0 && isStartPinned) ? 0.0f : 1.0f);
+			if (i > 0) {
+				AddConstraint(first + i - 1, first + i);
+			}
+		}
+		return first;
+	}
+
+	/// <summary>
+	/// 格子状の布を作る(縦横の拘束と、ゆがみを防ぐ斜めの拘束)
+	/// </summary>
+	/// <param name="origin">角の位置</param>
+	/// <param name="edgeU">横の辺</param>
+	/// <param name="edgeV">縦の辺</param>
+	/// <param name="countU">横の粒子数(1なら edgeU を使わず1列、0なら何も作らない)</param>
+	/// <param name="countV">縦の粒子数(1なら edgeV を使わず1行、0なら何も作らない)</param>
+	/// <param name="isFirstRowPinned">v = 0 の列を固定するか</param>
+	/// <returns>角の粒子の番号(粒子は u が先に並ぶ)</returns>
+	uint32_t CreateCloth(const Vector3& origin, const Vector3& edgeU, const Vector3& edgeV, uint32_t countU, uint32_t countV, bool isFirstRowPinned = true) {
+		uint32_t first = uint32_t(particles_.Size());
+		// 粒子が1つの向きは辺の始まりに置く
+		const float stepU = countU > 1 ? 1.0f / float(countU - 1) : 0.0f;
+		const float stepV = countV > 1 ? 1.0f / float(countV - 1) : 0.0f;
+		for (uint32_t v = 0; v < countV; ++v) {
+			for (uint32_t u = 0; u < countU; ++u) {
+				Vector3 position = Add(origin, Add(Multiply(float(u) * stepU, edgeU), Multiply(float(v) * stepV, edgeV)));
+				AddParticle(position, (v == 0 && isFirstRowPinned) ? 0.0f : 1.0f);
+			}
+		}
+		auto index = [&](uint32_t u, uint32_t v) { return first + v * countU + u; };
+		for (uint32_t v = 0; v < countV; ++v) {
+			for (uint32_t u = 0; u < countU; ++u) {
+				if (u + 1 < countU) { AddConstraint(index(u, v), index(u + 1, v)); }
+				if (v + 1 < countV) { AddConstraint(index(u, v), index(u, v + 1)); }
+				if (u + 1 < countU && v + 1 < countV) {
+					AddConstraint(index(u, v), index(u + 1, v + 1), false);
+					AddConstraint(index(u + 1, v), index(u, v + 1), false);
+				}
+			}
+		}
+		return first;
+	}
+
+	// 当たる図形を追加
+	void AddCollider(const Sphere& sphere) { spheres_.push_back(sphere); }
+	void AddCollider(const Plane& plane) { planes_.push_back(plane); }
+	void AddCollider(const AABB& aabb) { aabbs_.push_back(aabb); }
+	// 静的な地形の距離場(図形の数によらず粒子ごとに1回の参照で済む、nullptrで外す)
+	void SetStaticField(const SignedDistanceField* field) { staticField_ = field; }
+
+	// 当たる図形を全て消す(動く図形は毎フレーム登録し直す)
+	void ClearColliders() {
+		spheres_.clear();
+		planes_.clear();
+		aabbs_.clear();
+	}
+
+	// 粒子を動かす(固定した粒子をつかんで動かすときなど)
+	void SetParticlePosition(uint32_t index, const Vector3& position, bool isTeleport = false) {
+		particles_.SetPosition(index, position);
+		if (isTeleport) {
+			particles_.previousX[index] = position.x;
+			particles_.previousY[index] = position.y;
+			particles_.previousZ[index] = position.z;
+		}
+	}
+
+	const VerletParticles& GetParticles() const { return particles_; }
+	const DistanceConstraints& GetConstraints() const { return constraints_; }
+	uint32_t GetColorCount() const { return constraints_.colorStarts.empty() ? 0 : uint32_t(constraints_.colorStarts.size() - 1); }
+
+	/// <summary>
+	/// 時間を進める
+	/// </summary>
+	/// <param name="deltaTime">経過時間(秒)</param>
+	void Step(float deltaTime) {
+		MT3_PROFILE_SCOPE("VerletSolver::Step");
+		if (isDirty_) {
+			BuildBatches();
+		}
+		Integrate(deltaTime);
+		for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+			SolveConstraints();
+		}
+		SolveCollisions();
+	}
+
+	/// <summary>
+	/// 拘束を線分として描画する
+	/// </summary>
+	/// <param name="lineList">線分を積む先</param>
+	/// <param name="viewProjectionMatrix">ビュー射影行列</param>
+	/// <param name="viewportMatrix">ビューポート行列</param>
+	/// <param name="color">色</param>
+	void Draw(LineList& lineList, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
+		MT3_PROFILE_SCOPE("VerletSolver::Draw");
+		// 粒子ごとに1回だけ変換する
+		Matrix4x4 worldToScreen = Multiply(viewProjectionMatrix, viewportMatrix);
+		screenPositions_.resize(particles_.Size());
+		threadPool_->ParallelFor(particles_.Size(), kVerletGrainSize, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				screenPositions_[i] = TransformVector(particles_.GetPosition(uint32_t(i)), worldToScreen);
+			}
+		});
+		lineList.lines.reserve(lineList.lines.size() + lineIndices_.size() / 2);
+		for (size_t i = 0; i + 1 < lineIndices_.size(); i += 2) {
+			const Vector3& a = screenPositions_[lineIndices_[i]];
+			const Vector3& b = screenPositions_[lineIndices_[i + 1]];
+			lineList.Add(a.x, a.y, b.x, b.y, color);
+		}
+	}
+
+private:
+	/// <summary>
+	/// 拘束を色分けして色ごとに並べ替える(貪欲法)
+	/// 粒子ごとに使用済みの色をビットで持ち、両端の粒子が使っていない一番小さい色を選ぶ
+	/// 空いている色が無い拘束は色を付けずに最後へ並べ、並列にせず順番に解く
+	/// </summary>
+	void BuildBatches() {
+		MT3_PROFILE_SCOPE("VerletSolver::BuildBatches");
+		std::vector<uint64_t> usedColors(particles_.Size(), 0);
+		std::vector<uint32_t> colors(pendingA_.size());
+		// 最後の1つは色の無い拘束
+		std::vector<uint32_t> colorCounts(kVerletMaxColors + 1, 0);
+		uint32_t colorCount = 0;
+		for (size_t i = 0; i < pendingA_.size(); ++i) {
+			uint64_t used = usedColors[pendingA_[i]] | usedColors[pendingB_[i]];
+			uint32_t color = 0;
+			while (color < kVerletMaxColors && (used & (uint64_t(1) << color))) {
+				++color;
+			}
+			colors[i] = color;
+			++colorCounts[color];
+			if (color == kVerletMaxColors) { continue; }
+			usedColors[pendingA_[i]] |= uint64_t(1) << color;
+			usedColors[pendingB_[i]] |= uint64_t(1) << color;
+			colorCount = (std::max)(colorCount, color + 1);
+		}
+
+		// 色ごとに並べる(色の中では追加した順)、色の無い拘束は最後
+		constraints_.colorStarts.assign(colorCount + 1, 0);
+		for (uint32_t c = 0; c < colorCount; ++c) {
+			constraints_.colorStarts[c + 1] = constraints_.colorStarts[c] + colorCounts[c];
+		}
+		std::vector<uint32_t> cursor(constraints_.colorStarts.begin(), constraints_.colorStarts.end() - 1);
+		cursor.resize(kVerletMaxColors + 1, 0);
+		cursor[kVerletMaxColors] = constraints_.colorStarts.back();
+		constraints_.indexA.resize(pendingA_.size());
+		constraints_.indexB.resize(pendingA_.size());
+		constraints_.restLength.resize(pendingA_.size());
+		for (size_t i = 0; i < pendingA_.size(); ++i) {
+			uint32_t slot = cursor[colors[i]]++;
+			constraints_.indexA[slot] = pendingA_[i];
+			constraints_.indexB[slot] = pendingB_[i];
+			constraints_.restLength[slot] = pendingRestLength_[i];
+		}
+		isDirty_ = false;
+	}
+
+	// 慣性と重力で動かす
+	void Integrate(float deltaTime) {
+		MT3_PROFILE_SCOPE("VerletSolver::Integrate");
+		// 時間刻みによらず1秒あたりの減衰が同じになるようにする
+		const float keep = std::exp(-damping * deltaTime);
+		const Vector3 acceleration = Multiply(deltaTime * deltaTime, gravity);
+		VerletParticles& p = particles_;
+		threadPool_->ParallelFor(p.Size(), kVerletGrainSize, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				float x = p.x[i];
+				float y = p.y[i];
+				float z = p.z[i];
+				// 固定した粒子は速度を持たない
+				float scale = p.inverseMass[i] > 0.0f ? 1.0f : 0.0f;
+				p.x[i] += scale * ((x - p.previousX[i]) * keep + acceleration.x);
+				p.y[i] += scale * ((y - p.previousY[i]) * keep + acceleration.y);
+				p.z[i] += scale * ((z - p.previousZ[i]) * keep + acceleration.z);
+				p.previousX[i] = x;
+				p.previousY[i] = y;
+				p.previousZ[i] = z;
+			}
+		});
+	}
+
+	// 距離拘束 [begin, end) を順に解く
+	void SolveConstraintRange(size_t begin, size_t end) {
+		VerletParticles& p = particles_;
+		const DistanceConstraints& c = constraints_;
+		for (size_t k = begin; k < end; ++k) {
+			uint32_t a = c.indexA[k];
+			uint32_t b = c.indexB[k];
+			float weightA = p.inverseMass[a];
+			float weightB = p.inverseMass[b];
+			float weightSum = weightA + weightB;
+			if (weightSum <= 0.0f) { continue; }
+			float dx = p.x[b] - p.x[a];
+			float dy = p.y[b] - p.y[a];
+			float dz = p.z[b] - p.z[a];
+			float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+			if (length <= 0.0f) { continue; }
+			// 長さの差を質量の逆数の比で両端に配る
+			float correction = stiffness * (length - c.restLength[k]) / (length * weightSum);
+			p.x[a] += dx * correction * weightA;
+			p.y[a] += dy * correction * weightA;
+			p.z[a] += dz * correction * weightA;
+			p.x[b] -= dx * correction * weightB;
+			p.y[b] -= dy * correction * weightB;
+			p.z[b] -= dz * correction * weightB;
+		}
+	}
+
+	// 距離拘束を色ごとに並列に解き、色の無い拘束は最後に順番に解く
+	void SolveConstraints() {
+		MT3_PROFILE_SCOPE("VerletSolver::SolveConstraints");
+		const DistanceConstraints& c = constraints_;
+		for (uint32_t color = 0; color + 1 < c.colorStarts.size(); ++color) {
+			size_t first = c.colorStarts[color];
+			size_t count = c.colorStarts[color + 1] - first;
+			threadPool_->ParallelFor(count, kVerletGrainSize, [&](size_t begin, size_t end, uint32_t) {
+				SolveConstraintRange(first + begin, first + end);
+			});
+		}
+		if (!c.colorStarts.empty()) {
+			SolveConstraintRange(c.colorStarts.back(), c.Size());
+		}
+	}
+
+	// 図形の外へ押し出す(粒子ごとに独立なので並列)
+	void SolveCollisions() {
+		MT3_PROFILE_SCOPE("VerletSolver::SolveCollisions");
+		if (spheres_.empty() && planes_.empty() && aabbs_.empty() && !staticField_) { return; }
+		VerletParticles& p = particles_;
+		threadPool_->ParallelFor(p.Size(), kVerletGrainSize, [&](size_t begin, size_t end, uint32_t) {
+			for (size_t i = begin; i < end; ++i) {
+				if (p.inverseMass[i] <= 0.0f) { continue; }
+				Vector3 original = { p.x[i], p.y[i], p.z[i] };
+				Vector3 position = original;
+				for (const Sphere& sphere : spheres_) {
+					Vector3 difference = Subtract(position, sphere.center);
+					float distanceSquared = Dot(difference, difference);
+					if (distanceSquared < sphere.radius * sphere.radius && distanceSquared > 0.0f) {
+						position = Add(sphere.center, Multiply(sphere.radius / std::sqrt(distanceSquared), difference));
+					}
+				}
+				for (const Plane& plane : planes_) {
+					float distance = Dot(plane.normal, position) - plane.distance;
+					if (distance < 0.0f) {
+						position = Subtract(position, Multiply(distance, plane.normal));
+					}
+				}
+				for (const AABB& aabb : aabbs_) {
+					if (position.x <= aabb.min.x || position.x >= aabb.max.x ||
+						position.y <= aabb.min.y || position.y >= aabb.max.y ||
+						position.z <= aabb.min.z || position.z >= aabb.max.z) {
+						continue;
+					}
+					// 一番近い面へ押し出す
+					const float gaps[6] = {
+						position.x - aabb.min.x, aabb.max.x - position.x,
+						position.y - aabb.min.y, aabb.max.y - position.y,
+						position.z - aabb.min.z, aabb.max.z - position.z
+					};
+					int face = int(std::min_element(gaps, gaps + 6) - gaps);
+					switch (face) {
+					case 0: position.x = aabb.min.x; break;
+					case 1: position.x = aabb.max.x; break;
+					case 2: position.y = aabb.min.y; break;
+					case 3: position.y = aabb.max.y; break;
+					case 4: position.z = aabb.min.z; break;
+					default: position.z = aabb.max.z; break;
+					}
+				}
+				if (staticField_) {
+					Vector3 normal;
+					float distance = staticField_->GetDistance(position, normal);
+					if (distance < 0.0f) {
+						position = Subtract(position, Multiply(distance, normal));
+					}
+				}
+				if (position.x == original.x && position.y == original.y && position.z == original.z) { continue; }
+				p.x[i] = position.x;
+				p.y[i] = position.y;
+				p.z[i] = position.z;
+				// 当たった粒子は速度を減らす(1ステップ前の位置を近づける)
+				p.previousX[i] += (position.x - p.previousX[i]) * friction;
+				p.previousY[i] += (position.y - p.previousY[i]) * friction;
+				p.previousZ[i] += (position.z - p.previousZ[i]) * friction;
+			}
+		});
+	}
+
+	ThreadPool* threadPool_;
+	VerletParticles particles_;
+	DistanceConstraints constraints_;
+
+	// 色分け前の拘束(追加した順)
+	std::vector<uint32_t> pendingA_;
+	std::vector<uint32_t> pendingB_;
+	std::vector<float> pendingRestLength_;
+	bool isDirty_ = false;
+
+	std::vector<uint32_t> lineIndices_;		// 描画する拘束の両端(2つで1本)
+	std::vector<Vector3> screenPositions_;
+
+	std::vector<Sphere> spheres_;
+	std::vector<Plane> planes_;
+	std::vector<AABB> aabbs_;
+	const SignedDistanceField* staticField_ = nullptr;
+};
\ No newline at end of file
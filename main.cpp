@@ -1,86 +1,28 @@
 #include <Novice.h>
 #include "Matrix4x4.h"
+#include "Shape.h"
+#include "Collision.h"
+#include "StaticGeometry.h"
+#include "Curve.h"
+#include "DebugDraw.h"
+#include "FastMath.h"
+#include "FixedTimestep.h"
+#include "FrameArena.h"
+#include "FramePipeline.h"
+#include "Profiler.h"
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <algorithm>
 #include <imgui.h>
 const char kWindowTitle[] = "MT3";
 
-// 球
-struct Sphere {
-	Vector3 center;
-	float radius;
-};
-
-//  線分
-struct Segment {
-	Vector3 origin;
-	Vector3 diff;
-};
-
-// 直線
-struct Line {
-	Vector3 origin;
-	Vector3 diff;
-};
-
-// 半直線
-struct Ray {
-	Vector3 origin;
-	Vector3 diff;
-};
-
-// 平面
-struct Plane {
-	Vector3 normal; // 法線
-	float distance; // 距離
-};
-
-// 三角形
-struct Triangle {
-	Vector3 vertices[3];
-};
-
-// AABB
-struct AABB {
-	Vector3 min; // 最小点
-	Vector3 max; // 最大点
-};
-
-// OBB
-struct OBB {
-	Vector3 center; // 中心点
-	Vector3 orientations[3]; // 各軸の方向ベクトル
-	Vector3 size; // 各軸の長さの半分
-};
-
-Vector3 Project(const Vector3& v1, const  Vector3& v2);
-Vector3 ClosestPoint(const Vector3& point, const Segment& segment);
-Vector3 Lerp(const Vector3& v1, const Vector3& v2, float t);
-bool CheckCollision(const Sphere& sphere, const Plane& plane);
-bool CheckCollision(const Segment& segment, const Plane& plane);
-bool CheckCollision(const Line& line, const Plane& plane);
-bool CheckCollision(const Ray& ray, const Plane& plane);
-bool CheckCollision(const Triangle& triangle, const Segment& segment);
-bool CheckCollision(const Triangle& triangle, const Line& line);
-bool CheckCollision(const Triangle& triangle, const Ray& ray);
-bool CheckCollision(const AABB& aabb1, const AABB& aabb2);
-bool CheckCollision(const AABB& aabb, const Sphere& sphere);
-bool CheckCollision(const AABB& aabb, const Segment& segment);
-Vector3 Perpendicular(const Vector3& vector);
-
 // 表示用の関数
 static const int kColumnWidth = 60;
 static const int kRowHeight = 20;
 void VectorScreenPrintf(int x, int y, const Vector3& vector, const char* label);
 void MatrixScreenPrintf(int x, int y, const Matrix4x4& matrix, const char* label);
-void DrawSphere(const Sphere& sphere, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color);
-void DrawGrid(const Matrix4x4& viewProjectionMatrix, const Matrix4x4 viewportMatrix);
-void DrawPlane(const Plane& plane, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color);
-void DrawTriangle(const Triangle& triangle, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color);
-void DrawAABB(const AABB& aabb, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color);
-void DrawBezier(const Vector3& controlPoint0, const Vector3& controlPoint1, const Vector3& controlPoint2,
-	const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color);
+void SubmitLineList(const LineList& lineList);
+void DrawProfilerWindow();
 
 // Windowsアプリでのエントリーポイント(main関数)
 int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
@@ -95,9 +37,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	struct ConicalPendulum {
 		Vector3 anchor;
 		float length;
-		float halfApexAngle;	// 頂角の半分
-		float angle;
-		float angularVelocity;
+		float halfApexAngle;		// 頂角の半分(初期値)
+		float polarAngle;			// 鉛直からの角度
+		float polarVelocity;
+		float angle;				// 回転角
+		float angularMomentum;		// sin^2(polarAngle) * 回転の角速度(保存する)
+		float previousPolarAngle;	// 1ステップ前(描画の補間用)
+		float previousAngle;
 	};
 
 	// 変数の宣言
@@ -107,22 +53,78 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	Matrix4x4 viewProjectionMatrix = MakeViewProjectionMatrix(cameraTransform, float(kWindowWidth) / float(kWindowHeight));
 	Matrix4x4 viewportMatrix = MakeViewportMatrix(0, 0, float(kWindowWidth), float(kWindowHeight), 0.0f, 1.0f);
 
+	// 動かない図形は一度だけ登録し、カメラが動いたときだけ変換する(描画準備スレッドだけが触る)
+	StaticLineBuffer staticLines;
+	staticLines.AddGrid();
+
+	// 描画準備に渡す1フレーム分の状態
+	struct FrameSnapshot {
+		Matrix4x4 viewProjectionMatrix;
+		Vector3 anchor;
+		Vector3 point;
+		float lineTolerance;	// 線分をまとめる許容誤差(画素、負ならまとめない)
+	};
+
+	// スナップショットから描画する線分を作る(更新と並列に動く)
+	FramePipeline<FrameSnapshot> framePipeline([&staticLines, &viewportMatrix, kWindowWidth, kWindowHeight](const FrameSnapshot& snapshot, LineList& lineList) {
+		// グリッド
+		{
+			MT3_PROFILE_SCOPE("StaticLines");
+			staticLines.Update(Multiply(snapshot.viewProjectionMatrix, viewportMatrix));
+			staticLines.Submit([&lineList](int x0, int y0, int x1, int y1, uint32_t color) {
+				lineList.Add(float(x0), float(y0), float(x1), float(y1), color);
+			});
+		}
+
+		Vector3 pointScreen = TransformVector(TransformVector(snapshot.point, snapshot.viewProjectionMatrix), viewportMatrix);
+		// 球
+		DrawSphere(lineList, { snapshot.point, 0.05f }, snapshot.viewProjectionMatrix, viewportMatrix, WHITE);
+
+		// 振り子の線
+		Vector3 anchorScreen = TransformVector(TransformVector(snapshot.anchor, snapshot.viewProjectionMatrix), viewportMatrix);
+		lineList.Add(anchorScreen.x, anchorScreen.y, pointScreen.x, pointScreen.y, WHITE);
+
+		lineList.CullOutside(float(kWindowWidth), float(kWindowHeight));
+		if (snapshot.lineTolerance >= 0.0f) {
+			lineList.Simplify(snapshot.lineTolerance);
+		}
+	});
+
 	ConicalPendulum conicalPendulum;
 	conicalPendulum.anchor = { 0.0f,1.0f,0.0f };
 	conicalPendulum.length = 0.8f;
 	conicalPendulum.halfApexAngle = 0.7f;
+	// 円錐振り子になる角速度から始める
+	float apexSin, apexCos;
+	SinCos(conicalPendulum.halfApexAngle, apexSin, apexCos);
+	conicalPendulum.polarAngle = conicalPendulum.halfApexAngle;
+	conicalPendulum.polarVelocity = 0.0f;
 	conicalPendulum.angle = 0.0f;
-	conicalPendulum.angularVelocity = 0.0f;
-	float radius = std::sin(conicalPendulum.halfApexAngle) * conicalPendulum.length;
-	float height = std::cos(conicalPendulum.halfApexAngle) * conicalPendulum.length;
-	Vector3 point = { radius,0.0f,0.0f };
+	conicalPendulum.angularMomentum = apexSin * apexSin * std::sqrtf(9.8f / (conicalPendulum.length * apexCos));
+	conicalPendulum.previousPolarAngle = conicalPendulum.polarAngle;
+	conicalPendulum.previousAngle = conicalPendulum.angle;
+	// 球面振り子の鉛直からの角度の加速度(角運動量が保存するので角度だけで決まる)
+	auto pendulumAcceleration = [&conicalPendulum](float polarAngle, float) {
+		float polarSin, polarCos;
+		SinCos(polarAngle, polarSin, polarCos);
+		float momentum = conicalPendulum.angularMomentum;
+		return momentum * momentum * polarCos / (polarSin * polarSin * polarSin) - 9.8f / conicalPendulum.length * polarSin;
+	};
+	Vector3 point = { 0.0f,0.0f,0.0f };
 	bool isMove = false;
-	float deltaTime = 1.0f / 60.0f;
+
+	// シミュレーションは描画と別の固定刻みで進める
+	int simulationHz = 30;
+	int integratorIndex = int(Integrator::RungeKutta4);
+	FixedTimestep fixedTimestep(1.0f / float(simulationHz));
+	FrameTimer frameTimer;
+	float lineTolerance = 0.5f;
 
 	// ウィンドウの×ボタンが押されるまでループ
 	while (Novice::ProcessMessage() == 0) {
 		// フレームの開始
 		Novice::BeginFrame();
+		ProfilerBeginFrame();
 
 		// キー入力を受け取る
 		memcpy(preKeys, keys, 256);
@@ -132,20 +134,31 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		/// ↓更新処理ここから
 		///
 		
-		if (isMove) {
-			
-			// 角速度を求める
-			conicalPendulum.angularVelocity = std::sqrtf(9.8f / (conicalPendulum.length * std::cos(conicalPendulum.halfApexAngle)));
-
-			// 速度から角度を求める
-			conicalPendulum.angle += conicalPendulum.angularVelocity * deltaTime;
-
-			radius = std::sin(conicalPendulum.halfApexAngle) * conicalPendulum.length;
-			height = std::cos(conicalPendulum.halfApexAngle) * conicalPendulum.length;
-
-			point.x = conicalPendulum.anchor.x + std::cos(conicalPendulum.angle) * radius;
+		// 止めている間は時間を貯めない
+		float frameTime = frameTimer.Tick();
+		uint32_t stepCount = fixedTimestep.Advance(isMove ? frameTime : 0.0f);
+		{
+			MT3_PROFILE_SCOPE("UpdatePendulum");
+			for (uint32_t step = 0; step < stepCount; ++step) {
+				conicalPendulum.previousPolarAngle = conicalPendulum.polarAngle;
+				conicalPendulum.previousAngle = conicalPendulum.angle;
+				Integrate(Integrator(integratorIndex), conicalPendulum.polarAngle, conicalPendulum.polarVelocity, fixedTimestep.GetStepTime(), pendulumAcceleration);
+				// 回転角は角運動量から(ステップの中点の角度で求める)
+				float middleSin, middleCos;
+				SinCos(0.5f * (conicalPendulum.previousPolarAngle + conicalPendulum.polarAngle), middleSin, middleCos);
+				conicalPendulum.angle += conicalPendulum.angularMomentum / (middleSin * middleSin) * fixedTimestep.GetStepTime();
+			}
+
+			// 前後のステップの間を補間して位置を求める
+			float alpha = fixedTimestep.GetAlpha();
+			float polarSin, polarCos, angleSin, angleCos;
+			SinCos(Interpolate(conicalPendulum.previousPolarAngle, conicalPendulum.polarAngle, alpha), polarSin, polarCos);
+			SinCos(Interpolate(conicalPendulum.previousAngle, conicalPendulum.angle, alpha), angleSin, angleCos);
+			float radius = polarSin * conicalPendulum.length;
+			float height = polarCos * conicalPendulum.length;
+			point.x = conicalPendulum.anchor.x + angleCos * radius;
 			point.y = conicalPendulum.anchor.y - height;
-			point.z = conicalPendulum.anchor.z - std::sin(conicalPendulum.angle) * radius;
+			point.z = conicalPendulum.anchor.z - angleSin * radius;
 		}
 
 		ImGui::Begin("Window");
@@ -156,6 +169,11 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		if (isMove && ImGui::Button("Stop")) {
 			isMove = false;
 		}
+		ImGui::Combo("Integrator", &integratorIndex, kIntegratorNames, IM_ARRAYSIZE(kIntegratorNames));
+		if (ImGui::SliderInt("Simulation Hz", &simulationHz, 15, 240)) {
+			fixedTimestep.SetStepTime(1.0f / float(simulationHz));
+		}
+		ImGui::SliderFloat("Line Tolerance", &lineTolerance, -1.0f, 2.0f);
 
 		// デバッグ用カメラ操作
 		ImGuiIO& io = ImGui::GetIO();
@@ -190,6 +208,7 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		}
 		ImGui::End();
 		
+		DrawProfilerWindow();
 
 		///
 		/// ↑更新処理ここまで
@@ -200,24 +219,30 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		///
 
 		// ビューx射影行列の作成
-		viewProjectionMatrix = MakeViewProjectionMatrix(cameraTransform, float(kWindowWidth) / float(kWindowHeight));
-
-		DrawGrid(viewProjectionMatrix, viewportMatrix);
-
-		Vector3 pointScreen = TransformVector(TransformVector(point, viewProjectionMatrix), viewportMatrix);
-		// 球
-		DrawSphere({ point, 0.05f }, viewProjectionMatrix, viewportMatrix, WHITE);
+		{
+			MT3_PROFILE_SCOPE("MakeViewProjectionMatrix");
+			viewProjectionMatrix = MakeViewProjectionMatrix(cameraTransform, float(kWindowWidth) / float(kWindowHeight));
+		}
 
-		// 振り子の線
-		Vector3 anchorScreen = TransformVector(TransformVector(conicalPendulum.anchor, viewProjectionMatrix), viewportMatrix);
-		Novice::DrawLine(int(anchorScreen.x), int(anchorScreen.y), int(pointScreen.x), int(pointScreen.y), WHITE);
+		// 描画準備スレッドへ渡し、1フレーム前に渡した分の線分をまとめて描画
+		FrameSnapshot& snapshot = framePipeline.GetSnapshot();
+		snapshot.viewProjectionMatrix = viewProjectionMatrix;
+		snapshot.anchor = conicalPendulum.anchor;
+		snapshot.point = point;
+		snapshot.lineTolerance = lineTolerance;
+		SubmitLineList(framePipeline.Submit());
 
 		///
 		/// ↑描画処理ここまで
 		///
 
 		// フレームの終了
-		Novice::EndFrame();
+		{
+			MT3_PROFILE_SCOPE("EndFrame");
+			Novice::EndFrame();
+		}
+		ProfilerEndFrame();
+		FrameArenaEndFrame();
 
 		// ESCキーが押されたらループを抜ける
 		if (preKeys[DIK_ESCAPE] == 0 && keys[DIK_ESCAPE] != 0) {
@@ -230,382 +255,14 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	return 0;
 }
 
-// 正射影ベクトル
-Vector3 Project(const Vector3& v1, const Vector3& v2) {
-	return Multiply(Dot(v1, Normalize(v2)), Normalize(v2));
-}
-
-// 最近接点
-Vector3 ClosestPoint(const Vector3& point, const Segment& segment) {
-	return Add(segment.origin, Project(Subtract(point, segment.origin), segment.diff));
-}
-
-// 球と平面の衝突判定
-bool CheckCollision(const Sphere& sphere, const Plane& plane) {
-	// 平面と点の距離
-	float k = fabs(Dot(plane.normal, sphere.center) - plane.distance); // 符号なし
-
-	// 半径より距離が小さければ衝突
-	return k <= sphere.radius;
-}
-
-// 線分と平面の衝突判定
-bool CheckCollision(const Segment& segment, const Plane& plane) {
-	// 法線と線の内積
-	float dot = Dot(plane.normal, segment.diff);
-	if (dot == 0.0f) { return false; } // 平行な場合衝突しない
-
-	float t = (plane.distance - Dot(segment.origin, plane.normal)) / dot;
-	if (0 <= t && t <= 1) { // 線分の範囲内なら衝突
-		return true;
-	}
-	return false;
-}
-
-// 直線と平面の衝突判定
-bool CheckCollision(const Line& line, const Plane& plane) {
-	// 法線と線の内積
-	float dot = Dot(plane.normal, line.diff);
-	if (dot == 0.0f) { return false; } // 平行な場合衝突しない
-
-	// 平行でなければどこかで衝突する
-	return true;
-}
-
-// 半直線と平面の衝突判定
-bool CheckCollision(const Ray& ray, const Plane& plane) {
-	// 法線と線の内積
-	float dot = Dot(plane.normal, ray.diff);
-	if (dot == 0.0f) { return false; } // 平行な場合衝突しない
-
-	float t = (plane.distance - Dot(ray.origin, plane.normal)) / dot;
-	if (t >= 0) {
-		return true;
-	}
-	return false;
-}
-
-// 三角形と線分の衝突判定
-bool CheckCollision(const Triangle& triangle, const Segment& segment) {
-	// 三角形から平面を求める
-	Plane plane;
-	Vector3 v1 = Subtract(triangle.vertices[1], triangle.vertices[0]);
-	Vector3 v2 = Subtract(triangle.vertices[2], triangle.vertices[1]);
-	plane.normal = Normalize(Cross(v1, v2)); // 法線
-	plane.distance = Dot(triangle.vertices[0], plane.normal); // 平面の距離
-
-	// 衝突点
-	float t = (plane.distance - Dot(segment.origin, plane.normal)) / Dot(segment.diff, plane.normal);
-	if (0 <= t && t <= 1) { // 線分の範囲内かチェック
-		Vector3 p = Add(segment.origin, Multiply(t, segment.diff));
-
-		// 衝突点が三角形の内側かどうかを求める
-		Vector3 cross01 = Cross(Subtract(triangle.vertices[1], triangle.vertices[0]), Subtract(p, triangle.vertices[1]));
-		Vector3 cross12 = Cross(Subtract(triangle.vertices[2], triangle.vertices[1]), Subtract(p, triangle.vertices[2]));
-		Vector3 cross20 = Cross(Subtract(triangle.vertices[0], triangle.vertices[2]), Subtract(p, triangle.vertices[0]));
-		// すべての小三角形のクロス積と法線が同じ向きなら衝突
-		if (Dot(cross01, plane.normal) >= 0.0f &&
-			Dot(cross12, plane.normal) >= 0.0f &&
-			Dot(cross20, plane.normal) >= 0.0f) {
-			return true;
-		}
-	}
-
-	return false;
-}
-
-// 三角形と直線の衝突判定
-bool CheckCollision(const Triangle& triangle, const Line& line) {
-	// 三角形から平面を求める
-	Plane plane;
-	Vector3 v1 = Subtract(triangle.vertices[1], triangle.vertices[0]);
-	Vector3 v2 = Subtract(triangle.vertices[2], triangle.vertices[1]);
-	plane.normal = Normalize(Cross(v1, v2)); // 法線
-	plane.distance = Dot(triangle.vertices[0], plane.normal); // 平面の距離
-
-	// 衝突点
-	float t = (plane.distance - Dot(line.origin, plane.normal)) / Dot(line.diff, plane.normal);
-	Vector3 p = Add(line.origin, Multiply(t, line.diff));
-
-	// 衝突点が三角形の内側かどうかを求める
-	Vector3 cross01 = Cross(Subtract(triangle.vertices[1], triangle.vertices[0]), Subtract(p, triangle.vertices[1]));
-	Vector3 cross12 = Cross(Subtract(triangle.vertices[2], triangle.vertices[1]), Subtract(p, triangle.vertices[2]));
-	Vector3 cross20 = Cross(Subtract(triangle.vertices[0], triangle.vertices[2]), Subtract(p, triangle.vertices[0]));
-	// すべての小三角形のクロス積と法線が同じ向きなら衝突
-	if (Dot(cross01, plane.normal) >= 0.0f &&
-		Dot(cross12, plane.normal) >= 0.0f &&
-		Dot(cross20, plane.normal) >= 0.0f) {
-		return true;
-	}
-	return false;
-}
-
-// 三角形と半直線の衝突判定
-bool CheckCollision(const Triangle& triangle, const Ray& ray) {
-	// 三角形から平面を求める
-	Plane plane;
-	Vector3 v1 = Subtract(triangle.vertices[1], triangle.vertices[0]);
-	Vector3 v2 = Subtract(triangle.vertices[2], triangle.vertices[1]);
-	plane.normal = Normalize(Cross(v1, v2)); // 法線
-	plane.distance = Dot(triangle.vertices[0], plane.normal); // 平面の距離
-
-	// 衝突点
-	float t = (plane.distance - Dot(ray.origin, plane.normal)) / Dot(ray.diff, plane.normal);
-	if (t >= 0) { // 半直線の範囲内かチェック
-		Vector3 p = Add(ray.origin, Multiply(t, ray.diff));
-
-		// 衝突点が三角形の内側かどうかを求める
-		Vector3 cross01 = Cross(Subtract(triangle.vertices[1], triangle.vertices[0]), Subtract(p, triangle.vertices[1]));
-		Vector3 cross12 = Cross(Subtract(triangle.vertices[2], triangle.vertices[1]), Subtract(p, triangle.vertices[2]));
-		Vector3 cross20 = Cross(Subtract(triangle.vertices[0], triangle.vertices[2]), Subtract(p, triangle.vertices[0]));
-		// すべての小三角形のクロス積と法線が同じ向きなら衝突
-		if (Dot(cross01, plane.normal) >= 0.0f &&
-			Dot(cross12, plane.normal) >= 0.0f &&
-			Dot(cross20, plane.normal) >= 0.0f) {
-			return true;
-		}
-	}
-	return false;
-}
-
-// AABB同士の衝突判定
-bool CheckCollision(const AABB& aabb1, const AABB& aabb2) {
-	if ((aabb1.min.x <= aabb2.max.x && aabb1.max.x >= aabb2.min.x) && // x軸
-		(aabb1.min.y <= aabb2.max.y && aabb1.max.y >= aabb2.min.y) && // y軸
-		(aabb1.min.z <= aabb2.max.z && aabb1.max.z >= aabb2.min.z)) {
-		return true;
-	}
-	return false;
-}
-
-// AABBと球の衝突判定
-bool CheckCollision(const AABB& aabb, const Sphere& sphere) {
-	// 最近接点を求める
-	Vector3 closestPoint = {
-		std::clamp(sphere.center.x, aabb.min.x, aabb.max.x),
-		std::clamp(sphere.center.y, aabb.min.y, aabb.max.y),
-		std::clamp(sphere.center.z, aabb.min.z, aabb.max.z),
-	};
-	// 最近接点と球の中心の距離を求める
-	float distance = Length(Subtract(closestPoint, sphere.center));
-	// 距離が半径よりも小さければ衝突
-	if (distance <= sphere.radius) {
-		return true;
-	}
-	return false;
-}
-
-bool CheckCollision(const AABB& aabb, const Segment& segment) {
-	// 各平面の媒介変数を求める
-	Vector3 tMin = {
-		(aabb.min.x - segment.origin.x) / segment.diff.x,
-		(aabb.min.y - segment.origin.y) / segment.diff.y,
-		(aabb.min.z - segment.origin.z) / segment.diff.z
-	};
-	Vector3 tMax = {
-		(aabb.max.x - segment.origin.x) / segment.diff.x,
-		(aabb.max.y - segment.origin.y) / segment.diff.y,
-		(aabb.max.z - segment.origin.z) / segment.diff.z
-	};
-
-	Vector3 tNear = {
-		min(tMin.x, tMax.x),
-		min(tMin.y, tMax.y),
-		min(tMin.z, tMax.z)
-	};
-	Vector3 tFar = {
-		max(tMin.x, tMax.x),
-		max(tMin.y, tMax.y),
-		max(tMin.z, tMax.z)
-	};
-
-	// 衝突(貫通)している点
-	float min = max(max(tNear.x, tNear.y), tNear.z);
-	float max = min(min(tFar.x, tFar.y), tFar.z);
-
-	// 線分の範囲と衝突しているか
-	if (min <= max && (0.0f <= max && min <= 1.0f)) {
-
-		// 衝突
-		return true;
-	}
-
-	return false;
-}
-
-// AABBと直線の衝突判定
-bool CheckCollision(const AABB& aabb, const Line& line) {
-	// 各平面の媒介変数を求める
-	Vector3 tMin = {
-		(aabb.min.x - line.origin.x) / line.diff.x,
-		(aabb.min.y - line.origin.y) / line.diff.y,
-		(aabb.min.z - line.origin.z) / line.diff.z
-	};
-	Vector3 tMax = {
-		(aabb.max.x - line.origin.x) / line.diff.x,
-		(aabb.max.y - line.origin.y) / line.diff.y,
-		(aabb.max.z - line.origin.z) / line.diff.z
-	};
-
-	Vector3 tNear = {
-		min(tMin.x, tMax.x),
-		min(tMin.y, tMax.y),
-		min(tMin.z, tMax.z)
-	};
-	Vector3 tFar = {
-		max(tMin.x, tMax.x),
-		max(tMin.y, tMax.y),
-		max(tMin.z, tMax.z)
-	};
-
-	// 衝突(貫通)している点
-	float min = max(max(tNear.x, tNear.y), tNear.z);
-	float max = min(min(tFar.x, tFar.y), tFar.z);
-
-	// 直線の範囲と衝突しているか
-	if (min <= max) {
-
-		// 衝突
-		return true;
-	}
-
-	return false;
-}
-
-// AABBと半直線の衝突判定
-bool CheckCollision(const AABB& aabb, const Ray& ray) {
-	// 各平面の媒介変数を求める
-	Vector3 tMin = {
-		(aabb.min.x - ray.origin.x) / ray.diff.x,
-		(aabb.min.y - ray.origin.y) / ray.diff.y,
-		(aabb.min.z - ray.origin.z) / ray.diff.z
-	};
-	Vector3 tMax = {
-		(aabb.max.x - ray.origin.x) / ray.diff.x,
-		(aabb.max.y - ray.origin.y) / ray.diff.y,
-		(aabb.max.z - ray.origin.z) / ray.diff.z
-	};
-
-	Vector3 tNear = {
-		min(tMin.x, tMax.x),
-		min(tMin.y, tMax.y),
-		min(tMin.z, tMax.z)
-	};
-	Vector3 tFar = {
-		max(tMin.x, tMax.x),
-		max(tMin.y, tMax.y),
-		max(tMin.z, tMax.z)
-	};
-
-	// 衝突(貫通)している点
-	float min = max(max(tNear.x, tNear.y), tNear.z);
-	float max = min(min(tFar.x, tFar.y), tFar.z);
-
-	// 半直線の範囲と衝突しているか
-	if (min <= max && 0.0f <= max) {
-
-		// 衝突
-		return true;
-	}
-
-	return false;
-}
-
-// 垂直ベクトルを求める
-Vector3 Perpendicular(const Vector3& vector) {
-	if (vector.x != 0.0f || vector.y != 0.0f) {
-		return { -vector.y,vector.x,0.0f };
-	}
-	return { 0.0f,-vector.z,vector.y };
-}
-
-// 平面描画
-void DrawPlane(const Plane& plane, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
-	Vector3 center = Multiply(plane.distance, plane.normal);
-	Vector3 perpendiculars[4];
-	perpendiculars[0] = Normalize(Perpendicular(plane.normal)); // 法線と垂直なベクトル
-	perpendiculars[1] = { -perpendiculars[0].x,-perpendiculars[0].y, -perpendiculars[0].z }; // の逆ベクトル
-	perpendiculars[2] = Cross(plane.normal, perpendiculars[0]); // 法線と、垂直ベクトルのクロス積
-	perpendiculars[3] = { -perpendiculars[2].x,-perpendiculars[2].y, -perpendiculars[2].z }; // の逆ベクトル
-	Vector3 points[4];
-	// 頂点を求める
-	for (int32_t index = 0; index < 4; ++index) {
-		Vector3 extend = Multiply(2.0f, perpendiculars[index]);
-		Vector3 point = Add(center, extend);
-		points[index] = TransformVector(TransformVector(point, viewProjectionMatrix), viewportMatrix);
-	}
-	// 描画
-	Novice::DrawLine(int(points[0].x), int(points[0].y), int(points[2].x), int(points[2].y), color);
-	Novice::DrawLine(int(points[2].x), int(points[2].y), int(points[1].x), int(points[1].y), color);
-	Novice::DrawLine(int(points[1].x), int(points[1].y), int(points[3].x), int(points[3].y), color);
-	Novice::DrawLine(int(points[3].x), int(points[3].y), int(points[0].x), int(points[0].y), color);
-}
-
-// 三角形描画
-void DrawTriangle(const Triangle& triangle, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
-	Vector3 points[3];
-	// 頂点を求める
-	for (int32_t index = 0; index < 3; ++index) {
-		Vector3 point = TransformVector(TransformVector(triangle.vertices[index], viewProjectionMatrix), viewportMatrix);
-		points[index] = point;
-	}
-	// 描画
-	Novice::DrawLine(int(points[0].x), int(points[0].y), int(points[1].x), int(points[1].y), color);
-	Novice::DrawLine(int(points[1].x), int(points[1].y), int(points[2].x), int(points[2].y), color);
-	Novice::DrawLine(int(points[2].x), int(points[2].y), int(points[0].x), int(points[0].y), color);
-}
-
-// AABB描画
-void DrawAABB(const AABB& aabb, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
-	Vector3 points[8];
-	// 頂点を求める
-	points[0] = { aabb.min.x, aabb.min.y, aabb.min.z };
-	points[1] = { aabb.max.x, aabb.min.y, aabb.min.z };
-	points[2] = { aabb.min.x, aabb.max.y, aabb.min.z };
-	points[3] = { aabb.max.x, aabb.max.y, aabb.min.z };
-	points[4] = { aabb.min.x, aabb.min.y, aabb.max.z };
-	points[5] = { aabb.max.x, aabb.min.y, aabb.max.z };
-	points[6] = { aabb.min.x, aabb.max.y, aabb.max.z };
-	points[7] = { aabb.max.x, aabb.max.y, aabb.max.z };
-
-	// スクリーン座標に変換
-	for (int32_t index = 0; index < 8; ++index) {
-		Vector3 point = TransformVector(TransformVector(points[index], viewProjectionMatrix), viewportMatrix);
-		points[index] = point;
-	}
-
-	// 辺
-	static const int edge[12][2] = {
-		{0,1},{1,3},{3,2},{2,0}, // 下面
-		{4,5},{5,7},{7,6},{6,4}, // 上面
-		{0,4},{1,5},{2,6},{3,7}  // 側面
-	};
-
-	// 辺を描画
-	for (int i = 0; i < 12; ++i) {
-		const Vector3& p0 = points[edge[i][0]];
-		const Vector3& p1 = points[edge[i][1]];
-		Novice::DrawLine(int(p0.x), int(p0.y), int(p1.x), int(p1.y), color);
-	}
-}
-
-// 2次ベジェ曲線描画
-void DrawBezier(const Vector3& controlPoint0, const Vector3& controlPoint1, const Vector3& controlPoint2, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
-	float t = 0.0f;
-	const int kSubdivision = 32; // 分割数
-	Vector3 p = controlPoint0;
-	for (int i = 0; i < kSubdivision; ++i) {
-		t = float(i + 1) / float(kSubdivision);
-		Vector3 p0p1 = Lerp(controlPoint0, controlPoint1, t); // 制御点0,1を線形補間
-		Vector3 p1p2 = Lerp(controlPoint1, controlPoint2, t); // 制御点1,2を線形補間
-		Vector3 preP = p;
-		p = Lerp(p0p1, p1p2, t); // 二つの点を線形補間
-
-		// スクリーン座標へ変換
-		Vector3 screenPoint0 = TransformVector(TransformVector(preP, viewProjectionMatrix), viewportMatrix);
-		Vector3 screenPoint1 = TransformVector(TransformVector(p, viewProjectionMatrix), viewportMatrix);
-
-		Novice::DrawLine(int(screenPoint0.x), int(screenPoint0.y), int(screenPoint1.x), int(screenPoint1.y), color);
+/// <summary>
+/// 線分リストをNoviceで描画
+/// </summary>
+/// <param name="lineList">描画する線分</param>
+void SubmitLineList(const LineList& lineList) {
+	MT3_PROFILE_SCOPE("SubmitLineList");
+	for (const ScreenLine& line : lineList.lines) {
+		Novice::DrawLine(int(line.x0), int(line.y0), int(line.x1), int(line.y1), line.color);
 	}
 }
 
@@ -641,82 +298,27 @@ void MatrixScreenPrintf(int x, int y, const Matrix4x4& matrix, const char* label
 }
 
 /// <summary>
-/// グリッド描画
+/// プロファイラの計測結果を表示
 /// </summary>
-/// <param name="viewProjectionMatrix">ビューx射影行列</param>
-/// <param name="viewportMatrix">ビューポート行列</param>
-void DrawGrid(const Matrix4x4& viewProjectionMatrix, const Matrix4x4 viewportMatrix) {
-	const float kGridHalfWidth = 2.0f;	// 半分の幅
-	const uint32_t kSubdivision = 10;	// 分割数
-	const float kGridEvery = (kGridHalfWidth * 2.0f) / float(kSubdivision);	// 1つ分の長さ
-	Matrix4x4 screenTransformMatrix = Multiply(viewProjectionMatrix, viewportMatrix);
-
-	// 奥から手前への線を順々に引いていく
-	for (uint32_t xIndex = 0; xIndex <= kSubdivision; ++xIndex) {
-		// ワールド座標系上の始点と終点を求める
-		Vector3 start = { -kGridHalfWidth + kGridEvery * xIndex, 0.0f, -kGridHalfWidth };
-		Vector3 end = { -kGridHalfWidth + kGridEvery * xIndex, 0.0f, kGridHalfWidth };
-		// 座標変換
-		Vector3 startScreen = TransformVector(start, screenTransformMatrix);
-		Vector3 endScreen = TransformVector(end, screenTransformMatrix);
-		// 変換した座標を使って表示
-		Novice::DrawLine(int(startScreen.x), int(startScreen.y),
-			int(endScreen.x), int(endScreen.y), 0xAAAAAAFF);
+void DrawProfilerWindow() {
+	ImGui::Begin("Profiler");
+	ImGui::Text("Frame %.3f ms", GetProfilerFrameMilliseconds());
+	ImGui::Text("Dropped events %llu", static_cast<unsigned long long>(GetProfilerDroppedEventCount()));
+	ImGui::Separator();
+	ImGui::Text("%-32s %8s %8s %8s %6s", "Scope", "ms", "avg", "max", "calls");
+	for (const ProfileScopeStat& stat : GetProfileScopeStats()) {
+		ImGui::Text("%-32s %8.3f %8.3f %8.3f %6u", stat.name,
+			stat.lastMilliseconds, stat.averageMilliseconds, stat.maxMilliseconds, stat.callCount);
 	}
-
-	// 左から右への線
-	for (uint32_t zIndex = 0; zIndex <= kSubdivision; ++zIndex) {
-		// ワールド座標系上の始点と終点を求める
-		Vector3 start = { -kGridHalfWidth, 0.0f, -kGridHalfWidth + kGridEvery * zIndex };
-		Vector3 end = { kGridHalfWidth, 0.0f, -kGridHalfWidth + kGridEvery * zIndex };
-		// 座標変換
-		Vector3 startScreen = TransformVector(start, screenTransformMatrix);
-		Vector3 endScreen = TransformVector(end, screenTransformMatrix);
-		// 変換した座標を使って表示
-		Novice::DrawLine(int(startScreen.x), int(startScreen.y),
-			int(endScreen.x), int(endScreen.y), 0xAAAAAAFF);
+	ImGui::Separator();
+	FrameArenaReport arenaReport = GetFrameArenaReport();
+	ImGui::Text("Frame arena: %zu KB used, %zu KB peak, %zu KB reserved, %zu heap allocs (%u threads)",
+		arenaReport.lastUsedBytes / 1024, arenaReport.highWaterBytes / 1024, arenaReport.capacityBytes / 1024,
+		arenaReport.heapAllocationCount, arenaReport.threadCount);
+	ImGui::Separator();
+	// chrome://tracing で開けるJSONを書き出す
+	if (ImGui::Button("Export Chrome Trace")) {
+		ExportChromeTrace("profile_trace.json");
 	}
-}
-
-/// <summary>
-/// 球の描画
-/// </summary>
-/// <param name="sphere">球</param>
-/// <param name="viewProjectionMatrix">ビューx射影行列</param>
-/// <param name="viewportMatrix">ビューポート行列</param>
-/// <param name="color">色</param>
-void DrawSphere(const Sphere& sphere, const Matrix4x4& viewProjectionMatrix, const Matrix4x4& viewportMatrix, uint32_t color) {
-	const uint32_t kSubdivision = 20;						// 分割数
-	const float kLonEvery = float(M_PI) * 2.0f / kSubdivision;		// 経度分割1つ分の角度
-	const float kLatEvery = float(M_PI) / kSubdivision;			// 緯度分割1つ分の角度
-	Matrix4x4 screenTransformMatrix = Multiply(viewProjectionMatrix, viewportMatrix);
-
-	// 緯度の方向に分割 -π/2 ~ π/2
-	for (uint32_t latIndex = 0; latIndex < kSubdivision; ++latIndex) {
-		float lat = -float(M_PI) / 2.0f + kLatEvery * latIndex;	// 現在の緯度
-		// 経度の方向に分割 0 ~ 2π
-		for (uint32_t lonIndex = 0; lonIndex < kSubdivision; ++lonIndex) {
-			float lon = lonIndex * kLonEvery;	// 現在の経度
-
-			// world座標系でのa,b,cを求める
-			Vector3 a, b, c;
-			a = Add(sphere.center,
-				Multiply(sphere.radius,
-					{ cos(lat) * cos(lon), sin(lat), cos(lat) * sin(lon) }));
-			b = Add(sphere.center,
-				Multiply(sphere.radius,
-					{ cos(lat + kLatEvery) * cos(lon), sin(lat + kLatEvery), cos(lat + kLatEvery) * sin(lon) }));
-			c = Add(sphere.center,
-				Multiply(sphere.radius,
-					{ cos(lat) * cos(lon + kLonEvery), sin(lat), cos(lat) * sin(lon + kLonEvery) }));
-
-			// a,b,cをScreen座標系に変換
-			Vector3 aScreen = TransformVector(a, screenTransformMatrix);
-			Vector3 bScreen = TransformVector(b, screenTransformMatrix);
-			Vector3 cScreen = TransformVector(c, screenTransformMatrix);
-			// 画面に描画
-			Novice::DrawLine(int(aScreen.x), int(aScreen.y), int(bScreen.x), int(bScreen.y), color);
-			Novice::DrawLine(int(aScreen.x), int(aScreen.y), int(cScreen.x), int(cScreen.y), color);
-		}
-	}
-}
+	ImGui::End();
+}
\ No newline at end of file